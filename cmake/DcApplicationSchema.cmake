@@ -0,0 +1,39 @@
+# Generates the perfect hash indexes for a settings schema and adds them to a target.
+#
+#   dc_application_schema_index(TARGET app NAME app_settings SCHEMA APP_SCHEMA HEADER app_schema.h)
+#
+# HEADER defines the SCHEMA macro and is found through the include directories of TARGET. The generated
+# <NAME>_index.h goes in the binary directory, which is added to the include directories of TARGET, and has to be
+# included before DC_SCHEMA_DEFINE_INDEXED(NAME, SCHEMA, prefix).
+
+set(DC_APPLICATION_SCHEMA_INDEX_SOURCE ${CMAKE_CURRENT_LIST_DIR}/../tools/schema_index.c)
+
+if (NOT EXISTS ${DC_APPLICATION_SCHEMA_INDEX_SOURCE})
+    # installed layout
+    set(DC_APPLICATION_SCHEMA_INDEX_SOURCE ${CMAKE_CURRENT_LIST_DIR}/schema_index.c)
+endif ()
+
+function(dc_application_schema_index)
+    cmake_parse_arguments(ARG "" "TARGET;NAME;SCHEMA;HEADER" "" ${ARGN})
+
+    set(GENERATOR ${ARG_NAME}_schema_index)
+    set(OUTPUT_DIR ${CMAKE_CURRENT_BINARY_DIR}/${ARG_NAME}_index)
+    set(OUTPUT ${OUTPUT_DIR}/${ARG_NAME}_index.h)
+
+    add_executable(${GENERATOR} ${DC_APPLICATION_SCHEMA_INDEX_SOURCE})
+    target_compile_definitions(${GENERATOR} PRIVATE
+            DC_SCHEMA_HEADER="${ARG_HEADER}"
+            DC_SCHEMA=${ARG_SCHEMA}
+            DC_SCHEMA_NAME=${ARG_NAME})
+    target_include_directories(${GENERATOR} PRIVATE $<TARGET_PROPERTY:${ARG_TARGET},INCLUDE_DIRECTORIES>)
+    set_target_properties(${GENERATOR} PROPERTIES C_CLANG_TIDY "")
+
+    add_custom_command(OUTPUT ${OUTPUT}
+            COMMAND ${CMAKE_COMMAND} -E make_directory ${OUTPUT_DIR}
+            COMMAND ${GENERATOR} ${OUTPUT}
+            DEPENDS ${GENERATOR}
+            COMMENT "Generating the settings indexes for ${ARG_NAME}")
+
+    target_sources(${ARG_TARGET} PRIVATE ${OUTPUT})
+    target_include_directories(${ARG_TARGET} PRIVATE ${OUTPUT_DIR})
+endfunction()
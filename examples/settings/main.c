@@ -3,25 +3,19 @@
 #include <dc_application/defaults.h>
 #include <dc_application/environment.h>
 #include <dc_application/options.h>
-#include <dc_posix/dc_stdlib.h>
-#include <dc_posix/dc_string.h>
-#include <getopt.h>
+#include <dc_application/schema.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 
-struct application_settings
-{
-    struct dc_opt_settings opts;
-    struct dc_setting_string *message;
-};
+#define APPLICATION_SCHEMA(X, S)                                                                                           \
+    X(S, config_path, opts.parent.config_path, 0, "config", required_argument, 'c', "CONFIG", NULL, NULL, NULL, NULL)      \
+    X(S, string, message, 0, "message", required_argument, 'm', "MESSAGE", "message", "Hello, Default World!", NULL, NULL)
 
+DC_SCHEMA_STRUCT(application_settings, APPLICATION_SCHEMA)
+DC_SCHEMA_DEFINE(application_settings, APPLICATION_SCHEMA, "DC_EXAMPLE_")
 
 
-static struct dc_application_settings *create_settings(const struct dc_env *env, struct dc_error *err);
-static int destroy_settings(const struct dc_env *env,
-                            struct dc_error *err,
-                            struct dc_application_settings **psettings);
 static int run(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings);
 static void error_reporter(const struct dc_error *err);
 static void trace_reporter(const struct dc_env *env,
@@ -45,83 +39,13 @@ int main(int argc, char *argv[])
     dc_error_init(&err, reporter);
     dc_env_init(&env, tracer);
     info = dc_application_info_create(&env, &err, "Settings Application");
-    ret_val = dc_application_run(&env, &err, info, create_settings, destroy_settings, run, dc_default_create_lifecycle, dc_default_destroy_lifecycle, NULL, argc, argv);
+    ret_val = dc_application_run(&env, &err, info, application_settings_create, application_settings_destroy, run, dc_default_create_lifecycle, dc_default_destroy_lifecycle, NULL, argc, argv);
     dc_application_info_destroy(&env, &info);
     dc_error_reset(&err);
 
     return ret_val;
 }
 
-static struct dc_application_settings *create_settings(const struct dc_env *env, struct dc_error *err)
-{
-    static bool default_verbose = false;
-    struct application_settings *settings;
-
-    DC_TRACE(env);
-    settings = dc_malloc(env, err, sizeof(struct application_settings));
-
-    if(settings == NULL)
-    {
-        return NULL;
-    }
-
-    settings->opts.parent.config_path = dc_setting_path_create(env, err);
-    settings->message = dc_setting_string_create(env, err);
-
-    struct options opts[] = {
-            {(struct dc_setting *)settings->opts.parent.config_path,
-                    dc_options_set_path,
-                    "config",
-                    required_argument,
-                    'c',
-                    "CONFIG",
-                    dc_string_from_string,
-                    NULL,
-                    dc_string_from_config,
-                    NULL},
-            {(struct dc_setting *)settings->message,
-                    dc_options_set_string,
-                    "message",
-                    required_argument,
-                    'm',
-                    "MESSAGE",
-                    dc_string_from_string,
-                    "message",
-                    dc_string_from_config,
-                    "Hello, Default World!"},
-    };
-
-    // note the trick here - we use calloc and add 1 to ensure the last line is all 0/NULL
-    settings->opts.opts_count = (sizeof(opts) / sizeof(struct options)) + 1;
-    settings->opts.opts_size = sizeof(struct options);
-    settings->opts.opts = dc_calloc(env, err, settings->opts.opts_count, settings->opts.opts_size);
-    dc_memcpy(env, settings->opts.opts, opts, sizeof(opts));
-    settings->opts.flags = "m:";
-    settings->opts.env_prefix = "DC_EXAMPLE_";
-
-    return (struct dc_application_settings *)settings;
-}
-
-static int destroy_settings(const struct dc_env *env,
-                            struct dc_error *err,
-                            struct dc_application_settings **psettings)
-{
-    struct application_settings *app_settings;
-
-    DC_TRACE(env);
-    app_settings = (struct application_settings *)*psettings;
-    dc_setting_string_destroy(env, &app_settings->message);
-    dc_free(env, app_settings->opts.opts, app_settings->opts.opts_count);
-    dc_free(env, *psettings, sizeof(struct application_settings));
-
-    if(env->null_free)
-    {
-        *psettings = NULL;
-    }
-
-    return 0;
-}
-
 static int run(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings)
 {
     struct application_settings *app_settings;
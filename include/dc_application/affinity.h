@@ -0,0 +1,168 @@
+#ifndef LIBDC_APPLICATION_AFFINITY_H
+#define LIBDC_APPLICATION_AFFINITY_H
+
+
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <dc_env/env.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Where the threads of the process run and where its memory comes from. A set is written the way taskset and the
+ * kernel write them, numbers and ranges separated by commas ("0-7,16-23"). The same syntax names NUMA nodes in a
+ * policy, which is one of:
+ *  - default: the system policy.
+ *  - local: memory from the node of the CPU that touches it first.
+ *  - node:<nodes>: memory only from those nodes.
+ *  - preferred:<node>: memory from that node while it has some.
+ *  - interleave:<nodes>: pages spread across the nodes in turn.
+ *
+ * Setting them only changes the calling thread and the threads it starts afterwards, so they are applied before the
+ * application starts any. Only Linux has them, elsewhere applying one raises ENOTSUP.
+ */
+#define DC_CPUSET_SIZE 1024U
+#define DC_CPUSET_FORMAT_SIZE 4096U
+#define DC_NUMA_POLICY_FORMAT_SIZE (DC_CPUSET_FORMAT_SIZE + 16U)
+
+struct dc_cpuset
+{
+    unsigned long bits[DC_CPUSET_SIZE / (sizeof(unsigned long) * CHAR_BIT)];
+};
+
+typedef enum
+{
+    DC_NUMA_DEFAULT,
+    DC_NUMA_LOCAL,
+    DC_NUMA_BIND,
+    DC_NUMA_PREFERRED,
+    DC_NUMA_INTERLEAVE,
+} dc_numa_mode;
+
+struct dc_numa_policy
+{
+    dc_numa_mode mode;
+    struct dc_cpuset nodes;
+};
+
+
+/**
+ * Parse a set of CPUs or NUMA nodes, each below DC_CPUSET_SIZE. An empty set is an error.
+ *
+ * @param env
+ * @param err
+ * @param str
+ * @param set
+ * @return
+ */
+bool dc_cpuset_parse(const struct dc_env *env, struct dc_error *err, const char *str, struct dc_cpuset *set);
+
+/**
+ * Format a set with the longest ranges possible, so that it parses back to the same set.
+ *
+ * @param env
+ * @param set
+ * @param buffer
+ * @param size
+ * @return the number of characters that the whole string needs, as snprintf does. A buffer that is too small is cut
+ *         between numbers, never in the middle of one.
+ */
+int dc_cpuset_format(const struct dc_env *env, const struct dc_cpuset *set, char *buffer, size_t size);
+
+/**
+ *
+ * @param env
+ * @param set
+ * @return the number of CPUs in the set.
+ */
+size_t dc_cpuset_get_count(const struct dc_env *env, const struct dc_cpuset *set);
+
+/**
+ *
+ * @param env
+ * @param set
+ * @param index
+ * @return the index'th CPU in the set, counting from the lowest, or DC_CPUSET_SIZE if there are not that many.
+ */
+unsigned int dc_cpuset_get_cpu(const struct dc_env *env, const struct dc_cpuset *set, size_t index);
+
+/**
+ *
+ * @param env
+ * @param err
+ * @param str
+ * @param policy
+ * @return
+ */
+bool dc_numa_policy_parse(const struct dc_env *env, struct dc_error *err, const char *str, struct dc_numa_policy *policy);
+
+/**
+ * Format a policy so that it parses back to the same policy.
+ *
+ * @param env
+ * @param policy
+ * @param buffer
+ * @param size
+ * @return the number of characters that the whole string needs, as snprintf does. A buffer that is too small is cut
+ *         between numbers, never in the middle of one.
+ */
+int dc_numa_policy_format(const struct dc_env *env, const struct dc_numa_policy *policy, char *buffer, size_t size);
+
+/**
+ * Run the calling thread, and the threads it starts afterwards, only on the CPUs in the set.
+ *
+ * @param env
+ * @param err
+ * @param set
+ */
+void dc_affinity_set_cpus(const struct dc_env *env, struct dc_error *err, const struct dc_cpuset *set);
+
+/**
+ * Pin the calling thread to one CPU of the set, worker n gets the n'th CPU and the workers wrap around when there
+ * are more of them than CPUs.
+ *
+ * @param env
+ * @param err
+ * @param set
+ * @param worker
+ */
+void dc_affinity_pin_worker(const struct dc_env *env, struct dc_error *err, const struct dc_cpuset *set, size_t worker);
+
+/**
+ * Allocate the memory the calling thread, and the threads it starts afterwards, touches first by the policy.
+ *
+ * @param env
+ * @param err
+ * @param policy
+ */
+void dc_affinity_set_numa_policy(const struct dc_env *env, struct dc_error *err, const struct dc_numa_policy *policy);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // LIBDC_APPLICATION_AFFINITY_H
@@ -0,0 +1,72 @@
+#ifndef LIBDC_APPLICATION_ALLOCATOR_H
+#define LIBDC_APPLICATION_ALLOCATOR_H
+
+
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <dc_env/env.h>
+#include <stdbool.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * dc_malloc and friends call the C library allocator, so tuning it reaches the library and the application without
+ * touching either. The tuning is done with mallopt and only does anything with the GNU C library, elsewhere every kind
+ * is the same as DC_ALLOCATOR_SYSTEM. The per thread caches (tcache) can only be tuned before the process starts, with
+ * GLIBC_TUNABLES.
+ */
+#define DC_ALLOCATOR_ENV_VAR "DC_ALLOCATOR"
+
+typedef enum
+{
+    DC_ALLOCATOR_SYSTEM,    // "system": the C library defaults
+    DC_ALLOCATOR_ARENA,     // "arena": at most one arena per CPU (M_ARENA_MAX), bounding the memory arenas hold
+    DC_ALLOCATOR_RETAIN,    // "retain": freed memory is kept for reuse instead of going back to the kernel
+} dc_allocator;
+
+
+/**
+ * Look up an allocator by the name it has in DC_ALLOCATOR_ENV_VAR.
+ *
+ * @param env
+ * @param name
+ * @param kind set to the allocator if there is one with the name.
+ * @return false if there is not.
+ */
+bool dc_allocator_from_string(const struct dc_env *env, const char *name, dc_allocator *kind);
+
+/**
+ * Tune the C library allocator for the process. It is meant to be done once, before there are threads.
+ *
+ * @param env
+ * @param err
+ * @param kind
+ */
+void dc_allocator_install(const struct dc_env *env, struct dc_error *err, dc_allocator kind);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // LIBDC_APPLICATION_ALLOCATOR_H
@@ -18,6 +18,7 @@
  */
 
 
+#include "allocator.h"
 #include <dc_env/env.h>
 
 
@@ -28,10 +29,56 @@ extern "C" {
 
 struct dc_application_info;
 struct dc_application_lifecycle;
+struct dc_settings_segment;
+struct dc_component;
+struct dc_config_provider;
+struct dc_memory_region;
 
+/*
+ * lock_memory, prefault and warmup_files pick what the warmup state does before the application runs (see warmup.h),
+ * they are owned by the application's settings and left NULL when it does not have them. When the settings are
+ * created each is kept if an option's setting is the member's value (a table built by hand), set from the option whose
+ * setting_offset names the member (the schema declares them that way), and otherwise cleared, so an application that
+ * allocates the struct does not have to clear them.
+ *
+ * A memory_region_size above 0 has a huge page region (see memory.h) made for memory_region at the start of the
+ * INIT_COMPONENTS state, bound to memory_region_node if that is set and prefaulted with the warmup regions. The
+ * application makes its pools from it, it is unmapped before the settings are destroyed. memory_region_size and
+ * memory_region_node are found the same way as the warmup settings, memory_region is cleared by the library and only
+ * ever set by it.
+ *
+ * cpuset and numa_policy (see affinity.h) are applied to the process at the start of the INIT_COMPONENTS state, before
+ * the region is made and any component thread is started, so every thread and the region inherit them. Worker
+ * threads that should each have a CPU of their own pin themselves with dc_affinity_pin_worker. Both are found the same
+ * way as the warmup settings.
+ */
 struct dc_application_settings
 {
     struct dc_setting_path *config_path;
+    struct dc_settings_segment *segment;
+    struct dc_setting_bool *lock_memory;
+    struct dc_setting_bool *prefault;
+    struct dc_setting_list *warmup_files;
+    struct dc_setting_bytes *memory_region_size;
+    struct dc_setting_uint32 *memory_region_node;
+    struct dc_memory_region *memory_region;
+    struct dc_setting_cpuset *cpuset;
+    struct dc_setting_numa_policy *numa_policy;
+};
+
+/*
+ * A verb of a tool with subcommands ("svc serve", "svc db migrate"). Each command has its own settings and run
+ * function, only the settings of the command that was picked are created, parsed and resolved. commands holds the
+ * verbs under this one, ended by an entry with a NULL name, and a command without a run function is only a group
+ * for them.
+ */
+struct dc_application_command
+{
+    const char *name;
+    struct dc_application_settings *(*create_settings)(const struct dc_env *env, struct dc_error *err);
+    int (*destroy_settings)(const struct dc_env *env, struct dc_error *err, struct dc_application_settings **);
+    int (*run)(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *);
+    const struct dc_application_command *commands;
 };
 
 /**
@@ -124,6 +171,182 @@ void dc_application_lifecycle_set_cleanup(
                     struct dc_application_settings *settings));
 
 
+/**
+ * Reload the settings from the configuration file without overriding the command line, environment, or runtime
+ * changes.
+ *
+ * @param env
+ * @param lifecycle
+ * @param func
+ */
+void dc_application_lifecycle_set_reload_config(
+        const struct dc_env *env, struct dc_application_lifecycle *lifecycle,
+        int (*func)(const struct dc_env *env, struct dc_error *err,
+                    struct dc_application_settings *settings));
+
+
+/**
+ * Serve the control protocol (see control.h) on a unix domain socket while the application runs.
+ *
+ * @param env
+ * @param lifecycle
+ * @param path the socket path, NULL to not serve one.
+ */
+void dc_application_lifecycle_set_control_socket(
+        const struct dc_env *env, struct dc_application_lifecycle *lifecycle,
+        const char *path);
+
+
+/**
+ * Tune the C library allocator (see allocator.h) before the settings are created, so that everything the library and
+ * the application allocate uses it. DC_ALLOCATOR_ENV_VAR, if it is set, takes the place of kind. dc_application_run
+ * fails if it does not name an allocator or the allocator cannot be tuned.
+ *
+ * @param env
+ * @param lifecycle
+ * @param kind
+ */
+void dc_application_lifecycle_set_allocator(
+        const struct dc_env *env, struct dc_application_lifecycle *lifecycle,
+        dc_allocator kind);
+
+
+/**
+ * Run as a zygote (see zygote.h): once the settings are resolved and warmed up, fork a child for each request on the
+ * socket. Only the children call run, the zygote goes straight to cleanup when it is stopped.
+ *
+ * @param env
+ * @param lifecycle
+ * @param path the socket path, NULL to run normally.
+ */
+void dc_application_lifecycle_set_zygote(
+        const struct dc_env *env, struct dc_application_lifecycle *lifecycle,
+        const char *path);
+
+
+/**
+ * Called in the warmup state, after the settings are resolved and the built in warmup is done and before the
+ * application runs or anything is told it is ready.
+ *
+ * @param env
+ * @param lifecycle
+ * @param func
+ */
+void dc_application_lifecycle_set_warmup(
+        const struct dc_env *env, struct dc_application_lifecycle *lifecycle,
+        int (*func)(const struct dc_env *env, struct dc_error *err,
+                    struct dc_application_settings *settings));
+
+
+/**
+ * Add a named step to the lifecycle. after and before are ',' separated names of other phases or of the built in
+ * states (CREATE_SETTINGS, PARSE_COMMAND_LINE, READ_ENV_VARS, READ_CONFIG, SET_DEFAULTS, INIT_COMPONENTS, WARMUP, RUN,
+ * CLEANUP and DESTROY_SETTINGS). A phase without after runs after SET_DEFAULTS, and one with neither runs before
+ * WARMUP as well. The order is worked out when dc_application_run builds the state machine, a phase runs as early as
+ * its constraints allow, and parallel phases that become ready together run on threads of their own at the same time.
+ *
+ * @param env
+ * @param err
+ * @param lifecycle
+ * @param name unique, kept by the lifecycle.
+ * @param func returns 0 on success.
+ * @param after the phases this one runs after, NULL for SET_DEFAULTS.
+ * @param before the phases this one runs before, may be NULL.
+ * @param parallel true if func can run at the same time as other phases.
+ */
+void dc_application_lifecycle_add_phase(
+        const struct dc_env *env, struct dc_error *err,
+        struct dc_application_lifecycle *lifecycle, const char *name,
+        int (*func)(const struct dc_env *env, struct dc_error *err,
+                    struct dc_application_settings *settings),
+        const char *after, const char *before, bool parallel);
+
+
+/**
+ * Register a component (see component.h). The components are initialized in the INIT_COMPONENTS state, started in the
+ * run state before the application is ready, stopped in cleanup and released before the settings are destroyed.
+ *
+ * @param env
+ * @param err
+ * @param lifecycle
+ * @param component kept by the lifecycle.
+ */
+void dc_application_lifecycle_add_component(
+        const struct dc_env *env, struct dc_error *err,
+        struct dc_application_lifecycle *lifecycle,
+        const struct dc_component *component);
+
+
+/**
+ * Register a config provider (see provider.h). The providers start fetching when the settings are created and what
+ * they fetched is applied in the READ_CONFIG state after the config file.
+ *
+ * @param env
+ * @param err
+ * @param lifecycle
+ * @param provider kept by the lifecycle.
+ */
+void dc_application_lifecycle_add_config_provider(
+        const struct dc_env *env, struct dc_error *err,
+        struct dc_application_lifecycle *lifecycle,
+        const struct dc_config_provider *provider);
+
+
+/**
+ * Add a region for the warmup state to prefault when the prefault setting is true. The region has to outlive the
+ * lifecycle.
+ *
+ * @param env
+ * @param err
+ * @param lifecycle
+ * @param addr
+ * @param length
+ */
+void dc_application_lifecycle_add_arena(
+        const struct dc_env *env, struct dc_error *err,
+        struct dc_application_lifecycle *lifecycle, void *addr, size_t length);
+
+
+/**
+ * Pick the settings and run function from the leading arguments. The longest run of verbs that names a command with
+ * a run function is taken off the command line, what is left is parsed with the command's name as argv[0]. When no
+ * command is named the functions given to dc_application_run are used, which can print the usage.
+ *
+ * @param env
+ * @param lifecycle
+ * @param commands the top level verbs, ended by an entry with a NULL name.
+ */
+void dc_application_lifecycle_set_commands(
+        const struct dc_env *env, struct dc_application_lifecycle *lifecycle,
+        const struct dc_application_command *commands);
+
+
+/**
+ * Publish the resolved settings in a shared memory segment before running so that child processes can attach to it
+ * instead of resolving the settings again.
+ *
+ * @param env
+ * @param lifecycle
+ * @param name the name the segment is published under (see segment.h), NULL to not publish one.
+ */
+void dc_application_lifecycle_set_share_settings(
+        const struct dc_env *env, struct dc_application_lifecycle *lifecycle,
+        const char *name);
+
+
+/**
+ * Take the settings from a segment a parent published under name, if one was handed down, instead of parsing the
+ * command line, environment and config. Applications that do not call this always resolve their own settings.
+ *
+ * @param env
+ * @param lifecycle
+ * @param name the name the parent published the segment under, NULL to never attach.
+ */
+void dc_application_lifecycle_set_attach_settings(
+        const struct dc_env *env, struct dc_application_lifecycle *lifecycle,
+        const char *name);
+
+
 /**
  *
  * @param env
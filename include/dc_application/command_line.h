@@ -20,7 +20,9 @@
 
 
 #include "application.h"
+#include "options.h"
 #include <dc_env/env.h>
+#include <limits.h>
 
 
 #ifdef __cplusplus
@@ -28,6 +30,102 @@ extern "C" {
 #endif
 
 
+/*
+ * A command line parser that keeps all of its state here instead of in the getopt globals, so any number of them
+ * can run at once. It takes what getopt_long takes: clustered short options ("-vn" and "-mhello"), "--name=value",
+ * "--name value" for required arguments, unique abbreviations of long names, and "--" to end the options. Like
+ * getopt_long it moves the operands after the options in argv, optind is the first operand once parsing is done.
+ *
+ * An operand of the form @path names a response file holding more arguments, separated by white space with quotes
+ * and backslashes as in the shell. The file is mapped and split in place, so a file with hundreds of thousands of
+ * arguments never turns into an argv. The @path stays with the operands in argv and stands for the operands in the
+ * file, dc_command_line_operands_next returns them in order. An @ inside a response file is not expanded again.
+ */
+struct dc_command_line_parser
+{
+    const struct dc_opt_settings *opt_settings;
+    int argc;
+    char **argv;
+    int optind;
+
+    // the operands stepped over so far are argv[operand_start] up to the next argument
+    int next;
+    int operand_start;
+    const char *cluster;
+    bool done;
+
+    // the response file being read and every one that was opened, newest first
+    struct dc_response_file *file;
+    struct dc_response_file *response_files;
+
+    // the options with a short form in the flags, by character
+    const struct options *short_options[UCHAR_MAX + 1];
+};
+
+/**
+ * @param env
+ * @param parser
+ * @param opt_settings
+ * @param argc
+ * @param argv
+ */
+void dc_command_line_parser_init(const struct dc_env *env,
+                                 struct dc_command_line_parser *parser,
+                                 const struct dc_opt_settings *opt_settings,
+                                 int argc,
+                                 char *argv[]);
+
+/**
+ * Get the next option and its argument.
+ *
+ * @param env
+ * @param err
+ * @param parser
+ * @param opt the option, set when true is returned.
+ * @param value the argument, NULL when the option was given without one. It is good until the next call.
+ * @return false at the end of the options or on an error.
+ */
+bool dc_command_line_parser_next(const struct dc_env *env,
+                                 struct dc_error *err,
+                                 struct dc_command_line_parser *parser,
+                                 const struct options **opt,
+                                 const char **value);
+
+/**
+ * Walks the operands left after parsing, argv from optind on with each response file replaced by its operands.
+ */
+struct dc_command_line_operands
+{
+    const struct dc_opt_settings *opt_settings;
+    int index;
+    const char *next;
+    size_t remaining;
+};
+
+/**
+ * @param env
+ * @param operands
+ * @param opt_settings settings that dc_default_parse_command_line filled in.
+ */
+void dc_command_line_operands_init(const struct dc_env *env,
+                                   struct dc_command_line_operands *operands,
+                                   const struct dc_opt_settings *opt_settings);
+
+/**
+ * @param env
+ * @param operands
+ * @return the next operand, NULL after the last one.
+ */
+const char *dc_command_line_operands_next(const struct dc_env *env, struct dc_command_line_operands *operands);
+
+/**
+ * Unmap the response files. The operands from them are gone after this.
+ *
+ * @param env
+ * @param pfiles
+ */
+void dc_command_line_release_response_files(const struct dc_env *env, struct dc_response_file **pfiles);
+
 int dc_default_parse_command_line(const struct dc_env *env,
                                   struct dc_error *err,
                                   struct dc_application_settings *settings,
@@ -0,0 +1,152 @@
+#ifndef LIBDC_APPLICATION_COMPONENT_H
+#define LIBDC_APPLICATION_COMPONENT_H
+
+
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include "application.h"
+#include <dc_env/env.h>
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * The upper bound on the threads that initialize components, the I/O a component waits on while it initializes is why
+ * there are more than the CPUs.
+ */
+#define DC_COMPONENTS_MAX_THREADS 16U
+
+/*
+ * A service the application is made of (a connection pool, a cache, a listener). depends names the components, and
+ * settings the long option names of the settings, that have to be ready before init is called, each as a ',' separated
+ * list. Any of the callbacks may be NULL, data is passed to each of them.
+ */
+struct dc_component
+{
+    const char *name;
+    const char *depends;
+    const char *settings;
+    int (*init)(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings, void *data);
+    int (*start)(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings, void *data);
+    int (*stop)(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings, void *data);
+    int (*destroy)(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings, void *data);
+    void *data;
+};
+
+struct dc_components;
+
+
+/**
+ *
+ * @param env
+ * @param err
+ * @return
+ */
+struct dc_components *dc_components_create(const struct dc_env *env, struct dc_error *err);
+
+/**
+ * Free the registry, the components have to be stopped and released first.
+ *
+ * @param env
+ * @param pcomponents
+ */
+void dc_components_destroy(const struct dc_env *env, struct dc_components **pcomponents);
+
+/**
+ * Register a component, the registry keeps the pointer.
+ *
+ * @param env
+ * @param err
+ * @param components
+ * @param component
+ */
+void dc_components_add(const struct dc_env *env,
+                       struct dc_error *err,
+                       struct dc_components *components,
+                       const struct dc_component *component);
+
+/**
+ * Call init on every component, each one once the components it depends on are done, with the ones that do not
+ * depend on each other running at the same time on a pool of threads. If one fails no more are started and the ones
+ * that finished are released.
+ *
+ * @param env
+ * @param err
+ * @param components
+ * @param settings
+ * @param thread_count the size of the pool, 0 for as many as could be busy up to DC_COMPONENTS_MAX_THREADS.
+ */
+void dc_components_init(const struct dc_env *env,
+                        struct dc_error *err,
+                        struct dc_components *components,
+                        struct dc_application_settings *settings,
+                        size_t thread_count);
+
+/**
+ * Call start on every component in the order they finished init. If one fails the ones already started are stopped.
+ *
+ * @param env
+ * @param err
+ * @param components
+ * @param settings
+ */
+void dc_components_start(const struct dc_env *env,
+                         struct dc_error *err,
+                         struct dc_components *components,
+                         struct dc_application_settings *settings);
+
+/**
+ * Call stop on every started component, in the reverse of the order they started. A failure does not keep the others
+ * from stopping.
+ *
+ * @param env
+ * @param err
+ * @param components
+ * @param settings
+ */
+void dc_components_stop(const struct dc_env *env,
+                        struct dc_error *err,
+                        struct dc_components *components,
+                        struct dc_application_settings *settings);
+
+/**
+ * Call destroy on every initialized component, in the reverse of the order they finished init. A failure does not
+ * keep the others from being released.
+ *
+ * @param env
+ * @param err
+ * @param components
+ * @param settings
+ */
+void dc_components_release(const struct dc_env *env,
+                           struct dc_error *err,
+                           struct dc_components *components,
+                           struct dc_application_settings *settings);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // LIBDC_APPLICATION_COMPONENT_H
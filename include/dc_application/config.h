@@ -29,8 +29,60 @@ extern "C" {
 #endif
 
 
+struct dc_config_load;
+
+
 int dc_default_load_config(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings);
 
+/**
+ * Start reading and parsing a config file on another thread. Nothing is applied until dc_config_load_finish.
+ *
+ * @param env
+ * @param err
+ * @param path the file that is expected to be the config path once the command line and environment are read, it is
+ *             expanded as the config path setting is and resolved to an absolute path before it is read.
+ * @return the load to finish or cancel.
+ */
+struct dc_config_load *dc_config_load_start(const struct dc_env *env, struct dc_error *err, const char *path);
+
+/**
+ * Wait for the load and apply it as dc_default_load_config would. If the config path, resolved the same way, is no
+ * longer the file that was read the config path is read instead.
+ *
+ * @param env
+ * @param err
+ * @param pload the load, set to NULL.
+ * @param settings
+ * @return 0 on success.
+ */
+int dc_config_load_finish(const struct dc_env *env,
+                          struct dc_error *err,
+                          struct dc_config_load **pload,
+                          struct dc_application_settings *settings);
+
+/**
+ * Wait for the load and throw it away.
+ *
+ * @param env
+ * @param pload the load, set to NULL.
+ */
+void dc_config_load_cancel(const struct dc_env *env, struct dc_config_load **pload);
+
+/**
+ * Apply settings written in the config file syntax as config settings, the same way the config file is applied.
+ *
+ * @param env
+ * @param err
+ * @param settings
+ * @param text
+ */
+void dc_config_apply_string(const struct dc_env *env,
+                            struct dc_error *err,
+                            struct dc_application_settings *settings,
+                            const char *text);
+
+int dc_default_reload_config(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings);
+
 const void *dc_string_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item);
 
 const void *dc_flag_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item);
@@ -39,6 +91,28 @@ const void *dc_uint16_from_config(const struct dc_env *env, struct dc_error *err
 
 const void *dc_in_port_t_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item);
 
+const void *dc_int32_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item);
+
+const void *dc_int64_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item);
+
+const void *dc_uint32_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item);
+
+const void *dc_uint64_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item);
+
+const void *dc_size_t_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item);
+
+const void *dc_double_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item);
+
+const void *dc_bytes_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item);
+
+const void *dc_duration_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item);
+
+const void *dc_string_list_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item);
+
+const void *dc_integer_list_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item);
+
+const void *dc_endpoint_list_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item);
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,86 @@
+#ifndef LIBDC_APPLICATION_CONTROL_H
+#define LIBDC_APPLICATION_CONTROL_H
+
+
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "application.h"
+#include <dc_env/env.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Every request and response is a 4 byte length in network byte order followed by that many bytes of text.
+ *
+ * Requests:
+ *   get <name>
+ *   set <name> <value>
+ *   dump
+ *   reload
+ *
+ * Responses start with "OK" or "ERR". get responds with "OK <value>", dump with "OK" followed by one
+ * "<name>=<value>" line per setting.
+ *
+ * The socket is made with dc_local_socket_listen, only processes running as the same user can connect. Clients are
+ * served one at a time and a client is disconnected once it has been idle, or stuck part way through a frame, for
+ * DC_CONTROL_CLIENT_TIMEOUT_MS.
+ */
+#define DC_CONTROL_MAX_FRAME 65536U
+#define DC_CONTROL_CLIENT_TIMEOUT_MS 5000U
+
+struct dc_control_server;
+
+
+/**
+ * Start serving the control protocol on a unix domain socket from a dedicated thread.
+ *
+ * @param env
+ * @param err
+ * @param settings
+ * @param path
+ * @param reload_func called for the reload command, may be NULL.
+ * @return
+ */
+struct dc_control_server *dc_control_server_start(const struct dc_env *env,
+                                                  struct dc_error *err,
+                                                  struct dc_application_settings *settings,
+                                                  const char *path,
+                                                  int (*reload_func)(const struct dc_env *env,
+                                                                     struct dc_error *err,
+                                                                     struct dc_application_settings *settings));
+
+
+/**
+ * Stop the server thread and remove the socket.
+ *
+ * @param env
+ * @param pserver
+ */
+void dc_control_server_stop(const struct dc_env *env, struct dc_control_server **pserver);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // LIBDC_APPLICATION_CONTROL_H
@@ -0,0 +1,206 @@
+#ifndef LIBDC_APPLICATION_LIST_H
+#define LIBDC_APPLICATION_LIST_H
+
+
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <arpa/inet.h>
+#include <dc_env/env.h>
+#include <libconfig.h>
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef enum
+{
+    DC_LIST_STRING,
+    DC_LIST_INTEGER,
+    DC_LIST_ENDPOINT,
+} dc_list_element;
+
+/*
+ * A list is a single allocation holding a header, an array of element offsets and values, and the characters of
+ * every element. Nothing inside it is a pointer, so it can be copied, or mapped from another process, as plain bytes.
+ *
+ * Endpoints are written as host:port, or [host]:port when the host contains a colon.
+ */
+struct dc_list;
+
+
+/**
+ * Parse every element of a delimited string. Whitespace around each element is ignored, and an empty string is an
+ * empty list.
+ *
+ * @param env
+ * @param err
+ * @param element
+ * @param str
+ * @param delimiter
+ * @return
+ */
+struct dc_list *dc_list_parse(const struct dc_env *env,
+                              struct dc_error *err,
+                              dc_list_element element,
+                              const char *str,
+                              char delimiter);
+
+
+/**
+ * Build a list from a libconfig array or list. A single string is parsed as a comma delimited list.
+ *
+ * @param env
+ * @param err
+ * @param element
+ * @param item
+ * @return
+ */
+struct dc_list *dc_list_from_config(const struct dc_env *env,
+                                    struct dc_error *err,
+                                    dc_list_element element,
+                                    const config_setting_t *item);
+
+
+/**
+ *
+ * @param env
+ * @param err
+ * @param list
+ * @return
+ */
+struct dc_list *dc_list_copy(const struct dc_env *env, struct dc_error *err, const struct dc_list *list);
+
+
+/**
+ * Check and copy a list that was written out as bytes, for example by another process.
+ *
+ * @param env
+ * @param err
+ * @param bytes
+ * @param size
+ * @return
+ */
+struct dc_list *dc_list_load(const struct dc_env *env, struct dc_error *err, const void *bytes, size_t size);
+
+
+/**
+ *
+ * @param env
+ * @param plist
+ */
+void dc_list_destroy(const struct dc_env *env, struct dc_list **plist);
+
+
+/**
+ *
+ * @param env
+ * @param list
+ * @return the number of bytes in the list, for writing it out.
+ */
+size_t dc_list_get_size(const struct dc_env *env, const struct dc_list *list);
+
+
+/**
+ *
+ * @param env
+ * @param list
+ * @return
+ */
+size_t dc_list_get_count(const struct dc_env *env, const struct dc_list *list);
+
+
+/**
+ *
+ * @param env
+ * @param list
+ * @return
+ */
+dc_list_element dc_list_get_element(const struct dc_env *env, const struct dc_list *list);
+
+
+/**
+ *
+ * @param env
+ * @param list
+ * @param index
+ * @return
+ */
+const char *dc_list_get_string(const struct dc_env *env, const struct dc_list *list, size_t index);
+
+
+/**
+ *
+ * @param env
+ * @param list
+ * @param index
+ * @return
+ */
+size_t dc_list_get_length(const struct dc_env *env, const struct dc_list *list, size_t index);
+
+
+/**
+ *
+ * @param env
+ * @param list
+ * @param index
+ * @return
+ */
+int64_t dc_list_get_integer(const struct dc_env *env, const struct dc_list *list, size_t index);
+
+
+/**
+ *
+ * @param env
+ * @param list
+ * @param index
+ * @return
+ */
+const char *dc_list_get_host(const struct dc_env *env, const struct dc_list *list, size_t index);
+
+
+/**
+ *
+ * @param env
+ * @param list
+ * @param index
+ * @return
+ */
+in_port_t dc_list_get_port(const struct dc_env *env, const struct dc_list *list, size_t index);
+
+
+/**
+ * Write the list as a comma delimited string.
+ *
+ * @param env
+ * @param list
+ * @param buffer
+ * @param size
+ * @return the number of characters that the whole string needs, as snprintf does.
+ */
+int dc_list_format(const struct dc_env *env, const struct dc_list *list, char *buffer, size_t size);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // LIBDC_APPLICATION_LIST_H
@@ -0,0 +1,85 @@
+#ifndef LIBDC_APPLICATION_LOCAL_SOCKET_H
+#define LIBDC_APPLICATION_LOCAL_SOCKET_H
+
+
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <dc_env/env.h>
+#include <stdbool.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Unix domain sockets that only the user the process runs as can use, for the control socket and the zygote. The
+ * socket is made in a directory that only that user can write to, created with mode 0700 if it is not there, and the
+ * socket itself is mode 0600. A server still checks the credentials of each peer, the file permissions are not
+ * enforced for sockets on every system.
+ */
+
+
+/**
+ * Bind and listen on path. Something left at path by a previous run is only removed if it is a socket.
+ *
+ * @param env
+ * @param err
+ * @param path
+ * @return the listening socket.
+ */
+int dc_local_socket_listen(const struct dc_env *env, struct dc_error *err, const char *path);
+
+/**
+ * Connect to the socket at path.
+ *
+ * @param env
+ * @param err
+ * @param path
+ * @return the connected socket.
+ */
+int dc_local_socket_connect(const struct dc_env *env, struct dc_error *err, const char *path);
+
+/**
+ * Check that the process on the other end of an accepted socket runs as the same user as this one.
+ *
+ * @param env
+ * @param fd
+ * @return
+ */
+bool dc_local_socket_is_peer_trusted(const struct dc_env *env, int fd);
+
+/**
+ * Make reads and writes on the socket fail with EAGAIN once they have waited timeout_ms, so a peer that stops
+ * talking cannot hold the server up.
+ *
+ * @param env
+ * @param err
+ * @param fd
+ * @param timeout_ms
+ */
+void dc_local_socket_set_timeout(const struct dc_env *env, struct dc_error *err, int fd, unsigned int timeout_ms);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // LIBDC_APPLICATION_LOCAL_SOCKET_H
@@ -0,0 +1,85 @@
+#ifndef LIBDC_APPLICATION_MATCHER_H
+#define LIBDC_APPLICATION_MATCHER_H
+
+
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <dc_env/env.h>
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * A compiled POSIX extended regular expression that is shared by everything in the process that uses the same
+ * pattern text. Patterns that are only a literal, an anchored literal, or a single bracket expression repeated over
+ * the whole string are matched with a compare or a table lookup instead of regexec, with the same result.
+ *
+ * A matcher never changes after it is created, so it can be used from any number of threads at once.
+ */
+struct dc_matcher;
+
+
+/**
+ * Get the matcher for a pattern, compiling it only if nothing else holds it.
+ *
+ * @param env
+ * @param err
+ * @param pattern
+ * @return
+ */
+struct dc_matcher *dc_matcher_acquire(const struct dc_env *env, struct dc_error *err, const char *pattern);
+
+
+/**
+ *
+ * @param env
+ * @param pmatcher
+ */
+void dc_matcher_release(const struct dc_env *env, struct dc_matcher **pmatcher);
+
+
+/**
+ * Check a string the way regexec without any flags does.
+ *
+ * @param env
+ * @param matcher
+ * @param str
+ * @return
+ */
+bool dc_matcher_match(const struct dc_env *env, const struct dc_matcher *matcher, const char *str);
+
+
+/**
+ *
+ * @param env
+ * @param matcher
+ * @return
+ */
+const char *dc_matcher_get_pattern(const struct dc_env *env, const struct dc_matcher *matcher);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // LIBDC_APPLICATION_MATCHER_H
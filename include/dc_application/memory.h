@@ -0,0 +1,149 @@
+#ifndef LIBDC_APPLICATION_MEMORY_H
+#define LIBDC_APPLICATION_MEMORY_H
+
+
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <dc_env/env.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * A region is one mapping backed by huge pages where the system allows it, so that large structures kept in it need
+ * far fewer TLB entries. Explicit huge pages (MAP_HUGETLB) are tried first, they have to be reserved by the
+ * administrator (vm.nr_hugepages). Without them the region is an ordinary mapping marked for transparent huge pages.
+ *
+ * Pools hand out objects of one size from a region. Each pool takes its memory from the region when it is created and
+ * keeps it until the region is destroyed, getting and putting objects never goes to the kernel.
+ */
+#define DC_MEMORY_HUGE_PAGE_SIZE (2U * 1024U * 1024U)
+#define DC_MEMORY_MAX_NODES 1024U
+
+struct dc_memory_region;
+struct dc_memory_pool;
+
+
+/**
+ * Map a region.
+ *
+ * @param env
+ * @param err
+ * @param length the size, rounded up to DC_MEMORY_HUGE_PAGE_SIZE.
+ * @return
+ */
+struct dc_memory_region *dc_memory_region_create(const struct dc_env *env, struct dc_error *err, size_t length);
+
+/**
+ * Unmap a region, the pools made from it cannot be used after this.
+ *
+ * @param env
+ * @param pregion
+ */
+void dc_memory_region_destroy(const struct dc_env *env, struct dc_memory_region **pregion);
+
+/**
+ * Allocate the pages of the region that are not touched yet from a NUMA node. Bind before prefaulting, pages that
+ * are already there stay where they are.
+ *
+ * @param env
+ * @param err
+ * @param region
+ * @param node less than DC_MEMORY_MAX_NODES.
+ */
+void dc_memory_region_bind(const struct dc_env *env, struct dc_error *err, struct dc_memory_region *region, unsigned int node);
+
+/**
+ *
+ * @param env
+ * @param region
+ * @return the start of the region.
+ */
+void *dc_memory_region_get_address(const struct dc_env *env, const struct dc_memory_region *region);
+
+/**
+ *
+ * @param env
+ * @param region
+ * @return the size of the region.
+ */
+size_t dc_memory_region_get_length(const struct dc_env *env, const struct dc_memory_region *region);
+
+/**
+ *
+ * @param env
+ * @param region
+ * @return true if the region is made of explicit huge pages, false if it relies on transparent huge pages.
+ */
+bool dc_memory_region_is_hugetlb(const struct dc_env *env, const struct dc_memory_region *region);
+
+/**
+ * Take the memory for count objects of object_size bytes from the region.
+ *
+ * @param env
+ * @param err
+ * @param region
+ * @param object_size rounded up so every object is aligned for any type.
+ * @param count
+ * @return
+ */
+struct dc_memory_pool *dc_memory_pool_create(const struct dc_env *env,
+                                             struct dc_error *err,
+                                             struct dc_memory_region *region,
+                                             size_t object_size,
+                                             size_t count);
+
+/**
+ * Free the pool, its memory stays taken from the region.
+ *
+ * @param env
+ * @param ppool
+ */
+void dc_memory_pool_destroy(const struct dc_env *env, struct dc_memory_pool **ppool);
+
+/**
+ * Get an object. It is safe to call from more than one thread.
+ *
+ * @param env
+ * @param err
+ * @param pool
+ * @return the object, NULL with ENOMEM raised if all of them are in use.
+ */
+void *dc_memory_pool_get(const struct dc_env *env, struct dc_error *err, struct dc_memory_pool *pool);
+
+/**
+ * Give back an object from dc_memory_pool_get.
+ *
+ * @param env
+ * @param pool
+ * @param object
+ */
+void dc_memory_pool_put(const struct dc_env *env, struct dc_memory_pool *pool, void *object);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // LIBDC_APPLICATION_MEMORY_H
@@ -0,0 +1,110 @@
+#ifndef LIBDC_APPLICATION_NOTIFY_H
+#define LIBDC_APPLICATION_NOTIFY_H
+
+
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include <dc_env/env.h>
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * The service manager notification protocol used by systemd's sd_notify: newline separated "NAME=value" lines in one
+ * datagram to the unix domain socket named by NOTIFY_SOCKET (an abstract socket when it starts with '@').
+ */
+#define DC_NOTIFY_SOCKET_ENV_VAR "NOTIFY_SOCKET"
+#define DC_NOTIFY_WATCHDOG_USEC_ENV_VAR "WATCHDOG_USEC"
+#define DC_NOTIFY_WATCHDOG_PID_ENV_VAR "WATCHDOG_PID"
+
+struct dc_notifier;
+
+
+/**
+ * Connect to the socket named in the environment.
+ *
+ * @param env
+ * @param err
+ * @return NULL if the process was not started with a notification socket.
+ */
+struct dc_notifier *dc_notifier_create(const struct dc_env *env, struct dc_error *err);
+
+/**
+ * Stop the watchdog, if it was started, and close the socket.
+ *
+ * @param env
+ * @param pnotifier
+ */
+void dc_notifier_destroy(const struct dc_env *env, struct dc_notifier **pnotifier);
+
+/**
+ * Close the socket in a child process without touching the watchdog thread, which only exists in the parent.
+ *
+ * @param env
+ * @param pnotifier
+ */
+void dc_notifier_destroy_after_fork(const struct dc_env *env, struct dc_notifier **pnotifier);
+
+/**
+ * Send one message.
+ *
+ * @param env
+ * @param err
+ * @param notifier
+ * @param message newline separated "NAME=value" lines.
+ */
+void dc_notifier_send(const struct dc_env *env, struct dc_error *err, struct dc_notifier *notifier, const char *message);
+
+/**
+ * Send WATCHDOG=1 from a dedicated thread at half the interval the service manager asked for. Nothing is started if
+ * it did not ask for one, or asked for it from another process.
+ *
+ * @param env
+ * @param err
+ * @param notifier
+ */
+void dc_notifier_start_watchdog(const struct dc_env *env, struct dc_error *err, struct dc_notifier *notifier);
+
+/**
+ * Stop the watchdog thread, if it is running.
+ *
+ * @param env
+ * @param notifier
+ */
+void dc_notifier_stop_watchdog(const struct dc_env *env, struct dc_notifier *notifier);
+
+/**
+ * The monotonic clock in microseconds, the clock the service manager uses for MONOTONIC_USEC.
+ *
+ * @param env
+ * @return
+ */
+uint64_t dc_notifier_now(const struct dc_env *env);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // LIBDC_APPLICATION_NOTIFY_H
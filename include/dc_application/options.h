@@ -22,6 +22,7 @@
 #include "application.h"
 #include "config.h"
 #include "settings.h"
+#include <stdint.h>
 
 
 #ifdef __cplusplus
@@ -29,6 +30,8 @@ extern "C" {
 #endif
 
 
+struct dc_response_file;
+
 typedef void (*dc_setting_set_func)(const struct dc_env *env,
                                     struct dc_error *err,
                                     struct dc_setting *setting,
@@ -52,33 +55,139 @@ struct options
                                     struct dc_error *err, config_setting_t *item);
 
     const void *default_value;
+
+    // inclusive bounds for the numeric kinds, NULL for no bound
+    const void *min_value;
+    const void *max_value;
+
+    // when setting is NULL the setting pointer is read from this offset in the settings, so a table can be const
+    size_t setting_offset;
+};
+
+/*
+ * A minimal perfect hash from a key to the position of its option in the table, generated at build time by
+ * tools/schema_index.c. The key hashes to a bucket and the displacement stored for the bucket picks the slot, so a
+ * lookup is one pass over the key and one compare.
+ */
+struct dc_options_index
+{
+    size_t slot_count;
+    size_t bucket_count;
+    const uint32_t *displacements;
+    const uint16_t *slots;
 };
 
+// config keys are written with '.' between the groups and are at most this long, the generator checks both
+#define DC_OPTIONS_MAX_CONFIG_KEY 256
+
 struct dc_opt_settings
 {
     struct dc_application_settings parent;
-    struct options *opts;
+    const struct options *opts;
     size_t opts_count;
     size_t opts_size;
     const char *flags;
     const char *env_prefix;
+
+    // NULL to search the table in order
+    const struct dc_options_index *name_index;
+    const struct dc_options_index *env_index;
+    const struct dc_options_index *config_index;
+
     int optind;
     int argc;
     char **argv;
+
+    // the @file arguments that were read, dc_command_line_operands_next returns the operands from them
+    struct dc_response_file *response_files;
 };
 
+const struct options *dc_options_find(const struct dc_env *env, const struct dc_opt_settings *opt_settings, const char *name);
+
+const struct options *dc_options_find_name(const struct dc_env *env, const struct dc_opt_settings *opt_settings, const char *name, size_t length);
+
+const struct options *dc_options_find_env(const struct dc_env *env, const struct dc_opt_settings *opt_settings, const char *key, size_t length);
+
+const struct options *dc_options_find_config(const struct dc_env *env, const struct dc_opt_settings *opt_settings, const char *key, size_t length);
+
+// shared with the generator, changing either changes the tables it writes
+static inline uint64_t dc_options_hash(const char *key, size_t length)
+{
+    uint64_t hash;
+
+    // FNV-1a
+    hash = UINT64_C(14695981039346656037);
+
+    for(size_t i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char)key[i];
+        hash *= UINT64_C(1099511628211);
+    }
+
+    return hash;
+}
+
+static inline size_t dc_options_hash_bucket(uint64_t hash, size_t bucket_count)
+{
+    return (size_t)((hash >> 32) % bucket_count);
+}
+
+static inline size_t dc_options_hash_slot(uint64_t hash, uint32_t displacement, size_t slot_count)
+{
+    uint64_t mixed;
+
+    mixed = hash ^ (displacement * UINT64_C(0x9E3779B97F4A7C15));
+    mixed ^= mixed >> 29;
+    mixed *= UINT64_C(0xBF58476D1CE4E5B9);
+    mixed ^= mixed >> 32;
+
+    return (size_t)(mixed % slot_count);
+}
+
+struct dc_setting *dc_options_get_setting(const struct dc_env *env, const struct dc_opt_settings *opt_settings, const struct options *opt);
+
+bool dc_options_check_range(const struct dc_env *env, struct dc_error *err, const struct dc_opt_settings *opt_settings, const struct options *opt, const void *value);
+
+void dc_options_apply(const struct dc_env *env, struct dc_error *err, const struct dc_opt_settings *opt_settings, const struct options *opt, const void *value, dc_setting_type type);
+
 void dc_options_set_string(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
 
 void dc_options_set_regex(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
 
 void dc_options_set_path(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
 
+void dc_options_set_fd(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
+
+void dc_options_set_dirfd(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
+
 void dc_options_set_bool(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
 
 void dc_options_set_uint16(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
 
 void dc_options_set_in_port_t(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
 
+void dc_options_set_int32(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
+
+void dc_options_set_int64(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
+
+void dc_options_set_uint32(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
+
+void dc_options_set_uint64(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
+
+void dc_options_set_size_t(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
+
+void dc_options_set_double(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
+
+void dc_options_set_bytes(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
+
+void dc_options_set_duration(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
+
+void dc_options_set_list(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
+
+void dc_options_set_cpuset(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
+
+void dc_options_set_numa_policy(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting, const void *value, dc_setting_type type);
+
 const void *dc_string_from_string(const struct dc_env *env, struct dc_error *err, const char *str);
 
 const void *dc_flag_from_string(const struct dc_env *env, struct dc_error *err, const char *str);
@@ -87,6 +196,28 @@ const void *dc_uint16_from_string(const struct dc_env *env, struct dc_error *err
 
 const void *dc_in_port_t_from_string(const struct dc_env *env, struct dc_error *err, const char *str);
 
+const void *dc_int32_from_string(const struct dc_env *env, struct dc_error *err, const char *str);
+
+const void *dc_int64_from_string(const struct dc_env *env, struct dc_error *err, const char *str);
+
+const void *dc_uint32_from_string(const struct dc_env *env, struct dc_error *err, const char *str);
+
+const void *dc_uint64_from_string(const struct dc_env *env, struct dc_error *err, const char *str);
+
+const void *dc_size_t_from_string(const struct dc_env *env, struct dc_error *err, const char *str);
+
+const void *dc_double_from_string(const struct dc_env *env, struct dc_error *err, const char *str);
+
+const void *dc_bytes_from_string(const struct dc_env *env, struct dc_error *err, const char *str);
+
+const void *dc_duration_from_string(const struct dc_env *env, struct dc_error *err, const char *str);
+
+const void *dc_string_list_from_string(const struct dc_env *env, struct dc_error *err, const char *str);
+
+const void *dc_integer_list_from_string(const struct dc_env *env, struct dc_error *err, const char *str);
+
+const void *dc_endpoint_list_from_string(const struct dc_env *env, struct dc_error *err, const char *str);
+
 
 #ifdef __cplusplus
 }
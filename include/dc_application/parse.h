@@ -0,0 +1,162 @@
+#ifndef LIBDC_APPLICATION_PARSE_H
+#define LIBDC_APPLICATION_PARSE_H
+
+
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <dc_env/env.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Parsers that write into storage owned by the caller and never allocate. The whole string has to be a decimal
+ * number with an optional sign, anything else raises EINVAL, and a number that does not fit raises ERANGE.
+ */
+
+
+/**
+ *
+ * @param env
+ * @param err
+ * @param str
+ * @param value
+ * @return
+ */
+bool dc_parse_int32(const struct dc_env *env, struct dc_error *err, const char *str, int32_t *value);
+
+
+/**
+ *
+ * @param env
+ * @param err
+ * @param str
+ * @param value
+ * @return
+ */
+bool dc_parse_int64(const struct dc_env *env, struct dc_error *err, const char *str, int64_t *value);
+
+
+/**
+ *
+ * @param env
+ * @param err
+ * @param str
+ * @param value
+ * @return
+ */
+bool dc_parse_uint32(const struct dc_env *env, struct dc_error *err, const char *str, uint32_t *value);
+
+
+/**
+ *
+ * @param env
+ * @param err
+ * @param str
+ * @param value
+ * @return
+ */
+bool dc_parse_uint64(const struct dc_env *env, struct dc_error *err, const char *str, uint64_t *value);
+
+
+/**
+ *
+ * @param env
+ * @param err
+ * @param str
+ * @param value
+ * @return
+ */
+bool dc_parse_size_t(const struct dc_env *env, struct dc_error *err, const char *str, size_t *value);
+
+
+/**
+ * Parse a floating point number, which may have a fraction and an exponent.
+ *
+ * @param env
+ * @param err
+ * @param str
+ * @param value
+ * @return
+ */
+bool dc_parse_double(const struct dc_env *env, struct dc_error *err, const char *str, double *value);
+
+
+/**
+ * Parse a size in bytes. The number may have a fraction and is followed by an optional unit, either B, the binary
+ * units KiB, MiB, GiB, TiB, PiB, and EiB, or the decimal units kB (or KB), MB, GB, TB, PB, and EB.
+ *
+ * @param env
+ * @param err
+ * @param str
+ * @param value the number of bytes, any fraction of a byte is dropped.
+ * @return
+ */
+bool dc_parse_bytes(const struct dc_env *env, struct dc_error *err, const char *str, uint64_t *value);
+
+
+/**
+ * Parse a duration. The number may have a fraction and must be followed by one of the units ns, us, ms, s, m (or
+ * min), h, or d. Only 0 may be written without a unit.
+ *
+ * @param env
+ * @param err
+ * @param str
+ * @param value the number of nanoseconds, any fraction of a nanosecond is dropped.
+ * @return
+ */
+bool dc_parse_duration(const struct dc_env *env, struct dc_error *err, const char *str, uint64_t *value);
+
+
+/**
+ * Format a size in bytes using the largest binary unit that represents it exactly, so that it parses back to the
+ * same value.
+ *
+ * @param env
+ * @param value
+ * @param buffer
+ * @param size
+ * @return the number of characters that the whole string needs, as snprintf does.
+ */
+int dc_format_bytes(const struct dc_env *env, uint64_t value, char *buffer, size_t size);
+
+
+/**
+ * Format a duration in nanoseconds using the largest unit that represents it exactly, so that it parses back to the
+ * same value.
+ *
+ * @param env
+ * @param value
+ * @param buffer
+ * @param size
+ * @return the number of characters that the whole string needs, as snprintf does.
+ */
+int dc_format_duration(const struct dc_env *env, uint64_t value, char *buffer, size_t size);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // LIBDC_APPLICATION_PARSE_H
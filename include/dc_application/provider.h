@@ -0,0 +1,125 @@
+#ifndef LIBDC_APPLICATION_PROVIDER_H
+#define LIBDC_APPLICATION_PROVIDER_H
+
+
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "application.h"
+#include <dc_env/env.h>
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * A source of settings outside of the config file (a configuration service, a key-value store). fetch returns the
+ * settings in the config file syntax, allocated with dc_malloc, or NULL if there are none. It runs on its own thread and
+ * may still be running after READ_CONFIG if it is slow, data has to live as long as the process.
+ *
+ * What fetch returns is written to cache_path, if it is not NULL. A cache younger than ttl_ms is used without calling
+ * fetch at all. Otherwise READ_CONFIG waits up to timeout_ms, counted from when the fetch started, and then uses the
+ * cache, however old, as the last known good settings. A cache that is empty or does not parse is ignored.
+ */
+struct dc_config_provider
+{
+    const char *name;
+    char *(*fetch)(const struct dc_env *env, struct dc_error *err, void *data);
+    void *data;
+    const char *cache_path;
+    uint64_t ttl_ms;
+    uint64_t timeout_ms;
+};
+
+struct dc_config_providers;
+
+
+/**
+ *
+ * @param env
+ * @param err
+ * @return
+ */
+struct dc_config_providers *dc_config_providers_create(const struct dc_env *env, struct dc_error *err);
+
+/**
+ * Free the registry. A fetch that is still running frees its own state when it returns.
+ *
+ * @param env
+ * @param pproviders
+ */
+void dc_config_providers_destroy(const struct dc_env *env, struct dc_config_providers **pproviders);
+
+/**
+ * Register a provider, the registry keeps the pointer.
+ *
+ * @param env
+ * @param err
+ * @param providers
+ * @param provider
+ */
+void dc_config_providers_add(const struct dc_env *env,
+                             struct dc_error *err,
+                             struct dc_config_providers *providers,
+                             const struct dc_config_provider *provider);
+
+/**
+ * Read the caches and start a fetch for each provider without a fresh one. A fetch that cannot be started falls back
+ * to the cache.
+ *
+ * @param env
+ * @param err
+ * @param providers
+ */
+void dc_config_providers_start(const struct dc_env *env, struct dc_error *err, struct dc_config_providers *providers);
+
+/**
+ * Apply what each provider fetched, or its cache, as config settings. The providers are applied in the order they were
+ * added and a setting that is already set is kept, so a setting in the config file wins over the providers and an
+ * earlier provider wins over a later one.
+ *
+ * @param env
+ * @param err
+ * @param providers
+ * @param settings
+ */
+void dc_config_providers_apply(const struct dc_env *env,
+                               struct dc_error *err,
+                               struct dc_config_providers *providers,
+                               struct dc_application_settings *settings);
+
+/**
+ * A fetch for a local stand-in of a key-value store: connect to the unix domain socket named by data and read the
+ * settings until the other end closes the connection.
+ *
+ * @param env
+ * @param err
+ * @param data the socket path.
+ * @return the settings.
+ */
+char *dc_config_provider_unix_fetch(const struct dc_env *env, struct dc_error *err, void *data);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // LIBDC_APPLICATION_PROVIDER_H
@@ -0,0 +1,388 @@
+#ifndef LIBDC_APPLICATION_SCHEMA_H
+#define LIBDC_APPLICATION_SCHEMA_H
+
+
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "command_line.h"
+#include "config.h"
+#include "options.h"
+#include "settings.h"
+#include <dc_c/dc_stdlib.h>
+#include <getopt.h>
+#include <stddef.h>
+
+
+/*
+ * Generates the settings struct, the option table, the getopt flags, and the create and destroy functions from one
+ * description of the settings. The description is a macro that calls X once per setting and passes S through:
+ *
+ *     #define APP_SCHEMA(X, S) \
+ *         X(S, config_path, opts.parent.config_path, 0, "config", required_argument, 'c', "CONFIG", NULL, NULL, NULL, NULL) \
+ *         X(S, string, message, 0, "message", required_argument, 'm', "MESSAGE", "message", "Hello", NULL, NULL) \
+ *         X(S, uint16, workers, 0, "workers", long_required_argument, 0x100, "WORKERS", "workers", &(const uint16_t){4}, NULL, NULL)
+ *
+ *     DC_SCHEMA_STRUCT(app_settings, APP_SCHEMA)
+ *     DC_SCHEMA_DEFINE(app_settings, APP_SCHEMA, "APP_")
+ *
+ * The columns are:
+ *  - kind: string, regex, path, config_path, fd, dirfd, bool, uint16, in_port_t, int32, int64, uint32, uint64,
+ *    size_t, double, bytes, duration, string_list, integer_list, endpoint_list, cpuset, or numa_policy.
+ *  - member: the member of the struct, opts.parent.config_path for config_path. The warmup settings are declared with
+ *    their usual kinds on opts.parent.lock_memory, opts.parent.prefault (bool) and opts.parent.warmup_files
+ *    (string_list), the memory region ones on opts.parent.memory_region_size (bytes) and
+ *    opts.parent.memory_region_node (uint32), and the placement ones on opts.parent.cpuset (cpuset) and
+ *    opts.parent.numa_policy (numa_policy).
+ *  - arg: the pattern for regex, the open flags for fd and dirfd, ignored by the other kinds.
+ *  - the long option name.
+ *  - no_argument, required_argument or optional_argument. The long_ forms of those are for options without a short
+ *    form, their value has to be above UCHAR_MAX so it does not clash with a short option.
+ *  - the short option character.
+ *  - the environment variable (after the prefix), the config file key, the default, and the minimum and maximum.
+ *    The values are pointers as in struct options, file scope compound literals work for numbers.
+ *
+ * The option table and the flags are static const, so nothing is built when the settings are created.
+ * DC_SCHEMA_DEFINE has to be used at file scope, the functions it defines are <name>_create and <name>_destroy.
+ *
+ * Without an index the long option, environment variable and config key of each setting are found by searching the
+ * table. With the schema macro in a header of its own, dc_application_schema_index in cmake/DcApplicationSchema.cmake
+ * generates perfect hash indexes for all three at build time; include the generated <name>_index.h and use
+ * DC_SCHEMA_DEFINE_INDEXED instead.
+ */
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define DC_SCHEMA_MEMBER_string(member) struct dc_setting_string *member;
+#define DC_SCHEMA_CREATE_string(env, err, arg) dc_setting_string_create(env, err)
+#define DC_SCHEMA_DESTROY_string(env, psetting) dc_setting_string_destroy(env, psetting)
+#define DC_SCHEMA_SET_string dc_options_set_string
+#define DC_SCHEMA_FROM_STRING_string dc_string_from_string
+#define DC_SCHEMA_FROM_CONFIG_string dc_string_from_config
+
+#define DC_SCHEMA_MEMBER_regex(member) struct dc_setting_regex *member;
+#define DC_SCHEMA_CREATE_regex(env, err, arg) dc_setting_regex_create(env, err, arg)
+#define DC_SCHEMA_DESTROY_regex(env, psetting) dc_setting_regex_destroy(env, psetting)
+#define DC_SCHEMA_SET_regex dc_options_set_regex
+#define DC_SCHEMA_FROM_STRING_regex dc_string_from_string
+#define DC_SCHEMA_FROM_CONFIG_regex dc_string_from_config
+
+#define DC_SCHEMA_MEMBER_path(member) struct dc_setting_path *member;
+#define DC_SCHEMA_CREATE_path(env, err, arg) dc_setting_path_create(env, err)
+#define DC_SCHEMA_DESTROY_path(env, psetting) dc_setting_path_destroy(env, psetting)
+#define DC_SCHEMA_SET_path dc_options_set_path
+#define DC_SCHEMA_FROM_STRING_path dc_string_from_string
+#define DC_SCHEMA_FROM_CONFIG_path dc_string_from_config
+
+#define DC_SCHEMA_MEMBER_fd(member) struct dc_setting_fd *member;
+#define DC_SCHEMA_CREATE_fd(env, err, arg) dc_setting_fd_create(env, err, arg)
+#define DC_SCHEMA_DESTROY_fd(env, psetting) dc_setting_fd_destroy(env, psetting)
+#define DC_SCHEMA_SET_fd dc_options_set_fd
+#define DC_SCHEMA_FROM_STRING_fd dc_string_from_string
+#define DC_SCHEMA_FROM_CONFIG_fd dc_string_from_config
+
+#define DC_SCHEMA_MEMBER_dirfd(member) struct dc_setting_dirfd *member;
+#define DC_SCHEMA_CREATE_dirfd(env, err, arg) dc_setting_dirfd_create(env, err, arg)
+#define DC_SCHEMA_DESTROY_dirfd(env, psetting) dc_setting_dirfd_destroy(env, psetting)
+#define DC_SCHEMA_SET_dirfd dc_options_set_dirfd
+#define DC_SCHEMA_FROM_STRING_dirfd dc_string_from_string
+#define DC_SCHEMA_FROM_CONFIG_dirfd dc_string_from_config
+
+#define DC_SCHEMA_MEMBER_bool(member) struct dc_setting_bool *member;
+#define DC_SCHEMA_CREATE_bool(env, err, arg) dc_setting_bool_create(env, err)
+#define DC_SCHEMA_DESTROY_bool(env, psetting) dc_setting_bool_destroy(env, psetting)
+#define DC_SCHEMA_SET_bool dc_options_set_bool
+#define DC_SCHEMA_FROM_STRING_bool dc_flag_from_string
+#define DC_SCHEMA_FROM_CONFIG_bool dc_flag_from_config
+
+#define DC_SCHEMA_MEMBER_uint16(member) struct dc_setting_uint16 *member;
+#define DC_SCHEMA_CREATE_uint16(env, err, arg) dc_setting_uint16_create(env, err)
+#define DC_SCHEMA_DESTROY_uint16(env, psetting) dc_setting_uint16_destroy(env, psetting)
+#define DC_SCHEMA_SET_uint16 dc_options_set_uint16
+#define DC_SCHEMA_FROM_STRING_uint16 dc_uint16_from_string
+#define DC_SCHEMA_FROM_CONFIG_uint16 dc_uint16_from_config
+
+#define DC_SCHEMA_MEMBER_in_port_t(member) struct dc_setting_in_port_t *member;
+#define DC_SCHEMA_CREATE_in_port_t(env, err, arg) dc_setting_in_port_t_create(env, err)
+#define DC_SCHEMA_DESTROY_in_port_t(env, psetting) dc_setting_in_port_t_destroy(env, psetting)
+#define DC_SCHEMA_SET_in_port_t dc_options_set_in_port_t
+#define DC_SCHEMA_FROM_STRING_in_port_t dc_in_port_t_from_string
+#define DC_SCHEMA_FROM_CONFIG_in_port_t dc_in_port_t_from_config
+
+#define DC_SCHEMA_MEMBER_int32(member) struct dc_setting_int32 *member;
+#define DC_SCHEMA_CREATE_int32(env, err, arg) dc_setting_int32_create(env, err)
+#define DC_SCHEMA_DESTROY_int32(env, psetting) dc_setting_int32_destroy(env, psetting)
+#define DC_SCHEMA_SET_int32 dc_options_set_int32
+#define DC_SCHEMA_FROM_STRING_int32 dc_int32_from_string
+#define DC_SCHEMA_FROM_CONFIG_int32 dc_int32_from_config
+
+#define DC_SCHEMA_MEMBER_int64(member) struct dc_setting_int64 *member;
+#define DC_SCHEMA_CREATE_int64(env, err, arg) dc_setting_int64_create(env, err)
+#define DC_SCHEMA_DESTROY_int64(env, psetting) dc_setting_int64_destroy(env, psetting)
+#define DC_SCHEMA_SET_int64 dc_options_set_int64
+#define DC_SCHEMA_FROM_STRING_int64 dc_int64_from_string
+#define DC_SCHEMA_FROM_CONFIG_int64 dc_int64_from_config
+
+#define DC_SCHEMA_MEMBER_uint32(member) struct dc_setting_uint32 *member;
+#define DC_SCHEMA_CREATE_uint32(env, err, arg) dc_setting_uint32_create(env, err)
+#define DC_SCHEMA_DESTROY_uint32(env, psetting) dc_setting_uint32_destroy(env, psetting)
+#define DC_SCHEMA_SET_uint32 dc_options_set_uint32
+#define DC_SCHEMA_FROM_STRING_uint32 dc_uint32_from_string
+#define DC_SCHEMA_FROM_CONFIG_uint32 dc_uint32_from_config
+
+#define DC_SCHEMA_MEMBER_uint64(member) struct dc_setting_uint64 *member;
+#define DC_SCHEMA_CREATE_uint64(env, err, arg) dc_setting_uint64_create(env, err)
+#define DC_SCHEMA_DESTROY_uint64(env, psetting) dc_setting_uint64_destroy(env, psetting)
+#define DC_SCHEMA_SET_uint64 dc_options_set_uint64
+#define DC_SCHEMA_FROM_STRING_uint64 dc_uint64_from_string
+#define DC_SCHEMA_FROM_CONFIG_uint64 dc_uint64_from_config
+
+#define DC_SCHEMA_MEMBER_size_t(member) struct dc_setting_size_t *member;
+#define DC_SCHEMA_CREATE_size_t(env, err, arg) dc_setting_size_t_create(env, err)
+#define DC_SCHEMA_DESTROY_size_t(env, psetting) dc_setting_size_t_destroy(env, psetting)
+#define DC_SCHEMA_SET_size_t dc_options_set_size_t
+#define DC_SCHEMA_FROM_STRING_size_t dc_size_t_from_string
+#define DC_SCHEMA_FROM_CONFIG_size_t dc_size_t_from_config
+
+#define DC_SCHEMA_MEMBER_double(member) struct dc_setting_double *member;
+#define DC_SCHEMA_CREATE_double(env, err, arg) dc_setting_double_create(env, err)
+#define DC_SCHEMA_DESTROY_double(env, psetting) dc_setting_double_destroy(env, psetting)
+#define DC_SCHEMA_SET_double dc_options_set_double
+#define DC_SCHEMA_FROM_STRING_double dc_double_from_string
+#define DC_SCHEMA_FROM_CONFIG_double dc_double_from_config
+
+#define DC_SCHEMA_MEMBER_bytes(member) struct dc_setting_bytes *member;
+#define DC_SCHEMA_CREATE_bytes(env, err, arg) dc_setting_bytes_create(env, err)
+#define DC_SCHEMA_DESTROY_bytes(env, psetting) dc_setting_bytes_destroy(env, psetting)
+#define DC_SCHEMA_SET_bytes dc_options_set_bytes
+#define DC_SCHEMA_FROM_STRING_bytes dc_bytes_from_string
+#define DC_SCHEMA_FROM_CONFIG_bytes dc_bytes_from_config
+
+#define DC_SCHEMA_MEMBER_duration(member) struct dc_setting_duration *member;
+#define DC_SCHEMA_CREATE_duration(env, err, arg) dc_setting_duration_create(env, err)
+#define DC_SCHEMA_DESTROY_duration(env, psetting) dc_setting_duration_destroy(env, psetting)
+#define DC_SCHEMA_SET_duration dc_options_set_duration
+#define DC_SCHEMA_FROM_STRING_duration dc_duration_from_string
+#define DC_SCHEMA_FROM_CONFIG_duration dc_duration_from_config
+
+#define DC_SCHEMA_MEMBER_string_list(member) struct dc_setting_list *member;
+#define DC_SCHEMA_CREATE_string_list(env, err, arg) dc_setting_list_create(env, err, DC_LIST_STRING)
+#define DC_SCHEMA_DESTROY_string_list(env, psetting) dc_setting_list_destroy(env, psetting)
+#define DC_SCHEMA_SET_string_list dc_options_set_list
+#define DC_SCHEMA_FROM_STRING_string_list dc_string_list_from_string
+#define DC_SCHEMA_FROM_CONFIG_string_list dc_string_list_from_config
+
+#define DC_SCHEMA_MEMBER_integer_list(member) struct dc_setting_list *member;
+#define DC_SCHEMA_CREATE_integer_list(env, err, arg) dc_setting_list_create(env, err, DC_LIST_INTEGER)
+#define DC_SCHEMA_DESTROY_integer_list(env, psetting) dc_setting_list_destroy(env, psetting)
+#define DC_SCHEMA_SET_integer_list dc_options_set_list
+#define DC_SCHEMA_FROM_STRING_integer_list dc_integer_list_from_string
+#define DC_SCHEMA_FROM_CONFIG_integer_list dc_integer_list_from_config
+
+#define DC_SCHEMA_MEMBER_endpoint_list(member) struct dc_setting_list *member;
+#define DC_SCHEMA_CREATE_endpoint_list(env, err, arg) dc_setting_list_create(env, err, DC_LIST_ENDPOINT)
+#define DC_SCHEMA_DESTROY_endpoint_list(env, psetting) dc_setting_list_destroy(env, psetting)
+#define DC_SCHEMA_SET_endpoint_list dc_options_set_list
+#define DC_SCHEMA_FROM_STRING_endpoint_list dc_endpoint_list_from_string
+#define DC_SCHEMA_FROM_CONFIG_endpoint_list dc_endpoint_list_from_config
+
+#define DC_SCHEMA_MEMBER_cpuset(member) struct dc_setting_cpuset *member;
+#define DC_SCHEMA_CREATE_cpuset(env, err, arg) dc_setting_cpuset_create(env, err)
+#define DC_SCHEMA_DESTROY_cpuset(env, psetting) dc_setting_cpuset_destroy(env, psetting)
+#define DC_SCHEMA_SET_cpuset dc_options_set_cpuset
+#define DC_SCHEMA_FROM_STRING_cpuset dc_string_from_string
+#define DC_SCHEMA_FROM_CONFIG_cpuset dc_string_from_config
+
+#define DC_SCHEMA_MEMBER_numa_policy(member) struct dc_setting_numa_policy *member;
+#define DC_SCHEMA_CREATE_numa_policy(env, err, arg) dc_setting_numa_policy_create(env, err)
+#define DC_SCHEMA_DESTROY_numa_policy(env, psetting) dc_setting_numa_policy_destroy(env, psetting)
+#define DC_SCHEMA_SET_numa_policy dc_options_set_numa_policy
+#define DC_SCHEMA_FROM_STRING_numa_policy dc_string_from_string
+#define DC_SCHEMA_FROM_CONFIG_numa_policy dc_string_from_config
+
+// the config file path lives in struct dc_application_settings and is destroyed by the application
+#define DC_SCHEMA_MEMBER_config_path(member)
+#define DC_SCHEMA_CREATE_config_path(env, err, arg) dc_setting_path_create(env, err)
+#define DC_SCHEMA_DESTROY_config_path(env, psetting)
+#define DC_SCHEMA_SET_config_path dc_options_set_path
+#define DC_SCHEMA_FROM_STRING_config_path dc_string_from_string
+#define DC_SCHEMA_FROM_CONFIG_config_path dc_string_from_config
+
+#define DC_SCHEMA_HAS_ARG_no_argument no_argument
+#define DC_SCHEMA_HAS_ARG_required_argument required_argument
+#define DC_SCHEMA_HAS_ARG_optional_argument optional_argument
+#define DC_SCHEMA_HAS_ARG_long_no_argument no_argument
+#define DC_SCHEMA_HAS_ARG_long_required_argument required_argument
+#define DC_SCHEMA_HAS_ARG_long_optional_argument optional_argument
+
+#define DC_SCHEMA_FLAG_no_argument(c) c,
+#define DC_SCHEMA_FLAG_required_argument(c) c, ':',
+#define DC_SCHEMA_FLAG_optional_argument(c) c, ':', ':',
+#define DC_SCHEMA_FLAG_long_no_argument(c)
+#define DC_SCHEMA_FLAG_long_required_argument(c)
+#define DC_SCHEMA_FLAG_long_optional_argument(c)
+
+// the parameters are not named after the members of struct options since they are used as designators
+#define DC_SCHEMA_MEMBER(S, kind, member, arg, long_name, has_arg, short_name, env_name, config_name, default_val, min_val, max_val) \
+    DC_SCHEMA_MEMBER_##kind(member)
+
+#define DC_SCHEMA_OPTION(S, kind, member, arg, long_name, has_arg, short_name, env_name, config_name, default_val, min_val, max_val) \
+    {                                                     \
+        .setting = NULL,                                  \
+        .setting_func = DC_SCHEMA_SET_##kind,             \
+        .name = (long_name),                              \
+        .required = DC_SCHEMA_HAS_ARG_##has_arg,          \
+        .val = (short_name),                              \
+        .env_key = (env_name),                            \
+        .read_from_string = DC_SCHEMA_FROM_STRING_##kind, \
+        .config_key = (config_name),                      \
+        .read_from_config = DC_SCHEMA_FROM_CONFIG_##kind, \
+        .default_value = (default_val),                   \
+        .min_value = (min_val),                           \
+        .max_value = (max_val),                           \
+        .setting_offset = offsetof(struct S, member),     \
+    },
+
+#define DC_SCHEMA_FLAG(S, kind, member, arg, long_name, has_arg, short_name, env_name, config_name, default_val, min_val, max_val) \
+    DC_SCHEMA_FLAG_##has_arg(short_name)
+
+#define DC_SCHEMA_CREATE(S, kind, member, arg, long_name, has_arg, short_name, env_name, config_name, default_val, min_val, max_val) \
+    if(dc_error_has_no_error(err))                                   \
+    {                                                                \
+        settings->member = DC_SCHEMA_CREATE_##kind(env, err, (arg)); \
+    }
+
+#define DC_SCHEMA_DESTROY(S, kind, member, arg, long_name, has_arg, short_name, env_name, config_name, default_val, min_val, max_val) \
+    if(settings->member)                                  \
+    {                                                     \
+        DC_SCHEMA_DESTROY_##kind(env, &settings->member); \
+    }
+
+#define DC_SCHEMA_KEYS(S, kind, member, arg, long_name, has_arg, short_name, env_name, config_name, default_val, min_val, max_val) \
+    {(long_name), (env_name), (config_name)},
+
+// the keys of one option in table order, what tools/schema_index.c builds the indexes from
+struct dc_schema_keys
+{
+    const char *name;
+    const char *env_key;
+    const char *config_key;
+};
+
+/**
+ * Declare struct S holding the dc_opt_settings followed by a member for each setting.
+ */
+#define DC_SCHEMA_STRUCT(S, SCHEMA)  \
+    struct S                         \
+    {                                \
+        struct dc_opt_settings opts; \
+        SCHEMA(DC_SCHEMA_MEMBER, S)  \
+    };
+
+/**
+ * Define S_options, S_flags, S_create and S_destroy. S_create and S_destroy are the create_settings and
+ * destroy_settings functions for dc_application_run.
+ */
+#define DC_SCHEMA_DEFINE(S, SCHEMA, prefix) DC_SCHEMA_DEFINE_WITH_INDEX(S, SCHEMA, prefix, NULL, NULL, NULL)
+
+/**
+ * DC_SCHEMA_DEFINE for settings that have indexes generated by dc_application_schema_index. The generated
+ * S_index.h has to be included before this.
+ */
+#define DC_SCHEMA_DEFINE_INDEXED(S, SCHEMA, prefix) \
+    DC_SCHEMA_DEFINE_WITH_INDEX(S, SCHEMA, prefix, &S##_name_index, &S##_env_index, &S##_config_index)
+
+#define DC_SCHEMA_DEFINE_WITH_INDEX(S, SCHEMA, prefix, name_idx, env_idx, config_idx)                                  \
+    static const struct options S##_options[] =                                                                        \
+    {                                                                                                                  \
+        SCHEMA(DC_SCHEMA_OPTION, S)                                                                                    \
+        {0},                                                                                                           \
+    };                                                                                                                 \
+                                                                                                                       \
+    static const char S##_flags[] = {SCHEMA(DC_SCHEMA_FLAG, S) '\0'};                                                  \
+                                                                                                                       \
+    static void S##_free(const struct dc_env *env, struct S *settings)                                                 \
+    {                                                                                                                  \
+        SCHEMA(DC_SCHEMA_DESTROY, S)                                                                                   \
+                                                                                                                       \
+        if(settings->opts.response_files)                                                                              \
+        {                                                                                                              \
+            dc_command_line_release_response_files(env, &settings->opts.response_files);                              \
+        }                                                                                                              \
+                                                                                                                       \
+        dc_free(env, settings);                                                                                        \
+    }                                                                                                                  \
+                                                                                                                       \
+    static struct dc_application_settings *S##_create(const struct dc_env *env, struct dc_error *err)                  \
+    {                                                                                                                  \
+        struct S *settings;                                                                                            \
+                                                                                                                       \
+        DC_TRACE(env);                                                                                                 \
+        settings = dc_calloc(env, err, 1, sizeof(struct S));                                                           \
+                                                                                                                       \
+        if(dc_error_has_error(err))                                                                                    \
+        {                                                                                                              \
+            return NULL;                                                                                               \
+        }                                                                                                              \
+                                                                                                                       \
+        settings->opts.opts = S##_options;                                                                             \
+        settings->opts.opts_count = sizeof(S##_options) / sizeof(S##_options[0]);                                      \
+        settings->opts.opts_size = sizeof(struct options);                                                             \
+        settings->opts.flags = S##_flags;                                                                              \
+        settings->opts.env_prefix = (prefix);                                                                          \
+        settings->opts.name_index = (name_idx);                                                                        \
+        settings->opts.env_index = (env_idx);                                                                          \
+        settings->opts.config_index = (config_idx);                                                                    \
+        SCHEMA(DC_SCHEMA_CREATE, S)                                                                                    \
+                                                                                                                       \
+        if(dc_error_has_error(err))                                                                                    \
+        {                                                                                                              \
+            if(settings->opts.parent.config_path)                                                                      \
+            {                                                                                                          \
+                dc_setting_path_destroy(env, &settings->opts.parent.config_path);                                      \
+            }                                                                                                          \
+                                                                                                                       \
+            S##_free(env, settings);                                                                                   \
+            settings = NULL;                                                                                           \
+        }                                                                                                              \
+                                                                                                                       \
+        return (struct dc_application_settings *)settings;                                                             \
+    }                                                                                                                  \
+                                                                                                                       \
+    _Pragma("GCC diagnostic push")                                                                                     \
+    _Pragma("GCC diagnostic ignored \"-Wunused-parameter\"")                                                           \
+    static int S##_destroy(const struct dc_env *env, struct dc_error *err, struct dc_application_settings **psettings) \
+    {                                                                                                                  \
+        DC_TRACE(env);                                                                                                 \
+        S##_free(env, (struct S *)*psettings);                                                                         \
+        *psettings = NULL;                                                                                             \
+                                                                                                                       \
+        return 0;                                                                                                      \
+    }                                                                                                                  \
+    _Pragma("GCC diagnostic pop")
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // LIBDC_APPLICATION_SCHEMA_H
@@ -0,0 +1,341 @@
+#ifndef LIBDC_APPLICATION_SEGMENT_H
+#define LIBDC_APPLICATION_SEGMENT_H
+
+
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "application.h"
+#include "settings.h"
+#include <dc_env/env.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/**
+ * The environment variable used to hand the segment file descriptor to child processes.
+ */
+#define DC_SETTINGS_SEGMENT_ENV_VAR "DC_SETTINGS_SEGMENT"
+
+/**
+ * The size of the name a segment is published under, including the NUL.
+ */
+#define DC_SETTINGS_SEGMENT_NAME_SIZE 64U
+
+struct dc_settings_segment;
+
+
+/**
+ * Serialize the resolved settings into a sealed memfd that other processes can map read-only.
+ *
+ * @param env
+ * @param err
+ * @param name identifies the application, only processes attaching with the same name accept the segment.
+ * @param settings
+ * @return
+ */
+struct dc_settings_segment *dc_settings_segment_publish(const struct dc_env *env,
+                                                        struct dc_error *err,
+                                                        const char *name,
+                                                        const struct dc_application_settings *settings);
+
+
+/**
+ * Map a segment published by another process read-only. The descriptor has to carry the seals the publisher adds
+ * and the segment has to be published under name.
+ *
+ * @param env
+ * @param err
+ * @param fd
+ * @param name
+ * @return
+ */
+struct dc_settings_segment *dc_settings_segment_attach(const struct dc_env *env, struct dc_error *err, int fd, const char *name);
+
+
+/**
+ * Attach to the segment named by DC_SETTINGS_SEGMENT_ENV_VAR, if there is one. Once attached the variable is removed
+ * and the descriptor is closed on exec again, so the segment does not reach the processes this one starts.
+ *
+ * @param env
+ * @param err
+ * @param name
+ * @return NULL if the environment variable is not set.
+ */
+struct dc_settings_segment *dc_settings_segment_attach_from_environment(const struct dc_env *env,
+                                                                         struct dc_error *err,
+                                                                         const char *name);
+
+
+/**
+ *
+ * @param env
+ * @param psegment
+ */
+void dc_settings_segment_destroy(const struct dc_env *env, struct dc_settings_segment **psegment);
+
+
+/**
+ * Make the segment inheritable across exec and advertise it in DC_SETTINGS_SEGMENT_ENV_VAR.
+ *
+ * @param env
+ * @param err
+ * @param segment
+ * @return
+ */
+int dc_settings_segment_export(const struct dc_env *env, struct dc_error *err, const struct dc_settings_segment *segment);
+
+
+/**
+ * Copy the values from the segment into settings, keeping the source each value originally came from.
+ *
+ * @param env
+ * @param err
+ * @param segment
+ * @param settings
+ * @return
+ */
+int dc_settings_segment_apply(const struct dc_env *env,
+                              struct dc_error *err,
+                              const struct dc_settings_segment *segment,
+                              struct dc_application_settings *settings);
+
+
+/**
+ * Signal readers that the segment is stale. Only the publishing process can do this.
+ *
+ * @param env
+ * @param segment
+ * @return the new generation.
+ */
+uint64_t dc_settings_segment_invalidate(const struct dc_env *env, struct dc_settings_segment *segment);
+
+
+/**
+ *
+ * @param env
+ * @param segment
+ * @return
+ */
+uint64_t dc_settings_segment_get_generation(const struct dc_env *env, const struct dc_settings_segment *segment);
+
+
+/**
+ *
+ * @param env
+ * @param segment
+ * @return
+ */
+int dc_settings_segment_get_fd(const struct dc_env *env, const struct dc_settings_segment *segment);
+
+
+/**
+ *
+ * @param env
+ * @param segment
+ * @return
+ */
+size_t dc_settings_segment_get_count(const struct dc_env *env, const struct dc_settings_segment *segment);
+
+
+/**
+ *
+ * @param env
+ * @param segment
+ * @param name
+ * @return the index of the setting, or -1 if there is no setting with that name.
+ */
+ssize_t dc_settings_segment_find(const struct dc_env *env, const struct dc_settings_segment *segment, const char *name);
+
+
+/**
+ *
+ * @param env
+ * @param segment
+ * @param index
+ * @return
+ */
+const char *dc_settings_segment_get_name(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index);
+
+
+/**
+ *
+ * @param env
+ * @param segment
+ * @param index
+ * @return
+ */
+dc_setting_kind dc_settings_segment_get_kind(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index);
+
+
+/**
+ *
+ * @param env
+ * @param segment
+ * @param index
+ * @return
+ */
+dc_setting_type dc_settings_segment_get_type(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index);
+
+
+/**
+ * Get a string, regex, or path value. The returned string points into the segment.
+ *
+ * @param env
+ * @param segment
+ * @param index
+ * @return NULL if the setting at index does not hold a string or was never set.
+ */
+const char *dc_settings_segment_get_string(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index);
+
+
+/**
+ *
+ * @param env
+ * @param segment
+ * @param index
+ * @return false if the setting at index is not a bool or was never set.
+ */
+bool dc_settings_segment_get_bool(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index);
+
+
+/**
+ *
+ * @param env
+ * @param segment
+ * @param index
+ * @return 0 if the setting at index is not a uint16 or was never set.
+ */
+uint16_t dc_settings_segment_get_uint16(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index);
+
+
+/**
+ *
+ * @param env
+ * @param segment
+ * @param index
+ * @return 0 if the setting at index is not a in_port_t or was never set.
+ */
+in_port_t dc_settings_segment_get_in_port_t(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index);
+
+
+/**
+ *
+ * @param env
+ * @param segment
+ * @param index
+ * @return 0 if the setting at index is not a int32 or was never set.
+ */
+int32_t dc_settings_segment_get_int32(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index);
+
+
+/**
+ *
+ * @param env
+ * @param segment
+ * @param index
+ * @return 0 if the setting at index is not a int64 or was never set.
+ */
+int64_t dc_settings_segment_get_int64(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index);
+
+
+/**
+ *
+ * @param env
+ * @param segment
+ * @param index
+ * @return 0 if the setting at index is not a uint32 or was never set.
+ */
+uint32_t dc_settings_segment_get_uint32(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index);
+
+
+/**
+ *
+ * @param env
+ * @param segment
+ * @param index
+ * @return 0 if the setting at index is not a uint64 or was never set.
+ */
+uint64_t dc_settings_segment_get_uint64(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index);
+
+
+/**
+ *
+ * @param env
+ * @param segment
+ * @param index
+ * @return 0 if the setting at index is not a size_t or was never set.
+ */
+size_t dc_settings_segment_get_size_t(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index);
+
+
+/**
+ *
+ * @param env
+ * @param segment
+ * @param index
+ * @return 0 if the setting at index is not a double or was never set.
+ */
+double dc_settings_segment_get_double(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index);
+
+
+/**
+ *
+ * @param env
+ * @param segment
+ * @param index
+ * @return 0 if the setting at index is not a bytes or was never set.
+ */
+uint64_t dc_settings_segment_get_bytes(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index);
+
+
+/**
+ *
+ * @param env
+ * @param segment
+ * @param index
+ * @return 0 if the setting at index is not a duration or was never set.
+ */
+uint64_t dc_settings_segment_get_duration(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index);
+
+
+/**
+ * Get a copy of a list value, the segment itself may not be aligned for reading a list in place.
+ *
+ * @param env
+ * @param err
+ * @param segment
+ * @param index
+ * @return a list that the caller destroys, or NULL if the setting is not a list or is not set.
+ */
+struct dc_list *dc_settings_segment_get_list(const struct dc_env *env,
+                                             struct dc_error *err,
+                                             const struct dc_settings_segment *segment,
+                                             size_t index);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // LIBDC_APPLICATION_SEGMENT_H
@@ -19,6 +19,9 @@
  */
 
 
+#include "affinity.h"
+#include "list.h"
+#include "matcher.h"
 #include <arpa/inet.h>
 #include <dc_env/env.h>
 #include <stdint.h>
@@ -39,19 +42,71 @@ typedef enum
     DC_SETTING_COMMAND_LINE,
     DC_SETTING_ENVIRONMENT,
     DC_SETTING_CONFIG,
+    DC_SETTING_RUNTIME,
 } dc_setting_type;
 
+typedef enum
+{
+    DC_SETTING_KIND_STRING,
+    DC_SETTING_KIND_REGEX,
+    DC_SETTING_KIND_PATH,
+    DC_SETTING_KIND_FD,
+    DC_SETTING_KIND_DIRFD,
+    DC_SETTING_KIND_BOOL,
+    DC_SETTING_KIND_UINT16,
+    DC_SETTING_KIND_IN_PORT_T,
+    DC_SETTING_KIND_INT32,
+    DC_SETTING_KIND_INT64,
+    DC_SETTING_KIND_UINT32,
+    DC_SETTING_KIND_UINT64,
+    DC_SETTING_KIND_SIZE_T,
+    DC_SETTING_KIND_DOUBLE,
+    DC_SETTING_KIND_BYTES,
+    DC_SETTING_KIND_DURATION,
+    DC_SETTING_KIND_LIST,
+    DC_SETTING_KIND_CPUSET,
+    DC_SETTING_KIND_NUMA_POLICY,
+} dc_setting_kind;
+
 struct dc_setting
 {
     dc_setting_type type;
+    dc_setting_kind kind;
+    size_t slot;
+
+    // the generation current when the slot was given to the setting, only snapshots published after it hold its value
+    uint64_t registered_at;
 };
 
+struct dc_setting_subscription;
+struct dc_settings_notifier;
+
+/**
+ * Called once per transaction with every setting the subscriber is interested in that changed.
+ */
+typedef void (*dc_setting_callback)(const struct dc_env *env,
+                                    struct dc_setting *const *settings,
+                                    size_t count, void *ctx);
+
 struct dc_setting_string;
 struct dc_setting_regex;
 struct dc_setting_path;
+struct dc_setting_fd;
+struct dc_setting_dirfd;
 struct dc_setting_bool;
 struct dc_setting_uint16;
 struct dc_setting_in_port_t;
+struct dc_setting_int32;
+struct dc_setting_int64;
+struct dc_setting_uint32;
+struct dc_setting_uint64;
+struct dc_setting_size_t;
+struct dc_setting_double;
+struct dc_setting_bytes;
+struct dc_setting_duration;
+struct dc_setting_list;
+struct dc_setting_cpuset;
+struct dc_setting_numa_policy;
 
 
 /**
@@ -64,6 +119,215 @@ bool dc_setting_is_set(const struct dc_env *env,
                        struct dc_setting *setting);
 
 
+/**
+ * Get the kind of value the setting holds so that it can be handled generically.
+ *
+ * @param env
+ * @param setting
+ * @return
+ */
+dc_setting_kind dc_setting_get_kind(const struct dc_env *env,
+                                    const struct dc_setting *setting);
+
+
+/**
+ * Start a group of updates. Updates are serialized, readers are never blocked.
+ *
+ * @param env
+ */
+void dc_settings_transaction_begin(const struct dc_env *env);
+
+
+/**
+ * Finish a group of updates, publish them, and notify the subscribers of the settings that changed.
+ * If the snapshot can not be published the generation stays where it was.
+ *
+ * @param env
+ * @param err
+ * @return the new generation.
+ */
+uint64_t dc_settings_transaction_commit(const struct dc_env *env, struct dc_error *err);
+
+
+/**
+ *
+ * @param env
+ * @return the number of committed transactions.
+ */
+uint64_t dc_settings_get_generation(const struct dc_env *env);
+
+
+/**
+ * Replace the value of a setting even if it has already been set. Must be called inside a transaction.
+ *
+ * @param env
+ * @param err
+ * @param setting
+ * @param value the same representation the options setting functions take.
+ * @param type
+ * @return
+ */
+bool dc_setting_update(const struct dc_env *env, struct dc_error *err,
+                       struct dc_setting *setting, const void *value,
+                       dc_setting_type type);
+
+
+/**
+ * Write the value of a setting as a string.
+ *
+ * @param env
+ * @param setting
+ * @param buffer
+ * @param size
+ * @return the length of the value, as snprintf does.
+ */
+int dc_setting_format(const struct dc_env *env, struct dc_setting *setting,
+                      char *buffer, size_t size);
+
+
+/**
+ * Call callback when the setting changes. The callback runs on the thread that commits the transaction, after the
+ * transaction has been published. Subscribing several settings with the same callback and ctx gets one call per
+ * transaction for all of them.
+ *
+ * @param env
+ * @param err
+ * @param setting
+ * @param callback
+ * @param ctx
+ * @return
+ */
+struct dc_setting_subscription *dc_setting_subscribe(const struct dc_env *env, struct dc_error *err,
+                                                     struct dc_setting *setting,
+                                                     dc_setting_callback callback, void *ctx);
+
+
+/**
+ * Like dc_setting_subscribe, but the callback runs on whichever thread calls dc_settings_notifier_dispatch.
+ * Notifications that pile up before dispatch are coalesced into one call per subscriber.
+ *
+ * @param env
+ * @param err
+ * @param setting
+ * @param callback
+ * @param ctx
+ * @param notifier
+ * @return
+ */
+struct dc_setting_subscription *dc_setting_subscribe_on(const struct dc_env *env, struct dc_error *err,
+                                                        struct dc_setting *setting,
+                                                        dc_setting_callback callback, void *ctx,
+                                                        struct dc_settings_notifier *notifier);
+
+
+/**
+ *
+ * @param env
+ * @param psubscription
+ */
+void dc_setting_unsubscribe(const struct dc_env *env, struct dc_setting_subscription **psubscription);
+
+
+/**
+ * Create a queue of notifications for an event loop or worker thread.
+ *
+ * @param env
+ * @param err
+ * @return
+ */
+struct dc_settings_notifier *dc_settings_notifier_create(const struct dc_env *env, struct dc_error *err);
+
+
+/**
+ * Subscriptions using the notifier must be removed first.
+ *
+ * @param env
+ * @param pnotifier
+ */
+void dc_settings_notifier_destroy(const struct dc_env *env, struct dc_settings_notifier **pnotifier);
+
+
+/**
+ * Get a descriptor that becomes readable when there are notifications to dispatch.
+ *
+ * @param env
+ * @param notifier
+ * @return
+ */
+int dc_settings_notifier_get_fd(const struct dc_env *env, const struct dc_settings_notifier *notifier);
+
+
+/**
+ * Run the pending callbacks on the calling thread.
+ *
+ * @param env
+ * @param notifier
+ * @return the number of callbacks that were run.
+ */
+size_t dc_settings_notifier_dispatch(const struct dc_env *env, struct dc_settings_notifier *notifier);
+
+
+/**
+ * Publish a snapshot of the current values. Done on every commit, and by the lifecycle once the settings are resolved.
+ *
+ * @param env
+ * @param err
+ * @return the new generation.
+ */
+uint64_t dc_settings_publish(const struct dc_env *env, struct dc_error *err);
+
+
+/**
+ * Mark a quiescent point for the calling thread: it is not holding on to any setting value it got earlier. If a newer
+ * snapshot has been published the thread switches to it, otherwise this is a couple of plain loads.
+ * Until the next call the getters on this thread read the thread's snapshot without any atomic operations, so
+ * call this where a thread starts a new unit of work, such as the top of an event loop iteration.
+ * String and list values replaced at runtime are freed once every quiescing thread has passed the generation that
+ * replaced them, so a thread that reads them while updates can happen has to quiesce.
+ *
+ * @param env
+ * @param err
+ */
+void dc_settings_quiesce(const struct dc_env *env, struct dc_error *err);
+
+
+/**
+ * Stop reading from a snapshot on the calling thread, so that a thread that is going to block for a long time does
+ * not hold up freeing old snapshots. The getters go back to reading the settings directly until the next quiesce.
+ *
+ * @param env
+ */
+void dc_settings_offline(const struct dc_env *env);
+
+
+/**
+ * Free the values replaced by updates. Only safe once no other thread can be reading settings.
+ *
+ * @param env
+ */
+void dc_settings_reclaim(const struct dc_env *env);
+
+
+/**
+ * Get the shared copy of a string, the same buffer string settings hold. Equal strings get the same pointer so they
+ * can be compared with ==.
+ *
+ * @param env
+ * @param err
+ * @param string
+ * @return the interned string, released with dc_settings_intern_release.
+ */
+const char *dc_settings_intern(const struct dc_env *env, struct dc_error *err, const char *string);
+
+
+/**
+ *
+ * @param env
+ * @param string a string returned by dc_settings_intern, anything else is ignored.
+ */
+void dc_settings_intern_release(const struct dc_env *env, const char *string);
+
+
 /**
  *
  * @param env
@@ -152,6 +416,17 @@ const char *dc_setting_regex_get(const struct dc_env *env,
                                  struct dc_setting_regex *setting);
 
 
+/**
+ * Get the matcher that values of the setting are checked with, so that other strings can be checked against the
+ * same pattern without compiling it again.
+ *
+ * @param env
+ * @param setting
+ * @return
+ */
+const struct dc_matcher *dc_setting_regex_get_matcher(const struct dc_env *env, const struct dc_setting_regex *setting);
+
+
 /**
  *
  * @param env
@@ -195,6 +470,110 @@ const char *dc_setting_path_get(const struct dc_env *env,
                                 struct dc_setting_path *setting);
 
 
+/**
+ * A file that is opened when the setting is resolved.
+ *
+ * @param env
+ * @param err
+ * @param flags the open flags, such as O_RDONLY | O_CLOEXEC.
+ * @return
+ */
+struct dc_setting_fd *dc_setting_fd_create(const struct dc_env *env, struct dc_error *err, int flags);
+
+
+/**
+ * Closes the descriptor.
+ *
+ * @param env
+ * @param psetting
+ */
+void dc_setting_fd_destroy(const struct dc_env *env, struct dc_setting_fd **psetting);
+
+
+/**
+ * Expand and open the path. Failing to open it is an error, so a bad path is reported when the settings are resolved.
+ *
+ * @param env
+ * @param err
+ * @param setting
+ * @param value the path.
+ * @param type
+ * @return
+ */
+bool dc_setting_fd_set(const struct dc_env *env, struct dc_error *err, struct dc_setting_fd *setting, const char *value, dc_setting_type type);
+
+
+/**
+ * A runtime update opens the new path and the old descriptor is closed once no quiescing thread can be using it.
+ *
+ * @param env
+ * @param setting
+ * @return the descriptor, -1 if the setting is not set.
+ */
+int dc_setting_fd_get(const struct dc_env *env, struct dc_setting_fd *setting);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @return the expanded path that was opened.
+ */
+const char *dc_setting_fd_get_path(const struct dc_env *env, struct dc_setting_fd *setting);
+
+
+/**
+ * A directory that is opened when the setting is resolved, O_DIRECTORY is added to the flags.
+ *
+ * @param env
+ * @param err
+ * @param flags the open flags, such as O_RDONLY | O_CLOEXEC.
+ * @return
+ */
+struct dc_setting_dirfd *dc_setting_dirfd_create(const struct dc_env *env, struct dc_error *err, int flags);
+
+
+/**
+ * Closes the descriptor.
+ *
+ * @param env
+ * @param psetting
+ */
+void dc_setting_dirfd_destroy(const struct dc_env *env, struct dc_setting_dirfd **psetting);
+
+
+/**
+ * Expand and open the path. Failing to open it is an error, so a bad path is reported when the settings are resolved.
+ *
+ * @param env
+ * @param err
+ * @param setting
+ * @param value the path.
+ * @param type
+ * @return
+ */
+bool dc_setting_dirfd_set(const struct dc_env *env, struct dc_error *err, struct dc_setting_dirfd *setting, const char *value, dc_setting_type type);
+
+
+/**
+ * A runtime update opens the new path and the old descriptor is closed once no quiescing thread can be using it.
+ *
+ * @param env
+ * @param setting
+ * @return the descriptor for openat and the other *at functions, -1 if the setting is not set.
+ */
+int dc_setting_dirfd_get(const struct dc_env *env, struct dc_setting_dirfd *setting);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @return the expanded path that was opened.
+ */
+const char *dc_setting_dirfd_get_path(const struct dc_env *env, struct dc_setting_dirfd *setting);
+
+
 /**
  *
  * @param env
@@ -312,6 +691,454 @@ bool dc_setting_in_port_t_set(const struct dc_env *env, struct dc_setting_in_por
 in_port_t dc_setting_in_port_t_get(const struct dc_env *env, struct dc_setting_in_port_t *setting);
 
 
+/**
+ *
+ * @param env
+ * @param err
+ * @return
+ */
+struct dc_setting_int32 *dc_setting_int32_create(const struct dc_env *env, struct dc_error *err);
+
+
+/**
+ *
+ * @param env
+ * @param psetting
+ */
+void dc_setting_int32_destroy(const struct dc_env *env,  struct dc_setting_int32 **psetting);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @param value
+ * @param type
+ * @return
+ */
+bool dc_setting_int32_set(const struct dc_env *env, struct dc_setting_int32 *setting, int32_t value, dc_setting_type type);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @return
+ */
+int32_t dc_setting_int32_get(const struct dc_env *env, struct dc_setting_int32 *setting);
+
+
+/**
+ *
+ * @param env
+ * @param err
+ * @return
+ */
+struct dc_setting_int64 *dc_setting_int64_create(const struct dc_env *env, struct dc_error *err);
+
+
+/**
+ *
+ * @param env
+ * @param psetting
+ */
+void dc_setting_int64_destroy(const struct dc_env *env,  struct dc_setting_int64 **psetting);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @param value
+ * @param type
+ * @return
+ */
+bool dc_setting_int64_set(const struct dc_env *env, struct dc_setting_int64 *setting, int64_t value, dc_setting_type type);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @return
+ */
+int64_t dc_setting_int64_get(const struct dc_env *env, struct dc_setting_int64 *setting);
+
+
+/**
+ *
+ * @param env
+ * @param err
+ * @return
+ */
+struct dc_setting_uint32 *dc_setting_uint32_create(const struct dc_env *env, struct dc_error *err);
+
+
+/**
+ *
+ * @param env
+ * @param psetting
+ */
+void dc_setting_uint32_destroy(const struct dc_env *env,  struct dc_setting_uint32 **psetting);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @param value
+ * @param type
+ * @return
+ */
+bool dc_setting_uint32_set(const struct dc_env *env, struct dc_setting_uint32 *setting, uint32_t value, dc_setting_type type);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @return
+ */
+uint32_t dc_setting_uint32_get(const struct dc_env *env, struct dc_setting_uint32 *setting);
+
+
+/**
+ *
+ * @param env
+ * @param err
+ * @return
+ */
+struct dc_setting_uint64 *dc_setting_uint64_create(const struct dc_env *env, struct dc_error *err);
+
+
+/**
+ *
+ * @param env
+ * @param psetting
+ */
+void dc_setting_uint64_destroy(const struct dc_env *env,  struct dc_setting_uint64 **psetting);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @param value
+ * @param type
+ * @return
+ */
+bool dc_setting_uint64_set(const struct dc_env *env, struct dc_setting_uint64 *setting, uint64_t value, dc_setting_type type);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @return
+ */
+uint64_t dc_setting_uint64_get(const struct dc_env *env, struct dc_setting_uint64 *setting);
+
+
+/**
+ *
+ * @param env
+ * @param err
+ * @return
+ */
+struct dc_setting_size_t *dc_setting_size_t_create(const struct dc_env *env, struct dc_error *err);
+
+
+/**
+ *
+ * @param env
+ * @param psetting
+ */
+void dc_setting_size_t_destroy(const struct dc_env *env,  struct dc_setting_size_t **psetting);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @param value
+ * @param type
+ * @return
+ */
+bool dc_setting_size_t_set(const struct dc_env *env, struct dc_setting_size_t *setting, size_t value, dc_setting_type type);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @return
+ */
+size_t dc_setting_size_t_get(const struct dc_env *env, struct dc_setting_size_t *setting);
+
+
+/**
+ *
+ * @param env
+ * @param err
+ * @return
+ */
+struct dc_setting_double *dc_setting_double_create(const struct dc_env *env, struct dc_error *err);
+
+
+/**
+ *
+ * @param env
+ * @param psetting
+ */
+void dc_setting_double_destroy(const struct dc_env *env,  struct dc_setting_double **psetting);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @param value
+ * @param type
+ * @return
+ */
+bool dc_setting_double_set(const struct dc_env *env, struct dc_setting_double *setting, double value, dc_setting_type type);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @return
+ */
+double dc_setting_double_get(const struct dc_env *env, struct dc_setting_double *setting);
+
+
+/**
+ *
+ * @param env
+ * @param err
+ * @return
+ */
+struct dc_setting_bytes *dc_setting_bytes_create(const struct dc_env *env, struct dc_error *err);
+
+
+/**
+ *
+ * @param env
+ * @param psetting
+ */
+void dc_setting_bytes_destroy(const struct dc_env *env,  struct dc_setting_bytes **psetting);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @param value
+ * @param type
+ * @return
+ */
+bool dc_setting_bytes_set(const struct dc_env *env, struct dc_setting_bytes *setting, uint64_t value, dc_setting_type type);
+
+
+/**
+ * The value is a number of bytes, the string and config forms accept suffixes such as 64KiB or 2GB.
+ *
+ * @param env
+ * @param setting
+ * @return
+ */
+uint64_t dc_setting_bytes_get(const struct dc_env *env, struct dc_setting_bytes *setting);
+
+
+/**
+ *
+ * @param env
+ * @param err
+ * @return
+ */
+struct dc_setting_duration *dc_setting_duration_create(const struct dc_env *env, struct dc_error *err);
+
+
+/**
+ *
+ * @param env
+ * @param psetting
+ */
+void dc_setting_duration_destroy(const struct dc_env *env,  struct dc_setting_duration **psetting);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @param value
+ * @param type
+ * @return
+ */
+bool dc_setting_duration_set(const struct dc_env *env, struct dc_setting_duration *setting, uint64_t value, dc_setting_type type);
+
+
+/**
+ * The value is a number of nanoseconds, the string and config forms need a unit such as 250ms or 1.5s.
+ *
+ * @param env
+ * @param setting
+ * @return
+ */
+uint64_t dc_setting_duration_get(const struct dc_env *env, struct dc_setting_duration *setting);
+
+
+/**
+ *
+ * @param env
+ * @param err
+ * @param element the kind of element that every value of the setting must hold.
+ * @return
+ */
+struct dc_setting_list *dc_setting_list_create(const struct dc_env *env, struct dc_error *err, dc_list_element element);
+
+
+/**
+ *
+ * @param env
+ * @param psetting
+ */
+void dc_setting_list_destroy(const struct dc_env *env,  struct dc_setting_list **psetting);
+
+
+/**
+ * The setting keeps its own copy of the list.
+ *
+ * @param env
+ * @param err
+ * @param setting
+ * @param value
+ * @param type
+ * @return
+ */
+bool dc_setting_list_set(const struct dc_env *env,
+                         struct dc_error *err,
+                         struct dc_setting_list *setting,
+                         const struct dc_list *value,
+                         dc_setting_type type);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @return
+ */
+const struct dc_list *dc_setting_list_get(const struct dc_env *env, struct dc_setting_list *setting);
+
+
+/**
+ *
+ * @param env
+ * @param err
+ * @return
+ */
+struct dc_setting_cpuset *dc_setting_cpuset_create(const struct dc_env *env, struct dc_error *err);
+
+
+/**
+ *
+ * @param env
+ * @param psetting
+ */
+void dc_setting_cpuset_destroy(const struct dc_env *env,  struct dc_setting_cpuset **psetting);
+
+
+/**
+ * The value is a set such as 0-7,16-23, it is kept in the form dc_cpuset_format writes.
+ *
+ * @param env
+ * @param err
+ * @param setting
+ * @param value
+ * @param type
+ * @return
+ */
+bool dc_setting_cpuset_set(const struct dc_env *env,
+                           struct dc_error *err,
+                           struct dc_setting_cpuset *setting,
+                           const char *value,
+                           dc_setting_type type);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @return
+ */
+const char *dc_setting_cpuset_get(const struct dc_env *env, struct dc_setting_cpuset *setting);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @param set
+ * @return false, leaving set empty, if the setting has no value.
+ */
+bool dc_setting_cpuset_get_cpus(const struct dc_env *env, struct dc_setting_cpuset *setting, struct dc_cpuset *set);
+
+
+/**
+ *
+ * @param env
+ * @param err
+ * @return
+ */
+struct dc_setting_numa_policy *dc_setting_numa_policy_create(const struct dc_env *env, struct dc_error *err);
+
+
+/**
+ *
+ * @param env
+ * @param psetting
+ */
+void dc_setting_numa_policy_destroy(const struct dc_env *env,  struct dc_setting_numa_policy **psetting);
+
+
+/**
+ * The value is a policy such as node:1 or interleave:0-1, it is kept in the form dc_numa_policy_format writes.
+ *
+ * @param env
+ * @param err
+ * @param setting
+ * @param value
+ * @param type
+ * @return
+ */
+bool dc_setting_numa_policy_set(const struct dc_env *env,
+                                struct dc_error *err,
+                                struct dc_setting_numa_policy *setting,
+                                const char *value,
+                                dc_setting_type type);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @return
+ */
+const char *dc_setting_numa_policy_get(const struct dc_env *env, struct dc_setting_numa_policy *setting);
+
+
+/**
+ *
+ * @param env
+ * @param setting
+ * @param policy
+ * @return false, leaving policy the default, if the setting has no value.
+ */
+bool dc_setting_numa_policy_get_policy(const struct dc_env *env, struct dc_setting_numa_policy *setting, struct dc_numa_policy *policy);
+
+
 #ifdef __cplusplus
 }
 #endif
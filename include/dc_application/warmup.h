@@ -0,0 +1,72 @@
+#ifndef LIBDC_APPLICATION_WARMUP_H
+#define LIBDC_APPLICATION_WARMUP_H
+
+
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+
+#include <dc_env/env.h>
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * The work done before an application is ready so that the first requests do not pay for page faults and cold caches.
+ * Symbols bound lazily by the dynamic linker are not covered, link with -Wl,-z,now (or run with LD_BIND_NOW set) to
+ * have them bound at load time.
+ */
+
+
+/**
+ * Lock every page the process has, and every page it maps from now on, into memory.
+ *
+ * @param env
+ * @param err
+ */
+void dc_warmup_lock_memory(const struct dc_env *env, struct dc_error *err);
+
+/**
+ * Touch every page of a writable region so that its page faults happen now.
+ *
+ * @param env
+ * @param err
+ * @param addr
+ * @param length
+ */
+void dc_warmup_prefault(const struct dc_env *env, struct dc_error *err, void *addr, size_t length);
+
+/**
+ * Read a file through so that it is in the page cache.
+ *
+ * @param env
+ * @param err
+ * @param path
+ */
+void dc_warmup_file(const struct dc_env *env, struct dc_error *err, const char *path);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // LIBDC_APPLICATION_WARMUP_H
@@ -0,0 +1,130 @@
+#ifndef LIBDC_APPLICATION_ZYGOTE_H
+#define LIBDC_APPLICATION_ZYGOTE_H
+
+
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "application.h"
+#include <dc_env/env.h>
+#include <sys/types.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * A zygote resolves its settings and warms up once, then forks a child for each request on a unix domain socket.
+ *
+ * A request is a 4 byte length in network byte order followed by that many bytes: the argument count, the
+ * environment count and a descriptor mask, each 4 bytes in network byte order, then that many NUL terminated
+ * arguments (argv[0] first) and "NAME=value" environment variables. Up to DC_ZYGOTE_MAX_FDS descriptors can be passed
+ * with the first byte, bit n of the mask set means one of them becomes descriptor n (standard input, output and error)
+ * in the child, in order. A request with a length of 0 stops the zygote. The socket is made as a local socket (see
+ * local_socket.h) and connections from other users are closed without being read.
+ *
+ * The child answers with its pid and, once run returns, the value run returned, each 4 bytes in network byte order.
+ * A child that dies before run returns closes the connection without the second answer.
+ */
+#define DC_ZYGOTE_MAX_FRAME (1024U * 1024U)
+#define DC_ZYGOTE_MAX_FDS 3
+
+struct dc_zygote_request;
+
+
+/**
+ * Fork a child for each request until a stop request. The arguments of a request are applied to the child's settings
+ * as command line settings and the environment variables with the settings prefix as environment settings, over what
+ * the zygote resolved.
+ *
+ * @param env
+ * @param err
+ * @param settings the resolved settings.
+ * @param path the socket path.
+ * @return the request in a child, NULL in the zygote once it stops.
+ */
+struct dc_zygote_request *dc_zygote_serve(const struct dc_env *env,
+                                          struct dc_error *err,
+                                          struct dc_application_settings *settings,
+                                          const char *path);
+
+/**
+ * Send the value run returned to the client and close the connection.
+ *
+ * @param env
+ * @param request
+ * @param status
+ */
+void dc_zygote_request_reply(const struct dc_env *env, struct dc_zygote_request *request, int status);
+
+/**
+ * Free the request. The settings refer to its arguments, so it has to outlive them.
+ *
+ * @param env
+ * @param prequest
+ */
+void dc_zygote_request_destroy(const struct dc_env *env, struct dc_zygote_request **prequest);
+
+/**
+ * Ask a zygote to start a child.
+ *
+ * @param env
+ * @param err
+ * @param path the socket path.
+ * @param argv the arguments, NULL terminated.
+ * @param envp the environment variables, NULL terminated, may be NULL.
+ * @param fds the standard input, output and error for the child, -1 for the zygote's own.
+ * @param pid set to the pid of the child.
+ * @return the connection to wait on with dc_zygote_wait.
+ */
+int dc_zygote_spawn(const struct dc_env *env,
+                    struct dc_error *err,
+                    const char *path,
+                    char *const argv[],
+                    char *const envp[],
+                    const int fds[DC_ZYGOTE_MAX_FDS],
+                    pid_t *pid);
+
+/**
+ * Wait for the child started by dc_zygote_spawn and close the connection.
+ *
+ * @param env
+ * @param err
+ * @param fd the connection from dc_zygote_spawn.
+ * @param status set to the value run returned.
+ * @return false if the child died before run returned.
+ */
+bool dc_zygote_wait(const struct dc_env *env, struct dc_error *err, int fd, int *status);
+
+/**
+ * Stop a zygote.
+ *
+ * @param env
+ * @param err
+ * @param path the socket path.
+ */
+void dc_zygote_stop(const struct dc_env *env, struct dc_error *err, const char *path);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif // LIBDC_APPLICATION_ZYGOTE_H
@@ -0,0 +1,488 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "dc_application/affinity.h"
+#include <dc_c/dc_string.h>
+#include <errno.h>
+#include <stdio.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+#define BITS_PER_LONG (sizeof(unsigned long) * CHAR_BIT)
+
+#ifdef __linux__
+// from linux/mempolicy.h, which is not always installed
+#define MPOL_DEFAULT 0
+#define MPOL_PREFERRED 1
+#define MPOL_BIND 2
+#define MPOL_INTERLEAVE 3
+#define MPOL_LOCAL 4
+#endif
+
+
+struct numa_mode_name
+{
+    const char *name;
+    dc_numa_mode mode;
+    bool has_nodes;
+};
+
+
+static bool parse_number(const char **pstr, unsigned int *number);
+static void add_range(struct dc_cpuset *set, unsigned int first, unsigned int last);
+static bool is_set(const struct dc_cpuset *set, unsigned int cpu);
+static void append(const struct dc_env *env, char *buffer, size_t size, int *length, const char *separator, unsigned int number);
+#ifdef __linux__
+static void to_cpu_set(const struct dc_cpuset *set, cpu_set_t *cpus);
+#endif
+
+
+static const struct numa_mode_name numa_mode_names[] =
+{
+    {"default",    DC_NUMA_DEFAULT,    false},
+    {"local",      DC_NUMA_LOCAL,      false},
+    {"node",       DC_NUMA_BIND,       true},
+    {"preferred",  DC_NUMA_PREFERRED,  true},
+    {"interleave", DC_NUMA_INTERLEAVE, true},
+};
+
+
+bool dc_cpuset_parse(const struct dc_env *env, struct dc_error *err, const char *str, struct dc_cpuset *set)
+{
+    const char *current;
+
+    DC_TRACE(env);
+    dc_memset(env, set, 0, sizeof(struct dc_cpuset));
+    current = str;
+
+    while(true)
+    {
+        unsigned int first;
+        unsigned int last;
+
+        if(!(parse_number(&current, &first)))
+        {
+            DC_ERROR_RAISE_USER(err, "cpu set has to be numbers and ranges separated by ','", EINVAL);
+
+            return false;
+        }
+
+        last = first;
+
+        if(*current == '-')
+        {
+            current++;
+
+            if(!(parse_number(&current, &last)) || last < first)
+            {
+                DC_ERROR_RAISE_USER(err, "cpu set range has to be low-high", EINVAL);
+
+                return false;
+            }
+        }
+
+        if(last >= DC_CPUSET_SIZE)
+        {
+            DC_ERROR_RAISE_USER(err, "cpu set number is out of range", ERANGE);
+
+            return false;
+        }
+
+        add_range(set, first, last);
+
+        if(*current == '\0')
+        {
+            break;
+        }
+
+        if(*current != ',')
+        {
+            DC_ERROR_RAISE_USER(err, "cpu set has to be numbers and ranges separated by ','", EINVAL);
+
+            return false;
+        }
+
+        current++;
+    }
+
+    return true;
+}
+
+int dc_cpuset_format(const struct dc_env *env, const struct dc_cpuset *set, char *buffer, size_t size)
+{
+    const char *separator;
+    int length;
+
+    DC_TRACE(env);
+    length = 0;
+    separator = "";
+
+    if(size > 0)
+    {
+        buffer[0] = '\0';
+    }
+
+    for(unsigned int cpu = 0; cpu < DC_CPUSET_SIZE; cpu++)
+    {
+        unsigned int last;
+
+        if(!(is_set(set, cpu)))
+        {
+            continue;
+        }
+
+        for(last = cpu; last + 1 < DC_CPUSET_SIZE && is_set(set, last + 1); last++)
+        {
+        }
+
+        append(env, buffer, size, &length, separator, cpu);
+
+        if(last > cpu)
+        {
+            append(env, buffer, size, &length, "-", last);
+        }
+
+        separator = ",";
+        cpu = last;
+    }
+
+    return length;
+}
+
+size_t dc_cpuset_get_count(const struct dc_env *env, const struct dc_cpuset *set)
+{
+    size_t count;
+
+    DC_TRACE(env);
+    count = 0;
+
+    for(size_t i = 0; i < sizeof(set->bits) / sizeof(set->bits[0]); i++)
+    {
+        count += (size_t)__builtin_popcountl(set->bits[i]);
+    }
+
+    return count;
+}
+
+unsigned int dc_cpuset_get_cpu(const struct dc_env *env, const struct dc_cpuset *set, size_t index)
+{
+    size_t seen;
+
+    DC_TRACE(env);
+    seen = 0;
+
+    for(unsigned int cpu = 0; cpu < DC_CPUSET_SIZE; cpu++)
+    {
+        if(is_set(set, cpu))
+        {
+            if(seen == index)
+            {
+                return cpu;
+            }
+
+            seen++;
+        }
+    }
+
+    return DC_CPUSET_SIZE;
+}
+
+bool dc_numa_policy_parse(const struct dc_env *env, struct dc_error *err, const char *str, struct dc_numa_policy *policy)
+{
+    DC_TRACE(env);
+    dc_memset(env, policy, 0, sizeof(struct dc_numa_policy));
+
+    for(size_t i = 0; i < sizeof(numa_mode_names) / sizeof(numa_mode_names[0]); i++)
+    {
+        const struct numa_mode_name *name;
+        size_t length;
+
+        name = &numa_mode_names[i];
+        length = dc_strlen(env, name->name);
+
+        if(dc_strncmp(env, str, name->name, length) != 0)
+        {
+            continue;
+        }
+
+        if(!(name->has_nodes))
+        {
+            if(str[length] != '\0')
+            {
+                break;
+            }
+
+            policy->mode = name->mode;
+
+            return true;
+        }
+
+        if(str[length] != ':')
+        {
+            break;
+        }
+
+        if(!(dc_cpuset_parse(env, err, &str[length + 1], &policy->nodes)))
+        {
+            return false;
+        }
+
+        if(name->mode == DC_NUMA_PREFERRED && dc_cpuset_get_count(env, &policy->nodes) != 1)
+        {
+            DC_ERROR_RAISE_USER(err, "preferred NUMA policy takes one node", EINVAL);
+
+            return false;
+        }
+
+        policy->mode = name->mode;
+
+        return true;
+    }
+
+    DC_ERROR_RAISE_USER(err, "NUMA policy has to be default, local, node:, preferred: or interleave:", EINVAL);
+
+    return false;
+}
+
+int dc_numa_policy_format(const struct dc_env *env, const struct dc_numa_policy *policy, char *buffer, size_t size)
+{
+    const struct numa_mode_name *name;
+    int length;
+
+    DC_TRACE(env);
+    name = &numa_mode_names[0];
+
+    for(size_t i = 0; i < sizeof(numa_mode_names) / sizeof(numa_mode_names[0]); i++)
+    {
+        if(numa_mode_names[i].mode == policy->mode)
+        {
+            name = &numa_mode_names[i];
+        }
+    }
+
+    if(!(name->has_nodes))
+    {
+        return snprintf(buffer, size, "%s", name->name);
+    }
+
+    length = snprintf(buffer, size, "%s:", name->name);
+
+    if(length < 0)
+    {
+        return length;
+    }
+
+    if((size_t)length < size)
+    {
+        return length + dc_cpuset_format(env, &policy->nodes, &buffer[length], size - (size_t)length);
+    }
+
+    return length + dc_cpuset_format(env, &policy->nodes, NULL, 0);
+}
+
+#ifdef __linux__
+void dc_affinity_set_cpus(const struct dc_env *env, struct dc_error *err, const struct dc_cpuset *set)
+{
+    cpu_set_t cpus;
+
+    DC_TRACE(env);
+    to_cpu_set(set, &cpus);
+
+    if(sched_setaffinity(0, sizeof(cpus), &cpus) != 0)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+    }
+}
+
+void dc_affinity_pin_worker(const struct dc_env *env, struct dc_error *err, const struct dc_cpuset *set, size_t worker)
+{
+    struct dc_cpuset one;
+    size_t count;
+
+    DC_TRACE(env);
+    count = dc_cpuset_get_count(env, set);
+
+    if(count == 0)
+    {
+        DC_ERROR_RAISE_USER(err, "cpu set is empty", EINVAL);
+
+        return;
+    }
+
+    dc_memset(env, &one, 0, sizeof(one));
+    add_range(&one, dc_cpuset_get_cpu(env, set, worker % count), dc_cpuset_get_cpu(env, set, worker % count));
+    dc_affinity_set_cpus(env, err, &one);
+}
+
+void dc_affinity_set_numa_policy(const struct dc_env *env, struct dc_error *err, const struct dc_numa_policy *policy)
+{
+    const unsigned long *nodes;
+    unsigned long max_node;
+    int mode;
+
+    DC_TRACE(env);
+    nodes = NULL;
+    max_node = 0;
+
+    switch(policy->mode)
+    {
+        case DC_NUMA_LOCAL:
+        {
+            mode = MPOL_LOCAL;
+            break;
+        }
+        case DC_NUMA_BIND:
+        {
+            mode = MPOL_BIND;
+            break;
+        }
+        case DC_NUMA_PREFERRED:
+        {
+            mode = MPOL_PREFERRED;
+            break;
+        }
+        case DC_NUMA_INTERLEAVE:
+        {
+            mode = MPOL_INTERLEAVE;
+            break;
+        }
+        case DC_NUMA_DEFAULT:
+        default:
+        {
+            mode = MPOL_DEFAULT;
+        }
+    }
+
+    if(mode != MPOL_DEFAULT && mode != MPOL_LOCAL)
+    {
+        nodes = policy->nodes.bits;
+        max_node = DC_CPUSET_SIZE + 1;
+    }
+
+    // glibc has no wrapper for set_mempolicy, libnuma does but it is not worth the dependency for one call
+    if(syscall(SYS_set_mempolicy, mode, nodes, max_node) != 0)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+    }
+}
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+void dc_affinity_set_cpus(const struct dc_env *env, struct dc_error *err, const struct dc_cpuset *set)
+{
+    DC_TRACE(env);
+    DC_ERROR_RAISE_USER(err, "CPU affinity is not supported", ENOTSUP);
+}
+
+void dc_affinity_pin_worker(const struct dc_env *env, struct dc_error *err, const struct dc_cpuset *set, size_t worker)
+{
+    DC_TRACE(env);
+    DC_ERROR_RAISE_USER(err, "CPU affinity is not supported", ENOTSUP);
+}
+
+void dc_affinity_set_numa_policy(const struct dc_env *env, struct dc_error *err, const struct dc_numa_policy *policy)
+{
+    DC_TRACE(env);
+    DC_ERROR_RAISE_USER(err, "NUMA policies are not supported", ENOTSUP);
+}
+#pragma GCC diagnostic pop
+#endif
+
+static bool parse_number(const char **pstr, unsigned int *number)
+{
+    const char *current;
+    unsigned int value;
+
+    current = *pstr;
+    value = 0;
+
+    if(*current < '0' || *current > '9')
+    {
+        return false;
+    }
+
+    // anything past DC_CPUSET_SIZE is out of range, stopping there keeps the value from overflowing
+    while(*current >= '0' && *current <= '9')
+    {
+        if(value <= DC_CPUSET_SIZE)
+        {
+            value = value * 10U + (unsigned int)(*current - '0');
+        }
+
+        current++;
+    }
+
+    *number = value;
+    *pstr = current;
+
+    return true;
+}
+
+static void add_range(struct dc_cpuset *set, unsigned int first, unsigned int last)
+{
+    for(unsigned int cpu = first; cpu <= last; cpu++)
+    {
+        set->bits[cpu / BITS_PER_LONG] |= 1UL << (cpu % BITS_PER_LONG);
+    }
+}
+
+static bool is_set(const struct dc_cpuset *set, unsigned int cpu)
+{
+    return (set->bits[cpu / BITS_PER_LONG] & (1UL << (cpu % BITS_PER_LONG))) != 0;
+}
+
+static void append(const struct dc_env *env, char *buffer, size_t size, int *length, const char *separator, unsigned int number)
+{
+    char piece[16];
+    int written;
+
+    written = snprintf(piece, sizeof(piece), "%s%u", separator, number);
+
+    if(written < 0 || (size_t)written >= sizeof(piece))
+    {
+        return;
+    }
+
+    // a number is never cut short, once one does not fit only the length is counted, as snprintf does
+    if((size_t)*length + (size_t)written < size)
+    {
+        dc_memcpy(env, &buffer[*length], piece, (size_t)written + 1);
+    }
+
+    *length += written;
+}
+
+#ifdef __linux__
+static void to_cpu_set(const struct dc_cpuset *set, cpu_set_t *cpus)
+{
+    CPU_ZERO(cpus);
+
+    for(unsigned int cpu = 0; cpu < DC_CPUSET_SIZE && cpu < CPU_SETSIZE; cpu++)
+    {
+        if(is_set(set, cpu))
+        {
+            CPU_SET(cpu, cpus);
+        }
+    }
+}
+#endif
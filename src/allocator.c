@@ -0,0 +1,137 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "dc_application/allocator.h"
+#include <dc_c/dc_string.h>
+#include <dc_posix/dc_unistd.h>
+#include <errno.h>
+#include <limits.h>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+
+#ifdef __GLIBC__
+// allocations at least this big get their own mapping when memory is retained, below it they come from the heap
+#define RETAIN_MMAP_THRESHOLD (32 * 1024 * 1024)
+// how much more than asked for the heap grows by when memory is retained
+#define RETAIN_TOP_PAD (16 * 1024 * 1024)
+#endif
+
+
+struct allocator_name
+{
+    const char *name;
+    dc_allocator kind;
+};
+
+
+#ifdef __GLIBC__
+static void set_option(const struct dc_env *env, struct dc_error *err, int param, int value);
+#endif
+
+
+static const struct allocator_name allocator_names[] =
+{
+    {"system", DC_ALLOCATOR_SYSTEM},
+    {"arena",  DC_ALLOCATOR_ARENA},
+    {"retain", DC_ALLOCATOR_RETAIN},
+};
+
+
+bool dc_allocator_from_string(const struct dc_env *env, const char *name, dc_allocator *kind)
+{
+    DC_TRACE(env);
+
+    for(size_t i = 0; i < sizeof(allocator_names) / sizeof(allocator_names[0]); i++)
+    {
+        if(dc_strcmp(env, allocator_names[i].name, name) == 0)
+        {
+            *kind = allocator_names[i].kind;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#ifdef __GLIBC__
+void dc_allocator_install(const struct dc_env *env, struct dc_error *err, dc_allocator kind)
+{
+    DC_TRACE(env);
+
+    switch(kind)
+    {
+        case DC_ALLOCATOR_ARENA:
+        {
+            long cpus;
+
+            cpus = dc_sysconf(env, err, _SC_NPROCESSORS_ONLN);
+
+            // the C library allows eight arenas per CPU on 64 bit systems
+            if(dc_error_has_no_error(err) && cpus > 0)
+            {
+                set_option(env, err, M_ARENA_MAX, cpus > INT_MAX ? INT_MAX : (int)cpus);
+            }
+
+            break;
+        }
+        case DC_ALLOCATOR_RETAIN:
+        {
+            // setting either threshold also stops the C library from moving them as memory is freed
+            set_option(env, err, M_MMAP_THRESHOLD, RETAIN_MMAP_THRESHOLD);
+
+            if(dc_error_has_no_error(err))
+            {
+                set_option(env, err, M_TRIM_THRESHOLD, INT_MAX);
+            }
+
+            if(dc_error_has_no_error(err))
+            {
+                set_option(env, err, M_TOP_PAD, RETAIN_TOP_PAD);
+            }
+
+            break;
+        }
+        case DC_ALLOCATOR_SYSTEM:
+        default:
+        {
+        }
+    }
+}
+
+static void set_option(const struct dc_env *env, struct dc_error *err, int param, int value)
+{
+    DC_TRACE(env);
+
+    // mallopt does not set errno, 0 is all it says
+    if(mallopt(param, value) == 0)
+    {
+        DC_ERROR_RAISE_USER(err, "could not tune the allocator", EINVAL);
+    }
+}
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+void dc_allocator_install(const struct dc_env *env, struct dc_error *err, dc_allocator kind)
+{
+    DC_TRACE(env);
+}
+#pragma GCC diagnostic pop
+#endif
@@ -16,24 +16,45 @@
 
 
 #include "dc_application/application.h"
+#include "dc_application/affinity.h"
 #include "dc_application/command_line.h"
+#include "dc_application/component.h"
 #include "dc_application/config.h"
+#include "dc_application/control.h"
 #include "dc_application/defaults.h"
 #include "dc_application/environment.h"
+#include "dc_application/memory.h"
+#include "dc_application/notify.h"
+#include "dc_application/provider.h"
+#include "dc_application/segment.h"
 #include "dc_application/settings.h"
+#include "dc_application/warmup.h"
+#include "dc_application/zygote.h"
 #include <dc_c/dc_stdlib.h>
 #include <dc_c/dc_string.h>
 #include <dc_fsm/fsm.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
 
 
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
 extern char **environ;
 
+static void install_allocator(const struct dc_env *env, struct dc_error *err, struct dc_application_info *info);
 static int create_settings(const struct dc_env *env, struct dc_error *err, void *arg);
 static int parse_command_line(const struct dc_env *env, struct dc_error *err, void *arg);
 static int read_env_vars(const struct dc_env *env, struct dc_error *err, void *arg);
 static int read_config(const struct dc_env *env, struct dc_error *err, void *arg);
+static void claim_settings(const struct dc_env *env, struct dc_application_settings *settings);
+static void start_config_load(const struct dc_env *env, struct dc_application_info *info);
 static int set_defaults(const struct dc_env *env, struct dc_error *err, void *arg);
+static int init_components(const struct dc_env *env, struct dc_error *err, void *arg);
+static void apply_placement(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings);
+static void create_memory_region(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings);
+static int warmup(const struct dc_env *env, struct dc_error *err, void *arg);
 static int run(const struct dc_env *env, struct dc_error *err, void *arg);
 static int cleanup(const struct dc_env *env, struct dc_error *err, void *arg);
 static int destroy_settings(const struct dc_env *env, struct dc_error *err, void *arg);
@@ -42,9 +63,62 @@ static int parse_command_line_error(const struct dc_env *env, struct dc_error *e
 static int read_env_vars_error(const struct dc_env *env, struct dc_error *err, void *arg);
 static int read_config_error(const struct dc_env *env, struct dc_error *err, void *arg);
 static int set_defaults_error(const struct dc_env *env, struct dc_error *err, void *arg);
+static int init_components_error(const struct dc_env *env, struct dc_error *err, void *arg);
+static int warmup_error(const struct dc_env *env, struct dc_error *err, void *arg);
 static int run_error(const struct dc_env *env, struct dc_error *err, void *arg);
 static int cleanup_error(const struct dc_env *env, struct dc_error *err, void *arg);
 static int destroy_settings_error(const struct dc_env *env, struct dc_error *err, void *arg);
+static int run_phases(const struct dc_env *env, struct dc_error *err, void *arg);
+static int phase_error(const struct dc_env *env, struct dc_error *err, void *arg);
+static void select_command(const struct dc_env *env, struct dc_application_info *info);
+static void enter_phase(const struct dc_env *env, struct dc_application_info *info, int state);
+static void notify(const struct dc_env *env, struct dc_application_info *info, const char *state);
+static void append_field(const struct dc_env *env, char *message, size_t size, size_t *length, const char *field);
+
+struct arena
+{
+    void *addr;
+    size_t length;
+};
+
+struct phase
+{
+    const char *name;
+    int (*func)(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings);
+    const char *after;
+    const char *before;
+    bool parallel;
+};
+
+// phases that run together, as one state
+struct batch
+{
+    size_t first;
+    size_t count;
+};
+
+struct schedule
+{
+    int *order;
+    size_t order_count;
+    struct batch *batches;
+    size_t batch_count;
+    const struct phase **batch_phases;
+
+    // the state being performed, a batch is the one after it in the order
+    int current;
+};
+
+struct phase_task
+{
+    const struct dc_env *env;
+    struct dc_application_settings *settings;
+    const struct phase *phase;
+    struct dc_error err;
+    int result;
+    pthread_t thread;
+    bool started;
+};
 
 struct dc_application_lifecycle
 {
@@ -69,9 +143,54 @@ struct dc_application_lifecycle
 
     int (*cleanup)(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *);
 
+    int (*reload_config)(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *);
+
     int (*destroy_settings)(const struct dc_env *env, struct dc_error *err, struct dc_application_settings **);
+
+    const char *share_settings;
+
+    const char *attach_settings;
+
+    const char *control_socket_path;
+
+    const struct dc_application_command *commands;
+
+    const char *zygote_path;
+
+    dc_allocator allocator;
+
+    int (*warmup)(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *);
+
+    struct arena *arenas;
+
+    size_t arena_count;
+
+    struct phase *phases;
+
+    size_t phase_count;
+
+    struct dc_components *components;
+
+    struct dc_config_providers *providers;
+};
+
+// the built in states in the order of the application_states they are named after, phases refer to them by these names
+static const char *const phase_names[] =
+{
+    "CREATE_SETTINGS",
+    "PARSE_COMMAND_LINE",
+    "READ_ENV_VARS",
+    "READ_CONFIG",
+    "SET_DEFAULTS",
+    "INIT_COMPONENTS",
+    "WARMUP",
+    "RUN",
+    "CLEANUP",
+    "DESTROY_SETTINGS",
 };
 
+#define PHASE_COUNT (sizeof(phase_names) / sizeof(phase_names[0]))
+
 struct dc_application_info
 {
     char *name;
@@ -80,6 +199,11 @@ struct dc_application_info
     int argc;
     char *default_config_path;
     char **argv;
+    struct dc_zygote_request *zygote_request;
+    struct dc_notifier *notifier;
+    struct dc_config_load *config_load;
+    uint64_t phase_usec[PHASE_COUNT];
+    struct schedule schedule;
 };
 
 enum application_states
@@ -89,19 +213,108 @@ enum application_states
     READ_ENV_VARS,                          // 4
     READ_CONFIG,                            // 5
     SET_DEFAULTS,                           // 6
-    RUN,                                    // 7
-    CLEANUP,                                // 8
-    DESTROY_SETTINGS,                       // 9
-    CREATE_SETTINGS_ERROR,                  // 10
-    PARSE_COMMAND_LINE_ERROR,               // 11
-    READ_ENV_VARS_ERROR,                    // 12
-    READ_CONFIG_ERROR,                      // 13
-    SET_DEFAULTS_ERROR,                     // 14
-    RUN_ERROR,                              // 15
-    CLEANUP_ERROR,                          // 16
-    DESTROY_SETTINGS_ERROR,                 // 17
+    INIT_COMPONENTS,                        // 7
+    WARMUP,                                 // 8
+    RUN,                                    // 9
+    CLEANUP,                                // 10
+    DESTROY_SETTINGS,                       // 11
+    CREATE_SETTINGS_ERROR,                  // 12
+    PARSE_COMMAND_LINE_ERROR,               // 13
+    READ_ENV_VARS_ERROR,                    // 14
+    READ_CONFIG_ERROR,                      // 15
+    SET_DEFAULTS_ERROR,                     // 16
+    INIT_COMPONENTS_ERROR,                  // 17
+    WARMUP_ERROR,                           // 18
+    RUN_ERROR,                              // 19
+    CLEANUP_ERROR,                          // 20
+    DESTROY_SETTINGS_ERROR,                 // 21
+    PHASE_ERROR,                            // 22
+    PHASE_START,                            // 23, the batches of added phases follow
+};
+
+static int (*const phase_functions[])(const struct dc_env *env, struct dc_error *err, void *arg) =
+{
+    create_settings,
+    parse_command_line,
+    read_env_vars,
+    read_config,
+    set_defaults,
+    init_components,
+    warmup,
+    run,
+    cleanup,
+    destroy_settings,
+};
+
+// the members of dc_application_settings the library reads, the application may have left them uninitialised
+static const size_t library_settings[] =
+{
+    offsetof(struct dc_application_settings, lock_memory),
+    offsetof(struct dc_application_settings, prefault),
+    offsetof(struct dc_application_settings, warmup_files),
+    offsetof(struct dc_application_settings, memory_region_size),
+    offsetof(struct dc_application_settings, memory_region_node),
+    offsetof(struct dc_application_settings, cpuset),
+    offsetof(struct dc_application_settings, numa_policy),
+};
+
+static const struct dc_fsm_transition error_transitions[] =
+{
+    {CREATE_SETTINGS,          CREATE_SETTINGS_ERROR,    create_settings_error},
+    {PARSE_COMMAND_LINE,       PARSE_COMMAND_LINE_ERROR, parse_command_line_error},
+    {READ_ENV_VARS,            READ_ENV_VARS_ERROR,      read_env_vars_error},
+    {READ_CONFIG,              READ_CONFIG_ERROR,        read_config_error},
+    {SET_DEFAULTS,             SET_DEFAULTS_ERROR,       set_defaults_error},
+    {INIT_COMPONENTS,          INIT_COMPONENTS_ERROR,    init_components_error},
+    {WARMUP,                   WARMUP_ERROR,             warmup_error},
+    {RUN,                      RUN_ERROR,                run_error},
+    {CLEANUP,                  CLEANUP_ERROR,            cleanup_error},
+    {DESTROY_SETTINGS,         DESTROY_SETTINGS_ERROR,   destroy_settings_error},
+    {CREATE_SETTINGS_ERROR,    DC_FSM_EXIT,   NULL},
+    {PARSE_COMMAND_LINE_ERROR, DESTROY_SETTINGS,         destroy_settings},
+    {READ_ENV_VARS_ERROR,      DESTROY_SETTINGS,         destroy_settings},
+    {READ_CONFIG_ERROR,        DESTROY_SETTINGS,         destroy_settings},
+    {SET_DEFAULTS_ERROR,       DESTROY_SETTINGS,         destroy_settings},
+    {INIT_COMPONENTS_ERROR,    DESTROY_SETTINGS,         destroy_settings},
+    {WARMUP_ERROR,             DESTROY_SETTINGS,         destroy_settings},
+    {RUN_ERROR,                DESTROY_SETTINGS,         destroy_settings},
+    {CLEANUP_ERROR,            DESTROY_SETTINGS,         destroy_settings},
+    {PHASE_ERROR,              DESTROY_SETTINGS,         destroy_settings},
+    {DESTROY_SETTINGS_ERROR,   DC_FSM_EXIT,   NULL},
 };
 
+#define ERROR_TRANSITION_COUNT (sizeof(error_transitions) / sizeof(error_transitions[0]))
+
+static struct dc_fsm_transition *compile_transitions(const struct dc_env *env,
+                                                     struct dc_error *err,
+                                                     struct dc_application_info *info);
+static void add_constraints(const struct dc_env *env,
+                            struct dc_error *err,
+                            const struct dc_application_lifecycle *lifecycle,
+                            bool *edges,
+                            size_t node_count);
+static void add_names(const struct dc_env *env,
+                      struct dc_error *err,
+                      const struct dc_application_lifecycle *lifecycle,
+                      bool *edges,
+                      size_t node_count,
+                      const char *names,
+                      size_t node,
+                      bool after);
+static size_t find_node(const struct dc_env *env,
+                        const struct dc_application_lifecycle *lifecycle,
+                        const char *name,
+                        size_t length);
+static void sort_phases(const struct dc_env *env,
+                        struct dc_error *err,
+                        struct dc_application_info *info,
+                        const bool *edges,
+                        size_t node_count);
+static void destroy_schedule(const struct dc_env *env, struct schedule *schedule);
+static int next_state(const struct dc_application_info *info, int state);
+static int run_parallel(const struct dc_env *env, struct dc_error *err, struct dc_application_info *info, const struct batch *batch);
+static void *run_task(void *arg);
+
 static void will_change_state(const struct dc_env *env,
                               struct dc_error *err,
                               const struct dc_fsm_info *info,
@@ -147,6 +360,18 @@ struct dc_application_lifecycle *dc_application_lifecycle_create(
 void dc_application_lifecycle_destroy(const struct dc_env *env, struct dc_application_lifecycle **plifecycle)
 {
     DC_TRACE(env);
+    if((*plifecycle)->components)
+    {
+        dc_components_destroy(env, &(*plifecycle)->components);
+    }
+
+    if((*plifecycle)->providers)
+    {
+        dc_config_providers_destroy(env, &(*plifecycle)->providers);
+    }
+
+    dc_free(env, (*plifecycle)->phases);
+    dc_free(env, (*plifecycle)->arenas);
     dc_free(env, *plifecycle);
     *plifecycle = NULL;
 }
@@ -200,6 +425,166 @@ void dc_application_lifecycle_set_cleanup(const struct dc_env *env,
     lifecycle->cleanup = func;
 }
 
+void dc_application_lifecycle_set_reload_config(const struct dc_env *env,
+                                                struct dc_application_lifecycle *lifecycle,
+                                                int (*func)(const struct dc_env *env,
+                                                            struct dc_error *err,
+                                                            struct dc_application_settings *))
+{
+    DC_TRACE(env);
+    lifecycle->reload_config = func;
+}
+
+void dc_application_lifecycle_set_control_socket(const struct dc_env *env,
+                                                 struct dc_application_lifecycle *lifecycle,
+                                                 const char *path)
+{
+    DC_TRACE(env);
+    lifecycle->control_socket_path = path;
+}
+
+void dc_application_lifecycle_set_share_settings(const struct dc_env *env,
+                                                 struct dc_application_lifecycle *lifecycle,
+                                                 const char *name)
+{
+    DC_TRACE(env);
+    lifecycle->share_settings = name;
+}
+
+void dc_application_lifecycle_set_attach_settings(const struct dc_env *env,
+                                                  struct dc_application_lifecycle *lifecycle,
+                                                  const char *name)
+{
+    DC_TRACE(env);
+    lifecycle->attach_settings = name;
+}
+
+void dc_application_lifecycle_set_allocator(const struct dc_env *env,
+                                            struct dc_application_lifecycle *lifecycle,
+                                            dc_allocator kind)
+{
+    DC_TRACE(env);
+    lifecycle->allocator = kind;
+}
+
+void dc_application_lifecycle_set_zygote(const struct dc_env *env,
+                                         struct dc_application_lifecycle *lifecycle,
+                                         const char *path)
+{
+    DC_TRACE(env);
+    lifecycle->zygote_path = path;
+}
+
+void dc_application_lifecycle_set_warmup(const struct dc_env *env,
+                                         struct dc_application_lifecycle *lifecycle,
+                                         int (*func)(const struct dc_env *env,
+                                                     struct dc_error *err,
+                                                     struct dc_application_settings *settings))
+{
+    DC_TRACE(env);
+    lifecycle->warmup = func;
+}
+
+void dc_application_lifecycle_add_phase(const struct dc_env *env,
+                                        struct dc_error *err,
+                                        struct dc_application_lifecycle *lifecycle,
+                                        const char *name,
+                                        int (*func)(const struct dc_env *env,
+                                                    struct dc_error *err,
+                                                    struct dc_application_settings *settings),
+                                        const char *after,
+                                        const char *before,
+                                        bool parallel)
+{
+    struct phase *phases;
+
+    DC_TRACE(env);
+
+    if(find_node(env, lifecycle, name, dc_strlen(env, name)) != SIZE_MAX || dc_strchr(env, name, ',') != NULL)
+    {
+        DC_ERROR_RAISE_USER(err, "phase name is already used or has a ','", EINVAL);
+
+        return;
+    }
+
+    phases = dc_realloc(env, err, lifecycle->phases, (lifecycle->phase_count + 1) * sizeof(struct phase));
+
+    if(dc_error_has_no_error(err))
+    {
+        phases[lifecycle->phase_count].name = name;
+        phases[lifecycle->phase_count].func = func;
+        phases[lifecycle->phase_count].after = after;
+        phases[lifecycle->phase_count].before = before;
+        phases[lifecycle->phase_count].parallel = parallel;
+        lifecycle->phases = phases;
+        lifecycle->phase_count++;
+    }
+}
+
+void dc_application_lifecycle_add_component(const struct dc_env *env,
+                                            struct dc_error *err,
+                                            struct dc_application_lifecycle *lifecycle,
+                                            const struct dc_component *component)
+{
+    DC_TRACE(env);
+
+    if(lifecycle->components == NULL)
+    {
+        lifecycle->components = dc_components_create(env, err);
+    }
+
+    if(dc_error_has_no_error(err))
+    {
+        dc_components_add(env, err, lifecycle->components, component);
+    }
+}
+
+void dc_application_lifecycle_add_config_provider(const struct dc_env *env,
+                                                  struct dc_error *err,
+                                                  struct dc_application_lifecycle *lifecycle,
+                                                  const struct dc_config_provider *provider)
+{
+    DC_TRACE(env);
+
+    if(lifecycle->providers == NULL)
+    {
+        lifecycle->providers = dc_config_providers_create(env, err);
+    }
+
+    if(dc_error_has_no_error(err))
+    {
+        dc_config_providers_add(env, err, lifecycle->providers, provider);
+    }
+}
+
+void dc_application_lifecycle_add_arena(const struct dc_env *env,
+                                        struct dc_error *err,
+                                        struct dc_application_lifecycle *lifecycle,
+                                        void *addr,
+                                        size_t length)
+{
+    struct arena *arenas;
+
+    DC_TRACE(env);
+    arenas = dc_realloc(env, err, lifecycle->arenas, (lifecycle->arena_count + 1) * sizeof(struct arena));
+
+    if(dc_error_has_no_error(err))
+    {
+        arenas[lifecycle->arena_count].addr = addr;
+        arenas[lifecycle->arena_count].length = length;
+        lifecycle->arenas = arenas;
+        lifecycle->arena_count++;
+    }
+}
+
+void dc_application_lifecycle_set_commands(const struct dc_env *env,
+                                           struct dc_application_lifecycle *lifecycle,
+                                           const struct dc_application_command *commands)
+{
+    DC_TRACE(env);
+    lifecycle->commands = commands;
+}
+
 struct dc_application_info *
 dc_application_info_create(const struct dc_env *env, struct dc_error *err, const char *name)
 {
@@ -242,6 +627,7 @@ struct dc_application_lifecycle *dc_default_create_lifecycle(const struct dc_env
     dc_application_lifecycle_set_read_env_vars(env, lifecycle, dc_default_read_env_vars);
     dc_application_lifecycle_set_read_config(env, lifecycle, dc_default_load_config);
     dc_application_lifecycle_set_set_defaults(env, lifecycle, dc_default_set_defaults);
+    dc_application_lifecycle_set_reload_config(env, lifecycle, dc_default_reload_config);
 
     return lifecycle;
 }
@@ -305,10 +691,11 @@ int dc_application_run(const struct dc_env *env,
 
     if(dc_error_has_no_error(err))
     {
+        install_allocator(env, err, info);
         info->argc = argc;
         info->argv = argv;
 
-        if(default_config_path)
+        if(dc_error_has_no_error(err) && default_config_path)
         {
             info->default_config_path = dc_malloc(env, err, dc_strlen(env, default_config_path) + 1);
 
@@ -320,38 +707,27 @@ int dc_application_run(const struct dc_env *env,
 
         if(dc_error_has_no_error(err))
         {
+            struct dc_fsm_transition *transitions;
             struct dc_fsm_info *fsm_info;
-            static struct dc_fsm_transition transitions[] = {
-                    {DC_FSM_INIT,              CREATE_SETTINGS,          create_settings},
-                    {CREATE_SETTINGS,          PARSE_COMMAND_LINE,       parse_command_line},
-                    {CREATE_SETTINGS,          RUN,                      run},
-                    {PARSE_COMMAND_LINE,       READ_ENV_VARS,            read_env_vars},
-                    {READ_ENV_VARS,            READ_CONFIG,              read_config},
-                    {READ_CONFIG,              SET_DEFAULTS,             set_defaults},
-                    {SET_DEFAULTS,             RUN,                      run},
-                    {RUN,                      CLEANUP,                  cleanup},
-                    {CLEANUP,                  DESTROY_SETTINGS,         destroy_settings},
-                    {DESTROY_SETTINGS,         DC_FSM_EXIT,   NULL},
-                    {CREATE_SETTINGS,          CREATE_SETTINGS_ERROR,    create_settings_error},
-                    {PARSE_COMMAND_LINE,       PARSE_COMMAND_LINE_ERROR, parse_command_line_error},
-                    {READ_ENV_VARS,            READ_ENV_VARS_ERROR,      read_env_vars_error},
-                    {READ_CONFIG,              READ_CONFIG_ERROR,        read_config_error},
-                    {SET_DEFAULTS,             SET_DEFAULTS_ERROR,       set_defaults_error},
-                    {RUN,                      RUN_ERROR,                run_error},
-                    {CLEANUP,                  CLEANUP_ERROR,            cleanup_error},
-                    {DESTROY_SETTINGS,         DESTROY_SETTINGS_ERROR,   destroy_settings_error},
-                    {CREATE_SETTINGS_ERROR,    DC_FSM_EXIT,   NULL},
-                    {PARSE_COMMAND_LINE_ERROR, DESTROY_SETTINGS,         destroy_settings},
-                    {READ_ENV_VARS_ERROR,      DESTROY_SETTINGS,         destroy_settings},
-                    {READ_CONFIG_ERROR,        DESTROY_SETTINGS,         destroy_settings},
-                    {SET_DEFAULTS_ERROR,       DESTROY_SETTINGS,         destroy_settings},
-                    {RUN_ERROR,                DESTROY_SETTINGS,         destroy_settings},
-                    {CLEANUP_ERROR,            DESTROY_SETTINGS,         destroy_settings},
-                    {DESTROY_SETTINGS_ERROR,   DC_FSM_EXIT,   NULL},
-                    {DC_FSM_IGNORE,            DC_FSM_IGNORE, NULL},
-            };
-
-            fsm_info = dc_fsm_info_create(env, err, info->name);
+
+            // the added phases are placed between the built in states when the lifecycle is final
+            transitions = compile_transitions(env, err, info);
+            fsm_info = NULL;
+
+            if(dc_error_has_no_error(err))
+            {
+                fsm_info = dc_fsm_info_create(env, err, info->name);
+            }
+
+            // notifications are best effort, an application without them still runs
+            if(dc_error_has_no_error(err))
+            {
+                struct dc_error notify_err;
+
+                dc_error_init(&notify_err, NULL);
+                info->notifier = dc_notifier_create(env, &notify_err);
+                dc_error_reset(&notify_err);
+            }
 
             if(dc_error_has_no_error(err))
             {
@@ -364,6 +740,20 @@ int dc_application_run(const struct dc_env *env,
                 ret_val = dc_fsm_run(env, err, fsm_info, &from_state, &to_state, info, transitions);
                 dc_fsm_info_destroy(env, &fsm_info);
             }
+
+            // an error before READ_CONFIG leaves the load running
+            if(info->config_load)
+            {
+                dc_config_load_cancel(env, &info->config_load);
+            }
+
+            if(info->notifier)
+            {
+                dc_notifier_destroy(env, &info->notifier);
+            }
+
+            dc_free(env, transitions);
+            destroy_schedule(env, &info->schedule);
         }
 
         destroy_lifecycle_func(env, &info->lifecycle);
@@ -372,6 +762,29 @@ int dc_application_run(const struct dc_env *env,
     return ret_val;
 }
 
+// a misspelt DC_ALLOCATOR or an allocator that cannot be tuned stops the run rather than going unnoticed
+static void install_allocator(const struct dc_env *env, struct dc_error *err, struct dc_application_info *info)
+{
+    const char *name;
+    dc_allocator kind;
+
+    DC_TRACE(env);
+    kind = info->lifecycle->allocator;
+    name = dc_getenv(env, DC_ALLOCATOR_ENV_VAR);
+
+    if(name && !(dc_allocator_from_string(env, name, &kind)))
+    {
+        DC_ERROR_RAISE_USER(err, "unknown allocator in " DC_ALLOCATOR_ENV_VAR, EINVAL);
+
+        return;
+    }
+
+    if(kind != DC_ALLOCATOR_SYSTEM)
+    {
+        dc_allocator_install(env, err, kind);
+    }
+}
+
 static int create_settings(const struct dc_env *env, struct dc_error *err, void *arg)
 {
     struct dc_application_info *info;
@@ -379,14 +792,58 @@ static int create_settings(const struct dc_env *env, struct dc_error *err, void
 
     DC_TRACE(env);
     info = arg;
+    enter_phase(env, info, CREATE_SETTINGS);
+
+    if(info->lifecycle->commands)
+    {
+        select_command(env, info);
+    }
 
     if(info->lifecycle->create_settings)
     {
         info->settings = info->lifecycle->create_settings(env, err);
 
+        if(dc_error_has_no_error(err) && info->settings == NULL)
+        {
+            DC_ERROR_RAISE_USER(err, "create_settings returned NULL", EINVAL);
+        }
+
         if(dc_error_has_no_error(err))
         {
-            ret_val = PARSE_COMMAND_LINE;
+            ret_val = next_state(info, CREATE_SETTINGS);
+            claim_settings(env, info->settings);
+            info->settings->segment = NULL;
+            info->settings->memory_region = NULL;
+
+            if(info->lifecycle->attach_settings)
+            {
+                info->settings->segment = dc_settings_segment_attach_from_environment(env, err, info->lifecycle->attach_settings);
+            }
+
+            // a parent already resolved the settings, there is nothing left to parse
+            if(info->settings->segment)
+            {
+                dc_settings_segment_apply(env, err, info->settings->segment, info->settings);
+                dc_settings_publish(env, err);
+
+                // the states that resolve the settings are skipped, an added phase after them comes next
+                info->schedule.current = SET_DEFAULTS;
+                ret_val = next_state(info, SET_DEFAULTS);
+            }
+            else
+            {
+                start_config_load(env, info);
+
+                if(info->lifecycle->providers)
+                {
+                    dc_config_providers_start(env, err, info->lifecycle->providers);
+                }
+            }
+
+            if(dc_error_has_error(err))
+            {
+                ret_val = CREATE_SETTINGS_ERROR;
+            }
         }
         else
         {
@@ -409,6 +866,7 @@ static int parse_command_line(const struct dc_env *env, struct dc_error *err, vo
 
     DC_TRACE(env);
     info = arg;
+    enter_phase(env, info, PARSE_COMMAND_LINE);
     ret_val = 0;
 
     if(info->lifecycle->parse_command_line)
@@ -418,7 +876,7 @@ static int parse_command_line(const struct dc_env *env, struct dc_error *err, vo
 
     if(ret_val == 0)
     {
-        ret_val = READ_ENV_VARS;
+        ret_val = next_state(info, PARSE_COMMAND_LINE);
     }
     else
     {
@@ -435,6 +893,7 @@ static int read_env_vars(const struct dc_env *env, struct dc_error *err, void *a
 
     DC_TRACE(env);
     info = arg;
+    enter_phase(env, info, READ_ENV_VARS);
     ret_val = 0;
 
     if(info->lifecycle->read_env_vars)
@@ -444,7 +903,7 @@ static int read_env_vars(const struct dc_env *env, struct dc_error *err, void *a
 
     if(ret_val == 0)
     {
-        ret_val = READ_CONFIG;
+        ret_val = next_state(info, READ_ENV_VARS);
     }
     else
     {
@@ -461,6 +920,7 @@ static int read_config(const struct dc_env *env, struct dc_error *err, void *arg
 
     DC_TRACE(env);
     info = arg;
+    enter_phase(env, info, READ_CONFIG);
     ret_val = 0;
 
     if(info->lifecycle->read_config && info->default_config_path)
@@ -470,7 +930,14 @@ static int read_config(const struct dc_env *env, struct dc_error *err, void *arg
 
         if(dc_error_has_no_error(err))
         {
-            ret_val = info->lifecycle->read_config(env, err, info->settings);
+            if(info->config_load)
+            {
+                ret_val = dc_config_load_finish(env, err, &info->config_load, info->settings);
+            }
+            else
+            {
+                ret_val = info->lifecycle->read_config(env, err, info->settings);
+            }
         }
         else
         {
@@ -478,9 +945,20 @@ static int read_config(const struct dc_env *env, struct dc_error *err, void *arg
         }
     }
 
+    // the config file goes first so a setting in it wins over the same setting from a provider
+    if(ret_val == 0 && info->lifecycle->providers)
+    {
+        dc_config_providers_apply(env, err, info->lifecycle->providers, info->settings);
+
+        if(dc_error_has_error(err))
+        {
+            ret_val = -1;
+        }
+    }
+
     if(ret_val == 0)
     {
-        ret_val = SET_DEFAULTS;
+        ret_val = next_state(info, READ_CONFIG);
     }
     else
     {
@@ -490,6 +968,69 @@ static int read_config(const struct dc_env *env, struct dc_error *err, void *arg
     return ret_val;
 }
 
+static void claim_settings(const struct dc_env *env, struct dc_application_settings *settings)
+{
+    const struct dc_opt_settings *opt_settings;
+
+    DC_TRACE(env);
+    opt_settings = (const struct dc_opt_settings *)settings;
+
+    // a member is only trusted when the options table points at it or names it by offset, anything else is cleared
+    for(size_t i = 0; i < sizeof(library_settings) / sizeof(library_settings[0]); i++)
+    {
+        struct dc_setting *current;
+        struct dc_setting *setting;
+        size_t offset;
+
+        dc_memcpy(env, &current, (char *)settings + library_settings[i], sizeof(current));
+        setting = NULL;
+        offset = offsetof(struct dc_opt_settings, parent) + library_settings[i];
+
+        for(size_t j = 0; opt_settings->opts && opt_settings->opts[j].name != NULL; j++)
+        {
+            const struct options *opt;
+
+            opt = &opt_settings->opts[j];
+
+            if(opt->setting != NULL && opt->setting == current)
+            {
+                setting = current;
+                break;
+            }
+
+            if(opt->setting == NULL && opt->setting_offset == offset)
+            {
+                setting = dc_options_get_setting(env, opt_settings, opt);
+                break;
+            }
+        }
+
+        dc_memcpy(env, (char *)settings + library_settings[i], &setting, sizeof(setting));
+    }
+}
+
+/*
+ * The default config file is read and parsed on another thread while the command line and the environment are parsed,
+ * read_config applies it. Only dc_default_load_config is known to read nothing but the config path, an application
+ * with its own read_config keeps reading in READ_CONFIG.
+ */
+static void start_config_load(const struct dc_env *env, struct dc_application_info *info)
+{
+    struct dc_error load_err;
+
+    DC_TRACE(env);
+
+    if(info->lifecycle->read_config != dc_default_load_config || info->default_config_path == NULL)
+    {
+        return;
+    }
+
+    // if the thread cannot be started read_config reads the file itself
+    dc_error_init(&load_err, NULL);
+    info->config_load = dc_config_load_start(env, &load_err, info->default_config_path);
+    dc_error_reset(&load_err);
+}
+
 static int set_defaults(const struct dc_env *env, struct dc_error *err, void *arg)
 {
     struct dc_application_info *info;
@@ -497,6 +1038,7 @@ static int set_defaults(const struct dc_env *env, struct dc_error *err, void *ar
 
     DC_TRACE(env);
     info = arg;
+    enter_phase(env, info, SET_DEFAULTS);
     ret_val = 0;
 
     if(info->lifecycle->set_defaults)
@@ -506,78 +1048,384 @@ static int set_defaults(const struct dc_env *env, struct dc_error *err, void *ar
 
     if(ret_val == 0)
     {
-        ret_val = RUN;
-    }
-    else
-    {
-        ret_val = SET_DEFAULTS_ERROR;
+        // the settings are resolved, give the readers their first snapshot
+        dc_settings_publish(env, err);
     }
 
-    return ret_val;
-}
-
-static int run(const struct dc_env *env, struct dc_error *err, void *arg)
-{
-    struct dc_application_info *info;
-    int ret_val;
+    if(ret_val == 0 && info->lifecycle->share_settings)
+    {
+        info->settings->segment = dc_settings_segment_publish(env, err, info->lifecycle->share_settings, info->settings);
 
-    DC_TRACE(env);
-    info = arg;
-    ret_val = info->lifecycle->run(env, err, info->settings);
+        if(dc_error_has_no_error(err))
+        {
+            ret_val = dc_settings_segment_export(env, err, info->settings->segment);
+        }
+        else
+        {
+            ret_val = -1;
+        }
+    }
 
     if(ret_val == 0)
     {
-        ret_val = CLEANUP;
+        ret_val = next_state(info, SET_DEFAULTS);
     }
     else
     {
-        ret_val = RUN_ERROR;
+        ret_val = SET_DEFAULTS_ERROR;
     }
 
     return ret_val;
 }
 
-static int cleanup(const struct dc_env *env, struct dc_error *err, void *arg)
+static int init_components(const struct dc_env *env, struct dc_error *err, void *arg)
 {
     struct dc_application_info *info;
     int ret_val;
 
     DC_TRACE(env);
     info = arg;
-    ret_val = 0;
+    enter_phase(env, info, INIT_COMPONENTS);
+
+    // the component threads inherit the placement and the region pages follow the NUMA policy, so it goes first
+    apply_placement(env, err, info->settings);
 
-    if(info->lifecycle->cleanup)
+    // the region comes first so that the components can make their pools from it
+    if(dc_error_has_no_error(err))
     {
-        ret_val = info->lifecycle->cleanup(env, err, info->settings);
+        create_memory_region(env, err, info->settings);
     }
 
-    if(ret_val == 0)
+    if(dc_error_has_no_error(err) && info->lifecycle->components)
+    {
+        dc_components_init(env, err, info->lifecycle->components, info->settings, 0);
+    }
+
+    if(dc_error_has_no_error(err))
     {
-        ret_val = DESTROY_SETTINGS;
+        ret_val = next_state(info, INIT_COMPONENTS);
     }
     else
     {
-        ret_val = CLEANUP_ERROR;
+        ret_val = INIT_COMPONENTS_ERROR;
     }
 
     return ret_val;
 }
 
-static int destroy_settings(const struct dc_env *env, struct dc_error *err, void *arg)
+static void apply_placement(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings)
 {
-    struct dc_application_info *info;
+    DC_TRACE(env);
+
+    if(settings->cpuset)
+    {
+        struct dc_cpuset set;
+
+        if(dc_setting_cpuset_get_cpus(env, settings->cpuset, &set))
+        {
+            dc_affinity_set_cpus(env, err, &set);
+        }
+    }
+
+    if(dc_error_has_no_error(err) && settings->numa_policy)
+    {
+        struct dc_numa_policy policy;
+
+        if(dc_setting_numa_policy_get_policy(env, settings->numa_policy, &policy))
+        {
+            dc_affinity_set_numa_policy(env, err, &policy);
+        }
+    }
+}
+
+static void create_memory_region(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings)
+{
+    uint64_t size;
+
+    DC_TRACE(env);
+
+    if(settings->memory_region_size == NULL)
+    {
+        return;
+    }
+
+    size = dc_setting_bytes_get(env, settings->memory_region_size);
+
+    if(size == 0)
+    {
+        return;
+    }
+
+    if(size > SIZE_MAX)
+    {
+        DC_ERROR_RAISE_USER(err, "memory region size is out of range", EINVAL);
+
+        return;
+    }
+
+    settings->memory_region = dc_memory_region_create(env, err, (size_t)size);
+
+    if(dc_error_has_no_error(err) && settings->memory_region_node &&
+       dc_setting_is_set(env, (struct dc_setting *)settings->memory_region_node))
+    {
+        dc_memory_region_bind(env, err, settings->memory_region, dc_setting_uint32_get(env, settings->memory_region_node));
+    }
+}
+
+static int warmup(const struct dc_env *env, struct dc_error *err, void *arg)
+{
+    struct dc_application_info *info;
+    struct dc_application_settings *settings;
+    int ret_val;
+
+    DC_TRACE(env);
+    info = arg;
+    enter_phase(env, info, WARMUP);
+    settings = info->settings;
+    ret_val = 0;
+
+    // locking first means the pages touched below, and whatever the callback allocates, stay resident
+    if(settings->lock_memory && dc_setting_bool_get(env, settings->lock_memory))
+    {
+        dc_warmup_lock_memory(env, err);
+    }
+
+    if(dc_error_has_no_error(err) && settings->prefault && dc_setting_bool_get(env, settings->prefault))
+    {
+        for(size_t i = 0; i < info->lifecycle->arena_count && dc_error_has_no_error(err); i++)
+        {
+            dc_warmup_prefault(env, err, info->lifecycle->arenas[i].addr, info->lifecycle->arenas[i].length);
+        }
+
+        if(dc_error_has_no_error(err) && settings->memory_region)
+        {
+            dc_warmup_prefault(env,
+                               err,
+                               dc_memory_region_get_address(env, settings->memory_region),
+                               dc_memory_region_get_length(env, settings->memory_region));
+        }
+    }
+
+    if(dc_error_has_no_error(err) && settings->warmup_files)
+    {
+        const struct dc_list *files;
+
+        files = dc_setting_list_get(env, settings->warmup_files);
+
+        for(size_t i = 0; files && i < dc_list_get_count(env, files) && dc_error_has_no_error(err); i++)
+        {
+            dc_warmup_file(env, err, dc_list_get_string(env, files, i));
+        }
+    }
+
+    if(dc_error_has_error(err))
+    {
+        ret_val = -1;
+    }
+    else if(info->lifecycle->warmup)
+    {
+        ret_val = info->lifecycle->warmup(env, err, settings);
+    }
+
+    if(ret_val == 0)
+    {
+        ret_val = next_state(info, WARMUP);
+    }
+    else
+    {
+        ret_val = WARMUP_ERROR;
+    }
+
+    return ret_val;
+}
+
+static int run(const struct dc_env *env, struct dc_error *err, void *arg)
+{
+    struct dc_application_info *info;
+    struct dc_control_server *control_server;
+    int ret_val;
+
+    DC_TRACE(env);
+    info = arg;
+    enter_phase(env, info, RUN);
+    control_server = NULL;
+
+    if(info->settings && info->lifecycle->zygote_path)
+    {
+        notify(env, info, "READY=1");
+        info->zygote_request = dc_zygote_serve(env, err, info->settings, info->lifecycle->zygote_path);
+
+        // only the zygote talks to the service manager
+        if(info->zygote_request && info->notifier)
+        {
+            dc_notifier_destroy_after_fork(env, &info->notifier);
+        }
+
+        if(dc_error_has_error(err))
+        {
+            if(info->zygote_request)
+            {
+                dc_zygote_request_reply(env, info->zygote_request, -1);
+            }
+
+            return RUN_ERROR;
+        }
+
+        // the zygote itself never runs, only the children it forks do
+        if(info->zygote_request == NULL)
+        {
+            return next_state(info, RUN);
+        }
+    }
+
+    // in zygote mode the components start in each child, threads they start would not survive the fork
+    if(info->lifecycle->components)
+    {
+        dc_components_start(env, err, info->lifecycle->components, info->settings);
+
+        if(dc_error_has_error(err))
+        {
+            if(info->zygote_request)
+            {
+                dc_zygote_request_reply(env, info->zygote_request, -1);
+            }
+
+            return RUN_ERROR;
+        }
+    }
+
+    // a zygote child would serve on the zygote's path, so only a process that runs on its own gets the control socket
+    if(info->settings && info->lifecycle->control_socket_path && info->zygote_request == NULL)
+    {
+        control_server = dc_control_server_start(env, err, info->settings, info->lifecycle->control_socket_path, info->lifecycle->reload_config);
+
+        if(dc_error_has_error(err))
+        {
+            return RUN_ERROR;
+        }
+    }
+
+    if(info->zygote_request == NULL)
+    {
+        notify(env, info, "READY=1");
+    }
+
+    dc_settings_quiesce(env, err);
+    ret_val = info->lifecycle->run(env, err, info->settings);
+    dc_settings_offline(env);
+
+    if(info->zygote_request)
+    {
+        dc_zygote_request_reply(env, info->zygote_request, ret_val);
+    }
+
+    if(control_server)
+    {
+        dc_control_server_stop(env, &control_server);
+    }
+
+    if(ret_val == 0)
+    {
+        ret_val = next_state(info, RUN);
+    }
+    else
+    {
+        ret_val = RUN_ERROR;
+    }
+
+    return ret_val;
+}
+
+static int cleanup(const struct dc_env *env, struct dc_error *err, void *arg)
+{
+    struct dc_application_info *info;
+    int ret_val;
+
+    DC_TRACE(env);
+    info = arg;
+    enter_phase(env, info, CLEANUP);
+    ret_val = 0;
+    notify(env, info, "STOPPING=1");
+
+    if(info->notifier)
+    {
+        dc_notifier_stop_watchdog(env, info->notifier);
+    }
+
+    if(info->lifecycle->components)
+    {
+        dc_components_stop(env, err, info->lifecycle->components, info->settings);
+
+        if(dc_error_has_error(err))
+        {
+            ret_val = -1;
+        }
+    }
+
+    if(ret_val == 0 && info->lifecycle->cleanup)
+    {
+        ret_val = info->lifecycle->cleanup(env, err, info->settings);
+    }
+
+    if(ret_val == 0)
+    {
+        ret_val = next_state(info, CLEANUP);
+    }
+    else
+    {
+        ret_val = CLEANUP_ERROR;
+    }
+
+    return ret_val;
+}
+
+static int destroy_settings(const struct dc_env *env, struct dc_error *err, void *arg)
+{
+    struct dc_application_info *info;
     int ret_val;
 
     DC_TRACE(env);
     info = arg;
+    enter_phase(env, info, DESTROY_SETTINGS);
     ret_val = 0;
 
+    if(info->settings && info->settings->segment)
+    {
+        dc_settings_segment_destroy(env, &info->settings->segment);
+    }
+
+    // nothing can be reading the settings any more so values replaced at runtime can be freed
+    dc_settings_reclaim(env);
+
+    // after an error the components may not have been stopped
+    if(info->lifecycle->components)
+    {
+        struct dc_error component_err;
+
+        dc_error_init(&component_err, NULL);
+        dc_components_stop(env, &component_err, info->lifecycle->components, info->settings);
+        dc_components_release(env, &component_err, info->lifecycle->components, info->settings);
+        dc_error_reset(&component_err);
+    }
+
+    // the components are released by now, nothing is left in the pools
+    if(info->settings && info->settings->memory_region)
+    {
+        dc_memory_region_destroy(env, &info->settings->memory_region);
+    }
+
     if(info->lifecycle->destroy_settings)
     {
         dc_setting_path_destroy(env, &info->settings->config_path);
         ret_val = info->lifecycle->destroy_settings(env, err, &info->settings);
     }
 
+    // the settings point into the request's arguments so it goes after them
+    if(info->zygote_request)
+    {
+        dc_zygote_request_destroy(env, &info->zygote_request);
+    }
+
     if(ret_val == 0)
     {
         ret_val = DC_FSM_EXIT;
@@ -650,6 +1498,30 @@ static int set_defaults_error(const struct dc_env *env,
 }
 #pragma GCC diagnostic pop
 
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int init_components_error(const struct dc_env *env,
+                                 struct dc_error *err,
+                                 void *arg)
+{
+    DC_TRACE(env);
+
+    return DESTROY_SETTINGS;
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int warmup_error(const struct dc_env *env,
+                        struct dc_error *err,
+                        void *arg)
+{
+    DC_TRACE(env);
+
+    return DESTROY_SETTINGS;
+}
+#pragma GCC diagnostic pop
+
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 static int run_error(const struct dc_env *env,
@@ -674,6 +1546,18 @@ static int cleanup_error(const struct dc_env *env,
 }
 #pragma GCC diagnostic pop
 
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int phase_error(const struct dc_env *env,
+                       struct dc_error *err,
+                       void *arg)
+{
+    DC_TRACE(env);
+
+    return DESTROY_SETTINGS;
+}
+#pragma GCC diagnostic pop
+
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 static int destroy_settings_error(const struct dc_env *env,
@@ -725,3 +1609,644 @@ static void bad_change_state(const struct dc_env *env,
     printf("%s: bad change %d -> %d\n", dc_fsm_info_get_name(info), from_state_id, to_state_id);
 }
 #pragma GCC diagnostic pop
+
+// the settings of the other commands are never created, so what they cost does not depend on how many there are
+static void select_command(const struct dc_env *env, struct dc_application_info *info)
+{
+    const struct dc_application_command *commands;
+    const struct dc_application_command *selected;
+    int depth;
+    int selected_depth;
+
+    DC_TRACE(env);
+    commands = info->lifecycle->commands;
+    selected = NULL;
+    selected_depth = 0;
+
+    for(depth = 1; commands && depth < info->argc; depth++)
+    {
+        const struct dc_application_command *command;
+
+        for(command = commands; command->name && dc_strcmp(env, command->name, info->argv[depth]) != 0; command++)
+        {
+        }
+
+        if(command->name == NULL)
+        {
+            break;
+        }
+
+        if(command->run)
+        {
+            selected = command;
+            selected_depth = depth;
+        }
+
+        commands = command->commands;
+    }
+
+    if(selected)
+    {
+        info->lifecycle->create_settings = selected->create_settings;
+        info->lifecycle->destroy_settings = selected->destroy_settings;
+        info->lifecycle->run = selected->run;
+        info->argc -= selected_depth;
+        info->argv += selected_depth;
+    }
+}
+
+static void enter_phase(const struct dc_env *env, struct dc_application_info *info, int state)
+{
+    DC_TRACE(env);
+    info->phase_usec[state - CREATE_SETTINGS] = dc_notifier_now(env);
+    info->schedule.current = state;
+}
+
+/*
+ * Every message carries the monotonic time each state was entered so far, the service manager ignores the names it
+ * does not know and anything that reads its log gets the startup timing.
+ */
+static void notify(const struct dc_env *env, struct dc_application_info *info, const char *state)
+{
+    struct dc_error err;
+    char message[1024];
+    char line[128];
+    size_t length;
+    uint64_t now;
+    int written;
+
+    DC_TRACE(env);
+
+    if(info->notifier == NULL)
+    {
+        return;
+    }
+
+    now = dc_notifier_now(env);
+    message[0] = '\0';
+    length = 0;
+
+    // each field is formatted on its own and one that does not fit is left out whole, never sent cut short
+    append_field(env, message, sizeof(message), &length, state);
+    written = snprintf(line, sizeof(line), "MONOTONIC_USEC=%" PRIu64, now);
+
+    if(written > 0 && (size_t)written < sizeof(line))
+    {
+        append_field(env, message, sizeof(message), &length, line);
+    }
+
+    if(info->phase_usec[0] != 0)
+    {
+        written = snprintf(line, sizeof(line), "STATUS=%s after %" PRIu64 "us", state, now - info->phase_usec[0]);
+
+        if(written > 0 && (size_t)written < sizeof(line))
+        {
+            append_field(env, message, sizeof(message), &length, line);
+        }
+    }
+
+    for(size_t i = 0; i < PHASE_COUNT; i++)
+    {
+        if(info->phase_usec[i] != 0)
+        {
+            written = snprintf(line, sizeof(line), "DC_PHASE_%s_USEC=%" PRIu64, phase_names[i], info->phase_usec[i]);
+
+            if(written > 0 && (size_t)written < sizeof(line))
+            {
+                append_field(env, message, sizeof(message), &length, line);
+            }
+        }
+    }
+
+    dc_error_init(&err, NULL);
+    dc_notifier_send(env, &err, info->notifier, message);
+
+    // the watchdog starts once the service manager has been told the application is ready
+    if(dc_error_has_no_error(&err) && dc_strcmp(env, state, "READY=1") == 0)
+    {
+        dc_notifier_start_watchdog(env, &err, info->notifier);
+    }
+
+    dc_error_reset(&err);
+}
+
+static void append_field(const struct dc_env *env, char *message, size_t size, size_t *length, const char *field)
+{
+    size_t field_length;
+    size_t separator;
+
+    DC_TRACE(env);
+    field_length = dc_strlen(env, field);
+    separator = *length > 0 ? 1 : 0;
+
+    if(field_length + separator >= size - *length)
+    {
+        return;
+    }
+
+    if(separator)
+    {
+        message[*length] = '\n';
+    }
+
+    dc_memcpy(env, &message[*length + separator], field, field_length + 1);
+    *length += separator + field_length;
+}
+
+/*
+ * The built in states and the added phases are the nodes of a graph: the built in states in a chain, every phase after
+ * CREATE_SETTINGS and before DESTROY_SETTINGS, and an edge for each name in a phase's after and before lists. The
+ * success transitions follow a topological order of it, the error transitions do not change.
+ */
+static struct dc_fsm_transition *compile_transitions(const struct dc_env *env,
+                                                     struct dc_error *err,
+                                                     struct dc_application_info *info)
+{
+    struct dc_fsm_transition *transitions;
+    struct schedule *schedule;
+    size_t node_count;
+    size_t phase_count;
+    size_t count;
+    bool *edges;
+
+    DC_TRACE(env);
+    phase_count = info->lifecycle->phase_count;
+    node_count = PHASE_COUNT + phase_count;
+    schedule = &info->schedule;
+    dc_memset(env, schedule, 0, sizeof(struct schedule));
+    transitions = NULL;
+    edges = dc_calloc(env, err, node_count * node_count, sizeof(bool));
+
+    if(dc_error_has_no_error(err))
+    {
+        schedule->order = dc_calloc(env, err, node_count, sizeof(int));
+    }
+
+    if(dc_error_has_no_error(err))
+    {
+        schedule->batches = dc_calloc(env, err, phase_count + 1, sizeof(struct batch));
+    }
+
+    if(dc_error_has_no_error(err))
+    {
+        schedule->batch_phases = dc_calloc(env, err, phase_count + 1, sizeof(const struct phase *));
+    }
+
+    if(dc_error_has_no_error(err))
+    {
+        add_constraints(env, err, info->lifecycle, edges, node_count);
+    }
+
+    if(dc_error_has_no_error(err))
+    {
+        sort_phases(env, err, info, edges, node_count);
+    }
+
+    dc_free(env, edges);
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    // init, the order, exit, the two ways out of CREATE_SETTINGS that skip states, the batch errors and the end marker
+    count = schedule->order_count + 1 + 2 + schedule->batch_count + ERROR_TRANSITION_COUNT + 1;
+    transitions = dc_calloc(env, err, count, sizeof(struct dc_fsm_transition));
+
+    if(dc_error_has_no_error(err))
+    {
+        size_t next;
+
+        next = 0;
+        transitions[next].from_id = DC_FSM_INIT;
+
+        for(size_t i = 0; i < schedule->order_count; i++)
+        {
+            int state;
+
+            state = schedule->order[i];
+            transitions[next].to_id = state;
+            transitions[next].perform = state < PHASE_START ? phase_functions[state - CREATE_SETTINGS] : run_phases;
+            next++;
+            transitions[next].from_id = state;
+        }
+
+        transitions[next].to_id = DC_FSM_EXIT;
+        transitions[next].perform = NULL;
+        next++;
+
+        // without settings there is nothing to resolve, with settings from a parent there is nothing left to resolve
+        transitions[next].from_id = CREATE_SETTINGS;
+        transitions[next].to_id = RUN;
+        transitions[next].perform = run;
+        next++;
+        transitions[next].from_id = CREATE_SETTINGS;
+        transitions[next].to_id = next_state(info, SET_DEFAULTS);
+        transitions[next].perform = transitions[next].to_id < PHASE_START ? phase_functions[transitions[next].to_id - CREATE_SETTINGS] : run_phases;
+        next++;
+
+        for(size_t i = 0; i < schedule->batch_count; i++)
+        {
+            transitions[next].from_id = PHASE_START + (int)i;
+            transitions[next].to_id = PHASE_ERROR;
+            transitions[next].perform = phase_error;
+            next++;
+        }
+
+        dc_memcpy(env, &transitions[next], error_transitions, sizeof(error_transitions));
+        next += ERROR_TRANSITION_COUNT;
+        transitions[next].from_id = DC_FSM_IGNORE;
+        transitions[next].to_id = DC_FSM_IGNORE;
+        transitions[next].perform = NULL;
+    }
+
+    return transitions;
+}
+
+static void add_constraints(const struct dc_env *env,
+                            struct dc_error *err,
+                            const struct dc_application_lifecycle *lifecycle,
+                            bool *edges,
+                            size_t node_count)
+{
+    DC_TRACE(env);
+
+    for(size_t i = 0; i + 1 < PHASE_COUNT; i++)
+    {
+        edges[i * node_count + i + 1] = true;
+    }
+
+    for(size_t i = 0; i < lifecycle->phase_count && dc_error_has_no_error(err); i++)
+    {
+        const struct phase *phase;
+        const char *after;
+        const char *before;
+        size_t node;
+
+        phase = &lifecycle->phases[i];
+        node = PHASE_COUNT + i;
+        after = phase->after;
+        before = phase->before;
+        edges[node] = true;                                    // after CREATE_SETTINGS
+        edges[node * node_count + PHASE_COUNT - 1] = true;     // before DESTROY_SETTINGS
+
+        // a step runs once the settings are resolved, one with no constraints also before anything is served
+        if(after == NULL && before == NULL)
+        {
+            before = "WARMUP";
+        }
+
+        if(after == NULL)
+        {
+            after = "SET_DEFAULTS";
+        }
+
+        add_names(env, err, lifecycle, edges, node_count, after, node, true);
+        add_names(env, err, lifecycle, edges, node_count, before, node, false);
+    }
+}
+
+static void add_names(const struct dc_env *env,
+                      struct dc_error *err,
+                      const struct dc_application_lifecycle *lifecycle,
+                      bool *edges,
+                      size_t node_count,
+                      const char *names,
+                      size_t node,
+                      bool after)
+{
+    const char *start;
+
+    DC_TRACE(env);
+    start = names;
+
+    while(start && *start && dc_error_has_no_error(err))
+    {
+        const char *end;
+        size_t other;
+
+        end = dc_strchr(env, start, ',');
+
+        if(end == NULL)
+        {
+            end = start + dc_strlen(env, start);
+        }
+
+        other = find_node(env, lifecycle, start, (size_t)(end - start));
+
+        if(other == SIZE_MAX || other == node)
+        {
+            DC_ERROR_RAISE_USER(err, "phase constraint names an unknown phase", EINVAL);
+        }
+        else if(after)
+        {
+            edges[other * node_count + node] = true;
+        }
+        else
+        {
+            edges[node * node_count + other] = true;
+        }
+
+        start = *end ? end + 1 : end;
+    }
+}
+
+static size_t find_node(const struct dc_env *env,
+                        const struct dc_application_lifecycle *lifecycle,
+                        const char *name,
+                        size_t length)
+{
+    DC_TRACE(env);
+
+    for(size_t i = 0; i < PHASE_COUNT; i++)
+    {
+        if(dc_strncmp(env, phase_names[i], name, length) == 0 && phase_names[i][length] == '\0')
+        {
+            return i;
+        }
+    }
+
+    for(size_t i = 0; i < lifecycle->phase_count; i++)
+    {
+        if(dc_strncmp(env, lifecycle->phases[i].name, name, length) == 0 && lifecycle->phases[i].name[length] == '\0')
+        {
+            return PHASE_COUNT + i;
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+/*
+ * Kahn's algorithm, taking a ready phase before a ready built in state so that each phase runs as early as its
+ * constraints allow. A ready parallel phase takes every other ready parallel phase with it: none of them depends on
+ * another, so they can run at the same time.
+ */
+static void sort_phases(const struct dc_env *env,
+                        struct dc_error *err,
+                        struct dc_application_info *info,
+                        const bool *edges,
+                        size_t node_count)
+{
+    const struct dc_application_lifecycle *lifecycle;
+    struct schedule *schedule;
+    size_t *indegree;
+    size_t *round;
+    bool *placed;
+    size_t placed_count;
+    size_t batch_phase_count;
+
+    DC_TRACE(env);
+    lifecycle = info->lifecycle;
+    schedule = &info->schedule;
+    indegree = dc_calloc(env, err, node_count, sizeof(size_t));
+    round = NULL;
+    placed = NULL;
+
+    if(dc_error_has_no_error(err))
+    {
+        round = dc_calloc(env, err, node_count, sizeof(size_t));
+    }
+
+    if(dc_error_has_no_error(err))
+    {
+        placed = dc_calloc(env, err, node_count, sizeof(bool));
+    }
+
+    for(size_t i = 0; i < node_count * node_count && dc_error_has_no_error(err); i++)
+    {
+        if(edges[i])
+        {
+            indegree[i % node_count]++;
+        }
+    }
+
+    placed_count = 0;
+    batch_phase_count = 0;
+
+    while(placed_count < node_count && dc_error_has_no_error(err))
+    {
+        size_t chosen;
+        size_t round_count;
+
+        chosen = SIZE_MAX;
+
+        for(size_t i = PHASE_COUNT; i < node_count && chosen == SIZE_MAX; i++)
+        {
+            if(!(placed[i]) && indegree[i] == 0)
+            {
+                chosen = i;
+            }
+        }
+
+        for(size_t i = 0; i < PHASE_COUNT && chosen == SIZE_MAX; i++)
+        {
+            if(!(placed[i]) && indegree[i] == 0)
+            {
+                chosen = i;
+            }
+        }
+
+        if(chosen == SIZE_MAX)
+        {
+            DC_ERROR_RAISE_USER(err, "phase constraints form a cycle", EINVAL);
+            break;
+        }
+
+        round[0] = chosen;
+        round_count = 1;
+
+        if(chosen < PHASE_COUNT)
+        {
+            schedule->order[schedule->order_count] = CREATE_SETTINGS + (int)chosen;
+        }
+        else
+        {
+            struct batch *batch;
+
+            if(lifecycle->phases[chosen - PHASE_COUNT].parallel)
+            {
+                for(size_t i = chosen + 1; i < node_count; i++)
+                {
+                    if(!(placed[i]) && indegree[i] == 0 && lifecycle->phases[i - PHASE_COUNT].parallel)
+                    {
+                        round[round_count] = i;
+                        round_count++;
+                    }
+                }
+            }
+
+            batch = &schedule->batches[schedule->batch_count];
+            batch->first = batch_phase_count;
+            batch->count = round_count;
+
+            for(size_t i = 0; i < round_count; i++)
+            {
+                schedule->batch_phases[batch_phase_count] = &lifecycle->phases[round[i] - PHASE_COUNT];
+                batch_phase_count++;
+            }
+
+            schedule->order[schedule->order_count] = PHASE_START + (int)schedule->batch_count;
+            schedule->batch_count++;
+        }
+
+        schedule->order_count++;
+
+        // the whole round is taken before anything it frees up can join it
+        for(size_t i = 0; i < round_count; i++)
+        {
+            placed[round[i]] = true;
+            placed_count++;
+        }
+
+        for(size_t i = 0; i < round_count; i++)
+        {
+            for(size_t j = 0; j < node_count; j++)
+            {
+                if(edges[round[i] * node_count + j])
+                {
+                    indegree[j]--;
+                }
+            }
+        }
+    }
+
+    dc_free(env, placed);
+    dc_free(env, round);
+    dc_free(env, indegree);
+}
+
+static void destroy_schedule(const struct dc_env *env, struct schedule *schedule)
+{
+    DC_TRACE(env);
+    dc_free(env, schedule->batch_phases);
+    dc_free(env, schedule->batches);
+    dc_free(env, schedule->order);
+    dc_memset(env, schedule, 0, sizeof(struct schedule));
+}
+
+// the state after the given one in the compiled order
+static int next_state(const struct dc_application_info *info, int state)
+{
+    const struct schedule *schedule;
+
+    schedule = &info->schedule;
+
+    for(size_t i = 0; i + 1 < schedule->order_count; i++)
+    {
+        if(schedule->order[i] == state)
+        {
+            return schedule->order[i + 1];
+        }
+    }
+
+    return DC_FSM_EXIT;
+}
+
+static int run_phases(const struct dc_env *env, struct dc_error *err, void *arg)
+{
+    struct dc_application_info *info;
+    const struct batch *batch;
+    int state;
+    int ret_val;
+
+    DC_TRACE(env);
+    info = arg;
+    state = next_state(info, info->schedule.current);
+    info->schedule.current = state;
+    batch = &info->schedule.batches[state - PHASE_START];
+
+    if(batch->count == 1)
+    {
+        ret_val = info->schedule.batch_phases[batch->first]->func(env, err, info->settings);
+    }
+    else
+    {
+        ret_val = run_parallel(env, err, info, batch);
+    }
+
+    if(ret_val == 0 && dc_error_has_no_error(err))
+    {
+        ret_val = next_state(info, state);
+    }
+    else
+    {
+        ret_val = PHASE_ERROR;
+    }
+
+    return ret_val;
+}
+
+// the first phase runs on the calling thread, each of the others on a thread of its own
+static int run_parallel(const struct dc_env *env, struct dc_error *err, struct dc_application_info *info, const struct batch *batch)
+{
+    struct phase_task *tasks;
+    int ret_val;
+
+    DC_TRACE(env);
+    tasks = dc_calloc(env, err, batch->count, sizeof(struct phase_task));
+
+    if(dc_error_has_error(err))
+    {
+        return -1;
+    }
+
+    for(size_t i = 0; i < batch->count; i++)
+    {
+        tasks[i].env = env;
+        tasks[i].settings = info->settings;
+        tasks[i].phase = info->schedule.batch_phases[batch->first + i];
+        dc_error_init(&tasks[i].err, NULL);
+    }
+
+    for(size_t i = 1; i < batch->count; i++)
+    {
+        tasks[i].started = pthread_create(&tasks[i].thread, NULL, run_task, &tasks[i]) == 0;
+    }
+
+    // a phase that did not get a thread runs here
+    for(size_t i = 0; i < batch->count; i++)
+    {
+        if(!(tasks[i].started))
+        {
+            run_task(&tasks[i]);
+        }
+    }
+
+    ret_val = 0;
+
+    for(size_t i = 0; i < batch->count; i++)
+    {
+        if(tasks[i].started)
+        {
+            pthread_join(tasks[i].thread, NULL);
+        }
+
+        if(ret_val == 0 && (tasks[i].result != 0 || dc_error_has_error(&tasks[i].err)))
+        {
+            ret_val = -1;
+
+            if(dc_error_has_error(&tasks[i].err))
+            {
+                DC_ERROR_RAISE_USER(err, tasks[i].err.message ? tasks[i].err.message : tasks[i].phase->name, EIO);
+            }
+        }
+
+        dc_error_reset(&tasks[i].err);
+    }
+
+    dc_free(env, tasks);
+
+    return ret_val;
+}
+
+static void *run_task(void *arg)
+{
+    struct phase_task *task;
+
+    task = arg;
+    DC_TRACE(task->env);
+    task->result = task->phase->func(task->env, &task->err, task->settings);
+
+    return NULL;
+}
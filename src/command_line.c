@@ -16,22 +16,58 @@
 
 
 #include "dc_application/command_line.h"
-#include "dc_application/options.h"
+#include <ctype.h>
 #include <dc_c/dc_stdlib.h>
-#include <dc_unix/dc_getopt.h>
+#include <dc_c/dc_string.h>
+#include <dc_posix/dc_fcntl.h>
+#include <dc_posix/dc_unistd.h>
+#include <dc_posix/sys/dc_mman.h>
+#include <dc_posix/sys/dc_stat.h>
+#include <errno.h>
+#include <getopt.h>
 
 
-static struct option *create_long_opts(const struct dc_env *env,
+/*
+ * The mapping is one byte longer than the file so the last argument always has room for its NUL. The operands are
+ * moved down to the start of the mapping as they are found, they never catch up with the argument being read since
+ * every argument takes at least as many bytes in the file as it does terminated.
+ */
+struct dc_response_file
+{
+    struct dc_response_file *next;
+    const char *arg;
+    char *data;
+    size_t map_length;
+    char *read;
+    char *end;
+    char *write;
+    size_t operand_count;
+};
+
+
+static bool next_long(const struct dc_env *env,
+                      struct dc_error *err,
+                      struct dc_command_line_parser *parser,
+                      const char *arg,
+                      const struct options **opt,
+                      const char **value);
+static bool next_short(const struct dc_env *env,
+                       struct dc_error *err,
+                       struct dc_command_line_parser *parser,
+                       const struct options **opt,
+                       const char **value);
+static const struct options *find_long(const struct dc_env *env,
                                        struct dc_error *err,
                                        const struct dc_opt_settings *opt_settings,
-                                       size_t count);
-static void parse_arguments(const struct dc_env *env,
-                            struct dc_error *err,
-                            int argc,
-                            char *argv[],
-                            const struct dc_opt_settings *opt_settings,
-                            const struct option *long_options,
-                            size_t count);
+                                       const char *name,
+                                       size_t length);
+static const char *take_argument(const struct dc_env *env, struct dc_command_line_parser *parser);
+static void take(struct dc_command_line_parser *parser);
+static bool is_operand(const char *arg);
+static struct dc_response_file *open_response_file(const struct dc_env *env, struct dc_error *err, const char *arg);
+static bool map_response_file(const struct dc_env *env, struct dc_error *err, struct dc_response_file *file, int fd);
+static char *next_token(const struct dc_env *env, struct dc_response_file *file);
+static void keep_operand(const struct dc_env *env, struct dc_response_file *file, const char *token);
 
 
 int dc_default_parse_command_line(const struct dc_env *env,
@@ -45,108 +81,596 @@ int dc_default_parse_command_line(const struct dc_env *env,
     if(settings)
     {
         struct dc_opt_settings *opt_settings;
-        struct option *long_options;
-        size_t count;
+        struct dc_command_line_parser parser;
+        const struct options *opt;
+        const char *arg;
 
         opt_settings = (struct dc_opt_settings *)settings;
-        count = 0;
 
-        while(opt_settings->opts[count].setting != NULL)
+        if(opt_settings->response_files)
         {
-            count++;
+            dc_command_line_release_response_files(env, &opt_settings->response_files);
         }
 
-        long_options = create_long_opts(env, err, opt_settings, count);
+        dc_command_line_parser_init(env, &parser, opt_settings, argc, argv);
 
-        if(dc_error_has_no_error(err))
+        while(dc_command_line_parser_next(env, err, &parser, &opt, &arg))
         {
-            parse_arguments(env, err, argc, argv, opt_settings, long_options, count);
-            opt_settings->optind = optind;
-            opt_settings->argc = argc;
-            opt_settings->argv = argv;
+            const void *value;
 
-            dc_free(env, long_options);
+            value = opt->read_from_string(env, err, arg);
+
+            if(dc_error_has_no_error(err))
+            {
+                dc_options_apply(env, err, opt_settings, opt, value, DC_SETTING_COMMAND_LINE);
+            }
+
+            if(dc_error_has_error(err))
+            {
+                // TODO: now what?
+                break;
+            }
         }
+
+        opt_settings->optind = parser.optind;
+        opt_settings->argc = argc;
+        opt_settings->argv = argv;
+        opt_settings->response_files = parser.response_files;
     }
 
     return 0;
 }
 
+void dc_command_line_parser_init(const struct dc_env *env,
+                                 struct dc_command_line_parser *parser,
+                                 const struct dc_opt_settings *opt_settings,
+                                 int argc,
+                                 char *argv[])
+{
+    DC_TRACE(env);
+    dc_memset(env, parser, 0, sizeof(*parser));
+    parser->opt_settings = opt_settings;
+    parser->argc = argc;
+    parser->argv = argv;
+    parser->optind = argc > 0 ? 1 : 0;
+    parser->next = parser->optind;
+    parser->operand_start = parser->optind;
+
+    for(size_t i = 0; opt_settings->opts[i].name != NULL; i++)
+    {
+        const struct options *opt;
 
-static struct option *create_long_opts(const struct dc_env *env,
-                                       struct dc_error *err,
-                                       const struct dc_opt_settings *opt_settings,
-                                       size_t count)
+        opt = &opt_settings->opts[i];
+
+        // ':' is not an option character, it marks an argument in the flags
+        if(opt->val > 0 && opt->val <= UCHAR_MAX && opt->val != ':' && dc_strchr(env, opt_settings->flags, opt->val))
+        {
+            parser->short_options[opt->val] = opt;
+        }
+    }
+}
+
+bool dc_command_line_parser_next(const struct dc_env *env,
+                                 struct dc_error *err,
+                                 struct dc_command_line_parser *parser,
+                                 const struct options **opt,
+                                 const char **value)
 {
-    struct option *long_options;
+    DC_TRACE(env);
 
-    long_options = dc_calloc(env, err, count + 1, sizeof(struct option));
+    if(parser->cluster)
+    {
+        return next_short(env, err, parser, opt, value);
+    }
 
-    if(dc_error_has_no_error(err))
+    while(true)
     {
-        for(size_t i = 0; i < count; i++)
+        const char *arg;
+
+        if(parser->file)
         {
-            long_options[i].name = opt_settings->opts[i].name;
-            long_options[i].has_arg = opt_settings->opts[i].required;
-            long_options[i].flag = NULL;
-            long_options[i].val = opt_settings->opts[i].val;
+            arg = next_token(env, parser->file);
+
+            if(arg == NULL)
+            {
+                parser->file = NULL;
+                continue;
+            }
+
+            // the rest of a file after "--" is operands, it is still read to the end to move them down
+            if(parser->done || is_operand(arg))
+            {
+                keep_operand(env, parser->file, arg);
+                continue;
+            }
+        }
+        else
+        {
+            if(parser->done || parser->next >= parser->argc)
+            {
+                break;
+            }
+
+            arg = parser->argv[parser->next];
+
+            if(is_operand(arg))
+            {
+                if(arg[0] == '@' && arg[1] != '\0')
+                {
+                    parser->file = open_response_file(env, err, arg);
+
+                    if(parser->file == NULL)
+                    {
+                        parser->done = true;
+
+                        return false;
+                    }
+
+                    parser->file->next = parser->response_files;
+                    parser->response_files = parser->file;
+                }
+
+                parser->next++;
+                continue;
+            }
+
+            take(parser);
+        }
+
+        if(arg[1] == '-' && arg[2] == '\0')
+        {
+            parser->done = true;
+        }
+        else if(arg[1] == '-')
+        {
+            return next_long(env, err, parser, &arg[2], opt, value);
+        }
+        else
+        {
+            parser->cluster = &arg[1];
+
+            return next_short(env, err, parser, opt, value);
         }
     }
 
-    return long_options;
+    // everything after "--" is an operand and already follows the operands that were stepped over
+    parser->optind = parser->operand_start;
+
+    return false;
 }
 
+void dc_command_line_operands_init(const struct dc_env *env,
+                                   struct dc_command_line_operands *operands,
+                                   const struct dc_opt_settings *opt_settings)
+{
+    DC_TRACE(env);
+    operands->opt_settings = opt_settings;
+    operands->index = opt_settings->optind;
+    operands->next = NULL;
+    operands->remaining = 0;
+}
 
-static void parse_arguments(const struct dc_env *env,
-                            struct dc_error *err,
-                            int argc,
-                            char *argv[],
-                            const struct dc_opt_settings *opt_settings,
-                            const struct option *long_options,
-                            size_t count)
+const char *dc_command_line_operands_next(const struct dc_env *env, struct dc_command_line_operands *operands)
 {
-    while(1)
+    const struct dc_opt_settings *opt_settings;
+    const char *operand;
+
+    DC_TRACE(env);
+    opt_settings = operands->opt_settings;
+
+    while(operands->remaining == 0)
     {
-        int c;
-        const void *value;
-        struct options *opt;
+        const struct dc_response_file *file;
+        const char *arg;
 
-        c = dc_getopt_long(env, argc, (char **)argv, opt_settings->flags, long_options, NULL);
+        if(operands->index >= opt_settings->argc)
+        {
+            return NULL;
+        }
 
-        if(c == -1)
+        arg = opt_settings->argv[operands->index];
+        operands->index++;
+
+        // an @path that was read is found by the pointer, the same text after "--" is just an operand
+        for(file = opt_settings->response_files; file && file->arg != arg; file = file->next)
         {
-            break;
         }
 
-        opt = NULL;
+        if(file == NULL)
+        {
+            return arg;
+        }
+
+        operands->next = file->data;
+        operands->remaining = file->operand_count;
+    }
+
+    operand = operands->next;
+    operands->next += dc_strlen(env, operand) + 1;
+    operands->remaining--;
+
+    return operand;
+}
+
+void dc_command_line_release_response_files(const struct dc_env *env, struct dc_response_file **pfiles)
+{
+    struct dc_response_file *file;
+    struct dc_error err;
+
+    DC_TRACE(env);
+    dc_error_init(&err, NULL);
+    file = *pfiles;
+    *pfiles = NULL;
+
+    while(file)
+    {
+        struct dc_response_file *next;
 
-        for(size_t i = 0; i < count; i++)
+        next = file->next;
+
+        if(file->data)
         {
-            if(opt_settings->opts[i].val == c)
-            {
-                opt = &opt_settings->opts[i];
-                break;
-            }
+            dc_munmap(env, &err, file->data, file->map_length);
         }
 
-        if(opt == NULL)
+        dc_free(env, file);
+        file = next;
+    }
+
+    dc_error_reset(&err);
+}
+
+static bool next_long(const struct dc_env *env,
+                      struct dc_error *err,
+                      struct dc_command_line_parser *parser,
+                      const char *arg,
+                      const struct options **opt,
+                      const char **value)
+{
+    const char *equals;
+    size_t length;
+
+    DC_TRACE(env);
+    equals = dc_strchr(env, arg, '=');
+    length = equals ? (size_t)(equals - arg) : dc_strlen(env, arg);
+    *opt = find_long(env, err, parser->opt_settings, arg, length);
+
+    if(*opt == NULL)
+    {
+        parser->done = true;
+
+        return false;
+    }
+
+    *value = NULL;
+
+    if(equals)
+    {
+        if((*opt)->required == no_argument)
         {
-            // TODO: fix
-            DC_ERROR_RAISE_USER(err, "", 100);
+            DC_ERROR_RAISE_USER(err, "option does not take an argument", EINVAL);
+            parser->done = true;
+
+            return false;
         }
-        else
+
+        *value = &equals[1];
+    }
+    else if((*opt)->required == required_argument)
+    {
+        *value = take_argument(env, parser);
+
+        if(*value == NULL)
         {
-            value = opt->read_from_string(env, err, optarg);
+            DC_ERROR_RAISE_USER(err, "option requires an argument", EINVAL);
+            parser->done = true;
 
-            if(dc_error_has_no_error(err))
-            {
-                opt->setting_func(env, err, opt->setting, value, DC_SETTING_COMMAND_LINE);
-            }
+            return false;
+        }
+    }
 
-            if(dc_error_has_error(err))
+    return true;
+}
+
+static bool next_short(const struct dc_env *env,
+                       struct dc_error *err,
+                       struct dc_command_line_parser *parser,
+                       const struct options **opt,
+                       const char **value)
+{
+    unsigned char c;
+
+    DC_TRACE(env);
+    c = (unsigned char)*parser->cluster;
+    parser->cluster++;
+    *opt = parser->short_options[c];
+    *value = NULL;
+
+    if(*opt == NULL)
+    {
+        DC_ERROR_RAISE_USER(err, "unknown option", EINVAL);
+        parser->cluster = NULL;
+        parser->done = true;
+
+        return false;
+    }
+
+    // an argument is the rest of the cluster, a required one can also be the next argument
+    if((*opt)->required != no_argument && *parser->cluster != '\0')
+    {
+        *value = parser->cluster;
+        parser->cluster = NULL;
+    }
+    else if((*opt)->required == required_argument)
+    {
+        parser->cluster = NULL;
+        *value = take_argument(env, parser);
+
+        if(*value == NULL)
+        {
+            DC_ERROR_RAISE_USER(err, "option requires an argument", EINVAL);
+            parser->done = true;
+
+            return false;
+        }
+    }
+
+    if(parser->cluster && *parser->cluster == '\0')
+    {
+        parser->cluster = NULL;
+    }
+
+    return true;
+}
+
+static const struct options *find_long(const struct dc_env *env,
+                                       struct dc_error *err,
+                                       const struct dc_opt_settings *opt_settings,
+                                       const char *name,
+                                       size_t length)
+{
+    const struct options *opt;
+
+    DC_TRACE(env);
+    opt = dc_options_find_name(env, opt_settings, name, length);
+
+    if(opt)
+    {
+        return opt;
+    }
+
+    if(length == 0)
+    {
+        DC_ERROR_RAISE_USER(err, "unknown option", EINVAL);
+
+        return NULL;
+    }
+
+    // only a miss pays for looking at every option, an abbreviation has to match one option
+    for(size_t i = 0; opt_settings->opts[i].name != NULL; i++)
+    {
+        if(dc_strncmp(env, opt_settings->opts[i].name, name, length) == 0)
+        {
+            if(opt)
             {
-                // TODO: now what?
+                DC_ERROR_RAISE_USER(err, "ambiguous option", EINVAL);
+
+                return NULL;
             }
+
+            opt = &opt_settings->opts[i];
         }
     }
+
+    if(opt == NULL)
+    {
+        DC_ERROR_RAISE_USER(err, "unknown option", EINVAL);
+
+        return NULL;
+    }
+
+    return opt;
+}
+
+static const char *take_argument(const struct dc_env *env, struct dc_command_line_parser *parser)
+{
+    const char *arg;
+
+    // an option at the end of a response file takes its argument from the command line after it
+    if(parser->file)
+    {
+        arg = next_token(env, parser->file);
+
+        if(arg)
+        {
+            return arg;
+        }
+
+        parser->file = NULL;
+    }
+
+    if(parser->next >= parser->argc)
+    {
+        return NULL;
+    }
+
+    arg = parser->argv[parser->next];
+    take(parser);
+
+    return arg;
+}
+
+// move argv[next] in front of the operands stepped over so far
+static void take(struct dc_command_line_parser *parser)
+{
+    char *arg;
+
+    arg = parser->argv[parser->next];
+
+    for(int i = parser->next; i > parser->operand_start; i--)
+    {
+        parser->argv[i] = parser->argv[i - 1];
+    }
+
+    parser->argv[parser->operand_start] = arg;
+    parser->operand_start++;
+    parser->next++;
+}
+
+static bool is_operand(const char *arg)
+{
+    // "-" on its own is an operand, usually standard input
+    return arg[0] != '-' || arg[1] == '\0';
+}
+
+static struct dc_response_file *open_response_file(const struct dc_env *env, struct dc_error *err, const char *arg)
+{
+    struct dc_response_file *file;
+    int fd;
+
+    DC_TRACE(env);
+    file = dc_calloc(env, err, 1, sizeof(struct dc_response_file));
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    file->arg = arg;
+    fd = dc_open(env, err, &arg[1], O_RDONLY | O_CLOEXEC);
+
+    if(dc_error_has_no_error(err))
+    {
+        struct dc_error close_err;
+
+        map_response_file(env, err, file, fd);
+        dc_error_init(&close_err, NULL);
+        dc_close(env, &close_err, fd);
+        dc_error_reset(&close_err);
+    }
+
+    if(dc_error_has_error(err))
+    {
+        dc_command_line_release_response_files(env, &file);
+    }
+
+    return file;
+}
+
+static bool map_response_file(const struct dc_env *env, struct dc_error *err, struct dc_response_file *file, int fd)
+{
+    struct stat status;
+    size_t length;
+    char *data;
+
+    DC_TRACE(env);
+    dc_fstat(env, err, fd, &status);
+
+    if(dc_error_has_error(err))
+    {
+        return false;
+    }
+
+    length = (size_t)status.st_size;
+
+    if(length == 0)
+    {
+        return true;
+    }
+
+    // reserve the extra byte first, then put the file over the start of it. The pages are private so splitting the
+    // arguments in place never writes to the file.
+    data = dc_mmap(env, err, NULL, length + 1, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if(dc_error_has_error(err))
+    {
+        return false;
+    }
+
+    file->data = data;
+    file->map_length = length + 1;
+    dc_mmap(env, err, data, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, 0);
+
+    if(dc_error_has_error(err))
+    {
+        return false;
+    }
+
+    file->read = data;
+    file->end = &data[length];
+    file->write = data;
+
+    return true;
+}
+
+static char *next_token(const struct dc_env *env, struct dc_response_file *file)
+{
+    char *token;
+    char *out;
+    char quote;
+
+    DC_TRACE(env);
+
+    while(file->read < file->end && isspace((unsigned char)*file->read))
+    {
+        file->read++;
+    }
+
+    if(file->read >= file->end)
+    {
+        return NULL;
+    }
+
+    // the unquoted argument is never longer than its text, so it is written over the text
+    token = file->read;
+    out = token;
+    quote = '\0';
+
+    while(file->read < file->end)
+    {
+        char c;
+
+        c = *file->read;
+        file->read++;
+
+        if(quote == '\0' && isspace((unsigned char)c))
+        {
+            break;
+        }
+
+        if(c == quote)
+        {
+            quote = '\0';
+        }
+        else if(quote == '\0' && (c == '\'' || c == '"'))
+        {
+            quote = c;
+        }
+        else if(c == '\\' && quote != '\'' && file->read < file->end)
+        {
+            *out = *file->read;
+            out++;
+            file->read++;
+        }
+        else
+        {
+            *out = c;
+            out++;
+        }
+    }
+
+    *out = '\0';
+
+    return token;
+}
+
+static void keep_operand(const struct dc_env *env, struct dc_response_file *file, const char *token)
+{
+    size_t length;
+
+    DC_TRACE(env);
+    length = dc_strlen(env, token) + 1;
+    dc_memmove(env, file->write, token, length);
+    file->write += length;
+    file->operand_count++;
 }
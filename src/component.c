@@ -0,0 +1,585 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "dc_application/component.h"
+#include "dc_application/options.h"
+#include "dc_application/settings.h"
+#include <dc_c/dc_stdlib.h>
+#include <dc_c/dc_string.h>
+#include <errno.h>
+#include <pthread.h>
+
+
+struct entry
+{
+    const struct dc_component *component;
+    size_t *dependents;
+    size_t dependent_count;
+    size_t waiting;
+    bool initialized;
+    bool started;
+};
+
+struct dc_components
+{
+    struct entry *entries;
+    size_t count;
+    size_t *init_order;
+    size_t init_count;
+    size_t *start_order;
+    size_t start_count;
+};
+
+// what the pool shares while the components initialize, guarded by mutex
+struct pool
+{
+    const struct dc_env *env;
+    struct dc_components *components;
+    struct dc_application_settings *settings;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    size_t *ready;
+    size_t ready_count;
+    size_t running;
+    bool failed;
+    char *failure;
+};
+
+
+static void resolve_dependencies(const struct dc_env *env, struct dc_error *err, struct dc_components *components);
+static void check_settings(const struct dc_env *env,
+                           struct dc_error *err,
+                           const struct dc_component *component,
+                           struct dc_application_settings *settings);
+static size_t find_component(const struct dc_env *env, const struct dc_components *components, const char *name, size_t length);
+static void *work(void *arg);
+static void finish(struct pool *pool, size_t index, struct dc_error *err, int result);
+static void record_failure(struct pool *pool, const char *message);
+
+
+struct dc_components *dc_components_create(const struct dc_env *env, struct dc_error *err)
+{
+    DC_TRACE(env);
+
+    return dc_calloc(env, err, 1, sizeof(struct dc_components));
+}
+
+void dc_components_destroy(const struct dc_env *env, struct dc_components **pcomponents)
+{
+    struct dc_components *components;
+
+    DC_TRACE(env);
+    components = *pcomponents;
+
+    for(size_t i = 0; i < components->count; i++)
+    {
+        dc_free(env, components->entries[i].dependents);
+    }
+
+    dc_free(env, components->start_order);
+    dc_free(env, components->init_order);
+    dc_free(env, components->entries);
+    dc_free(env, components);
+    *pcomponents = NULL;
+}
+
+void dc_components_add(const struct dc_env *env,
+                       struct dc_error *err,
+                       struct dc_components *components,
+                       const struct dc_component *component)
+{
+    struct entry *entries;
+
+    DC_TRACE(env);
+
+    if(find_component(env, components, component->name, dc_strlen(env, component->name)) != SIZE_MAX)
+    {
+        DC_ERROR_RAISE_USER(err, "component name is already used", EINVAL);
+
+        return;
+    }
+
+    entries = dc_realloc(env, err, components->entries, (components->count + 1) * sizeof(struct entry));
+
+    if(dc_error_has_no_error(err))
+    {
+        dc_memset(env, &entries[components->count], 0, sizeof(struct entry));
+        entries[components->count].component = component;
+        components->entries = entries;
+        components->count++;
+    }
+}
+
+void dc_components_init(const struct dc_env *env,
+                        struct dc_error *err,
+                        struct dc_components *components,
+                        struct dc_application_settings *settings,
+                        size_t thread_count)
+{
+    struct pool pool;
+    pthread_t *threads;
+    size_t started;
+
+    DC_TRACE(env);
+
+    if(components->count == 0)
+    {
+        return;
+    }
+
+    for(size_t i = 0; i < components->count && dc_error_has_no_error(err); i++)
+    {
+        check_settings(env, err, components->entries[i].component, settings);
+    }
+
+    if(dc_error_has_no_error(err))
+    {
+        resolve_dependencies(env, err, components);
+    }
+
+    if(dc_error_has_no_error(err))
+    {
+        components->init_order = dc_calloc(env, err, components->count, sizeof(size_t));
+    }
+
+    if(dc_error_has_no_error(err))
+    {
+        components->start_order = dc_calloc(env, err, components->count, sizeof(size_t));
+    }
+
+    if(dc_error_has_error(err))
+    {
+        return;
+    }
+
+    dc_memset(env, &pool, 0, sizeof(pool));
+    pool.env = env;
+    pool.components = components;
+    pool.settings = settings;
+    pool.ready = dc_calloc(env, err, components->count, sizeof(size_t));
+
+    if(dc_error_has_error(err))
+    {
+        return;
+    }
+
+    for(size_t i = 0; i < components->count; i++)
+    {
+        if(components->entries[i].waiting == 0)
+        {
+            pool.ready[pool.ready_count] = i;
+            pool.ready_count++;
+        }
+    }
+
+    if(thread_count == 0)
+    {
+        thread_count = components->count < DC_COMPONENTS_MAX_THREADS ? components->count : DC_COMPONENTS_MAX_THREADS;
+    }
+
+    pthread_mutex_init(&pool.mutex, NULL);
+    pthread_cond_init(&pool.cond, NULL);
+    started = 0;
+
+    // the calling thread is one of the pool, a thread that cannot be created leaves the work to the others
+    threads = dc_calloc(env, err, thread_count, sizeof(pthread_t));
+
+    for(size_t i = 1; threads && i < thread_count; i++)
+    {
+        if(pthread_create(&threads[started], NULL, work, &pool) == 0)
+        {
+            started++;
+        }
+    }
+
+    if(threads)
+    {
+        work(&pool);
+    }
+
+    for(size_t i = 0; i < started; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool.cond);
+    pthread_mutex_destroy(&pool.mutex);
+    dc_free(env, threads);
+    dc_free(env, pool.ready);
+
+    if(dc_error_has_no_error(err) && !(pool.failed) && components->init_count < components->count)
+    {
+        pool.failed = true;
+        DC_ERROR_RAISE_USER(err, "component dependencies form a cycle", EINVAL);
+    }
+    else if(dc_error_has_no_error(err) && pool.failed)
+    {
+        DC_ERROR_RAISE_USER(err, pool.failure ? pool.failure : "component init failed", EIO);
+    }
+
+    dc_free(env, pool.failure);
+
+    if(dc_error_has_error(err))
+    {
+        struct dc_error release_err;
+
+        dc_error_init(&release_err, NULL);
+        dc_components_release(env, &release_err, components, settings);
+        dc_error_reset(&release_err);
+    }
+}
+
+void dc_components_start(const struct dc_env *env,
+                         struct dc_error *err,
+                         struct dc_components *components,
+                         struct dc_application_settings *settings)
+{
+    DC_TRACE(env);
+
+    for(size_t i = 0; i < components->init_count && dc_error_has_no_error(err); i++)
+    {
+        struct entry *entry;
+        int result;
+
+        entry = &components->entries[components->init_order[i]];
+        result = 0;
+
+        if(entry->component->start)
+        {
+            result = entry->component->start(env, err, settings, entry->component->data);
+        }
+
+        if(result == 0 && dc_error_has_no_error(err))
+        {
+            entry->started = true;
+            components->start_order[components->start_count] = components->init_order[i];
+            components->start_count++;
+        }
+        else if(dc_error_has_no_error(err))
+        {
+            DC_ERROR_RAISE_USER(err, "component start failed", EIO);
+        }
+    }
+
+    if(dc_error_has_error(err))
+    {
+        struct dc_error stop_err;
+
+        dc_error_init(&stop_err, NULL);
+        dc_components_stop(env, &stop_err, components, settings);
+        dc_error_reset(&stop_err);
+    }
+}
+
+void dc_components_stop(const struct dc_env *env,
+                        struct dc_error *err,
+                        struct dc_components *components,
+                        struct dc_application_settings *settings)
+{
+    bool failed;
+
+    DC_TRACE(env);
+    failed = false;
+
+    while(components->start_count > 0)
+    {
+        struct entry *entry;
+
+        components->start_count--;
+        entry = &components->entries[components->start_order[components->start_count]];
+        entry->started = false;
+
+        if(entry->component->stop)
+        {
+            struct dc_error stop_err;
+
+            dc_error_init(&stop_err, NULL);
+
+            if(entry->component->stop(env, &stop_err, settings, entry->component->data) != 0 || dc_error_has_error(&stop_err))
+            {
+                failed = true;
+            }
+
+            dc_error_reset(&stop_err);
+        }
+    }
+
+    if(failed)
+    {
+        DC_ERROR_RAISE_USER(err, "component stop failed", EIO);
+    }
+}
+
+void dc_components_release(const struct dc_env *env,
+                           struct dc_error *err,
+                           struct dc_components *components,
+                           struct dc_application_settings *settings)
+{
+    bool failed;
+
+    DC_TRACE(env);
+    failed = false;
+
+    while(components->init_count > 0)
+    {
+        struct entry *entry;
+
+        components->init_count--;
+        entry = &components->entries[components->init_order[components->init_count]];
+        entry->initialized = false;
+
+        if(entry->component->destroy)
+        {
+            struct dc_error destroy_err;
+
+            dc_error_init(&destroy_err, NULL);
+
+            if(entry->component->destroy(env, &destroy_err, settings, entry->component->data) != 0 || dc_error_has_error(&destroy_err))
+            {
+                failed = true;
+            }
+
+            dc_error_reset(&destroy_err);
+        }
+    }
+
+    if(failed)
+    {
+        DC_ERROR_RAISE_USER(err, "component destroy failed", EIO);
+    }
+}
+
+static void resolve_dependencies(const struct dc_env *env, struct dc_error *err, struct dc_components *components)
+{
+    DC_TRACE(env);
+
+    for(size_t i = 0; i < components->count; i++)
+    {
+        dc_free(env, components->entries[i].dependents);
+        components->entries[i].dependents = NULL;
+        components->entries[i].dependent_count = 0;
+        components->entries[i].waiting = 0;
+    }
+
+    for(size_t i = 0; i < components->count && dc_error_has_no_error(err); i++)
+    {
+        const char *start;
+
+        start = components->entries[i].component->depends;
+
+        while(start && *start && dc_error_has_no_error(err))
+        {
+            struct entry *dependency;
+            const char *end;
+            size_t *dependents;
+            size_t index;
+
+            end = dc_strchr(env, start, ',');
+
+            if(end == NULL)
+            {
+                end = start + dc_strlen(env, start);
+            }
+
+            index = find_component(env, components, start, (size_t)(end - start));
+            start = *end ? end + 1 : end;
+
+            if(index == SIZE_MAX || index == i)
+            {
+                DC_ERROR_RAISE_USER(err, "component depends on an unknown component", EINVAL);
+                break;
+            }
+
+            dependency = &components->entries[index];
+            dependents = dc_realloc(env, err, dependency->dependents, (dependency->dependent_count + 1) * sizeof(size_t));
+
+            if(dc_error_has_no_error(err))
+            {
+                dependents[dependency->dependent_count] = i;
+                dependency->dependents = dependents;
+                dependency->dependent_count++;
+                components->entries[i].waiting++;
+            }
+        }
+    }
+}
+
+static void check_settings(const struct dc_env *env,
+                           struct dc_error *err,
+                           const struct dc_component *component,
+                           struct dc_application_settings *settings)
+{
+    const struct dc_opt_settings *opt_settings;
+    const char *start;
+
+    DC_TRACE(env);
+    opt_settings = (const struct dc_opt_settings *)settings;
+    start = component->settings;
+
+    while(start && *start && dc_error_has_no_error(err))
+    {
+        const struct options *opt;
+        const char *end;
+
+        end = dc_strchr(env, start, ',');
+
+        if(end == NULL)
+        {
+            end = start + dc_strlen(env, start);
+        }
+
+        opt = opt_settings ? dc_options_find_name(env, opt_settings, start, (size_t)(end - start)) : NULL;
+        start = *end ? end + 1 : end;
+
+        if(opt == NULL)
+        {
+            DC_ERROR_RAISE_USER(err, "component needs an unknown setting", EINVAL);
+        }
+        else if(!(dc_setting_is_set(env, dc_options_get_setting(env, opt_settings, opt))))
+        {
+            DC_ERROR_RAISE_USER(err, "component needs a setting that is not set", EINVAL);
+        }
+    }
+}
+
+static size_t find_component(const struct dc_env *env, const struct dc_components *components, const char *name, size_t length)
+{
+    DC_TRACE(env);
+
+    for(size_t i = 0; i < components->count; i++)
+    {
+        const char *other;
+
+        other = components->entries[i].component->name;
+
+        if(dc_strncmp(env, other, name, length) == 0 && other[length] == '\0')
+        {
+            return i;
+        }
+    }
+
+    return SIZE_MAX;
+}
+
+static void *work(void *arg)
+{
+    struct pool *pool;
+
+    pool = arg;
+    DC_TRACE(pool->env);
+    pthread_mutex_lock(&pool->mutex);
+
+    while(true)
+    {
+        const struct dc_component *component;
+        struct dc_error err;
+        size_t index;
+        int result;
+
+        // done once nothing is ready and nothing running can make something ready
+        if(pool->failed || (pool->ready_count == 0 && pool->running == 0))
+        {
+            break;
+        }
+
+        if(pool->ready_count == 0)
+        {
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+            continue;
+        }
+
+        pool->ready_count--;
+        index = pool->ready[pool->ready_count];
+        pool->running++;
+        pthread_mutex_unlock(&pool->mutex);
+
+        component = pool->components->entries[index].component;
+        result = 0;
+        dc_error_init(&err, NULL);
+
+        if(component->init)
+        {
+            result = component->init(pool->env, &err, pool->settings, component->data);
+        }
+
+        pthread_mutex_lock(&pool->mutex);
+        finish(pool, index, &err, result);
+        dc_error_reset(&err);
+        pthread_cond_broadcast(&pool->cond);
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+
+    return NULL;
+}
+
+// called with the mutex held
+static void finish(struct pool *pool, size_t index, struct dc_error *err, int result)
+{
+    struct dc_components *components;
+    struct entry *entry;
+
+    components = pool->components;
+    entry = &components->entries[index];
+    pool->running--;
+
+    if(result != 0 || dc_error_has_error(err))
+    {
+        // the components still running finish, nothing new is started
+        if(!(pool->failed))
+        {
+            record_failure(pool, dc_error_has_error(err) && err->message ? err->message : entry->component->name);
+        }
+
+        pool->failed = true;
+
+        return;
+    }
+
+    entry->initialized = true;
+    components->init_order[components->init_count] = index;
+    components->init_count++;
+
+    for(size_t i = 0; i < entry->dependent_count; i++)
+    {
+        struct entry *dependent;
+
+        dependent = &components->entries[entry->dependents[i]];
+        dependent->waiting--;
+
+        if(dependent->waiting == 0)
+        {
+            pool->ready[pool->ready_count] = entry->dependents[i];
+            pool->ready_count++;
+        }
+    }
+}
+
+static void record_failure(struct pool *pool, const char *message)
+{
+    struct dc_error err;
+
+    dc_error_init(&err, NULL);
+    pool->failure = dc_malloc(pool->env, &err, dc_strlen(pool->env, message) + 1);
+
+    if(dc_error_has_no_error(&err))
+    {
+        dc_strcpy(pool->env, pool->failure, message);
+    }
+
+    dc_error_reset(&err);
+}
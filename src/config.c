@@ -17,8 +17,62 @@
 
 #include "dc_application/config.h"
 #include "dc_application/options.h"
+#include "dc_application/parse.h"
 #include "dc_application/settings.h"
 #include <dc_c/dc_stdlib.h>
+#include <dc_c/dc_string.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_util/path.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+
+
+struct dc_config_load
+{
+    pthread_t thread;
+    char *path;
+    config_t config;
+    int read;
+};
+
+
+static char *canonical_path(const struct dc_env *env, struct dc_error *err, const char *path);
+static void *load_file(void *arg);
+static int use_config(const struct dc_env *env,
+                      struct dc_error *err,
+                      struct dc_application_settings *settings,
+                      config_t *config,
+                      int read);
+static void apply_config(const struct dc_env *env,
+                         struct dc_error *err,
+                         const config_t *config,
+                         struct dc_opt_settings *opt_settings,
+                         bool reload);
+static void apply_group(const struct dc_env *env,
+                        struct dc_error *err,
+                        const config_setting_t *group,
+                        struct dc_opt_settings *opt_settings,
+                        char *path,
+                        size_t length,
+                        bool reload);
+static void apply_item(const struct dc_env *env,
+                       struct dc_error *err,
+                       struct dc_opt_settings *opt_settings,
+                       const struct options *opt,
+                       config_setting_t *item,
+                       bool reload);
+static bool config_signed(const struct dc_env *env,
+                          struct dc_error *err,
+                          const config_setting_t *item,
+                          int64_t min,
+                          int64_t max,
+                          int64_t *value);
+static bool config_unsigned(const struct dc_env *env,
+                            struct dc_error *err,
+                            const config_setting_t *item,
+                            uint64_t max,
+                            uint64_t *value);
 
 
 int dc_default_load_config(const struct dc_env *env,
@@ -27,13 +81,235 @@ int dc_default_load_config(const struct dc_env *env,
 {
     const char *config_path;
     config_t config;
+    int ret_val;
+
+    DC_TRACE(env);
+    config_path = dc_setting_path_get(env, settings->config_path);
+    config_init(&config);
+    ret_val = use_config(env, err, settings, &config, config_read_file(&config, config_path));
+    config_destroy(&config);
+
+    return ret_val;
+}
+
+struct dc_config_load *dc_config_load_start(const struct dc_env *env, struct dc_error *err, const char *path)
+{
+    struct dc_config_load *load;
+    int result;
+
+    DC_TRACE(env);
+    load = dc_malloc(env, err, sizeof(struct dc_config_load));
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    // the default is written the way a user would ("~/.app.cfg"), the config path setting holds it expanded
+    load->path = canonical_path(env, err, path);
+
+    if(dc_error_has_error(err))
+    {
+        dc_free(env, load);
+
+        return NULL;
+    }
+
+    load->read = CONFIG_FALSE;
+    config_init(&load->config);
+    result = pthread_create(&load->thread, NULL, load_file, load);
+
+    if(result != 0)
+    {
+        DC_ERROR_RAISE_ERRNO(err, result);
+        config_destroy(&load->config);
+        dc_free(env, load->path);
+        dc_free(env, load);
+
+        return NULL;
+    }
+
+    return load;
+}
+
+int dc_config_load_finish(const struct dc_env *env,
+                          struct dc_error *err,
+                          struct dc_config_load **pload,
+                          struct dc_application_settings *settings)
+{
+    struct dc_config_load *load;
+    const char *config_path;
+    char *path;
+    int ret_val;
+
+    DC_TRACE(env);
+    load = *pload;
+    pthread_join(load->thread, NULL);
+    config_path = dc_setting_path_get(env, settings->config_path);
+    path = NULL;
+
+    if(config_path)
+    {
+        struct dc_error path_err;
+
+        dc_error_init(&path_err, NULL);
+        path = canonical_path(env, &path_err, config_path);
+        dc_error_reset(&path_err);
+    }
+
+    // the command line or the environment named another file, the one that was read is of no use
+    if(path && dc_strcmp(env, path, load->path) == 0)
+    {
+        ret_val = use_config(env, err, settings, &load->config, load->read);
+    }
+    else
+    {
+        ret_val = dc_default_load_config(env, err, settings);
+    }
+
+    if(path)
+    {
+        dc_free(env, path);
+    }
+
+    config_destroy(&load->config);
+    dc_free(env, load->path);
+    dc_free(env, load);
+    *pload = NULL;
+
+    return ret_val;
+}
+
+void dc_config_load_cancel(const struct dc_env *env, struct dc_config_load **pload)
+{
+    struct dc_config_load *load;
+
+    DC_TRACE(env);
+    load = *pload;
+    pthread_join(load->thread, NULL);
+    config_destroy(&load->config);
+    dc_free(env, load->path);
+    dc_free(env, load);
+    *pload = NULL;
+}
+
+void dc_config_apply_string(const struct dc_env *env,
+                            struct dc_error *err,
+                            struct dc_application_settings *settings,
+                            const char *text)
+{
+    config_t config;
+
+    DC_TRACE(env);
+    config_init(&config);
+
+    if(config_read_string(&config, text))
+    {
+        apply_config(env, err, &config, (struct dc_opt_settings *)settings, false);
+    }
+    else
+    {
+        DC_ERROR_RAISE_USER(err, config_error_text(&config), -1);
+    }
+
+    config_destroy(&config);
+}
+
+int dc_default_reload_config(const struct dc_env *env,
+                             struct dc_error *err,
+                             struct dc_application_settings *settings)
+{
+    const char *config_path;
+    config_t config;
+    int ret_val;
 
     DC_TRACE(env);
     config_path = dc_setting_path_get(env, settings->config_path);
 
+    if(config_path == NULL)
+    {
+        return 0;
+    }
+
     config_init(&config);
 
-    if(!(config_read_file(&config, config_path)))
+    if(config_read_file(&config, config_path))
+    {
+        dc_settings_transaction_begin(env);
+        apply_config(env, err, &config, (struct dc_opt_settings *)settings, true);
+        dc_settings_transaction_commit(env, err);
+        ret_val = dc_error_has_no_error(err) ? 0 : -1;
+    }
+    else
+    {
+        DC_ERROR_RAISE_USER(err, config_error_text(&config), -1);
+        ret_val = -1;
+    }
+
+    config_destroy(&config);
+
+    return ret_val;
+}
+
+// the same file named two ways ("./app.cfg", "app.cfg") compares equal, a file that does not exist is left expanded
+static char *canonical_path(const struct dc_env *env, struct dc_error *err, const char *path)
+{
+    char resolved[PATH_MAX];
+    struct dc_error resolve_err;
+    char *expanded;
+    char *canonical;
+
+    DC_TRACE(env);
+    expanded = NULL;
+    dc_expand_path(env, err, &expanded, path);
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    dc_error_init(&resolve_err, NULL);
+
+    if(dc_realpath(env, &resolve_err, expanded, resolved) == NULL)
+    {
+        dc_error_reset(&resolve_err);
+
+        return expanded;
+    }
+
+    dc_error_reset(&resolve_err);
+    canonical = dc_malloc(env, err, dc_strlen(env, resolved) + 1);
+
+    if(dc_error_has_no_error(err))
+    {
+        dc_strcpy(env, canonical, resolved);
+    }
+
+    dc_free(env, expanded);
+
+    return canonical;
+}
+
+// only libconfig runs on the thread, dc_env and the settings are left to the caller
+static void *load_file(void *arg)
+{
+    struct dc_config_load *load;
+
+    load = arg;
+    load->read = config_read_file(&load->config, load->path);
+
+    return NULL;
+}
+
+static int use_config(const struct dc_env *env,
+                      struct dc_error *err,
+                      struct dc_application_settings *settings,
+                      config_t *config,
+                      int read)
+{
+    DC_TRACE(env);
+
+    if(!(read))
     {
         // if the config file was passed in on the command line or set as an env var then it needs to exist
         if(dc_setting_is_set(env, (struct dc_setting *)settings->config_path))
@@ -41,54 +317,152 @@ int dc_default_load_config(const struct dc_env *env,
             // TODO: this should be an error somehow - time to figure that out!
             fprintf(stderr,                     // NOLINT(cert-err33-c)
                     "%s:%d - %s\n",
-                    config_error_file(&config),
-                    config_error_line(&config),
-                    config_error_text(&config));
-            config_destroy(&config);
+                    config_error_file(config),
+                    config_error_line(config),
+                    config_error_text(config));
 
             return -1;
         }
     }
     else
     {
-        struct dc_opt_settings *opt_settings;
+        apply_config(env, err, config, (struct dc_opt_settings *)settings, false);
+    }
+
+    return 0;
+}
+
+static void apply_config(const struct dc_env *env,
+                         struct dc_error *err,
+                         const config_t *config,
+                         struct dc_opt_settings *opt_settings,
+                         bool reload)
+{
+    // with an index the file is walked once and each setting in it is looked up, otherwise each option is looked for
+    if(opt_settings->config_index)
+    {
+        char path[DC_OPTIONS_MAX_CONFIG_KEY];
+
+        apply_group(env, err, config_root_setting(config), opt_settings, path, 0, reload);
 
-        opt_settings = (struct dc_opt_settings *)settings;
+        return;
+    }
 
-        for(size_t i = 0; opt_settings->opts[i].name != NULL; i++)
+    for(size_t i = 0; opt_settings->opts[i].name != NULL; i++)
+    {
+        const struct options *opt;
+
+        opt = &opt_settings->opts[i];
+
+        if(opt->config_key)
         {
-            struct options *opt;
+            config_setting_t *item;
 
-            opt = &opt_settings->opts[i];
+            item = config_lookup(config, opt->config_key);
 
-            if(opt->config_key)
+            if(item != NULL)
             {
-                config_setting_t *item;
-                const void *value;
+                apply_item(env, err, opt_settings, opt, item, reload);
+            }
+        }
+    }
+}
+
+static void apply_group(const struct dc_env *env,
+                        struct dc_error *err,
+                        const config_setting_t *group,
+                        struct dc_opt_settings *opt_settings,
+                        char *path,
+                        size_t length,
+                        bool reload)
+{
+    int count;
+
+    count = config_setting_length(group);
+
+    for(int i = 0; i < count; i++)
+    {
+        config_setting_t *item;
+        const char *name;
+        size_t name_length;
+        size_t item_length;
+
+        item = config_setting_get_elem(group, (unsigned int)i);
+        name = config_setting_name(item);
 
-                item = config_lookup(&config, opt->config_key);
+        if(name == NULL)
+        {
+            continue;
+        }
 
-                if(item != NULL)
-                {
-                    value = opt->read_from_config(env, err, item);
+        name_length = dc_strlen(env, name);
+        item_length = length + (length > 0) + name_length;
 
-                    if(dc_error_has_no_error(err))
-                    {
-                        opt->setting_func(env, err, opt->setting, value, DC_SETTING_CONFIG);
-                    }
+        // nothing longer than the longest key can match, the generator refuses keys that do not fit
+        if(item_length >= DC_OPTIONS_MAX_CONFIG_KEY)
+        {
+            continue;
+        }
 
-                    if(dc_error_has_error(err))
-                    {
-                        // TODO: now what?
-                    }
-                }
+        if(length > 0)
+        {
+            path[length] = '.';
+        }
+
+        dc_memcpy(env, &path[item_length - name_length], name, name_length);
+
+        if(config_setting_type(item) == CONFIG_TYPE_GROUP)
+        {
+            apply_group(env, err, item, opt_settings, path, item_length, reload);
+        }
+        else
+        {
+            const struct options *opt;
+
+            opt = dc_options_find_config(env, opt_settings, path, item_length);
+
+            if(opt)
+            {
+                apply_item(env, err, opt_settings, opt, item, reload);
             }
         }
     }
+}
 
-    config_destroy(&config);
+static void apply_item(const struct dc_env *env,
+                       struct dc_error *err,
+                       struct dc_opt_settings *opt_settings,
+                       const struct options *opt,
+                       config_setting_t *item,
+                       bool reload)
+{
+    const void *value;
 
-    return 0;
+    value = opt->read_from_config(env, err, item);
+
+    if(dc_error_has_no_error(err))
+    {
+        struct dc_setting *setting;
+
+        setting = dc_options_get_setting(env, opt_settings, opt);
+
+        if(!(reload))
+        {
+            dc_options_apply(env, err, opt_settings, opt, value, DC_SETTING_CONFIG);
+        }
+        // a reload never overrides the command line, environment, or runtime changes
+        else if((setting->type == DC_SETTING_NONE || setting->type == DC_SETTING_DEFAULT ||
+                 setting->type == DC_SETTING_CONFIG) &&
+                 dc_options_check_range(env, err, opt_settings, opt, value))
+        {
+            dc_setting_update(env, err, setting, value, DC_SETTING_CONFIG);
+        }
+    }
+
+    if(dc_error_has_error(err))
+    {
+        // TODO: now what?
+    }
 }
 
 #pragma GCC diagnostic push
@@ -125,48 +499,348 @@ const void *dc_flag_from_config(const struct dc_env *env,
 }
 #pragma GCC diagnostic pop
 
+// the converted value is only good until the next conversion on the same thread, callers use it right away
 const void *dc_uint16_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item)
 {
-    long long config_value;
-    uint16_t *value;
+    static _Thread_local uint16_t value;
+    uint64_t config_value;
 
     DC_TRACE(env);
-    config_value = item->value.llval;
 
-    if(config_value < 0 || config_value > UINT16_MAX)
+    if(!(config_unsigned(env, err, item, UINT16_MAX, &config_value)))
     {
         return NULL;
     }
 
-    value = dc_malloc(env, err, sizeof(uint16_t));
+    value = (uint16_t)config_value;
 
-    if(dc_error_has_no_error(err))
+    return &value;
+}
+
+const void *dc_in_port_t_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item)
+{
+    static _Thread_local in_port_t value;
+    uint64_t config_value;
+
+    DC_TRACE(env);
+
+    if(!(config_unsigned(env, err, item, UINT16_MAX, &config_value)))
     {
-        *value = (uint16_t)config_value;
+        return NULL;
     }
 
-    return value;
+    value = (in_port_t)config_value;
+
+    return &value;
 }
 
-const void *dc_in_port_t_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item)
+const void *dc_int32_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item)
 {
-    long long config_value;
-    in_port_t *value;
+    static _Thread_local int32_t value;
+    int64_t config_value;
 
     DC_TRACE(env);
-    config_value = item->value.llval;
 
-    if(config_value < 0 || config_value > UINT16_MAX)
+    if(!(config_signed(env, err, item, INT32_MIN, INT32_MAX, &config_value)))
     {
         return NULL;
     }
 
-    value = dc_malloc(env, err, sizeof(in_port_t));
+    value = (int32_t)config_value;
 
-    if(dc_error_has_no_error(err))
+    return &value;
+}
+
+const void *dc_int64_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item)
+{
+    static _Thread_local int64_t value;
+    int64_t config_value;
+
+    DC_TRACE(env);
+
+    if(!(config_signed(env, err, item, INT64_MIN, INT64_MAX, &config_value)))
+    {
+        return NULL;
+    }
+
+    value = (int64_t)config_value;
+
+    return &value;
+}
+
+const void *dc_uint32_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item)
+{
+    static _Thread_local uint32_t value;
+    uint64_t config_value;
+
+    DC_TRACE(env);
+
+    if(!(config_unsigned(env, err, item, UINT32_MAX, &config_value)))
+    {
+        return NULL;
+    }
+
+    value = (uint32_t)config_value;
+
+    return &value;
+}
+
+const void *dc_uint64_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item)
+{
+    static _Thread_local uint64_t value;
+    uint64_t config_value;
+
+    DC_TRACE(env);
+
+    if(!(config_unsigned(env, err, item, UINT64_MAX, &config_value)))
+    {
+        return NULL;
+    }
+
+    value = (uint64_t)config_value;
+
+    return &value;
+}
+
+const void *dc_size_t_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item)
+{
+    static _Thread_local size_t value;
+    uint64_t config_value;
+
+    DC_TRACE(env);
+
+    if(!(config_unsigned(env, err, item, SIZE_MAX, &config_value)))
     {
-        *value = (in_port_t)config_value;
+        return NULL;
     }
 
+    value = (size_t)config_value;
+
+    return &value;
+}
+
+const void *dc_double_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item)
+{
+    static _Thread_local double value;
+
+    DC_TRACE(env);
+
+    switch(config_setting_type(item))
+    {
+        case CONFIG_TYPE_INT:
+        case CONFIG_TYPE_INT64:
+        {
+            value = (double)config_setting_get_int64(item);
+            break;
+        }
+        case CONFIG_TYPE_FLOAT:
+        {
+            value = config_setting_get_float(item);
+            break;
+        }
+        case CONFIG_TYPE_STRING:
+        {
+            if(!(dc_parse_double(env, err, config_setting_get_string(item), &value)))
+            {
+                return NULL;
+            }
+
+            break;
+        }
+        default:
+        {
+            DC_ERROR_RAISE_USER(err, "config value is not a number", EINVAL);
+
+            return NULL;
+        }
+    }
+
+    return &value;
+}
+
+const void *dc_bytes_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item)
+{
+    static _Thread_local uint64_t value;
+
+    DC_TRACE(env);
+
+    // a bare integer is a number of bytes, anything with a unit has to be written as a string
+    if(config_setting_type(item) == CONFIG_TYPE_STRING)
+    {
+        if(!(dc_parse_bytes(env, err, config_setting_get_string(item), &value)))
+        {
+            return NULL;
+        }
+    }
+    else if(!(config_unsigned(env, err, item, UINT64_MAX, &value)))
+    {
+        return NULL;
+    }
+
+    return &value;
+}
+
+const void *dc_duration_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item)
+{
+    static _Thread_local uint64_t value;
+
+    DC_TRACE(env);
+
+    if(config_setting_type(item) != CONFIG_TYPE_STRING)
+    {
+        DC_ERROR_RAISE_USER(err, "config duration must be a string with a unit", EINVAL);
+
+        return NULL;
+    }
+
+    if(!(dc_parse_duration(env, err, config_setting_get_string(item), &value)))
+    {
+        return NULL;
+    }
+
+    return &value;
+}
+
+// each converter keeps the last list it made for the thread and frees it on the next call
+const void *dc_string_list_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item)
+{
+    static _Thread_local struct dc_list *value = NULL;
+
+    DC_TRACE(env);
+
+    if(value)
+    {
+        dc_list_destroy(env, &value);
+    }
+
+    value = dc_list_from_config(env, err, DC_LIST_STRING, item);
+
     return value;
 }
+
+const void *dc_integer_list_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item)
+{
+    static _Thread_local struct dc_list *value = NULL;
+
+    DC_TRACE(env);
+
+    if(value)
+    {
+        dc_list_destroy(env, &value);
+    }
+
+    value = dc_list_from_config(env, err, DC_LIST_INTEGER, item);
+
+    return value;
+}
+
+const void *dc_endpoint_list_from_config(const struct dc_env *env, struct dc_error *err, config_setting_t *item)
+{
+    static _Thread_local struct dc_list *value = NULL;
+
+    DC_TRACE(env);
+
+    if(value)
+    {
+        dc_list_destroy(env, &value);
+    }
+
+    value = dc_list_from_config(env, err, DC_LIST_ENDPOINT, item);
+
+    return value;
+}
+
+// strings are accepted as well since libconfig cannot hold an unsigned value above INT64_MAX
+static bool config_signed(const struct dc_env *env,
+                          struct dc_error *err,
+                          const config_setting_t *item,
+                          int64_t min,
+                          int64_t max,
+                          int64_t *value)
+{
+    switch(config_setting_type(item))
+    {
+        case CONFIG_TYPE_INT:
+        case CONFIG_TYPE_INT64:
+        {
+            *value = config_setting_get_int64(item);
+            break;
+        }
+        case CONFIG_TYPE_STRING:
+        {
+            if(!(dc_parse_int64(env, err, config_setting_get_string(item), value)))
+            {
+                return false;
+            }
+
+            break;
+        }
+        default:
+        {
+            DC_ERROR_RAISE_USER(err, "config value is not an integer", EINVAL);
+
+            return false;
+        }
+    }
+
+    if(*value < min || *value > max)
+    {
+        DC_ERROR_RAISE_USER(err, "config value is out of range", ERANGE);
+
+        return false;
+    }
+
+    return true;
+}
+
+static bool config_unsigned(const struct dc_env *env,
+                            struct dc_error *err,
+                            const config_setting_t *item,
+                            uint64_t max,
+                            uint64_t *value)
+{
+    switch(config_setting_type(item))
+    {
+        case CONFIG_TYPE_INT:
+        case CONFIG_TYPE_INT64:
+        {
+            long long config_value;
+
+            config_value = config_setting_get_int64(item);
+
+            if(config_value < 0)
+            {
+                DC_ERROR_RAISE_USER(err, "config value is out of range", ERANGE);
+
+                return false;
+            }
+
+            *value = (uint64_t)config_value;
+            break;
+        }
+        case CONFIG_TYPE_STRING:
+        {
+            if(!(dc_parse_uint64(env, err, config_setting_get_string(item), value)))
+            {
+                return false;
+            }
+
+            break;
+        }
+        default:
+        {
+            DC_ERROR_RAISE_USER(err, "config value is not an integer", EINVAL);
+
+            return false;
+        }
+    }
+
+    if(*value > max)
+    {
+        DC_ERROR_RAISE_USER(err, "config value is out of range", ERANGE);
+
+        return false;
+    }
+
+    return true;
+}
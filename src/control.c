@@ -0,0 +1,583 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "dc_application/control.h"
+#include "dc_application/local_socket.h"
+#include "dc_application/options.h"
+#include "dc_application/settings.h"
+#include <dc_c/dc_stdlib.h>
+#include <dc_c/dc_string.h>
+#include <dc_posix/dc_poll.h>
+#include <dc_posix/dc_unistd.h>
+#include <dc_posix/sys/dc_socket.h>
+#include <errno.h>
+#include <pthread.h>
+
+
+struct dc_control_server
+{
+    const struct dc_env *env;
+    struct dc_application_settings *settings;
+    int (*reload)(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings);
+    char *path;
+    int listen_fd;
+    int stop_fds[2];
+    pthread_t thread;
+};
+
+struct response
+{
+    char *data;
+    size_t length;
+    size_t capacity;
+};
+
+static void *serve(void *arg);
+static void serve_client(struct dc_control_server *server, int client_fd);
+static void handle_request(struct dc_control_server *server, struct dc_error *err, char *request, struct response *response);
+static void handle_get(struct dc_control_server *server, struct dc_error *err, const char *name, struct response *response);
+static void handle_set(struct dc_control_server *server, struct dc_error *err, char *args, struct response *response);
+static void handle_dump(struct dc_control_server *server, struct dc_error *err, struct response *response);
+static void handle_reload(struct dc_control_server *server, struct dc_error *err, struct response *response);
+static void append(const struct dc_env *env, struct dc_error *err, struct response *response, const char *data, size_t length);
+static void append_string(const struct dc_env *env, struct dc_error *err, struct response *response, const char *data);
+static void append_value(const struct dc_env *env, struct dc_error *err, struct response *response, struct dc_setting *setting);
+static bool read_fully(const struct dc_env *env, int fd, void *buffer, size_t length);
+static bool write_fully(const struct dc_env *env, int fd, const void *buffer, size_t length);
+
+
+struct dc_control_server *dc_control_server_start(const struct dc_env *env,
+                                                  struct dc_error *err,
+                                                  struct dc_application_settings *settings,
+                                                  const char *path,
+                                                  int (*reload_func)(const struct dc_env *env,
+                                                                     struct dc_error *err,
+                                                                     struct dc_application_settings *settings))
+{
+    struct dc_control_server *server;
+    int result;
+
+    DC_TRACE(env);
+    server = dc_calloc(env, err, 1, sizeof(struct dc_control_server));
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    server->env = env;
+    server->settings = settings;
+    server->reload = reload_func;
+    server->listen_fd = -1;
+    server->stop_fds[0] = -1;
+    server->stop_fds[1] = -1;
+    server->path = dc_malloc(env, err, dc_strlen(env, path) + 1);
+
+    if(dc_error_has_no_error(err))
+    {
+        dc_strcpy(env, server->path, path);
+        server->listen_fd = dc_local_socket_listen(env, err, path);
+    }
+
+    if(dc_error_has_no_error(err))
+    {
+        dc_pipe(env, err, server->stop_fds);
+    }
+
+    if(dc_error_has_no_error(err))
+    {
+        result = pthread_create(&server->thread, NULL, serve, server);
+
+        if(result != 0)
+        {
+            DC_ERROR_RAISE_ERRNO(err, result);
+        }
+    }
+
+    if(dc_error_has_error(err))
+    {
+        struct dc_error cleanup_err;
+
+        dc_error_init(&cleanup_err, NULL);
+
+        if(server->stop_fds[0] != -1)
+        {
+            dc_close(env, &cleanup_err, server->stop_fds[0]);
+            dc_close(env, &cleanup_err, server->stop_fds[1]);
+        }
+
+        if(server->listen_fd != -1)
+        {
+            dc_close(env, &cleanup_err, server->listen_fd);
+            dc_unlink(env, &cleanup_err, path);
+        }
+
+        dc_error_reset(&cleanup_err);
+        dc_free(env, server->path);
+        dc_free(env, server);
+        server = NULL;
+    }
+
+    return server;
+}
+
+void dc_control_server_stop(const struct dc_env *env, struct dc_control_server **pserver)
+{
+    struct dc_control_server *server;
+    struct dc_error err;
+    char stop;
+
+    DC_TRACE(env);
+    server = *pserver;
+    dc_error_init(&err, NULL);
+    stop = 1;
+    dc_write(env, &err, server->stop_fds[1], &stop, sizeof(stop));
+    pthread_join(server->thread, NULL);
+    dc_close(env, &err, server->stop_fds[0]);
+    dc_close(env, &err, server->stop_fds[1]);
+    dc_close(env, &err, server->listen_fd);
+    dc_unlink(env, &err, server->path);
+    dc_error_reset(&err);
+    dc_free(env, server->path);
+    dc_free(env, server);
+    *pserver = NULL;
+}
+
+static void *serve(void *arg)
+{
+    struct dc_control_server *server;
+    const struct dc_env *env;
+
+    server = arg;
+    env = server->env;
+    DC_TRACE(env);
+
+    while(true)
+    {
+        struct pollfd fds[2];
+        struct dc_error err;
+        int client_fd;
+
+        fds[0].fd = server->stop_fds[0];
+        fds[0].events = POLLIN;
+        fds[1].fd = server->listen_fd;
+        fds[1].events = POLLIN;
+        dc_error_init(&err, NULL);
+
+        if(dc_poll(env, &err, fds, 2, -1) == -1)
+        {
+            if(errno == EINTR)
+            {
+                dc_error_reset(&err);
+                continue;
+            }
+
+            dc_error_reset(&err);
+            break;
+        }
+
+        if(fds[0].revents != 0)
+        {
+            break;
+        }
+
+        client_fd = dc_accept(env, &err, server->listen_fd, NULL, NULL);
+
+        if(dc_error_has_no_error(&err))
+        {
+            // the socket permissions are not enough on their own, other users must not see or change the settings
+            if(dc_local_socket_is_peer_trusted(env, client_fd))
+            {
+                dc_local_socket_set_timeout(env, &err, client_fd, DC_CONTROL_CLIENT_TIMEOUT_MS);
+            }
+            else
+            {
+                DC_ERROR_RAISE_USER(&err, "control client is another user", EPERM);
+            }
+
+            if(dc_error_has_no_error(&err))
+            {
+                serve_client(server, client_fd);
+            }
+
+            dc_error_reset(&err);
+            dc_close(env, &err, client_fd);
+        }
+
+        dc_error_reset(&err);
+    }
+
+    return NULL;
+}
+
+static void serve_client(struct dc_control_server *server, int client_fd)
+{
+    const struct dc_env *env;
+    struct dc_error err;
+    char *request;
+
+    env = server->env;
+    dc_error_init(&err, NULL);
+    request = dc_malloc(env, &err, DC_CONTROL_MAX_FRAME + 1);
+
+    if(dc_error_has_error(&err))
+    {
+        dc_error_reset(&err);
+
+        return;
+    }
+
+    while(true)
+    {
+        struct pollfd fds[2];
+        struct response response;
+        bool sent;
+        uint32_t length;
+        int ready;
+
+        fds[0].fd = server->stop_fds[0];
+        fds[0].events = POLLIN;
+        fds[1].fd = client_fd;
+        fds[1].events = POLLIN;
+        dc_error_init(&err, NULL);
+
+        // do not hold up freeing old snapshots while waiting for the next request
+        dc_settings_offline(env);
+        ready = dc_poll(env, &err, fds, 2, (int)DC_CONTROL_CLIENT_TIMEOUT_MS);
+
+        if(dc_error_has_error(&err) && errno == EINTR)
+        {
+            dc_error_reset(&err);
+            continue;
+        }
+
+        // the server serves one client at a time, one that stays idle is dropped so the next can connect
+        if(dc_error_has_error(&err) || ready == 0 || fds[0].revents != 0)
+        {
+            dc_error_reset(&err);
+            break;
+        }
+
+        if(!(read_fully(env, client_fd, &length, sizeof(length))))
+        {
+            break;
+        }
+
+        length = ntohl(length);
+
+        if(length > DC_CONTROL_MAX_FRAME || !(read_fully(env, client_fd, request, length)))
+        {
+            break;
+        }
+
+        request[length] = '\0';
+        dc_memset(env, &response, 0, sizeof(response));
+        dc_settings_quiesce(env, &err);
+        handle_request(server, &err, request, &response);
+
+        if(dc_error_has_error(&err))
+        {
+            struct dc_error append_err;
+
+            dc_error_init(&append_err, NULL);
+            response.length = 0;
+            append_string(env, &append_err, &response, "ERR ");
+            append_string(env, &append_err, &response, err.message ? err.message : "failed");
+            dc_error_reset(&err);
+            err = append_err;
+        }
+
+        sent = false;
+
+        if(dc_error_has_no_error(&err))
+        {
+            length = htonl((uint32_t)response.length);
+            sent = write_fully(env, client_fd, &length, sizeof(length)) &&
+                   write_fully(env, client_fd, response.data, response.length);
+        }
+
+        dc_error_reset(&err);
+        dc_free(env, response.data);
+
+        if(!(sent))
+        {
+            break;
+        }
+    }
+
+    dc_free(env, request);
+}
+
+static void handle_request(struct dc_control_server *server, struct dc_error *err, char *request, struct response *response)
+{
+    const struct dc_env *env;
+    char *args;
+
+    env = server->env;
+    args = dc_strchr(env, request, ' ');
+
+    if(args)
+    {
+        *args = '\0';
+        args++;
+    }
+
+    if(dc_strcmp(env, request, "get") == 0 && args)
+    {
+        handle_get(server, err, args, response);
+    }
+    else if(dc_strcmp(env, request, "set") == 0 && args)
+    {
+        handle_set(server, err, args, response);
+    }
+    else if(dc_strcmp(env, request, "dump") == 0)
+    {
+        handle_dump(server, err, response);
+    }
+    else if(dc_strcmp(env, request, "reload") == 0)
+    {
+        handle_reload(server, err, response);
+    }
+    else
+    {
+        DC_ERROR_RAISE_USER(err, "unknown command", EINVAL);
+    }
+}
+
+static void handle_get(struct dc_control_server *server, struct dc_error *err, const char *name, struct response *response)
+{
+    const struct dc_env *env;
+    const struct dc_opt_settings *opt_settings;
+    const struct options *opt;
+
+    env = server->env;
+    opt_settings = (struct dc_opt_settings *)server->settings;
+    opt = dc_options_find(env, opt_settings, name);
+
+    if(opt == NULL)
+    {
+        DC_ERROR_RAISE_USER(err, "unknown setting", ENOENT);
+
+        return;
+    }
+
+    append_string(env, err, response, "OK ");
+    append_value(env, err, response, dc_options_get_setting(env, opt_settings, opt));
+}
+
+static void handle_set(struct dc_control_server *server, struct dc_error *err, char *args, struct response *response)
+{
+    const struct dc_env *env;
+    const struct dc_opt_settings *opt_settings;
+    const struct options *opt;
+    char *value_string;
+    const void *value;
+
+    env = server->env;
+    opt_settings = (struct dc_opt_settings *)server->settings;
+    value_string = dc_strchr(env, args, ' ');
+
+    if(value_string == NULL)
+    {
+        DC_ERROR_RAISE_USER(err, "set requires a name and a value", EINVAL);
+
+        return;
+    }
+
+    *value_string = '\0';
+    value_string++;
+    opt = dc_options_find(env, opt_settings, args);
+
+    if(opt == NULL)
+    {
+        DC_ERROR_RAISE_USER(err, "unknown setting", ENOENT);
+
+        return;
+    }
+
+    value = opt->read_from_string(env, err, value_string);
+
+    if(dc_error_has_no_error(err) && dc_options_check_range(env, err, opt_settings, opt, value))
+    {
+        dc_settings_transaction_begin(env);
+        dc_setting_update(env, err, dc_options_get_setting(env, opt_settings, opt), value, DC_SETTING_RUNTIME);
+        dc_settings_transaction_commit(env, err);
+    }
+
+    if(dc_error_has_no_error(err))
+    {
+        append_string(env, err, response, "OK");
+    }
+}
+
+static void handle_dump(struct dc_control_server *server, struct dc_error *err, struct response *response)
+{
+    const struct dc_env *env;
+    struct dc_opt_settings *opt_settings;
+
+    env = server->env;
+    opt_settings = (struct dc_opt_settings *)server->settings;
+    append_string(env, err, response, "OK\n");
+
+    for(size_t i = 0; opt_settings->opts[i].name != NULL && dc_error_has_no_error(err); i++)
+    {
+        append_string(env, err, response, opt_settings->opts[i].name);
+        append_string(env, err, response, "=");
+        append_value(env, err, response, dc_options_get_setting(env, opt_settings, &opt_settings->opts[i]));
+        append_string(env, err, response, "\n");
+    }
+}
+
+static void handle_reload(struct dc_control_server *server, struct dc_error *err, struct response *response)
+{
+    const struct dc_env *env;
+
+    env = server->env;
+
+    if(server->reload == NULL)
+    {
+        DC_ERROR_RAISE_USER(err, "reload is not supported", ENOTSUP);
+
+        return;
+    }
+
+    if(server->reload(env, err, server->settings) == 0 && dc_error_has_no_error(err))
+    {
+        append_string(env, err, response, "OK");
+    }
+}
+
+static void append(const struct dc_env *env, struct dc_error *err, struct response *response, const char *data, size_t length)
+{
+    if(dc_error_has_error(err))
+    {
+        return;
+    }
+
+    if(response->length + length > response->capacity)
+    {
+        size_t capacity;
+        char *grown;
+
+        capacity = response->capacity ? response->capacity : 256;
+
+        while(capacity < response->length + length)
+        {
+            capacity *= 2;
+        }
+
+        grown = dc_realloc(env, err, response->data, capacity);
+
+        if(dc_error_has_error(err))
+        {
+            return;
+        }
+
+        response->data = grown;
+        response->capacity = capacity;
+    }
+
+    dc_memcpy(env, &response->data[response->length], data, length);
+    response->length += length;
+}
+
+static void append_string(const struct dc_env *env, struct dc_error *err, struct response *response, const char *data)
+{
+    append(env, err, response, data, dc_strlen(env, data));
+}
+
+static void append_value(const struct dc_env *env, struct dc_error *err, struct response *response, struct dc_setting *setting)
+{
+    char buffer[256];
+    int length;
+
+    length = dc_setting_format(env, setting, buffer, sizeof(buffer));
+
+    if(length < 0)
+    {
+        DC_ERROR_RAISE_USER(err, "cannot format setting", EINVAL);
+    }
+    else if((size_t)length < sizeof(buffer))
+    {
+        append(env, err, response, buffer, (size_t)length);
+    }
+    else
+    {
+        char *large;
+
+        large = dc_malloc(env, err, (size_t)length + 1);
+
+        if(dc_error_has_no_error(err))
+        {
+            dc_setting_format(env, setting, large, (size_t)length + 1);
+            append(env, err, response, large, (size_t)length);
+            dc_free(env, large);
+        }
+    }
+}
+
+static bool read_fully(const struct dc_env *env, int fd, void *buffer, size_t length)
+{
+    size_t total;
+
+    total = 0;
+
+    while(total < length)
+    {
+        struct dc_error err;
+        ssize_t nread;
+
+        dc_error_init(&err, NULL);
+        nread = dc_read(env, &err, fd, (char *)buffer + total, length - total);
+        dc_error_reset(&err);
+
+        if(nread <= 0)
+        {
+            return false;
+        }
+
+        total += (size_t)nread;
+    }
+
+    return true;
+}
+
+static bool write_fully(const struct dc_env *env, int fd, const void *buffer, size_t length)
+{
+    size_t total;
+
+    total = 0;
+
+    while(total < length)
+    {
+        struct dc_error err;
+        ssize_t nwrote;
+
+        dc_error_init(&err, NULL);
+        nwrote = dc_write(env, &err, fd, (const char *)buffer + total, length - total);
+        dc_error_reset(&err);
+
+        if(nwrote <= 0)
+        {
+            return false;
+        }
+
+        total += (size_t)nwrote;
+    }
+
+    return true;
+}
@@ -30,13 +30,13 @@ int dc_default_set_defaults(const struct dc_env *env,
 
     for(size_t i = 0; opt_settings->opts[i].name != NULL; i++)
     {
-        struct options *opt;
+        const struct options *opt;
 
         opt = &opt_settings->opts[i];
 
         if(opt->default_value)
         {
-            opt->setting_func(env, err, opt->setting, opt->default_value, DC_SETTING_DEFAULT);
+            dc_options_apply(env, err, opt_settings, opt, opt->default_value, DC_SETTING_DEFAULT);
 
             if(dc_error_has_error(err))
             {
@@ -17,18 +17,17 @@
 
 #include "dc_application/environment.h"
 #include "dc_application/options.h"
-#include <dc_c/dc_stdlib.h>
 #include <dc_c/dc_string.h>
-#include <dc_posix/dc_string.h>
 
 
 static bool set_from_env(const struct dc_env *env,
                          struct dc_error *err,
                          struct dc_opt_settings *settings,
-                         size_t prefix_len,
                          const char *key,
+                         size_t key_length,
                          const char *value);
 
+
 int dc_default_read_env_vars(const struct dc_env *env,
                              struct dc_error *err,
                              struct dc_application_settings *settings,
@@ -47,31 +46,17 @@ int dc_default_read_env_vars(const struct dc_env *env,
     {
         if(dc_strncmp(env, *envvars, prefix, prefix_len) == 0)
         {
-            size_t length;
-            char *env_var;
+            const char *key;
+            const char *equals;
 
-            length = dc_strlen(env, *envvars) + 1;
-            env_var = dc_malloc(env, err, length * sizeof(char));
+            // the variable is looked at in place, the key ends at the first '=' and the value is everything after it
+            key = &(*envvars)[prefix_len];
+            equals = dc_strchr(env, key, '=');
 
-            if(dc_error_has_no_error(err))
+            if(equals)
             {
-                char *rest;
-                char *key;
-                char *value;
-
-                dc_strcpy(env, env_var, *envvars);
-                rest = NULL;
-
-                // TODO: what if no token found??
-                key = dc_strtok_r(env, env_var, "=", &rest);
-
-                // TODO: why am I using ?
-                // TODO: what if no token found?
-                value = dc_strtok_r(env, NULL, "=", &rest);
-
                 // TODO: what to do about an err?
-                set_from_env(env, err, opt_settings, prefix_len, key, value);
-                dc_free(env, env_var);
+                set_from_env(env, err, opt_settings, key, (size_t)(equals - key), &equals[1]);
             }
         }
 
@@ -84,34 +69,28 @@ int dc_default_read_env_vars(const struct dc_env *env,
 static bool set_from_env(const struct dc_env *env,
                          struct dc_error *err,
                          struct dc_opt_settings *settings,
-                         size_t prefix_len,
-                         const char *env_key,
+                         const char *key,
+                         size_t key_length,
                          const char *env_value)
 {
-    const char *sub_key;
-    bool found;
+    const struct options *opt;
+    const void *value;
 
     DC_TRACE(env);
-    sub_key = &env_key[prefix_len];
-    found = false;
+    opt = dc_options_find_env(env, settings, key, key_length);
 
-    for(size_t i = 0; settings->opts[i].name != NULL; i++)
+    if(opt == NULL)
     {
-        struct options *opt;
-
-        opt = &settings->opts[i];
-
-        if(dc_strcmp(env, sub_key, opt->env_key) == 0)
-        {
-            const void *value;
+        return false;
+    }
 
-            value = opt->read_from_string(env, err, env_value);
-            opt->setting_func(env, err, opt->setting, value, DC_SETTING_ENVIRONMENT);
+    value = opt->read_from_string(env, err, env_value);
 
-            // TODO: what to do about an err?
-            found = true;
-        }
+    if(dc_error_has_no_error(err))
+    {
+        dc_options_apply(env, err, settings, opt, value, DC_SETTING_ENVIRONMENT);
     }
 
-    return found;
+    // TODO: what to do about an err?
+    return true;
 }
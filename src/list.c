@@ -0,0 +1,652 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "dc_application/list.h"
+#include "dc_application/parse.h"
+#include <dc_c/dc_stdlib.h>
+#include <dc_c/dc_string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+
+
+/*
+ * For strings the value is the length, for endpoints it is the port, and for integers it is the integer. The offset
+ * is into the characters at the end of the list.
+ */
+struct list_item
+{
+    size_t offset;
+    int64_t value;
+};
+
+struct dc_list
+{
+    size_t size;
+    size_t count;
+    size_t data_offset;
+    dc_list_element element;
+    struct list_item items[];
+};
+
+
+static struct dc_list *allocate(const struct dc_env *env,
+                                struct dc_error *err,
+                                dc_list_element element,
+                                size_t count,
+                                size_t data_size);
+static char *get_data(struct dc_list *list);
+static const char *get_const_data(const struct dc_list *list);
+static bool parse_element(const struct dc_env *env,
+                          struct dc_error *err,
+                          struct dc_list *list,
+                          size_t index,
+                          size_t offset,
+                          size_t length);
+static bool parse_endpoint(const struct dc_env *env, struct dc_error *err, struct dc_list *list, size_t index, size_t offset);
+static bool is_space(char c);
+static bool validate(const struct dc_list *list, size_t size);
+static void append(const struct dc_env *env, char *buffer, size_t size, size_t *length, const char *text);
+
+
+struct dc_list *dc_list_parse(const struct dc_env *env,
+                              struct dc_error *err,
+                              dc_list_element element,
+                              const char *str,
+                              char delimiter)
+{
+    struct dc_list *list;
+    const char *c;
+    size_t count;
+    size_t data_used;
+    bool blank;
+
+    DC_TRACE(env);
+    count = 1;
+    blank = true;
+
+    // the first pass only counts so that the whole list fits in one allocation, the string itself bounds the data
+    for(c = str; *c; c++)
+    {
+        count += (*c == delimiter);
+        blank = blank && is_space(*c);
+    }
+
+    if(blank)
+    {
+        count = 0;
+    }
+
+    list = allocate(env, err, element, count, (size_t)(c - str) + 1);
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    data_used = 0;
+    c = str;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        const char *start;
+        const char *end;
+        const char *next;
+        size_t length;
+
+        for(next = c; *next && *next != delimiter; next++)
+        {
+        }
+
+        for(start = c; start < next && is_space(*start); start++)
+        {
+        }
+
+        for(end = next; end > start && is_space(end[-1]); end--)
+        {
+        }
+
+        length = (size_t)(end - start);
+
+        if(length == 0)
+        {
+            DC_ERROR_RAISE_USER(err, "empty list element", EINVAL);
+            break;
+        }
+
+        dc_memcpy(env, &get_data(list)[data_used], start, length);
+        get_data(list)[data_used + length] = '\0';
+
+        if(!(parse_element(env, err, list, i, data_used, length)))
+        {
+            break;
+        }
+
+        data_used += length + 1;
+        c = *next ? next + 1 : next;
+    }
+
+    if(dc_error_has_error(err))
+    {
+        dc_list_destroy(env, &list);
+    }
+    else
+    {
+        // whitespace and delimiters are not copied, so the end of the allocation is never looked at
+        list->size = list->data_offset + data_used;
+    }
+
+    return list;
+}
+
+struct dc_list *dc_list_from_config(const struct dc_env *env,
+                                    struct dc_error *err,
+                                    dc_list_element element,
+                                    const config_setting_t *item)
+{
+    struct dc_list *list;
+    size_t count;
+    size_t data_size;
+    size_t data_used;
+    int type;
+
+    DC_TRACE(env);
+    type = config_setting_type(item);
+
+    if(type == CONFIG_TYPE_STRING)
+    {
+        return dc_list_parse(env, err, element, config_setting_get_string(item), ',');
+    }
+
+    if(type != CONFIG_TYPE_ARRAY && type != CONFIG_TYPE_LIST)
+    {
+        DC_ERROR_RAISE_USER(err, "config value is not an array or a list", EINVAL);
+
+        return NULL;
+    }
+
+    count = (size_t)config_setting_length(item);
+    data_size = 0;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        const config_setting_t *elem;
+
+        elem = config_setting_get_elem(item, (unsigned int)i);
+
+        if(config_setting_type(elem) == CONFIG_TYPE_STRING)
+        {
+            data_size += dc_strlen(env, config_setting_get_string(elem)) + 1;
+        }
+    }
+
+    list = allocate(env, err, element, count, data_size);
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    data_used = 0;
+
+    for(size_t i = 0; i < count && dc_error_has_no_error(err); i++)
+    {
+        const config_setting_t *elem;
+
+        elem = config_setting_get_elem(item, (unsigned int)i);
+
+        switch(config_setting_type(elem))
+        {
+            case CONFIG_TYPE_STRING:
+            {
+                const char *value;
+                size_t length;
+
+                value = config_setting_get_string(elem);
+                length = dc_strlen(env, value);
+                dc_memcpy(env, &get_data(list)[data_used], value, length + 1);
+                parse_element(env, err, list, i, data_used, length);
+                data_used += length + 1;
+                break;
+            }
+            case CONFIG_TYPE_INT:
+            case CONFIG_TYPE_INT64:
+            {
+                if(element != DC_LIST_INTEGER)
+                {
+                    DC_ERROR_RAISE_USER(err, "list element must be a string", EINVAL);
+                    break;
+                }
+
+                list->items[i].offset = 0;
+                list->items[i].value = config_setting_get_int64(elem);
+                break;
+            }
+            default:
+            {
+                DC_ERROR_RAISE_USER(err, "list element is not a string or an integer", EINVAL);
+            }
+        }
+    }
+
+    if(dc_error_has_error(err))
+    {
+        dc_list_destroy(env, &list);
+    }
+
+    return list;
+}
+
+struct dc_list *dc_list_copy(const struct dc_env *env, struct dc_error *err, const struct dc_list *list)
+{
+    struct dc_list *copy;
+
+    DC_TRACE(env);
+    copy = dc_malloc(env, err, list->size);
+
+    if(dc_error_has_no_error(err))
+    {
+        dc_memcpy(env, copy, list, list->size);
+    }
+
+    return copy;
+}
+
+struct dc_list *dc_list_load(const struct dc_env *env, struct dc_error *err, const void *bytes, size_t size)
+{
+    struct dc_list *list;
+
+    DC_TRACE(env);
+
+    if(size < sizeof(struct dc_list))
+    {
+        DC_ERROR_RAISE_USER(err, "list is truncated", EINVAL);
+
+        return NULL;
+    }
+
+    // copied before it is checked, the bytes may not be aligned and may belong to someone who can still change them
+    list = dc_malloc(env, err, size);
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    dc_memcpy(env, list, bytes, size);
+
+    if(!(validate(list, size)))
+    {
+        DC_ERROR_RAISE_USER(err, "list is corrupt", EINVAL);
+        dc_list_destroy(env, &list);
+    }
+
+    return list;
+}
+
+void dc_list_destroy(const struct dc_env *env, struct dc_list **plist)
+{
+    DC_TRACE(env);
+    dc_free(env, *plist);
+    *plist = NULL;
+}
+
+size_t dc_list_get_size(const struct dc_env *env, const struct dc_list *list)
+{
+    DC_TRACE(env);
+
+    return list->size;
+}
+
+size_t dc_list_get_count(const struct dc_env *env, const struct dc_list *list)
+{
+    DC_TRACE(env);
+
+    return list->count;
+}
+
+dc_list_element dc_list_get_element(const struct dc_env *env, const struct dc_list *list)
+{
+    DC_TRACE(env);
+
+    return list->element;
+}
+
+const char *dc_list_get_string(const struct dc_env *env, const struct dc_list *list, size_t index)
+{
+    DC_TRACE(env);
+
+    return &get_const_data(list)[list->items[index].offset];
+}
+
+size_t dc_list_get_length(const struct dc_env *env, const struct dc_list *list, size_t index)
+{
+    DC_TRACE(env);
+
+    return (size_t)list->items[index].value;
+}
+
+int64_t dc_list_get_integer(const struct dc_env *env, const struct dc_list *list, size_t index)
+{
+    DC_TRACE(env);
+
+    return list->items[index].value;
+}
+
+const char *dc_list_get_host(const struct dc_env *env, const struct dc_list *list, size_t index)
+{
+    DC_TRACE(env);
+
+    return &get_const_data(list)[list->items[index].offset];
+}
+
+in_port_t dc_list_get_port(const struct dc_env *env, const struct dc_list *list, size_t index)
+{
+    DC_TRACE(env);
+
+    return (in_port_t)list->items[index].value;
+}
+
+int dc_list_format(const struct dc_env *env, const struct dc_list *list, char *buffer, size_t size)
+{
+    size_t length;
+
+    DC_TRACE(env);
+    length = 0;
+
+    if(size > 0)
+    {
+        buffer[0] = '\0';
+    }
+
+    for(size_t i = 0; i < list->count; i++)
+    {
+        const struct list_item *item;
+        char number[24];
+
+        item = &list->items[i];
+
+        if(i > 0)
+        {
+            append(env, buffer, size, &length, ",");
+        }
+
+        switch(list->element)
+        {
+            case DC_LIST_STRING:
+            {
+                append(env, buffer, size, &length, &get_const_data(list)[item->offset]);
+                break;
+            }
+            case DC_LIST_INTEGER:
+            {
+                snprintf(number, sizeof(number), "%" PRId64, item->value);
+                append(env, buffer, size, &length, number);
+                break;
+            }
+            case DC_LIST_ENDPOINT:
+            {
+                const char *host;
+                bool bracket;
+
+                host = &get_const_data(list)[item->offset];
+                bracket = dc_strchr(env, host, ':') != NULL;
+                snprintf(number, sizeof(number), "%s:%" PRId64, bracket ? "]" : "", item->value);
+
+                if(bracket)
+                {
+                    append(env, buffer, size, &length, "[");
+                }
+
+                append(env, buffer, size, &length, host);
+                append(env, buffer, size, &length, number);
+                break;
+            }
+            default:
+            {
+            }
+        }
+    }
+
+    return (int)length;
+}
+
+static struct dc_list *allocate(const struct dc_env *env,
+                                struct dc_error *err,
+                                dc_list_element element,
+                                size_t count,
+                                size_t data_size)
+{
+    struct dc_list *list;
+    size_t data_offset;
+
+    if(count > (SIZE_MAX - sizeof(struct dc_list) - data_size) / sizeof(struct list_item))
+    {
+        DC_ERROR_RAISE_USER(err, "list is too large", ERANGE);
+
+        return NULL;
+    }
+
+    data_offset = sizeof(struct dc_list) + (count * sizeof(struct list_item));
+    list = dc_malloc(env, err, data_offset + data_size);
+
+    if(dc_error_has_no_error(err))
+    {
+        list->size = data_offset + data_size;
+        list->count = count;
+        list->data_offset = data_offset;
+        list->element = element;
+    }
+
+    return list;
+}
+
+static char *get_data(struct dc_list *list)
+{
+    return (char *)list + list->data_offset;
+}
+
+static const char *get_const_data(const struct dc_list *list)
+{
+    return (const char *)list + list->data_offset;
+}
+
+// the element text is already in the list at offset, NUL terminated
+static bool parse_element(const struct dc_env *env,
+                          struct dc_error *err,
+                          struct dc_list *list,
+                          size_t index,
+                          size_t offset,
+                          size_t length)
+{
+    struct list_item *item;
+
+    item = &list->items[index];
+    item->offset = offset;
+
+    switch(list->element)
+    {
+        case DC_LIST_STRING:
+        {
+            item->value = (int64_t)length;
+            break;
+        }
+        case DC_LIST_INTEGER:
+        {
+            dc_parse_int64(env, err, &get_data(list)[offset], &item->value);
+            break;
+        }
+        case DC_LIST_ENDPOINT:
+        {
+            parse_endpoint(env, err, list, index, offset);
+            break;
+        }
+        default:
+        {
+            DC_ERROR_RAISE_USER(err, "unknown list element", EINVAL);
+        }
+    }
+
+    return dc_error_has_no_error(err);
+}
+
+// the host is terminated in place by overwriting the ']' or ':' in front of the port
+static bool parse_endpoint(const struct dc_env *env, struct dc_error *err, struct dc_list *list, size_t index, size_t offset)
+{
+    char *text;
+    char *host;
+    char *colon;
+    uint32_t port;
+
+    text = &get_data(list)[offset];
+
+    if(text[0] == '[')
+    {
+        char *close;
+
+        host = &text[1];
+        close = dc_strchr(env, host, ']');
+
+        if(close == NULL || close[1] != ':')
+        {
+            DC_ERROR_RAISE_USER(err, "endpoint must be [host]:port", EINVAL);
+
+            return false;
+        }
+
+        *close = '\0';
+        colon = &close[1];
+    }
+    else
+    {
+        host = text;
+        colon = dc_strchr(env, text, ':');
+
+        if(colon == NULL || dc_strchr(env, &colon[1], ':') != NULL)
+        {
+            DC_ERROR_RAISE_USER(err, "endpoint must be host:port or [host]:port", EINVAL);
+
+            return false;
+        }
+    }
+
+    *colon = '\0';
+
+    if(host[0] == '\0')
+    {
+        DC_ERROR_RAISE_USER(err, "endpoint has no host", EINVAL);
+
+        return false;
+    }
+
+    if(!(dc_parse_uint32(env, err, &colon[1], &port)))
+    {
+        return false;
+    }
+
+    if(port > UINT16_MAX)
+    {
+        DC_ERROR_RAISE_USER(err, "endpoint port is out of range", ERANGE);
+
+        return false;
+    }
+
+    list->items[index].offset = (size_t)(host - get_data(list));
+    list->items[index].value = port;
+
+    return true;
+}
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool validate(const struct dc_list *list, size_t size)
+{
+    const char *data;
+    size_t data_size;
+
+    if(list->size != size || list->count > (size - sizeof(struct dc_list)) / sizeof(struct list_item) ||
+       list->data_offset != sizeof(struct dc_list) + (list->count * sizeof(struct list_item)))
+    {
+        return false;
+    }
+
+    if(list->element != DC_LIST_STRING && list->element != DC_LIST_INTEGER && list->element != DC_LIST_ENDPOINT)
+    {
+        return false;
+    }
+
+    if(list->element == DC_LIST_INTEGER || list->count == 0)
+    {
+        return true;
+    }
+
+    // with a NUL at the very end every offset inside the data is a terminated string
+    data = get_const_data(list);
+    data_size = size - list->data_offset;
+
+    if(data_size == 0 || data[data_size - 1] != '\0')
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i < list->count; i++)
+    {
+        const struct list_item *item;
+
+        item = &list->items[i];
+
+        if(item->offset >= data_size)
+        {
+            return false;
+        }
+
+        if(list->element == DC_LIST_STRING &&
+           (item->value < 0 || (uint64_t)item->value >= data_size - item->offset || data[item->offset + (size_t)item->value] != '\0'))
+        {
+            return false;
+        }
+
+        if(list->element == DC_LIST_ENDPOINT && (item->value < 0 || item->value > UINT16_MAX))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// keeps counting past the end of the buffer so the caller can find out how big it needs to be
+static void append(const struct dc_env *env, char *buffer, size_t size, size_t *length, const char *text)
+{
+    size_t text_length;
+
+    text_length = dc_strlen(env, text);
+
+    if(*length + 1 < size)
+    {
+        size_t copy_length;
+
+        copy_length = text_length < size - *length - 1 ? text_length : size - *length - 1;
+        dc_memcpy(env, &buffer[*length], text, copy_length);
+        buffer[*length + copy_length] = '\0';
+    }
+
+    *length += text_length;
+}
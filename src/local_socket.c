@@ -0,0 +1,274 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "dc_application/local_socket.h"
+#include <dc_c/dc_string.h>
+#include <dc_posix/dc_unistd.h>
+#include <dc_posix/sys/dc_socket.h>
+#include <dc_posix/sys/dc_stat.h>
+#include <errno.h>
+#include <sys/un.h>
+
+
+static bool make_address(const struct dc_env *env, struct dc_error *err, const char *path, struct sockaddr_un *address);
+static void check_directory(const struct dc_env *env, struct dc_error *err, const char *path);
+static void remove_stale(const struct dc_env *env, struct dc_error *err, const char *path);
+static void close_socket(const struct dc_env *env, int fd);
+
+
+int dc_local_socket_listen(const struct dc_env *env, struct dc_error *err, const char *path)
+{
+    struct sockaddr_un address;
+    int fd;
+
+    DC_TRACE(env);
+
+    if(!(make_address(env, err, path, &address)))
+    {
+        return -1;
+    }
+
+    check_directory(env, err, path);
+
+    if(dc_error_has_no_error(err))
+    {
+        remove_stale(env, err, path);
+    }
+
+    if(dc_error_has_error(err))
+    {
+        return -1;
+    }
+
+    fd = dc_socket(env, err, AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if(dc_error_has_error(err))
+    {
+        return -1;
+    }
+
+    dc_bind(env, err, fd, (struct sockaddr *)&address, sizeof(address));
+
+    // nobody can connect until listen is called, so there is no window where the socket has the umask's permissions
+    if(dc_error_has_no_error(err))
+    {
+        dc_chmod(env, err, path, S_IRUSR | S_IWUSR);
+
+        if(dc_error_has_error(err))
+        {
+            struct dc_error unlink_err;
+
+            dc_error_init(&unlink_err, NULL);
+            dc_unlink(env, &unlink_err, path);
+            dc_error_reset(&unlink_err);
+        }
+    }
+
+    if(dc_error_has_no_error(err))
+    {
+        dc_listen(env, err, fd, SOMAXCONN);
+    }
+
+    if(dc_error_has_error(err))
+    {
+        close_socket(env, fd);
+        fd = -1;
+    }
+
+    return fd;
+}
+
+int dc_local_socket_connect(const struct dc_env *env, struct dc_error *err, const char *path)
+{
+    struct sockaddr_un address;
+    int fd;
+
+    DC_TRACE(env);
+
+    if(!(make_address(env, err, path, &address)))
+    {
+        return -1;
+    }
+
+    fd = dc_socket(env, err, AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if(dc_error_has_error(err))
+    {
+        return -1;
+    }
+
+    dc_connect(env, err, fd, (struct sockaddr *)&address, sizeof(address));
+
+    if(dc_error_has_error(err))
+    {
+        close_socket(env, fd);
+        fd = -1;
+    }
+
+    return fd;
+}
+
+#if defined(SO_PEERCRED)
+bool dc_local_socket_is_peer_trusted(const struct dc_env *env, int fd)
+{
+    struct dc_error cred_err;
+    struct ucred credentials;
+    socklen_t length;
+    bool trusted;
+
+    DC_TRACE(env);
+    dc_error_init(&cred_err, NULL);
+    length = sizeof(credentials);
+    dc_getsockopt(env, &cred_err, fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length);
+    trusted = dc_error_has_no_error(&cred_err) && length == sizeof(credentials) && credentials.uid == dc_geteuid(env);
+    dc_error_reset(&cred_err);
+
+    return trusted;
+}
+#else
+bool dc_local_socket_is_peer_trusted(const struct dc_env *env, int fd)
+{
+    uid_t uid;
+    gid_t gid;
+
+    DC_TRACE(env);
+
+    return getpeereid(fd, &uid, &gid) == 0 && uid == dc_geteuid(env);
+}
+#endif
+
+void dc_local_socket_set_timeout(const struct dc_env *env, struct dc_error *err, int fd, unsigned int timeout_ms)
+{
+    struct timeval timeout;
+
+    DC_TRACE(env);
+    timeout.tv_sec = (time_t)(timeout_ms / 1000U);
+    timeout.tv_usec = (suseconds_t)((timeout_ms % 1000U) * 1000U);
+    dc_setsockopt(env, err, fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    if(dc_error_has_no_error(err))
+    {
+        dc_setsockopt(env, err, fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    }
+}
+
+static bool make_address(const struct dc_env *env, struct dc_error *err, const char *path, struct sockaddr_un *address)
+{
+    DC_TRACE(env);
+
+    if(dc_strlen(env, path) >= sizeof(address->sun_path))
+    {
+        DC_ERROR_RAISE_USER(err, "socket path is too long", ENAMETOOLONG);
+
+        return false;
+    }
+
+    dc_memset(env, address, 0, sizeof(struct sockaddr_un));
+    address->sun_family = AF_UNIX;
+    dc_strcpy(env, address->sun_path, path);
+
+    return true;
+}
+
+// the directory decides who can connect, and who can replace the socket with something else
+static void check_directory(const struct dc_env *env, struct dc_error *err, const char *path)
+{
+    char directory[sizeof(((struct sockaddr_un *)NULL)->sun_path)];
+    struct dc_error stat_err;
+    struct stat status;
+    char *slash;
+
+    DC_TRACE(env);
+    dc_strcpy(env, directory, path);
+    slash = dc_strrchr(env, directory, '/');
+
+    if(slash == NULL)
+    {
+        dc_strcpy(env, directory, ".");
+    }
+    else if(slash == directory)
+    {
+        slash[1] = '\0';
+    }
+    else
+    {
+        *slash = '\0';
+    }
+
+    dc_error_init(&stat_err, NULL);
+    dc_lstat(env, &stat_err, directory, &status);
+
+    if(dc_error_has_error(&stat_err))
+    {
+        int error;
+
+        error = errno;
+        dc_error_reset(&stat_err);
+
+        if(error == ENOENT)
+        {
+            dc_mkdir(env, err, directory, S_IRWXU);
+        }
+        else
+        {
+            DC_ERROR_RAISE_ERRNO(err, error);
+        }
+
+        return;
+    }
+
+    if(!(S_ISDIR(status.st_mode)) || status.st_uid != dc_geteuid(env) || (status.st_mode & (S_IWGRP | S_IWOTH)) != 0)
+    {
+        DC_ERROR_RAISE_USER(err, "socket directory has to be a directory only its owner can write to", EPERM);
+    }
+}
+
+static void remove_stale(const struct dc_env *env, struct dc_error *err, const char *path)
+{
+    struct dc_error stat_err;
+    struct stat status;
+
+    DC_TRACE(env);
+    dc_error_init(&stat_err, NULL);
+    dc_lstat(env, &stat_err, path, &status);
+
+    if(dc_error_has_error(&stat_err))
+    {
+        // nothing there is the usual case, anything else is left for bind to report
+        dc_error_reset(&stat_err);
+
+        return;
+    }
+
+    if(!(S_ISSOCK(status.st_mode)))
+    {
+        DC_ERROR_RAISE_USER(err, "socket path exists and is not a socket", EEXIST);
+
+        return;
+    }
+
+    dc_unlink(env, err, path);
+}
+
+static void close_socket(const struct dc_env *env, int fd)
+{
+    struct dc_error close_err;
+
+    dc_error_init(&close_err, NULL);
+    dc_close(env, &close_err, fd);
+    dc_error_reset(&close_err);
+}
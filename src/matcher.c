@@ -0,0 +1,471 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "dc_application/matcher.h"
+#include <ctype.h>
+#include <dc_c/dc_stdlib.h>
+#include <dc_c/dc_string.h>
+#include <dc_posix/dc_regex.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+
+
+typedef enum
+{
+    MATCH_REGEX,
+    MATCH_EXACT,    // ^literal$
+    MATCH_PREFIX,   // ^literal
+    MATCH_SUFFIX,   // literal$
+    MATCH_CONTAINS, // literal
+    MATCH_CLASS,    // ^[set]+$ or ^[set]*$
+} match_form;
+
+struct dc_matcher
+{
+    struct dc_matcher *next;
+    size_t hash;
+    size_t references;
+    match_form form;
+    bool accept_empty;
+    size_t literal_length;
+    const char *literal;
+    const char *pattern;
+    regex_t regex;
+    bool table[UCHAR_MAX + 1];
+    char text[];
+};
+
+
+static void analyze(const struct dc_env *env, struct dc_matcher *matcher);
+static bool analyze_class(const struct dc_env *env, const char *pattern, bool table[UCHAR_MAX + 1], const char **end);
+static bool add_named_class(const struct dc_env *env, const char *name, size_t length, bool table[UCHAR_MAX + 1]);
+static bool is_special(const struct dc_env *env, char c);
+static size_t hash_pattern(const char *pattern);
+static bool grow_buckets(const struct dc_env *env, struct dc_error *err);
+
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables)
+static pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct dc_matcher **buckets = NULL;
+static size_t bucket_count = 0;
+static size_t matcher_count = 0;
+// NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables)
+
+
+struct dc_matcher *dc_matcher_acquire(const struct dc_env *env, struct dc_error *err, const char *pattern)
+{
+    struct dc_matcher *matcher;
+    size_t hash;
+    size_t length;
+
+    DC_TRACE(env);
+    hash = hash_pattern(pattern);
+    pthread_mutex_lock(&cache_lock);
+
+    for(matcher = bucket_count ? buckets[hash % bucket_count] : NULL; matcher; matcher = matcher->next)
+    {
+        if(matcher->hash == hash && dc_strcmp(env, matcher->pattern, pattern) == 0)
+        {
+            matcher->references++;
+            pthread_mutex_unlock(&cache_lock);
+
+            return matcher;
+        }
+    }
+
+    if(matcher_count >= bucket_count && !(grow_buckets(env, err)))
+    {
+        pthread_mutex_unlock(&cache_lock);
+
+        return NULL;
+    }
+
+    // the pattern and the literal it may reduce to share one allocation with the matcher
+    length = dc_strlen(env, pattern);
+    matcher = dc_calloc(env, err, 1, sizeof(struct dc_matcher) + (2 * (length + 1)));
+
+    if(dc_error_has_no_error(err))
+    {
+        // always compiled, an invalid pattern has to be reported the same way whatever form it looks like
+        dc_regcomp(env, err, &matcher->regex, pattern, REG_EXTENDED);
+
+        if(dc_error_has_error(err))
+        {
+            dc_free(env, matcher);
+            matcher = NULL;
+        }
+    }
+
+    if(matcher)
+    {
+        dc_memcpy(env, matcher->text, pattern, length + 1);
+        matcher->pattern = matcher->text;
+        matcher->hash = hash;
+        matcher->references = 1;
+        analyze(env, matcher);
+        matcher->next = buckets[hash % bucket_count];
+        buckets[hash % bucket_count] = matcher;
+        matcher_count++;
+    }
+
+    pthread_mutex_unlock(&cache_lock);
+
+    return matcher;
+}
+
+void dc_matcher_release(const struct dc_env *env, struct dc_matcher **pmatcher)
+{
+    struct dc_matcher *matcher;
+
+    DC_TRACE(env);
+    matcher = *pmatcher;
+    *pmatcher = NULL;
+    pthread_mutex_lock(&cache_lock);
+    matcher->references--;
+
+    if(matcher->references == 0)
+    {
+        struct dc_matcher **link;
+
+        for(link = &buckets[matcher->hash % bucket_count]; *link != matcher; link = &(*link)->next)
+        {
+        }
+
+        *link = matcher->next;
+        matcher_count--;
+        dc_regfree(env, &matcher->regex);
+        dc_free(env, matcher);
+    }
+
+    if(matcher_count == 0)
+    {
+        dc_free(env, buckets);
+        buckets = NULL;
+        bucket_count = 0;
+    }
+
+    pthread_mutex_unlock(&cache_lock);
+}
+
+bool dc_matcher_match(const struct dc_env *env, const struct dc_matcher *matcher, const char *str)
+{
+    bool match;
+
+    DC_TRACE(env);
+
+    switch(matcher->form)
+    {
+        case MATCH_EXACT:
+        {
+            match = dc_strcmp(env, str, matcher->literal) == 0;
+            break;
+        }
+        case MATCH_PREFIX:
+        {
+            match = dc_strncmp(env, str, matcher->literal, matcher->literal_length) == 0;
+            break;
+        }
+        case MATCH_SUFFIX:
+        {
+            size_t length;
+
+            length = dc_strlen(env, str);
+            match = length >= matcher->literal_length &&
+                    dc_memcmp(env, &str[length - matcher->literal_length], matcher->literal, matcher->literal_length) == 0;
+            break;
+        }
+        case MATCH_CONTAINS:
+        {
+            match = dc_strstr(env, str, matcher->literal) != NULL;
+            break;
+        }
+        case MATCH_CLASS:
+        {
+            const unsigned char *c;
+
+            for(c = (const unsigned char *)str; *c && matcher->table[*c]; c++)
+            {
+            }
+
+            match = *c == '\0' && (matcher->accept_empty || str[0] != '\0');
+            break;
+        }
+        case MATCH_REGEX:
+        default:
+        {
+            match = dc_regexec(env, &matcher->regex, str, 0, NULL, 0) == 0;
+        }
+    }
+
+    return match;
+}
+
+const char *dc_matcher_get_pattern(const struct dc_env *env, const struct dc_matcher *matcher)
+{
+    DC_TRACE(env);
+
+    return matcher->pattern;
+}
+
+/*
+ * Only forms whose meaning does not depend on the locale are specialized. Anything with a byte outside of ASCII, a
+ * collating element, an equivalence class, or any operator other than the anchors stays with regexec.
+ */
+static void analyze(const struct dc_env *env, struct dc_matcher *matcher)
+{
+    const char *pattern;
+    char *literal;
+    size_t length;
+    bool anchored_start;
+    bool anchored_end;
+
+    pattern = matcher->pattern;
+    anchored_start = *pattern == '^';
+    pattern += anchored_start;
+    matcher->form = MATCH_REGEX;
+
+    if(anchored_start && *pattern == '[')
+    {
+        const char *end;
+
+        if(analyze_class(env, pattern, matcher->table, &end) && (*end == '+' || *end == '*') && dc_strcmp(env, &end[1], "$") == 0)
+        {
+            matcher->form = MATCH_CLASS;
+            matcher->accept_empty = *end == '*';
+        }
+
+        return;
+    }
+
+    literal = &matcher->text[dc_strlen(env, matcher->pattern) + 1];
+    length = 0;
+    anchored_end = false;
+
+    while(*pattern)
+    {
+        if((unsigned char)*pattern > SCHAR_MAX)
+        {
+            return;
+        }
+
+        if(*pattern == '\\' && is_special(env, pattern[1]))
+        {
+            literal[length++] = pattern[1];
+            pattern += 2;
+        }
+        else if(*pattern == '$' && pattern[1] == '\0')
+        {
+            anchored_end = true;
+            pattern++;
+        }
+        else if(is_special(env, *pattern))
+        {
+            return;
+        }
+        else
+        {
+            literal[length++] = *pattern;
+            pattern++;
+        }
+    }
+
+    literal[length] = '\0';
+    matcher->literal = literal;
+    matcher->literal_length = length;
+
+    if(anchored_start)
+    {
+        matcher->form = anchored_end ? MATCH_EXACT : MATCH_PREFIX;
+    }
+    else
+    {
+        matcher->form = anchored_end ? MATCH_SUFFIX : MATCH_CONTAINS;
+    }
+}
+
+static bool analyze_class(const struct dc_env *env, const char *pattern, bool table[UCHAR_MAX + 1], const char **end)
+{
+    size_t i;
+    bool negate;
+
+    i = 1;
+    negate = pattern[i] == '^';
+    i += negate;
+
+    // a ']' right after the '[' or '[^' is a member, not the end
+    for(bool first = true; first || pattern[i] != ']'; first = false)
+    {
+        unsigned char low;
+        unsigned char high;
+
+        if(pattern[i] == '\0' || (unsigned char)pattern[i] > SCHAR_MAX)
+        {
+            return false;
+        }
+
+        if(pattern[i] == '[' && pattern[i + 1] == ':')
+        {
+            size_t start;
+
+            start = i + 2;
+
+            for(i = start; pattern[i] && !(pattern[i] == ':' && pattern[i + 1] == ']'); i++)
+            {
+            }
+
+            if(pattern[i] == '\0' || !(add_named_class(env, &pattern[start], i - start, table)))
+            {
+                return false;
+            }
+
+            i += 2;
+            continue;
+        }
+
+        if(pattern[i] == '[' && (pattern[i + 1] == '.' || pattern[i + 1] == '='))
+        {
+            return false;
+        }
+
+        low = (unsigned char)pattern[i];
+        high = low;
+
+        if(pattern[i + 1] == '-' && pattern[i + 2] != ']' && pattern[i + 2] != '\0')
+        {
+            high = (unsigned char)pattern[i + 2];
+
+            if(high > SCHAR_MAX || high == '[' || high < low)
+            {
+                return false;
+            }
+
+            i += 2;
+        }
+
+        for(unsigned int c = low; c <= high; c++)
+        {
+            table[c] = true;
+        }
+
+        i++;
+    }
+
+    if(negate)
+    {
+        for(size_t c = 0; c <= UCHAR_MAX; c++)
+        {
+            table[c] = !(table[c]);
+        }
+    }
+
+    table[0] = false;
+    *end = &pattern[i + 1];
+
+    return true;
+}
+
+static bool add_named_class(const struct dc_env *env, const char *name, size_t length, bool table[UCHAR_MAX + 1])
+{
+    static const struct
+    {
+        const char *name;
+        int (*test)(int c);
+    } classes[] =
+    {
+        {"alnum", isalnum},
+        {"alpha", isalpha},
+        {"blank", isblank},
+        {"digit", isdigit},
+        {"lower", islower},
+        {"space", isspace},
+        {"upper", isupper},
+        {"xdigit", isxdigit},
+        {NULL, NULL},
+    };
+
+    for(size_t i = 0; classes[i].name; i++)
+    {
+        // only ASCII is filled in, what the other bytes mean depends on the locale
+        if(dc_strlen(env, classes[i].name) == length && dc_strncmp(env, classes[i].name, name, length) == 0)
+        {
+            for(int c = 0; c <= SCHAR_MAX; c++)
+            {
+                table[c] = table[c] || classes[i].test(c);
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool is_special(const struct dc_env *env, char c)
+{
+    return c != '\0' && dc_strchr(env, ".[]()*+?{}|^$\\", c) != NULL;
+}
+
+// FNV-1a
+static size_t hash_pattern(const char *pattern)
+{
+    uint64_t hash;
+
+    hash = UINT64_C(14695981039346656037);
+
+    for(const unsigned char *c = (const unsigned char *)pattern; *c; c++)
+    {
+        hash ^= *c;
+        hash *= UINT64_C(1099511628211);
+    }
+
+    return (size_t)hash;
+}
+
+// called with cache_lock held
+static bool grow_buckets(const struct dc_env *env, struct dc_error *err)
+{
+    struct dc_matcher **grown;
+    size_t count;
+
+    count = bucket_count ? bucket_count * 2 : 16;
+    grown = dc_calloc(env, err, count, sizeof(struct dc_matcher *));
+
+    if(dc_error_has_error(err))
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i < bucket_count; i++)
+    {
+        struct dc_matcher *matcher;
+        struct dc_matcher *next;
+
+        for(matcher = buckets[i]; matcher; matcher = next)
+        {
+            next = matcher->next;
+            matcher->next = grown[matcher->hash % count];
+            grown[matcher->hash % count] = matcher;
+        }
+    }
+
+    dc_free(env, buckets);
+    buckets = grown;
+    bucket_count = count;
+
+    return true;
+}
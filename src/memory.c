@@ -0,0 +1,321 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "dc_application/memory.h"
+#include <dc_c/dc_stdlib.h>
+#include <dc_c/dc_string.h>
+#include <dc_posix/sys/dc_mman.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdalign.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+
+#ifdef __linux__
+// from linux/mempolicy.h, which is not always installed
+#define MPOL_BIND 2
+#endif
+#define BITS_PER_LONG (sizeof(unsigned long) * CHAR_BIT)
+
+
+struct dc_memory_region
+{
+    char *address;
+    size_t length;
+    size_t used;
+    bool hugetlb;
+    pthread_mutex_t mutex;
+};
+
+// the free objects are a list threaded through the objects themselves
+struct dc_memory_pool
+{
+    void *free_list;
+    pthread_mutex_t mutex;
+};
+
+
+static void *map_region(const struct dc_env *env, struct dc_error *err, size_t length, bool *hugetlb);
+
+
+struct dc_memory_region *dc_memory_region_create(const struct dc_env *env, struct dc_error *err, size_t length)
+{
+    struct dc_memory_region *region;
+
+    DC_TRACE(env);
+
+    if(length == 0 || length > SIZE_MAX - DC_MEMORY_HUGE_PAGE_SIZE)
+    {
+        DC_ERROR_RAISE_USER(err, "memory region size is out of range", EINVAL);
+
+        return NULL;
+    }
+
+    region = dc_calloc(env, err, 1, sizeof(struct dc_memory_region));
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    region->length = (length + DC_MEMORY_HUGE_PAGE_SIZE - 1) / DC_MEMORY_HUGE_PAGE_SIZE * DC_MEMORY_HUGE_PAGE_SIZE;
+    region->address = map_region(env, err, region->length, &region->hugetlb);
+
+    if(dc_error_has_error(err))
+    {
+        dc_free(env, region);
+
+        return NULL;
+    }
+
+    pthread_mutex_init(&region->mutex, NULL);
+
+    return region;
+}
+
+void dc_memory_region_destroy(const struct dc_env *env, struct dc_memory_region **pregion)
+{
+    struct dc_memory_region *region;
+    struct dc_error unmap_err;
+
+    DC_TRACE(env);
+    region = *pregion;
+    dc_error_init(&unmap_err, NULL);
+    dc_munmap(env, &unmap_err, region->address, region->length);
+    dc_error_reset(&unmap_err);
+    pthread_mutex_destroy(&region->mutex);
+    dc_free(env, region);
+    *pregion = NULL;
+}
+
+#ifdef __linux__
+void dc_memory_region_bind(const struct dc_env *env, struct dc_error *err, struct dc_memory_region *region, unsigned int node)
+{
+    unsigned long nodes[DC_MEMORY_MAX_NODES / BITS_PER_LONG];
+
+    DC_TRACE(env);
+
+    if(node >= DC_MEMORY_MAX_NODES)
+    {
+        DC_ERROR_RAISE_USER(err, "NUMA node is out of range", EINVAL);
+
+        return;
+    }
+
+    dc_memset(env, nodes, 0, sizeof(nodes));
+    nodes[node / BITS_PER_LONG] = 1UL << (node % BITS_PER_LONG);
+
+    // glibc has no wrapper for mbind, libnuma does but it is not worth the dependency for one call
+    if(syscall(SYS_mbind, region->address, region->length, MPOL_BIND, nodes, DC_MEMORY_MAX_NODES + 1, 0) != 0)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+    }
+}
+#else
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+void dc_memory_region_bind(const struct dc_env *env, struct dc_error *err, struct dc_memory_region *region, unsigned int node)
+{
+    DC_TRACE(env);
+    DC_ERROR_RAISE_USER(err, "NUMA binding is not supported", ENOTSUP);
+}
+#pragma GCC diagnostic pop
+#endif
+
+void *dc_memory_region_get_address(const struct dc_env *env, const struct dc_memory_region *region)
+{
+    DC_TRACE(env);
+
+    return region->address;
+}
+
+size_t dc_memory_region_get_length(const struct dc_env *env, const struct dc_memory_region *region)
+{
+    DC_TRACE(env);
+
+    return region->length;
+}
+
+bool dc_memory_region_is_hugetlb(const struct dc_env *env, const struct dc_memory_region *region)
+{
+    DC_TRACE(env);
+
+    return region->hugetlb;
+}
+
+struct dc_memory_pool *dc_memory_pool_create(const struct dc_env *env,
+                                             struct dc_error *err,
+                                             struct dc_memory_region *region,
+                                             size_t object_size,
+                                             size_t count)
+{
+    struct dc_memory_pool *pool;
+    char *objects;
+    size_t size;
+
+    DC_TRACE(env);
+
+    // an object has to be able to hold the free list link while it is free
+    size = object_size < sizeof(void *) ? sizeof(void *) : object_size;
+    size = (size + alignof(max_align_t) - 1) / alignof(max_align_t) * alignof(max_align_t);
+    pool = dc_calloc(env, err, 1, sizeof(struct dc_memory_pool));
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    objects = NULL;
+    pthread_mutex_lock(&region->mutex);
+
+    if(count > 0 && size <= (region->length - region->used) / count)
+    {
+        objects = &region->address[region->used];
+        region->used += size * count;
+    }
+
+    pthread_mutex_unlock(&region->mutex);
+
+    if(objects == NULL)
+    {
+        DC_ERROR_RAISE_USER(err, "memory region is too small for the pool", ENOMEM);
+        dc_free(env, pool);
+
+        return NULL;
+    }
+
+    // link them in address order so the first objects handed out are next to each other
+    for(size_t i = count; i > 0; i--)
+    {
+        void *object;
+
+        object = &objects[(i - 1) * size];
+        *(void **)object = pool->free_list;
+        pool->free_list = object;
+    }
+
+    pthread_mutex_init(&pool->mutex, NULL);
+
+    return pool;
+}
+
+void dc_memory_pool_destroy(const struct dc_env *env, struct dc_memory_pool **ppool)
+{
+    DC_TRACE(env);
+    pthread_mutex_destroy(&(*ppool)->mutex);
+    dc_free(env, *ppool);
+    *ppool = NULL;
+}
+
+void *dc_memory_pool_get(const struct dc_env *env, struct dc_error *err, struct dc_memory_pool *pool)
+{
+    void *object;
+
+    DC_TRACE(env);
+    pthread_mutex_lock(&pool->mutex);
+    object = pool->free_list;
+
+    if(object)
+    {
+        pool->free_list = *(void **)object;
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+
+    if(object == NULL)
+    {
+        DC_ERROR_RAISE_USER(err, "memory pool is empty", ENOMEM);
+    }
+
+    return object;
+}
+
+void dc_memory_pool_put(const struct dc_env *env, struct dc_memory_pool *pool, void *object)
+{
+    DC_TRACE(env);
+    pthread_mutex_lock(&pool->mutex);
+    *(void **)object = pool->free_list;
+    pool->free_list = object;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+static void *map_region(const struct dc_env *env, struct dc_error *err, size_t length, bool *hugetlb)
+{
+    void *address;
+
+    DC_TRACE(env);
+
+#ifdef MAP_HUGETLB
+    {
+        struct dc_error huge_err;
+
+        // there are often no huge pages reserved, which is not an error, the transparent ones are the fallback
+        dc_error_init(&huge_err, NULL);
+        address = dc_mmap(env, &huge_err, NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if(dc_error_has_no_error(&huge_err))
+        {
+            *hugetlb = true;
+
+            return address;
+        }
+
+        dc_error_reset(&huge_err);
+    }
+#endif
+
+    // transparent huge pages only back the parts that are aligned to a huge page, so map one more and trim the ends
+    *hugetlb = false;
+    address = dc_mmap(env, err, NULL, length + DC_MEMORY_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if(dc_error_has_no_error(err))
+    {
+        uintptr_t start;
+        size_t head;
+
+        start = (uintptr_t)address;
+        head = (DC_MEMORY_HUGE_PAGE_SIZE - start % DC_MEMORY_HUGE_PAGE_SIZE) % DC_MEMORY_HUGE_PAGE_SIZE;
+
+        if(head > 0)
+        {
+            dc_munmap(env, err, address, head);
+        }
+
+        if(dc_error_has_no_error(err) && head < DC_MEMORY_HUGE_PAGE_SIZE)
+        {
+            dc_munmap(env, err, (char *)address + head + length, DC_MEMORY_HUGE_PAGE_SIZE - head);
+        }
+
+        address = (char *)address + head;
+    }
+
+#ifdef MADV_HUGEPAGE
+    // only a hint, a kernel with transparent huge pages off still gives a working region
+    if(dc_error_has_no_error(err))
+    {
+        madvise(address, length, MADV_HUGEPAGE);    // NOLINT(cert-err33-c)
+    }
+#endif
+
+    return address;
+}
@@ -0,0 +1,308 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "dc_application/notify.h"
+#include "dc_application/parse.h"
+#include <dc_c/dc_stdlib.h>
+#include <dc_c/dc_string.h>
+#include <dc_posix/dc_poll.h>
+#include <dc_posix/dc_time.h>
+#include <dc_posix/dc_unistd.h>
+#include <dc_posix/sys/dc_socket.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <sys/un.h>
+
+
+struct dc_notifier
+{
+    const struct dc_env *env;
+    int fd;
+    struct sockaddr_un address;
+    socklen_t address_length;
+    uint64_t watchdog_usec;
+    bool watchdog_running;
+    int stop_fds[2];
+    pthread_t thread;
+};
+
+
+static void *watchdog(void *arg);
+
+
+struct dc_notifier *dc_notifier_create(const struct dc_env *env, struct dc_error *err)
+{
+    struct dc_notifier *notifier;
+    const char *path;
+    const char *value;
+    size_t length;
+
+    DC_TRACE(env);
+    path = dc_getenv(env, DC_NOTIFY_SOCKET_ENV_VAR);
+
+    if(path == NULL || path[0] == '\0')
+    {
+        return NULL;
+    }
+
+    notifier = dc_calloc(env, err, 1, sizeof(struct dc_notifier));
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    notifier->env = env;
+    notifier->fd = -1;
+    length = dc_strlen(env, path);
+
+    if(length >= sizeof(notifier->address.sun_path) || (path[0] != '/' && path[0] != '@'))
+    {
+        DC_ERROR_RAISE_USER(err, "bad " DC_NOTIFY_SOCKET_ENV_VAR, EINVAL);
+    }
+    else
+    {
+        notifier->address.sun_family = AF_UNIX;
+        dc_memcpy(env, notifier->address.sun_path, path, length);
+        notifier->address_length = (socklen_t)(offsetof(struct sockaddr_un, sun_path) + length);
+
+        // an abstract socket name starts with a NUL and is not NUL terminated
+        if(path[0] == '@')
+        {
+            notifier->address.sun_path[0] = '\0';
+        }
+        else
+        {
+            notifier->address_length++;
+        }
+
+        notifier->fd = dc_socket(env, err, AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    }
+
+    // the watchdog is for the process the service manager started, not for any it forks
+    value = dc_getenv(env, DC_NOTIFY_WATCHDOG_PID_ENV_VAR);
+
+    if(dc_error_has_no_error(err) && value)
+    {
+        struct dc_error parse_err;
+        uint64_t pid;
+
+        dc_error_init(&parse_err, NULL);
+
+        if(!(dc_parse_uint64(env, &parse_err, value, &pid)) || pid != (uint64_t)dc_getpid(env))
+        {
+            value = NULL;
+        }
+        else
+        {
+            value = dc_getenv(env, DC_NOTIFY_WATCHDOG_USEC_ENV_VAR);
+        }
+
+        dc_error_reset(&parse_err);
+    }
+    else if(dc_error_has_no_error(err))
+    {
+        value = dc_getenv(env, DC_NOTIFY_WATCHDOG_USEC_ENV_VAR);
+    }
+
+    if(dc_error_has_no_error(err) && value)
+    {
+        struct dc_error parse_err;
+
+        dc_error_init(&parse_err, NULL);
+
+        if(!(dc_parse_uint64(env, &parse_err, value, &notifier->watchdog_usec)))
+        {
+            notifier->watchdog_usec = 0;
+        }
+
+        dc_error_reset(&parse_err);
+    }
+
+    if(dc_error_has_error(err))
+    {
+        dc_free(env, notifier);
+        notifier = NULL;
+    }
+
+    return notifier;
+}
+
+void dc_notifier_destroy(const struct dc_env *env, struct dc_notifier **pnotifier)
+{
+    struct dc_notifier *notifier;
+    struct dc_error err;
+
+    DC_TRACE(env);
+    notifier = *pnotifier;
+    dc_notifier_stop_watchdog(env, notifier);
+    dc_error_init(&err, NULL);
+    dc_close(env, &err, notifier->fd);
+    dc_error_reset(&err);
+    dc_free(env, notifier);
+    *pnotifier = NULL;
+}
+
+void dc_notifier_destroy_after_fork(const struct dc_env *env, struct dc_notifier **pnotifier)
+{
+    struct dc_notifier *notifier;
+    struct dc_error err;
+
+    DC_TRACE(env);
+    notifier = *pnotifier;
+    dc_error_init(&err, NULL);
+
+    if(notifier->watchdog_running)
+    {
+        dc_close(env, &err, notifier->stop_fds[0]);
+        dc_close(env, &err, notifier->stop_fds[1]);
+    }
+
+    dc_close(env, &err, notifier->fd);
+    dc_error_reset(&err);
+    dc_free(env, notifier);
+    *pnotifier = NULL;
+}
+
+void dc_notifier_send(const struct dc_env *env, struct dc_error *err, struct dc_notifier *notifier, const char *message)
+{
+    DC_TRACE(env);
+    dc_sendto(env, err, notifier->fd, message, dc_strlen(env, message), MSG_NOSIGNAL,
+              (const struct sockaddr *)&notifier->address, notifier->address_length);
+}
+
+void dc_notifier_start_watchdog(const struct dc_env *env, struct dc_error *err, struct dc_notifier *notifier)
+{
+    int result;
+
+    DC_TRACE(env);
+
+    if(notifier->watchdog_usec == 0 || notifier->watchdog_running)
+    {
+        return;
+    }
+
+    dc_pipe(env, err, notifier->stop_fds);
+
+    if(dc_error_has_error(err))
+    {
+        return;
+    }
+
+    result = pthread_create(&notifier->thread, NULL, watchdog, notifier);
+
+    if(result != 0)
+    {
+        struct dc_error cleanup_err;
+
+        DC_ERROR_RAISE_ERRNO(err, result);
+        dc_error_init(&cleanup_err, NULL);
+        dc_close(env, &cleanup_err, notifier->stop_fds[0]);
+        dc_close(env, &cleanup_err, notifier->stop_fds[1]);
+        dc_error_reset(&cleanup_err);
+
+        return;
+    }
+
+    notifier->watchdog_running = true;
+}
+
+void dc_notifier_stop_watchdog(const struct dc_env *env, struct dc_notifier *notifier)
+{
+    struct dc_error err;
+    char stop;
+
+    DC_TRACE(env);
+
+    if(!(notifier->watchdog_running))
+    {
+        return;
+    }
+
+    dc_error_init(&err, NULL);
+    stop = 1;
+    dc_write(env, &err, notifier->stop_fds[1], &stop, sizeof(stop));
+    pthread_join(notifier->thread, NULL);
+    dc_close(env, &err, notifier->stop_fds[0]);
+    dc_close(env, &err, notifier->stop_fds[1]);
+    dc_error_reset(&err);
+    notifier->watchdog_running = false;
+}
+
+uint64_t dc_notifier_now(const struct dc_env *env)
+{
+    struct dc_error err;
+    struct timespec now;
+
+    DC_TRACE(env);
+    dc_error_init(&err, NULL);
+    now.tv_sec = 0;
+    now.tv_nsec = 0;
+    dc_clock_gettime(env, &err, CLOCK_MONOTONIC, &now);
+    dc_error_reset(&err);
+
+    return (uint64_t)now.tv_sec * 1000000U + (uint64_t)now.tv_nsec / 1000U;
+}
+
+static void *watchdog(void *arg)
+{
+    struct dc_notifier *notifier;
+    const struct dc_env *env;
+    int interval_ms;
+
+    notifier = arg;
+    env = notifier->env;
+    DC_TRACE(env);
+
+    // half the interval leaves room for a late wakeup, as sd_watchdog_enabled recommends
+    interval_ms = notifier->watchdog_usec / 2000U > INT32_MAX ? INT32_MAX : (int)(notifier->watchdog_usec / 2000U);
+
+    if(interval_ms == 0)
+    {
+        interval_ms = 1;
+    }
+
+    while(true)
+    {
+        struct pollfd fds[1];
+        struct dc_error err;
+        int result;
+
+        fds[0].fd = notifier->stop_fds[0];
+        fds[0].events = POLLIN;
+        dc_error_init(&err, NULL);
+        result = dc_poll(env, &err, fds, 1, interval_ms);
+
+        if(result == -1 && errno == EINTR)
+        {
+            dc_error_reset(&err);
+            continue;
+        }
+
+        if(result != 0)
+        {
+            dc_error_reset(&err);
+            break;
+        }
+
+        dc_notifier_send(env, &err, notifier, "WATCHDOG=1");
+        dc_error_reset(&err);
+    }
+
+    return NULL;
+}
@@ -16,8 +16,126 @@
 
 
 #include "dc_application/options.h"
+#include "dc_application/parse.h"
 #include <dc_c/dc_stdlib.h>
+#include <dc_c/dc_string.h>
 #include <dc_util/types.h>
+#include <errno.h>
+
+
+typedef enum
+{
+    KEY_NAME,
+    KEY_ENV,
+    KEY_CONFIG,
+} key_field;
+
+
+static const struct options *find_indexed(const struct dc_env *env,
+                                          const struct dc_opt_settings *opt_settings,
+                                          const struct dc_options_index *index,
+                                          key_field field,
+                                          const char *key,
+                                          size_t length);
+static const char *option_key(const struct options *opt, key_field field);
+static int compare_values(dc_setting_kind kind, const void *a, const void *b);
+static int compare_signed(int64_t a, int64_t b);
+static int compare_unsigned(uint64_t a, uint64_t b);
+
+
+const struct options *dc_options_find(const struct dc_env *env, const struct dc_opt_settings *opt_settings, const char *name)
+{
+    DC_TRACE(env);
+
+    return find_indexed(env, opt_settings, opt_settings->name_index, KEY_NAME, name, dc_strlen(env, name));
+}
+
+const struct options *dc_options_find_name(const struct dc_env *env, const struct dc_opt_settings *opt_settings, const char *name, size_t length)
+{
+    DC_TRACE(env);
+
+    return find_indexed(env, opt_settings, opt_settings->name_index, KEY_NAME, name, length);
+}
+
+const struct options *dc_options_find_env(const struct dc_env *env, const struct dc_opt_settings *opt_settings, const char *key, size_t length)
+{
+    DC_TRACE(env);
+
+    return find_indexed(env, opt_settings, opt_settings->env_index, KEY_ENV, key, length);
+}
+
+const struct options *dc_options_find_config(const struct dc_env *env, const struct dc_opt_settings *opt_settings, const char *key, size_t length)
+{
+    DC_TRACE(env);
+
+    return find_indexed(env, opt_settings, opt_settings->config_index, KEY_CONFIG, key, length);
+}
+
+struct dc_setting *dc_options_get_setting(const struct dc_env *env, const struct dc_opt_settings *opt_settings, const struct options *opt)
+{
+    struct dc_setting *setting;
+
+    DC_TRACE(env);
+
+    if(opt->setting)
+    {
+        return opt->setting;
+    }
+
+    // the member is a pointer to one of the setting types, copied rather than read through a different pointer type
+    dc_memcpy(env, &setting, (const char *)opt_settings + opt->setting_offset, sizeof(setting));
+
+    return setting;
+}
+
+bool dc_options_check_range(const struct dc_env *env,
+                            struct dc_error *err,
+                            const struct dc_opt_settings *opt_settings,
+                            const struct options *opt,
+                            const void *value)
+{
+    dc_setting_kind kind;
+
+    DC_TRACE(env);
+
+    if(value == NULL)
+    {
+        return true;
+    }
+
+    kind = dc_setting_get_kind(env, dc_options_get_setting(env, opt_settings, opt));
+
+    if(opt->min_value && compare_values(kind, value, opt->min_value) < 0)
+    {
+        DC_ERROR_RAISE_USER(err, "value is less than the minimum for the setting", ERANGE);
+
+        return false;
+    }
+
+    if(opt->max_value && compare_values(kind, value, opt->max_value) > 0)
+    {
+        DC_ERROR_RAISE_USER(err, "value is greater than the maximum for the setting", ERANGE);
+
+        return false;
+    }
+
+    return true;
+}
+
+void dc_options_apply(const struct dc_env *env,
+                      struct dc_error *err,
+                      const struct dc_opt_settings *opt_settings,
+                      const struct options *opt,
+                      const void *value,
+                      dc_setting_type type)
+{
+    DC_TRACE(env);
+
+    if(dc_options_check_range(env, err, opt_settings, opt, value))
+    {
+        opt->setting_func(env, err, dc_options_get_setting(env, opt_settings, opt), value, type);
+    }
+}
 
 
 void dc_options_set_string(const struct dc_env *env,
@@ -48,6 +166,24 @@ void dc_options_set_path(const struct dc_env *env,
 {
     dc_setting_path_set(env, err, (struct dc_setting_path *)setting, (const char *)value, type);
 }
+
+void dc_options_set_fd(const struct dc_env *env,
+                       struct dc_error *err,
+                       struct dc_setting *setting,
+                       const void *value,
+                       dc_setting_type type)
+{
+    dc_setting_fd_set(env, err, (struct dc_setting_fd *)setting, (const char *)value, type);
+}
+
+void dc_options_set_dirfd(const struct dc_env *env,
+                          struct dc_error *err,
+                          struct dc_setting *setting,
+                          const void *value,
+                          dc_setting_type type)
+{
+    dc_setting_dirfd_set(env, err, (struct dc_setting_dirfd *)setting, (const char *)value, type);
+}
 #pragma GCC diagnostic pop
 
 #pragma GCC diagnostic push
@@ -95,6 +231,153 @@ void dc_options_set_in_port_t(const struct dc_env *env,
 }
 #pragma GCC diagnostic pop
 
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+void dc_options_set_int32(const struct dc_env *env,
+                          struct dc_error *err,
+                          struct dc_setting *setting,
+                          const void *value,
+                          dc_setting_type type)
+{
+    const int32_t *pint32;
+
+    pint32 = value;
+    dc_setting_int32_set(env, (struct dc_setting_int32 *)setting, *pint32, type);
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+void dc_options_set_int64(const struct dc_env *env,
+                          struct dc_error *err,
+                          struct dc_setting *setting,
+                          const void *value,
+                          dc_setting_type type)
+{
+    const int64_t *pint64;
+
+    pint64 = value;
+    dc_setting_int64_set(env, (struct dc_setting_int64 *)setting, *pint64, type);
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+void dc_options_set_uint32(const struct dc_env *env,
+                           struct dc_error *err,
+                           struct dc_setting *setting,
+                           const void *value,
+                           dc_setting_type type)
+{
+    const uint32_t *puint32;
+
+    puint32 = value;
+    dc_setting_uint32_set(env, (struct dc_setting_uint32 *)setting, *puint32, type);
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+void dc_options_set_uint64(const struct dc_env *env,
+                           struct dc_error *err,
+                           struct dc_setting *setting,
+                           const void *value,
+                           dc_setting_type type)
+{
+    const uint64_t *puint64;
+
+    puint64 = value;
+    dc_setting_uint64_set(env, (struct dc_setting_uint64 *)setting, *puint64, type);
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+void dc_options_set_size_t(const struct dc_env *env,
+                           struct dc_error *err,
+                           struct dc_setting *setting,
+                           const void *value,
+                           dc_setting_type type)
+{
+    const size_t *psize_t;
+
+    psize_t = value;
+    dc_setting_size_t_set(env, (struct dc_setting_size_t *)setting, *psize_t, type);
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+void dc_options_set_double(const struct dc_env *env,
+                           struct dc_error *err,
+                           struct dc_setting *setting,
+                           const void *value,
+                           dc_setting_type type)
+{
+    const double *pdouble;
+
+    pdouble = value;
+    dc_setting_double_set(env, (struct dc_setting_double *)setting, *pdouble, type);
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+void dc_options_set_bytes(const struct dc_env *env,
+                          struct dc_error *err,
+                          struct dc_setting *setting,
+                          const void *value,
+                          dc_setting_type type)
+{
+    const uint64_t *pbytes;
+
+    pbytes = value;
+    dc_setting_bytes_set(env, (struct dc_setting_bytes *)setting, *pbytes, type);
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+void dc_options_set_duration(const struct dc_env *env,
+                             struct dc_error *err,
+                             struct dc_setting *setting,
+                             const void *value,
+                             dc_setting_type type)
+{
+    const uint64_t *pduration;
+
+    pduration = value;
+    dc_setting_duration_set(env, (struct dc_setting_duration *)setting, *pduration, type);
+}
+#pragma GCC diagnostic pop
+
+void dc_options_set_list(const struct dc_env *env,
+                         struct dc_error *err,
+                         struct dc_setting *setting,
+                         const void *value,
+                         dc_setting_type type)
+{
+    dc_setting_list_set(env, err, (struct dc_setting_list *)setting, (const struct dc_list *)value, type);
+}
+
+void dc_options_set_cpuset(const struct dc_env *env,
+                           struct dc_error *err,
+                           struct dc_setting *setting,
+                           const void *value,
+                           dc_setting_type type)
+{
+    dc_setting_cpuset_set(env, err, (struct dc_setting_cpuset *)setting, (const char *)value, type);
+}
+
+void dc_options_set_numa_policy(const struct dc_env *env,
+                                struct dc_error *err,
+                                struct dc_setting *setting,
+                                const void *value,
+                                dc_setting_type type)
+{
+    dc_setting_numa_policy_set(env, err, (struct dc_setting_numa_policy *)setting, (const char *)value, type);
+}
+
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 const void *
@@ -120,44 +403,351 @@ const void *dc_flag_from_string(const struct dc_env *env,
 }
 #pragma GCC diagnostic pop
 
+// the converted value is only good until the next conversion on the same thread, callers use it right away
 const void *dc_uint16_from_string(const struct dc_env *env, struct dc_error *err, const char *str)
 {
-    uint16_t *value;
+    static _Thread_local uint16_t value;
 
     DC_TRACE(env);
-    value = dc_malloc(env, err, sizeof(uint16_t));
+    value = dc_uint16_from_str(env, err, str, 10);
 
-    if(dc_error_has_no_error(err))
+    if(dc_error_has_error(err))
     {
-        *value = dc_uint16_from_str(env, err, str, 10);
+        return NULL;
+    }
 
-        if(dc_error_has_error(err))
-        {
-            dc_free(env, value);
-            value = NULL;
-        }
+    return &value;
+}
+
+const void *dc_in_port_t_from_string(const struct dc_env *env, struct dc_error *err, const char *str)
+{
+    static _Thread_local in_port_t value;
+
+    DC_TRACE(env);
+    value = dc_in_port_t_from_str(env, err, str, 10);
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
     }
 
+    return &value;
+}
+
+const void *dc_int32_from_string(const struct dc_env *env, struct dc_error *err, const char *str)
+{
+    static _Thread_local int32_t value;
+
+    DC_TRACE(env);
+
+    if(!(dc_parse_int32(env, err, str, &value)))
+    {
+        return NULL;
+    }
+
+    return &value;
+}
+
+const void *dc_int64_from_string(const struct dc_env *env, struct dc_error *err, const char *str)
+{
+    static _Thread_local int64_t value;
+
+    DC_TRACE(env);
+
+    if(!(dc_parse_int64(env, err, str, &value)))
+    {
+        return NULL;
+    }
+
+    return &value;
+}
+
+const void *dc_uint32_from_string(const struct dc_env *env, struct dc_error *err, const char *str)
+{
+    static _Thread_local uint32_t value;
+
+    DC_TRACE(env);
+
+    if(!(dc_parse_uint32(env, err, str, &value)))
+    {
+        return NULL;
+    }
+
+    return &value;
+}
+
+const void *dc_uint64_from_string(const struct dc_env *env, struct dc_error *err, const char *str)
+{
+    static _Thread_local uint64_t value;
+
+    DC_TRACE(env);
+
+    if(!(dc_parse_uint64(env, err, str, &value)))
+    {
+        return NULL;
+    }
+
+    return &value;
+}
+
+const void *dc_size_t_from_string(const struct dc_env *env, struct dc_error *err, const char *str)
+{
+    static _Thread_local size_t value;
+
+    DC_TRACE(env);
+
+    if(!(dc_parse_size_t(env, err, str, &value)))
+    {
+        return NULL;
+    }
+
+    return &value;
+}
+
+const void *dc_double_from_string(const struct dc_env *env, struct dc_error *err, const char *str)
+{
+    static _Thread_local double value;
+
+    DC_TRACE(env);
+
+    if(!(dc_parse_double(env, err, str, &value)))
+    {
+        return NULL;
+    }
+
+    return &value;
+}
+
+const void *dc_bytes_from_string(const struct dc_env *env, struct dc_error *err, const char *str)
+{
+    static _Thread_local uint64_t value;
+
+    DC_TRACE(env);
+
+    if(!(dc_parse_bytes(env, err, str, &value)))
+    {
+        return NULL;
+    }
+
+    return &value;
+}
+
+const void *dc_duration_from_string(const struct dc_env *env, struct dc_error *err, const char *str)
+{
+    static _Thread_local uint64_t value;
+
+    DC_TRACE(env);
+
+    if(!(dc_parse_duration(env, err, str, &value)))
+    {
+        return NULL;
+    }
+
+    return &value;
+}
+
+// lists are delimited by commas, each converter keeps the last list it made for the thread and frees it on the next call
+const void *dc_string_list_from_string(const struct dc_env *env, struct dc_error *err, const char *str)
+{
+    static _Thread_local struct dc_list *value = NULL;
+
+    DC_TRACE(env);
+
+    if(value)
+    {
+        dc_list_destroy(env, &value);
+    }
+
+    value = dc_list_parse(env, err, DC_LIST_STRING, str, ',');
+
     return value;
 }
 
-const void *dc_in_port_t_from_string(const struct dc_env *env, struct dc_error *err, const char *str)
+const void *dc_integer_list_from_string(const struct dc_env *env, struct dc_error *err, const char *str)
+{
+    static _Thread_local struct dc_list *value = NULL;
+
+    DC_TRACE(env);
+
+    if(value)
+    {
+        dc_list_destroy(env, &value);
+    }
+
+    value = dc_list_parse(env, err, DC_LIST_INTEGER, str, ',');
+
+    return value;
+}
+
+const void *dc_endpoint_list_from_string(const struct dc_env *env, struct dc_error *err, const char *str)
 {
-    in_port_t *value;
+    static _Thread_local struct dc_list *value = NULL;
 
     DC_TRACE(env);
-    value = dc_malloc(env, err, sizeof(in_port_t));
 
-    if(dc_error_has_no_error(err))
+    if(value)
     {
-        *value = dc_in_port_t_from_str(env, err, str, 10);
+        dc_list_destroy(env, &value);
+    }
+
+    value = dc_list_parse(env, err, DC_LIST_ENDPOINT, str, ',');
+
+    return value;
+}
+
+// the key does not have to be NUL terminated, the environment and config loaders pass part of a larger string
+static const struct options *find_indexed(const struct dc_env *env,
+                                          const struct dc_opt_settings *opt_settings,
+                                          const struct dc_options_index *index,
+                                          key_field field,
+                                          const char *key,
+                                          size_t length)
+{
+    const struct options *opt;
+    const char *opt_key;
+
+    if(index)
+    {
+        uint64_t hash;
+        uint32_t displacement;
+
+        if(index->slot_count == 0)
+        {
+            return NULL;
+        }
+
+        hash = dc_options_hash(key, length);
+        displacement = index->displacements[dc_options_hash_bucket(hash, index->bucket_count)];
+        opt = &opt_settings->opts[index->slots[dc_options_hash_slot(hash, displacement, index->slot_count)]];
+        opt_key = option_key(opt, field);
 
-        if(dc_error_has_error(err))
+        // a key that is not in the table still lands on some slot
+        if(opt_key && dc_strncmp(env, opt_key, key, length) == 0 && opt_key[length] == '\0')
         {
-            dc_free(env, value);
-            value = NULL;
+            return opt;
         }
+
+        return NULL;
     }
 
-    return value;
+    for(opt = opt_settings->opts; opt->name != NULL; opt++)
+    {
+        opt_key = option_key(opt, field);
+
+        if(opt_key && dc_strncmp(env, opt_key, key, length) == 0 && opt_key[length] == '\0')
+        {
+            return opt;
+        }
+    }
+
+    return NULL;
+}
+
+static const char *option_key(const struct options *opt, key_field field)
+{
+    const char *key;
+
+    switch(field)
+    {
+        case KEY_ENV:
+        {
+            key = opt->env_key;
+            break;
+        }
+        case KEY_CONFIG:
+        {
+            key = opt->config_key;
+            break;
+        }
+        case KEY_NAME:
+        default:
+        {
+            key = opt->name;
+        }
+    }
+
+    return key;
+}
+
+// values are widened to 64 bits so that one comparison covers every kind with the same signedness
+static int compare_values(dc_setting_kind kind, const void *a, const void *b)
+{
+    int result;
+
+    switch(kind)
+    {
+        case DC_SETTING_KIND_UINT16:
+        {
+            result = compare_unsigned(*(const uint16_t *)a, *(const uint16_t *)b);
+            break;
+        }
+        case DC_SETTING_KIND_IN_PORT_T:
+        {
+            result = compare_unsigned(*(const in_port_t *)a, *(const in_port_t *)b);
+            break;
+        }
+        case DC_SETTING_KIND_INT32:
+        {
+            result = compare_signed(*(const int32_t *)a, *(const int32_t *)b);
+            break;
+        }
+        case DC_SETTING_KIND_INT64:
+        {
+            result = compare_signed(*(const int64_t *)a, *(const int64_t *)b);
+            break;
+        }
+        case DC_SETTING_KIND_UINT32:
+        {
+            result = compare_unsigned(*(const uint32_t *)a, *(const uint32_t *)b);
+            break;
+        }
+        case DC_SETTING_KIND_UINT64:
+        case DC_SETTING_KIND_BYTES:
+        case DC_SETTING_KIND_DURATION:
+        {
+            result = compare_unsigned(*(const uint64_t *)a, *(const uint64_t *)b);
+            break;
+        }
+        case DC_SETTING_KIND_SIZE_T:
+        {
+            result = compare_unsigned(*(const size_t *)a, *(const size_t *)b);
+            break;
+        }
+        case DC_SETTING_KIND_DOUBLE:
+        {
+            double x;
+            double y;
+
+            x = *(const double *)a;
+            y = *(const double *)b;
+            result = (x > y) - (x < y);
+            break;
+        }
+        case DC_SETTING_KIND_STRING:
+        case DC_SETTING_KIND_REGEX:
+        case DC_SETTING_KIND_PATH:
+        case DC_SETTING_KIND_FD:
+        case DC_SETTING_KIND_DIRFD:
+        case DC_SETTING_KIND_BOOL:
+        case DC_SETTING_KIND_LIST:
+        case DC_SETTING_KIND_CPUSET:
+        case DC_SETTING_KIND_NUMA_POLICY:
+        default:
+        {
+            // there is no ordering for these so they are always in range
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static int compare_signed(int64_t a, int64_t b)
+{
+    return (a > b) - (a < b);
+}
+
+static int compare_unsigned(uint64_t a, uint64_t b)
+{
+    return (a > b) - (a < b);
 }
@@ -0,0 +1,465 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "dc_application/parse.h"
+#include <dc_c/dc_string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+struct unit
+{
+    const char *suffix;
+    uint64_t multiplier;
+};
+
+// the first entry with an empty suffix is the unit used when there is none
+static const struct unit byte_units[] =
+{
+    {"", 1},
+    {"B", 1},
+    {"KiB", UINT64_C(1) << 10},
+    {"MiB", UINT64_C(1) << 20},
+    {"GiB", UINT64_C(1) << 30},
+    {"TiB", UINT64_C(1) << 40},
+    {"PiB", UINT64_C(1) << 50},
+    {"EiB", UINT64_C(1) << 60},
+    {"kB", UINT64_C(1000)},
+    {"KB", UINT64_C(1000)},
+    {"MB", UINT64_C(1000000)},
+    {"GB", UINT64_C(1000000000)},
+    {"TB", UINT64_C(1000000000000)},
+    {"PB", UINT64_C(1000000000000000)},
+    {"EB", UINT64_C(1000000000000000000)},
+    {NULL, 0},
+};
+
+static const struct unit duration_units[] =
+{
+    {"ns", 1},
+    {"us", UINT64_C(1000)},
+    {"ms", UINT64_C(1000000)},
+    {"s", UINT64_C(1000000000)},
+    {"m", UINT64_C(60000000000)},
+    {"min", UINT64_C(60000000000)},
+    {"h", UINT64_C(3600000000000)},
+    {"d", UINT64_C(86400000000000)},
+    {NULL, 0},
+};
+
+// largest first, only the units that format uses
+static const struct unit byte_format_units[] =
+{
+    {"EiB", UINT64_C(1) << 60},
+    {"PiB", UINT64_C(1) << 50},
+    {"TiB", UINT64_C(1) << 40},
+    {"GiB", UINT64_C(1) << 30},
+    {"MiB", UINT64_C(1) << 20},
+    {"KiB", UINT64_C(1) << 10},
+    {"B", 1},
+    {NULL, 0},
+};
+
+static const struct unit duration_format_units[] =
+{
+    {"d", UINT64_C(86400000000000)},
+    {"h", UINT64_C(3600000000000)},
+    {"m", UINT64_C(60000000000)},
+    {"s", UINT64_C(1000000000)},
+    {"ms", UINT64_C(1000000)},
+    {"us", UINT64_C(1000)},
+    {"ns", 1},
+    {NULL, 0},
+};
+
+// more fraction digits than this are ignored, they are below the resolution of any unit
+#define MAX_FRACTION_DIGITS 9
+
+
+static int format_scaled(uint64_t value, const struct unit *units, char *buffer, size_t size);
+static int parse_magnitude(const char *str, uint64_t max, uint64_t *value);
+static int parse_scaled(const struct dc_env *env, const char *str, const struct unit *units, uint64_t *value);
+static int parse_signed(const char *str, int64_t min, int64_t max, int64_t *value);
+static int parse_unsigned(const char *str, uint64_t max, uint64_t *value);
+static bool report(struct dc_error *err, int result);
+
+
+bool dc_parse_int32(const struct dc_env *env, struct dc_error *err, const char *str, int32_t *value)
+{
+    int64_t result;
+    int status;
+
+    DC_TRACE(env);
+    status = parse_signed(str, INT32_MIN, INT32_MAX, &result);
+
+    if(status == 0)
+    {
+        *value = (int32_t)result;
+    }
+
+    return report(err, status);
+}
+
+bool dc_parse_int64(const struct dc_env *env, struct dc_error *err, const char *str, int64_t *value)
+{
+    DC_TRACE(env);
+
+    return report(err, parse_signed(str, INT64_MIN, INT64_MAX, value));
+}
+
+bool dc_parse_uint32(const struct dc_env *env, struct dc_error *err, const char *str, uint32_t *value)
+{
+    uint64_t result;
+    int status;
+
+    DC_TRACE(env);
+    status = parse_unsigned(str, UINT32_MAX, &result);
+
+    if(status == 0)
+    {
+        *value = (uint32_t)result;
+    }
+
+    return report(err, status);
+}
+
+bool dc_parse_uint64(const struct dc_env *env, struct dc_error *err, const char *str, uint64_t *value)
+{
+    DC_TRACE(env);
+
+    return report(err, parse_unsigned(str, UINT64_MAX, value));
+}
+
+bool dc_parse_size_t(const struct dc_env *env, struct dc_error *err, const char *str, size_t *value)
+{
+    uint64_t result;
+    int status;
+
+    DC_TRACE(env);
+    status = parse_unsigned(str, SIZE_MAX, &result);
+
+    if(status == 0)
+    {
+        *value = (size_t)result;
+    }
+
+    return report(err, status);
+}
+
+bool dc_parse_double(const struct dc_env *env, struct dc_error *err, const char *str, double *value)
+{
+    const char *c;
+    char *end;
+    double result;
+
+    DC_TRACE(env);
+
+    // strtod accepts things like leading space, hex, inf, and nan, which are not numbers in a setting
+    c = str;
+
+    if(*c == '+' || *c == '-')
+    {
+        c++;
+    }
+
+    if((unsigned int)(unsigned char)*c - '0' > 9 && !(*c == '.' && (unsigned int)(unsigned char)c[1] - '0' <= 9))
+    {
+        return report(err, EINVAL);
+    }
+
+    for(; *c; c++)
+    {
+        if((unsigned int)(unsigned char)*c - '0' > 9 && *c != '.' && *c != 'e' && *c != 'E' && *c != '+' && *c != '-')
+        {
+            return report(err, EINVAL);
+        }
+    }
+
+    result = strtod(str, &end);
+
+    if(*end != '\0')
+    {
+        return report(err, EINVAL);
+    }
+
+    if(isinf(result))
+    {
+        return report(err, ERANGE);
+    }
+
+    *value = result;
+
+    return report(err, 0);
+}
+
+bool dc_parse_bytes(const struct dc_env *env, struct dc_error *err, const char *str, uint64_t *value)
+{
+    DC_TRACE(env);
+
+    return report(err, parse_scaled(env, str, byte_units, value));
+}
+
+bool dc_parse_duration(const struct dc_env *env, struct dc_error *err, const char *str, uint64_t *value)
+{
+    DC_TRACE(env);
+
+    // there is no sensible default unit for a duration, but zero is zero in any of them
+    if(dc_strcmp(env, str, "0") == 0)
+    {
+        *value = 0;
+
+        return true;
+    }
+
+    return report(err, parse_scaled(env, str, duration_units, value));
+}
+
+int dc_format_bytes(const struct dc_env *env, uint64_t value, char *buffer, size_t size)
+{
+    DC_TRACE(env);
+
+    return format_scaled(value, byte_format_units, buffer, size);
+}
+
+int dc_format_duration(const struct dc_env *env, uint64_t value, char *buffer, size_t size)
+{
+    DC_TRACE(env);
+
+    if(value == 0)
+    {
+        return snprintf(buffer, size, "0");
+    }
+
+    return format_scaled(value, duration_format_units, buffer, size);
+}
+
+/*
+ * Accumulates the digits without branching on anything but the end of the string and a non-digit, which folds into
+ * a single unsigned compare. Overflow is checked once per digit against a precomputed limit.
+ */
+static int parse_magnitude(const char *str, uint64_t max, uint64_t *value)
+{
+    uint64_t result;
+    uint64_t limit;
+    unsigned int limit_digit;
+    const char *c;
+
+    if(*str == '\0')
+    {
+        return EINVAL;
+    }
+
+    result = 0;
+    limit = max / 10;
+    limit_digit = (unsigned int)(max % 10);
+
+    for(c = str; *c; c++)
+    {
+        unsigned int digit;
+
+        digit = (unsigned int)(unsigned char)*c - '0';
+
+        if(digit > 9)
+        {
+            return EINVAL;
+        }
+
+        if(result > limit || (result == limit && digit > limit_digit))
+        {
+            // keep going so that "99999999999999999999x" is reported as not a number rather than too big
+            for(c++; *c; c++)
+            {
+                if((unsigned int)(unsigned char)*c - '0' > 9)
+                {
+                    return EINVAL;
+                }
+            }
+
+            return ERANGE;
+        }
+
+        result = (result * 10) + digit;
+    }
+
+    *value = result;
+
+    return 0;
+}
+
+/*
+ * The number is split into a whole part and a fraction of at most MAX_FRACTION_DIGITS digits so that everything
+ * stays in integer arithmetic. The fraction contributes (fraction * multiplier) / denominator, which is computed as
+ * fraction * (multiplier / denominator) + (fraction * (multiplier % denominator)) / denominator so that neither
+ * product can overflow except when the result itself does.
+ */
+static int parse_scaled(const struct dc_env *env, const char *str, const struct unit *units, uint64_t *value)
+{
+    uint64_t whole;
+    uint64_t fraction;
+    uint64_t denominator;
+    uint64_t multiplier;
+    uint64_t scaled;
+    uint64_t part;
+    size_t digits;
+    size_t fraction_digits;
+    const char *c;
+
+    whole = 0;
+    fraction = 0;
+    denominator = 1;
+    digits = 0;
+    fraction_digits = 0;
+
+    for(c = str; (unsigned int)(unsigned char)*c - '0' <= 9; c++)
+    {
+        unsigned int digit;
+
+        digit = (unsigned int)(unsigned char)*c - '0';
+
+        if(whole > (UINT64_MAX - digit) / 10)
+        {
+            return ERANGE;
+        }
+
+        whole = (whole * 10) + digit;
+        digits++;
+    }
+
+    if(*c == '.')
+    {
+        for(c++; (unsigned int)(unsigned char)*c - '0' <= 9; c++)
+        {
+            if(fraction_digits < MAX_FRACTION_DIGITS)
+            {
+                fraction = (fraction * 10) + ((unsigned int)(unsigned char)*c - '0');
+                denominator *= 10;
+                fraction_digits++;
+            }
+
+            digits++;
+        }
+    }
+
+    if(digits == 0)
+    {
+        return EINVAL;
+    }
+
+    multiplier = 0;
+
+    for(size_t i = 0; units[i].suffix != NULL; i++)
+    {
+        if(dc_strcmp(env, c, units[i].suffix) == 0)
+        {
+            multiplier = units[i].multiplier;
+            break;
+        }
+    }
+
+    if(multiplier == 0)
+    {
+        return EINVAL;
+    }
+
+    if(whole > UINT64_MAX / multiplier)
+    {
+        return ERANGE;
+    }
+
+    scaled = whole * multiplier;
+
+    if(fraction != 0)
+    {
+        if(multiplier / denominator != 0 && fraction > UINT64_MAX / (multiplier / denominator))
+        {
+            return ERANGE;
+        }
+
+        part = (fraction * (multiplier / denominator)) + ((fraction * (multiplier % denominator)) / denominator);
+
+        if(scaled > UINT64_MAX - part)
+        {
+            return ERANGE;
+        }
+
+        scaled += part;
+    }
+
+    *value = scaled;
+
+    return 0;
+}
+
+static int format_scaled(uint64_t value, const struct unit *units, char *buffer, size_t size)
+{
+    size_t i;
+
+    // the last unit has a multiplier of 1 so the loop always stops on a unit
+    for(i = 0; value % units[i].multiplier != 0 || value < units[i].multiplier; i++)
+    {
+        if(units[i + 1].suffix == NULL)
+        {
+            break;
+        }
+    }
+
+    return snprintf(buffer, size, "%" PRIu64 "%s", value / units[i].multiplier, units[i].suffix);
+}
+
+static int parse_signed(const char *str, int64_t min, int64_t max, int64_t *value)
+{
+    uint64_t magnitude;
+    bool negative;
+    int status;
+
+    negative = *str == '-';
+    str += (*str == '-' || *str == '+');
+
+    // the magnitude of min is one more than max, which does not fit in an int64_t so it is computed unsigned
+    status = parse_magnitude(str, negative ? (uint64_t)(-(min + 1)) + 1 : (uint64_t)max, &magnitude);
+
+    if(status == 0)
+    {
+        *value = negative ? (int64_t)(0 - magnitude) : (int64_t)magnitude;
+    }
+
+    return status;
+}
+
+static int parse_unsigned(const char *str, uint64_t max, uint64_t *value)
+{
+    str += (*str == '+');
+
+    return parse_magnitude(str, max, value);
+}
+
+static bool report(struct dc_error *err, int result)
+{
+    if(result == EINVAL)
+    {
+        DC_ERROR_RAISE_USER(err, "not a number", EINVAL);
+    }
+    else if(result == ERANGE)
+    {
+        DC_ERROR_RAISE_USER(err, "number is out of range", ERANGE);
+    }
+
+    return result == 0;
+}
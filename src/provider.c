@@ -0,0 +1,605 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "dc_application/provider.h"
+#include "dc_application/config.h"
+#include <dc_c/dc_stdlib.h>
+#include <dc_c/dc_string.h>
+#include <dc_posix/dc_fcntl.h>
+#include <dc_posix/dc_stdio.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_time.h>
+#include <dc_posix/dc_unistd.h>
+#include <dc_posix/sys/dc_socket.h>
+#include <dc_posix/sys/dc_stat.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/un.h>
+
+
+// the most a provider can hand back, more than that is not settings
+#define MAX_TEXT (1024U * 1024U)
+#define MS_PER_SEC 1000
+#define NS_PER_MS 1000000L
+
+
+// shared by the thread running the fetch and the registry, whichever lets go of it last frees it
+struct fetch
+{
+    const struct dc_env *env;
+    const struct dc_config_provider *provider;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    struct timespec deadline;
+    char *text;
+    bool done;
+    bool abandoned;
+};
+
+struct entry
+{
+    const struct dc_config_provider *provider;
+    char *cached;
+    bool fresh;
+    struct fetch *fetch;
+};
+
+struct dc_config_providers
+{
+    struct entry *entries;
+    size_t count;
+};
+
+
+static void read_cache(const struct dc_env *env, struct dc_error *err, struct entry *entry);
+static char *read_all(const struct dc_env *env, struct dc_error *err, int fd);
+static void write_cache(const struct dc_env *env, struct dc_error *err, const char *path, const char *text);
+static struct fetch *start_fetch(const struct dc_env *env, struct dc_error *err, const struct dc_config_provider *provider);
+static void *run_fetch(void *arg);
+static char *wait_fetch(const struct dc_env *env, struct fetch *fetch);
+static void abandon_fetch(const struct dc_env *env, struct fetch *fetch);
+static void destroy_fetch(const struct dc_env *env, struct fetch *fetch);
+static bool is_valid(const char *text);
+
+
+struct dc_config_providers *dc_config_providers_create(const struct dc_env *env, struct dc_error *err)
+{
+    DC_TRACE(env);
+
+    return dc_calloc(env, err, 1, sizeof(struct dc_config_providers));
+}
+
+void dc_config_providers_destroy(const struct dc_env *env, struct dc_config_providers **pproviders)
+{
+    struct dc_config_providers *providers;
+
+    DC_TRACE(env);
+    providers = *pproviders;
+
+    for(size_t i = 0; i < providers->count; i++)
+    {
+        if(providers->entries[i].fetch)
+        {
+            abandon_fetch(env, providers->entries[i].fetch);
+        }
+
+        if(providers->entries[i].cached)
+        {
+            dc_free(env, providers->entries[i].cached);
+        }
+    }
+
+    dc_free(env, providers->entries);
+    dc_free(env, providers);
+    *pproviders = NULL;
+}
+
+void dc_config_providers_add(const struct dc_env *env,
+                             struct dc_error *err,
+                             struct dc_config_providers *providers,
+                             const struct dc_config_provider *provider)
+{
+    struct entry *entries;
+
+    DC_TRACE(env);
+    entries = dc_realloc(env, err, providers->entries, (providers->count + 1) * sizeof(struct entry));
+
+    if(dc_error_has_no_error(err))
+    {
+        dc_memset(env, &entries[providers->count], 0, sizeof(struct entry));
+        entries[providers->count].provider = provider;
+        providers->entries = entries;
+        providers->count++;
+    }
+}
+
+void dc_config_providers_start(const struct dc_env *env, struct dc_error *err, struct dc_config_providers *providers)
+{
+    DC_TRACE(env);
+
+    for(size_t i = 0; i < providers->count && dc_error_has_no_error(err); i++)
+    {
+        struct entry *entry;
+        struct dc_error cache_err;
+
+        entry = &providers->entries[i];
+
+        // a missing or unreadable cache is the same as not having one
+        if(entry->provider->cache_path)
+        {
+            dc_error_init(&cache_err, NULL);
+            read_cache(env, &cache_err, entry);
+            dc_error_reset(&cache_err);
+        }
+
+        if(!(entry->fresh))
+        {
+            entry->fetch = start_fetch(env, err, entry->provider);
+        }
+    }
+}
+
+void dc_config_providers_apply(const struct dc_env *env,
+                               struct dc_error *err,
+                               struct dc_config_providers *providers,
+                               struct dc_application_settings *settings)
+{
+    DC_TRACE(env);
+
+    for(size_t i = 0; i < providers->count && dc_error_has_no_error(err); i++)
+    {
+        struct entry *entry;
+        char *fetched;
+        const char *text;
+
+        entry = &providers->entries[i];
+        fetched = NULL;
+
+        if(entry->fetch)
+        {
+            fetched = wait_fetch(env, entry->fetch);
+            entry->fetch = NULL;
+        }
+
+        // a fetch that failed or is too slow leaves the last known good settings
+        text = fetched ? fetched : entry->cached;
+
+        if(text)
+        {
+            dc_config_apply_string(env, err, settings, text);
+        }
+
+        if(fetched)
+        {
+            dc_free(env, fetched);
+        }
+
+        if(entry->cached)
+        {
+            dc_free(env, entry->cached);
+            entry->cached = NULL;
+        }
+    }
+}
+
+char *dc_config_provider_unix_fetch(const struct dc_env *env, struct dc_error *err, void *data)
+{
+    struct sockaddr_un address;
+    struct dc_error close_err;
+    const char *path;
+    char *text;
+    int fd;
+
+    DC_TRACE(env);
+    path = data;
+
+    if(dc_strlen(env, path) >= sizeof(address.sun_path))
+    {
+        DC_ERROR_RAISE_USER(err, "provider socket path is too long", ENAMETOOLONG);
+
+        return NULL;
+    }
+
+    dc_memset(env, &address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    dc_strcpy(env, address.sun_path, path);
+    fd = dc_socket(env, err, AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    text = NULL;
+    dc_connect(env, err, fd, (struct sockaddr *)&address, sizeof(address));
+
+    if(dc_error_has_no_error(err))
+    {
+        text = read_all(env, err, fd);
+    }
+
+    dc_error_init(&close_err, NULL);
+    dc_close(env, &close_err, fd);
+    dc_error_reset(&close_err);
+
+    return text;
+}
+
+static void read_cache(const struct dc_env *env, struct dc_error *err, struct entry *entry)
+{
+    struct stat status;
+    struct timespec now;
+    struct dc_error close_err;
+    int fd;
+
+    DC_TRACE(env);
+    fd = dc_open(env, err, entry->provider->cache_path, O_RDONLY | O_CLOEXEC);
+
+    if(dc_error_has_error(err))
+    {
+        return;
+    }
+
+    dc_fstat(env, err, fd, &status);
+
+    if(dc_error_has_no_error(err))
+    {
+        entry->cached = read_all(env, err, fd);
+    }
+
+    dc_error_init(&close_err, NULL);
+    dc_close(env, &close_err, fd);
+    dc_error_reset(&close_err);
+
+    if(dc_error_has_no_error(err))
+    {
+        dc_clock_gettime(env, err, CLOCK_REALTIME, &now);
+    }
+
+    // a cache that was cut short or damaged is not last known good settings, it is thrown away and fetched again
+    if(entry->cached && (entry->cached[0] == '\0' || !(is_valid(entry->cached))))
+    {
+        dc_free(env, entry->cached);
+        entry->cached = NULL;
+    }
+
+    if(dc_error_has_no_error(err) && entry->cached)
+    {
+        int64_t age_ms;
+
+        age_ms = ((int64_t)now.tv_sec - (int64_t)status.st_mtim.tv_sec) * MS_PER_SEC +
+                 ((int64_t)now.tv_nsec - (int64_t)status.st_mtim.tv_nsec) / NS_PER_MS;
+        entry->fresh = age_ms >= 0 && (uint64_t)age_ms < entry->provider->ttl_ms;
+    }
+}
+
+static char *read_all(const struct dc_env *env, struct dc_error *err, int fd)
+{
+    char *text;
+    size_t length;
+    size_t capacity;
+
+    DC_TRACE(env);
+    length = 0;
+    capacity = BUFSIZ;
+    text = dc_malloc(env, err, capacity);
+
+    while(dc_error_has_no_error(err))
+    {
+        ssize_t nread;
+
+        // always leave room for the NUL
+        if(length + 1 == capacity)
+        {
+            char *bigger;
+
+            if(capacity >= MAX_TEXT)
+            {
+                DC_ERROR_RAISE_USER(err, "provider settings are too long", E2BIG);
+                break;
+            }
+
+            bigger = dc_realloc(env, err, text, capacity * 2);
+
+            if(dc_error_has_error(err))
+            {
+                break;
+            }
+
+            text = bigger;
+            capacity *= 2;
+        }
+
+        nread = dc_read(env, err, fd, &text[length], capacity - length - 1);
+
+        if(nread <= 0)
+        {
+            break;
+        }
+
+        length += (size_t)nread;
+    }
+
+    if(dc_error_has_error(err))
+    {
+        dc_free(env, text);
+
+        return NULL;
+    }
+
+    text[length] = '\0';
+
+    return text;
+}
+
+/*
+ * The new file is written under a unique name next to the cache and put in place with a rename, so a process starting
+ * at the same time never reads half of it and two writers never share a temporary file. It is synced before the
+ * rename so a crash leaves the old cache or the new one, not an empty file.
+ */
+static void write_cache(const struct dc_env *env, struct dc_error *err, const char *path, const char *text)
+{
+    char *temp_path;
+    size_t length;
+    size_t total;
+    int fd;
+
+    DC_TRACE(env);
+    length = dc_strlen(env, path);
+    temp_path = dc_malloc(env, err, length + sizeof(".XXXXXX"));
+
+    if(dc_error_has_error(err))
+    {
+        return;
+    }
+
+    dc_strcpy(env, temp_path, path);
+    dc_strcpy(env, &temp_path[length], ".XXXXXX");
+    fd = dc_mkstemp(env, err, temp_path);
+
+    if(dc_error_has_no_error(err))
+    {
+        dc_fcntl(env, err, fd, F_SETFD, FD_CLOEXEC);
+        length = dc_strlen(env, text);
+        total = 0;
+
+        while(total < length && dc_error_has_no_error(err))
+        {
+            ssize_t nwrote;
+
+            nwrote = dc_write(env, err, fd, &text[total], length - total);
+
+            if(nwrote > 0)
+            {
+                total += (size_t)nwrote;
+            }
+        }
+
+        if(dc_error_has_no_error(err))
+        {
+            dc_fsync(env, err, fd);
+        }
+
+        if(dc_error_has_no_error(err))
+        {
+            // a close that fails can mean the data never made it to the disk
+            dc_close(env, err, fd);
+        }
+        else
+        {
+            struct dc_error close_err;
+
+            dc_error_init(&close_err, NULL);
+            dc_close(env, &close_err, fd);
+            dc_error_reset(&close_err);
+        }
+
+        if(dc_error_has_no_error(err))
+        {
+            dc_rename(env, err, temp_path, path);
+        }
+
+        if(dc_error_has_error(err))
+        {
+            struct dc_error unlink_err;
+
+            dc_error_init(&unlink_err, NULL);
+            dc_unlink(env, &unlink_err, temp_path);
+            dc_error_reset(&unlink_err);
+        }
+    }
+
+    dc_free(env, temp_path);
+}
+
+static struct fetch *start_fetch(const struct dc_env *env, struct dc_error *err, const struct dc_config_provider *provider)
+{
+    struct fetch *fetch;
+    pthread_t thread;
+    int result;
+
+    DC_TRACE(env);
+    fetch = dc_calloc(env, err, 1, sizeof(struct fetch));
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    fetch->env = env;
+    fetch->provider = provider;
+    // pthread_cond_timedwait waits until a CLOCK_REALTIME time, there is no pthread_condattr_setclock on macOS
+    dc_clock_gettime(env, err, CLOCK_REALTIME, &fetch->deadline);
+
+    if(dc_error_has_error(err))
+    {
+        dc_free(env, fetch);
+
+        return NULL;
+    }
+
+    fetch->deadline.tv_sec += (time_t)(provider->timeout_ms / MS_PER_SEC);
+    fetch->deadline.tv_nsec += (long)(provider->timeout_ms % MS_PER_SEC) * NS_PER_MS;
+
+    if(fetch->deadline.tv_nsec >= MS_PER_SEC * NS_PER_MS)
+    {
+        fetch->deadline.tv_sec++;
+        fetch->deadline.tv_nsec -= MS_PER_SEC * NS_PER_MS;
+    }
+
+    pthread_cond_init(&fetch->cond, NULL);
+    pthread_mutex_init(&fetch->mutex, NULL);
+    result = pthread_create(&thread, NULL, run_fetch, fetch);
+
+    // without the thread there is only the cache
+    if(result != 0)
+    {
+        pthread_mutex_destroy(&fetch->mutex);
+        pthread_cond_destroy(&fetch->cond);
+        dc_free(env, fetch);
+
+        return NULL;
+    }
+
+    pthread_detach(thread);
+
+    return fetch;
+}
+
+static void *run_fetch(void *arg)
+{
+    struct fetch *fetch;
+    const struct dc_env *env;
+    struct dc_error err;
+    char *text;
+    bool abandoned;
+
+    fetch = arg;
+    env = fetch->env;
+    DC_TRACE(env);
+    dc_error_init(&err, NULL);
+    text = fetch->provider->fetch(env, &err, fetch->provider->data);
+
+    // only settings that can be applied are worth keeping, a bad answer must not replace the last good one
+    if(text && (dc_error_has_error(&err) || !(is_valid(text))))
+    {
+        dc_free(env, text);
+        text = NULL;
+    }
+
+    if(text && fetch->provider->cache_path)
+    {
+        write_cache(env, &err, fetch->provider->cache_path, text);
+    }
+
+    dc_error_reset(&err);
+    pthread_mutex_lock(&fetch->mutex);
+    fetch->text = text;
+    fetch->done = true;
+    abandoned = fetch->abandoned;
+    pthread_cond_signal(&fetch->cond);
+    pthread_mutex_unlock(&fetch->mutex);
+
+    if(abandoned)
+    {
+        destroy_fetch(env, fetch);
+    }
+
+    return NULL;
+}
+
+static char *wait_fetch(const struct dc_env *env, struct fetch *fetch)
+{
+    char *text;
+    bool done;
+
+    DC_TRACE(env);
+    pthread_mutex_lock(&fetch->mutex);
+
+    while(!(fetch->done))
+    {
+        if(pthread_cond_timedwait(&fetch->cond, &fetch->mutex, &fetch->deadline) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+
+    done = fetch->done;
+    text = NULL;
+
+    if(done)
+    {
+        text = fetch->text;
+        fetch->text = NULL;
+    }
+    else
+    {
+        // the thread finishes on its own, what it fetches still goes to the cache for the next start
+        fetch->abandoned = true;
+    }
+
+    pthread_mutex_unlock(&fetch->mutex);
+
+    if(done)
+    {
+        destroy_fetch(env, fetch);
+    }
+
+    return text;
+}
+
+static void abandon_fetch(const struct dc_env *env, struct fetch *fetch)
+{
+    bool done;
+
+    DC_TRACE(env);
+    pthread_mutex_lock(&fetch->mutex);
+    done = fetch->done;
+    fetch->abandoned = true;
+    pthread_mutex_unlock(&fetch->mutex);
+
+    if(done)
+    {
+        destroy_fetch(env, fetch);
+    }
+}
+
+static void destroy_fetch(const struct dc_env *env, struct fetch *fetch)
+{
+    DC_TRACE(env);
+
+    if(fetch->text)
+    {
+        dc_free(env, fetch->text);
+    }
+
+    pthread_mutex_destroy(&fetch->mutex);
+    pthread_cond_destroy(&fetch->cond);
+    dc_free(env, fetch);
+}
+
+static bool is_valid(const char *text)
+{
+    config_t config;
+    bool valid;
+
+    config_init(&config);
+    valid = config_read_string(&config, text) == CONFIG_TRUE;
+    config_destroy(&config);
+
+    return valid;
+}
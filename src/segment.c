@@ -0,0 +1,1043 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "dc_application/segment.h"
+#include "dc_application/options.h"
+#include <dc_c/dc_stdlib.h>
+#include <dc_c/dc_string.h>
+#include <dc_posix/dc_fcntl.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_unistd.h>
+#include <dc_posix/sys/dc_mman.h>
+#include <dc_posix/sys/dc_stat.h>
+#include <errno.h>
+#include <stdatomic.h>
+
+
+#define SEGMENT_MAGIC 0x53534344U    // "DCSS"
+#define SEGMENT_VERSION 2U
+// the seals a publisher adds, a descriptor without all of them was not made by dc_settings_segment_publish
+#ifdef F_SEAL_FUTURE_WRITE
+#define SEGMENT_SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL | F_SEAL_FUTURE_WRITE)
+#else
+#define SEGMENT_SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)
+#endif
+
+/*
+ * Everything in the segment is addressed by offset from the start of the mapping so that it can be mapped at any
+ * address. The string area holds the setting names followed by the string values, each NUL terminated.
+ */
+struct segment_header
+{
+    uint32_t magic;
+    uint32_t version;
+    char name[DC_SETTINGS_SEGMENT_NAME_SIZE];
+    _Atomic uint64_t generation;
+    uint64_t size;
+    uint32_t count;
+    uint32_t entries_offset;
+    uint32_t strings_offset;
+    uint32_t strings_size;
+};
+
+struct segment_entry
+{
+    uint32_t name_offset;
+    int32_t kind;
+    int32_t type;
+    uint32_t value_length;
+    uint64_t value;     // the value for scalar kinds, the offset into the string area for string kinds
+};
+
+struct dc_settings_segment
+{
+    int fd;
+    size_t size;
+    unsigned char *base;
+    bool owner;
+};
+
+static size_t count_options(const struct dc_opt_settings *opt_settings);
+static bool is_string_kind(dc_setting_kind kind);
+static const char *setting_string_value(const struct dc_env *env, struct dc_setting *setting);
+static uint64_t setting_scalar_value(const struct dc_env *env, struct dc_setting *setting);
+static const struct segment_header *get_header(const struct dc_settings_segment *segment);
+static const struct segment_entry *get_entry(const struct dc_settings_segment *segment, size_t index);
+static const char *get_string(const struct dc_settings_segment *segment, uint64_t offset);
+static uint64_t get_scalar(const struct dc_settings_segment *segment, size_t index, dc_setting_kind kind);
+static bool validate(const struct dc_settings_segment *segment);
+
+
+struct dc_settings_segment *dc_settings_segment_publish(const struct dc_env *env,
+                                                        struct dc_error *err,
+                                                        const char *name,
+                                                        const struct dc_application_settings *settings)
+{
+    const struct dc_opt_settings *opt_settings;
+    struct dc_settings_segment *segment;
+    struct segment_header *header;
+    struct segment_entry *entries;
+    char *strings;
+    size_t count;
+    size_t strings_size;
+    size_t string_offset;
+
+    DC_TRACE(env);
+
+    if(dc_strlen(env, name) >= DC_SETTINGS_SEGMENT_NAME_SIZE)
+    {
+        DC_ERROR_RAISE_USER(err, "settings segment name is too long", EINVAL);
+
+        return NULL;
+    }
+
+    opt_settings = (const struct dc_opt_settings *)settings;
+    count = count_options(opt_settings);
+    strings_size = 0;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        const struct options *opt;
+        struct dc_setting *setting;
+
+        opt = &opt_settings->opts[i];
+        setting = dc_options_get_setting(env, opt_settings, opt);
+        strings_size += dc_strlen(env, opt->name) + 1;
+
+        if(is_string_kind(setting->kind) && dc_setting_is_set(env, setting))
+        {
+            const char *value;
+
+            value = setting_string_value(env, setting);
+
+            if(value)
+            {
+                strings_size += dc_strlen(env, value) + 1;
+            }
+        }
+        else if(setting->kind == DC_SETTING_KIND_LIST && dc_setting_is_set(env, setting))
+        {
+            const struct dc_list *list;
+
+            list = dc_setting_list_get(env, (struct dc_setting_list *)setting);
+
+            if(list)
+            {
+                strings_size += dc_list_get_size(env, list) + 1;
+            }
+        }
+    }
+
+    segment = dc_calloc(env, err, 1, sizeof(struct dc_settings_segment));
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    segment->size = sizeof(struct segment_header) + (count * sizeof(struct segment_entry)) + strings_size;
+    segment->owner = true;
+    segment->fd = memfd_create("dc_settings", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+
+    if(segment->fd == -1)
+    {
+        DC_ERROR_RAISE_ERRNO(err, errno);
+        dc_free(env, segment);
+
+        return NULL;
+    }
+
+    dc_ftruncate(env, err, segment->fd, (off_t)segment->size);
+
+    if(dc_error_has_no_error(err))
+    {
+        segment->base = dc_mmap(env, err, NULL, segment->size, PROT_READ | PROT_WRITE, MAP_SHARED, segment->fd, 0);
+    }
+
+    if(dc_error_has_error(err))
+    {
+        segment->base = NULL;
+        dc_settings_segment_destroy(env, &segment);
+
+        return NULL;
+    }
+
+    header = (struct segment_header *)segment->base;
+    entries = (struct segment_entry *)(segment->base + sizeof(struct segment_header));
+    strings = (char *)(segment->base + sizeof(struct segment_header) + (count * sizeof(struct segment_entry)));
+    header->magic = SEGMENT_MAGIC;
+    header->version = SEGMENT_VERSION;
+    dc_strcpy(env, header->name, name);
+    header->size = segment->size;
+    header->count = (uint32_t)count;
+    header->entries_offset = (uint32_t)sizeof(struct segment_header);
+    header->strings_offset = (uint32_t)(sizeof(struct segment_header) + (count * sizeof(struct segment_entry)));
+    header->strings_size = (uint32_t)strings_size;
+    string_offset = 0;
+
+    for(size_t i = 0; i < count; i++)
+    {
+        const struct options *opt;
+        struct dc_setting *setting;
+        struct segment_entry *entry;
+
+        opt = &opt_settings->opts[i];
+        setting = dc_options_get_setting(env, opt_settings, opt);
+        entry = &entries[i];
+        entry->name_offset = (uint32_t)string_offset;
+        entry->kind = (int32_t)setting->kind;
+        entry->type = (int32_t)setting->type;
+        dc_strcpy(env, &strings[string_offset], opt->name);
+        string_offset += dc_strlen(env, opt->name) + 1;
+
+        if(!(dc_setting_is_set(env, setting)))
+        {
+            continue;
+        }
+
+        if(is_string_kind(setting->kind))
+        {
+            const char *value;
+
+            value = setting_string_value(env, setting);
+
+            if(value)
+            {
+                entry->value = string_offset;
+                entry->value_length = (uint32_t)dc_strlen(env, value);
+                dc_strcpy(env, &strings[string_offset], value);
+                string_offset += entry->value_length + 1;
+            }
+            else
+            {
+                entry->type = DC_SETTING_NONE;
+            }
+        }
+        else if(setting->kind == DC_SETTING_KIND_LIST)
+        {
+            const struct dc_list *list;
+
+            // a list has no pointers inside it so its bytes go into the string area as they are, with a NUL after
+            list = dc_setting_list_get(env, (struct dc_setting_list *)setting);
+
+            if(list)
+            {
+                entry->value = string_offset;
+                entry->value_length = (uint32_t)dc_list_get_size(env, list);
+                dc_memcpy(env, &strings[string_offset], list, entry->value_length);
+                strings[string_offset + entry->value_length] = '\0';
+                string_offset += entry->value_length + 1;
+            }
+            else
+            {
+                entry->type = DC_SETTING_NONE;
+            }
+        }
+        else
+        {
+            entry->value = setting_scalar_value(env, setting);
+        }
+    }
+
+    atomic_store_explicit(&header->generation, 1, memory_order_release);
+
+    // the publisher keeps its writable mapping so it can bump the generation, nobody else can get one
+    dc_fcntl(env, err, segment->fd, F_ADD_SEALS, SEGMENT_SEALS);
+
+    if(dc_error_has_error(err))
+    {
+        dc_settings_segment_destroy(env, &segment);
+    }
+
+    return segment;
+}
+
+struct dc_settings_segment *dc_settings_segment_attach(const struct dc_env *env, struct dc_error *err, int fd, const char *name)
+{
+    struct dc_settings_segment *segment;
+    struct stat status;
+    int seals;
+
+    DC_TRACE(env);
+
+    // only a sealed memfd can be trusted not to change size or contents under the mapping
+    seals = dc_fcntl(env, err, fd, F_GET_SEALS);
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    if((seals & SEGMENT_SEALS) != SEGMENT_SEALS)
+    {
+        DC_ERROR_RAISE_USER(err, "settings segment is not sealed", EINVAL);
+
+        return NULL;
+    }
+
+    dc_fstat(env, err, fd, &status);
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    if(status.st_size < (off_t)sizeof(struct segment_header))
+    {
+        DC_ERROR_RAISE_USER(err, "settings segment is too small", EINVAL);
+
+        return NULL;
+    }
+
+    segment = dc_calloc(env, err, 1, sizeof(struct dc_settings_segment));
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    segment->fd = -1;
+    segment->owner = false;
+    segment->size = (size_t)status.st_size;
+    segment->base = dc_mmap(env, err, NULL, segment->size, PROT_READ, MAP_SHARED, fd, 0);
+
+    if(dc_error_has_error(err))
+    {
+        segment->base = NULL;
+        dc_settings_segment_destroy(env, &segment);
+
+        return NULL;
+    }
+
+    if(!(validate(segment)))
+    {
+        DC_ERROR_RAISE_USER(err, "settings segment is corrupt", EINVAL);
+        dc_settings_segment_destroy(env, &segment);
+
+        return NULL;
+    }
+
+    if(dc_strcmp(env, get_header(segment)->name, name) != 0)
+    {
+        DC_ERROR_RAISE_USER(err, "settings segment belongs to another application", EINVAL);
+        dc_settings_segment_destroy(env, &segment);
+
+        return NULL;
+    }
+
+    segment->fd = fd;
+
+    return segment;
+}
+
+struct dc_settings_segment *dc_settings_segment_attach_from_environment(const struct dc_env *env,
+                                                                         struct dc_error *err,
+                                                                         const char *name)
+{
+    struct dc_settings_segment *segment;
+    const char *value;
+    int fd;
+
+    DC_TRACE(env);
+    value = dc_getenv(env, DC_SETTINGS_SEGMENT_ENV_VAR);
+
+    if(value == NULL || *value == '\0')
+    {
+        return NULL;
+    }
+
+    fd = 0;
+
+    for(const char *c = value; *c; c++)
+    {
+        if(*c < '0' || *c > '9' || fd > (INT16_MAX * 10))
+        {
+            DC_ERROR_RAISE_USER(err, DC_SETTINGS_SEGMENT_ENV_VAR " is not a file descriptor", EINVAL);
+
+            return NULL;
+        }
+
+        fd = (fd * 10) + (*c - '0');
+    }
+
+    segment = dc_settings_segment_attach(env, err, fd, name);
+
+    if(segment == NULL)
+    {
+        return NULL;
+    }
+
+    // the segment was handed to this process, the processes it starts resolve their own settings unless it exports it
+    dc_unsetenv(env, err, DC_SETTINGS_SEGMENT_ENV_VAR);
+
+    if(dc_error_has_no_error(err))
+    {
+        int flags;
+
+        flags = dc_fcntl(env, err, fd, F_GETFD);
+
+        if(dc_error_has_no_error(err))
+        {
+            dc_fcntl(env, err, fd, F_SETFD, flags | FD_CLOEXEC);
+        }
+    }
+
+    if(dc_error_has_error(err))
+    {
+        dc_settings_segment_destroy(env, &segment);
+    }
+
+    return segment;
+}
+
+void dc_settings_segment_destroy(const struct dc_env *env, struct dc_settings_segment **psegment)
+{
+    struct dc_settings_segment *segment;
+    struct dc_error err;
+
+    DC_TRACE(env);
+    segment = *psegment;
+    dc_error_init(&err, NULL);
+
+    if(segment->base)
+    {
+        dc_munmap(env, &err, segment->base, segment->size);
+    }
+
+    // an attached segment does not own the descriptor it was handed
+    if(segment->owner && segment->fd != -1)
+    {
+        dc_close(env, &err, segment->fd);
+    }
+
+    dc_error_reset(&err);
+    dc_free(env, segment);
+    *psegment = NULL;
+}
+
+int dc_settings_segment_export(const struct dc_env *env, struct dc_error *err, const struct dc_settings_segment *segment)
+{
+    char buffer[16];
+    int flags;
+
+    DC_TRACE(env);
+    flags = dc_fcntl(env, err, segment->fd, F_GETFD);
+
+    if(dc_error_has_no_error(err))
+    {
+        dc_fcntl(env, err, segment->fd, F_SETFD, flags & ~FD_CLOEXEC);
+    }
+
+    if(dc_error_has_no_error(err))
+    {
+        // NOLINTNEXTLINE(cert-err33-c)
+        snprintf(buffer, sizeof(buffer), "%d", segment->fd);
+        dc_setenv(env, err, DC_SETTINGS_SEGMENT_ENV_VAR, buffer, 1);
+    }
+
+    return dc_error_has_no_error(err) ? 0 : -1;
+}
+
+int dc_settings_segment_apply(const struct dc_env *env,
+                              struct dc_error *err,
+                              const struct dc_settings_segment *segment,
+                              struct dc_application_settings *settings)
+{
+    struct dc_opt_settings *opt_settings;
+    size_t count;
+
+    DC_TRACE(env);
+    opt_settings = (struct dc_opt_settings *)settings;
+    count = count_options(opt_settings);
+
+    for(size_t i = 0; i < count && dc_error_has_no_error(err); i++)
+    {
+        const struct options *opt;
+        struct dc_setting *setting;
+        const struct segment_entry *entry;
+        ssize_t index;
+        const void *value;
+        bool bool_value;
+        uint16_t uint16_value;
+        in_port_t in_port_t_value;
+        int32_t int32_value;
+        int64_t int64_value;
+        uint32_t uint32_value;
+        uint64_t uint64_value;
+        size_t size_t_value;
+        double double_value;
+        struct dc_list *list_value;
+
+        opt = &opt_settings->opts[i];
+        setting = dc_options_get_setting(env, opt_settings, opt);
+        index = dc_settings_segment_find(env, segment, opt->name);
+
+        if(index == -1)
+        {
+            continue;
+        }
+
+        entry = get_entry(segment, (size_t)index);
+
+        if(entry->type == DC_SETTING_NONE || entry->kind != (int32_t)setting->kind)
+        {
+            continue;
+        }
+
+        list_value = NULL;
+
+        switch((dc_setting_kind)entry->kind)
+        {
+            case DC_SETTING_KIND_STRING:
+            case DC_SETTING_KIND_REGEX:
+            case DC_SETTING_KIND_PATH:
+            case DC_SETTING_KIND_FD:
+            case DC_SETTING_KIND_DIRFD:
+            case DC_SETTING_KIND_CPUSET:
+            case DC_SETTING_KIND_NUMA_POLICY:
+            {
+                // each process opens its own descriptor from the path
+                value = get_string(segment, entry->value);
+                break;
+            }
+            case DC_SETTING_KIND_BOOL:
+            {
+                bool_value = entry->value != 0;
+                value = &bool_value;
+                break;
+            }
+            case DC_SETTING_KIND_UINT16:
+            {
+                uint16_value = (uint16_t)entry->value;
+                value = &uint16_value;
+                break;
+            }
+            case DC_SETTING_KIND_IN_PORT_T:
+            {
+                in_port_t_value = (in_port_t)entry->value;
+                value = &in_port_t_value;
+                break;
+            }
+            case DC_SETTING_KIND_INT32:
+            {
+                int32_value = (int32_t)entry->value;
+                value = &int32_value;
+                break;
+            }
+            case DC_SETTING_KIND_INT64:
+            {
+                int64_value = (int64_t)entry->value;
+                value = &int64_value;
+                break;
+            }
+            case DC_SETTING_KIND_UINT32:
+            {
+                uint32_value = (uint32_t)entry->value;
+                value = &uint32_value;
+                break;
+            }
+            case DC_SETTING_KIND_UINT64:
+            case DC_SETTING_KIND_BYTES:
+            case DC_SETTING_KIND_DURATION:
+            {
+                uint64_value = (uint64_t)entry->value;
+                value = &uint64_value;
+                break;
+            }
+            case DC_SETTING_KIND_SIZE_T:
+            {
+                size_t_value = (size_t)entry->value;
+                value = &size_t_value;
+                break;
+            }
+            case DC_SETTING_KIND_DOUBLE:
+            {
+                dc_memcpy(env, &double_value, &entry->value, sizeof(double_value));
+                value = &double_value;
+                break;
+            }
+            case DC_SETTING_KIND_LIST:
+            {
+                list_value = dc_list_load(env, err, get_string(segment, entry->value), entry->value_length);
+                value = list_value;
+                break;
+            }
+            default:
+            {
+                value = NULL;
+            }
+        }
+
+        if(value)
+        {
+            opt->setting_func(env, err, setting, value, (dc_setting_type)entry->type);
+        }
+
+        if(list_value)
+        {
+            dc_list_destroy(env, &list_value);
+        }
+    }
+
+    return dc_error_has_no_error(err) ? 0 : -1;
+}
+
+uint64_t dc_settings_segment_invalidate(const struct dc_env *env, struct dc_settings_segment *segment)
+{
+    struct segment_header *header;
+
+    DC_TRACE(env);
+
+    if(!(segment->owner))
+    {
+        return dc_settings_segment_get_generation(env, segment);
+    }
+
+    header = (struct segment_header *)segment->base;
+
+    return atomic_fetch_add_explicit(&header->generation, 1, memory_order_acq_rel) + 1;
+}
+
+uint64_t dc_settings_segment_get_generation(const struct dc_env *env, const struct dc_settings_segment *segment)
+{
+    struct segment_header *header;
+
+    DC_TRACE(env);
+    header = (struct segment_header *)segment->base;
+
+    return atomic_load_explicit(&header->generation, memory_order_acquire);
+}
+
+int dc_settings_segment_get_fd(const struct dc_env *env, const struct dc_settings_segment *segment)
+{
+    DC_TRACE(env);
+
+    return segment->fd;
+}
+
+size_t dc_settings_segment_get_count(const struct dc_env *env, const struct dc_settings_segment *segment)
+{
+    DC_TRACE(env);
+
+    return get_header(segment)->count;
+}
+
+ssize_t dc_settings_segment_find(const struct dc_env *env, const struct dc_settings_segment *segment, const char *name)
+{
+    const struct segment_header *header;
+
+    DC_TRACE(env);
+    header = get_header(segment);
+
+    for(size_t i = 0; i < header->count; i++)
+    {
+        if(dc_strcmp(env, get_string(segment, get_entry(segment, i)->name_offset), name) == 0)
+        {
+            return (ssize_t)i;
+        }
+    }
+
+    return -1;
+}
+
+const char *dc_settings_segment_get_name(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index)
+{
+    DC_TRACE(env);
+
+    return get_string(segment, get_entry(segment, index)->name_offset);
+}
+
+dc_setting_kind dc_settings_segment_get_kind(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index)
+{
+    DC_TRACE(env);
+
+    return (dc_setting_kind)get_entry(segment, index)->kind;
+}
+
+dc_setting_type dc_settings_segment_get_type(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index)
+{
+    DC_TRACE(env);
+
+    return (dc_setting_type)get_entry(segment, index)->type;
+}
+
+const char *dc_settings_segment_get_string(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index)
+{
+    const struct segment_entry *entry;
+
+    DC_TRACE(env);
+    entry = get_entry(segment, index);
+
+    if(entry->type == DC_SETTING_NONE || !(is_string_kind((dc_setting_kind)entry->kind)))
+    {
+        return NULL;
+    }
+
+    return get_string(segment, entry->value);
+}
+
+bool dc_settings_segment_get_bool(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index)
+{
+    DC_TRACE(env);
+
+    return get_scalar(segment, index, DC_SETTING_KIND_BOOL) != 0;
+}
+
+uint16_t dc_settings_segment_get_uint16(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index)
+{
+    DC_TRACE(env);
+
+    return (uint16_t)get_scalar(segment, index, DC_SETTING_KIND_UINT16);
+}
+
+in_port_t dc_settings_segment_get_in_port_t(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index)
+{
+    DC_TRACE(env);
+
+    return (in_port_t)get_scalar(segment, index, DC_SETTING_KIND_IN_PORT_T);
+}
+
+int32_t dc_settings_segment_get_int32(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index)
+{
+    DC_TRACE(env);
+
+    return (int32_t)get_scalar(segment, index, DC_SETTING_KIND_INT32);
+}
+
+int64_t dc_settings_segment_get_int64(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index)
+{
+    DC_TRACE(env);
+
+    return (int64_t)get_scalar(segment, index, DC_SETTING_KIND_INT64);
+}
+
+uint32_t dc_settings_segment_get_uint32(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index)
+{
+    DC_TRACE(env);
+
+    return (uint32_t)get_scalar(segment, index, DC_SETTING_KIND_UINT32);
+}
+
+uint64_t dc_settings_segment_get_uint64(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index)
+{
+    DC_TRACE(env);
+
+    return get_scalar(segment, index, DC_SETTING_KIND_UINT64);
+}
+
+size_t dc_settings_segment_get_size_t(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index)
+{
+    DC_TRACE(env);
+
+    return (size_t)get_scalar(segment, index, DC_SETTING_KIND_SIZE_T);
+}
+
+double dc_settings_segment_get_double(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index)
+{
+    uint64_t bits;
+    double value;
+
+    DC_TRACE(env);
+    bits = get_scalar(segment, index, DC_SETTING_KIND_DOUBLE);
+    dc_memcpy(env, &value, &bits, sizeof(value));
+
+    return value;
+}
+
+uint64_t dc_settings_segment_get_bytes(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index)
+{
+    DC_TRACE(env);
+
+    return get_scalar(segment, index, DC_SETTING_KIND_BYTES);
+}
+
+uint64_t dc_settings_segment_get_duration(const struct dc_env *env, const struct dc_settings_segment *segment, size_t index)
+{
+    DC_TRACE(env);
+
+    return get_scalar(segment, index, DC_SETTING_KIND_DURATION);
+}
+
+struct dc_list *dc_settings_segment_get_list(const struct dc_env *env,
+                                             struct dc_error *err,
+                                             const struct dc_settings_segment *segment,
+                                             size_t index)
+{
+    const struct segment_entry *entry;
+
+    DC_TRACE(env);
+    entry = get_entry(segment, index);
+
+    if(entry->type == DC_SETTING_NONE || entry->kind != DC_SETTING_KIND_LIST)
+    {
+        return NULL;
+    }
+
+    return dc_list_load(env, err, get_string(segment, entry->value), entry->value_length);
+}
+
+static size_t count_options(const struct dc_opt_settings *opt_settings)
+{
+    size_t count;
+
+    count = 0;
+
+    while(opt_settings->opts[count].name != NULL)
+    {
+        count++;
+    }
+
+    return count;
+}
+
+static bool is_string_kind(dc_setting_kind kind)
+{
+    return kind == DC_SETTING_KIND_STRING || kind == DC_SETTING_KIND_REGEX || kind == DC_SETTING_KIND_PATH ||
+           kind == DC_SETTING_KIND_FD || kind == DC_SETTING_KIND_DIRFD || kind == DC_SETTING_KIND_CPUSET ||
+           kind == DC_SETTING_KIND_NUMA_POLICY;
+}
+
+static const char *setting_string_value(const struct dc_env *env, struct dc_setting *setting)
+{
+    const char *value;
+
+    switch(setting->kind)
+    {
+        case DC_SETTING_KIND_STRING:
+        {
+            value = dc_setting_string_get(env, (struct dc_setting_string *)setting);
+            break;
+        }
+        case DC_SETTING_KIND_REGEX:
+        {
+            value = dc_setting_regex_get(env, (struct dc_setting_regex *)setting);
+            break;
+        }
+        case DC_SETTING_KIND_PATH:
+        {
+            value = dc_setting_path_get(env, (struct dc_setting_path *)setting);
+            break;
+        }
+        case DC_SETTING_KIND_FD:
+        {
+            value = dc_setting_fd_get_path(env, (struct dc_setting_fd *)setting);
+            break;
+        }
+        case DC_SETTING_KIND_DIRFD:
+        {
+            value = dc_setting_dirfd_get_path(env, (struct dc_setting_dirfd *)setting);
+            break;
+        }
+        case DC_SETTING_KIND_CPUSET:
+        {
+            value = dc_setting_cpuset_get(env, (struct dc_setting_cpuset *)setting);
+            break;
+        }
+        case DC_SETTING_KIND_NUMA_POLICY:
+        {
+            value = dc_setting_numa_policy_get(env, (struct dc_setting_numa_policy *)setting);
+            break;
+        }
+        case DC_SETTING_KIND_BOOL:
+        case DC_SETTING_KIND_UINT16:
+        case DC_SETTING_KIND_IN_PORT_T:
+        case DC_SETTING_KIND_INT32:
+        case DC_SETTING_KIND_INT64:
+        case DC_SETTING_KIND_UINT32:
+        case DC_SETTING_KIND_UINT64:
+        case DC_SETTING_KIND_SIZE_T:
+        case DC_SETTING_KIND_DOUBLE:
+        case DC_SETTING_KIND_BYTES:
+        case DC_SETTING_KIND_DURATION:
+        case DC_SETTING_KIND_LIST:
+        default:
+        {
+            value = NULL;
+        }
+    }
+
+    return value;
+}
+
+static uint64_t setting_scalar_value(const struct dc_env *env, struct dc_setting *setting)
+{
+    uint64_t value;
+
+    switch(setting->kind)
+    {
+        case DC_SETTING_KIND_BOOL:
+        {
+            value = dc_setting_bool_get(env, (struct dc_setting_bool *)setting);
+            break;
+        }
+        case DC_SETTING_KIND_UINT16:
+        {
+            value = dc_setting_uint16_get(env, (struct dc_setting_uint16 *)setting);
+            break;
+        }
+        case DC_SETTING_KIND_IN_PORT_T:
+        {
+            value = dc_setting_in_port_t_get(env, (struct dc_setting_in_port_t *)setting);
+            break;
+        }
+        case DC_SETTING_KIND_INT32:
+        {
+            value = (uint64_t)dc_setting_int32_get(env, (struct dc_setting_int32 *)setting);
+            break;
+        }
+        case DC_SETTING_KIND_INT64:
+        {
+            value = (uint64_t)dc_setting_int64_get(env, (struct dc_setting_int64 *)setting);
+            break;
+        }
+        case DC_SETTING_KIND_UINT32:
+        {
+            value = (uint64_t)dc_setting_uint32_get(env, (struct dc_setting_uint32 *)setting);
+            break;
+        }
+        case DC_SETTING_KIND_UINT64:
+        {
+            value = (uint64_t)dc_setting_uint64_get(env, (struct dc_setting_uint64 *)setting);
+            break;
+        }
+        case DC_SETTING_KIND_BYTES:
+        {
+            value = dc_setting_bytes_get(env, (struct dc_setting_bytes *)setting);
+            break;
+        }
+        case DC_SETTING_KIND_DURATION:
+        {
+            value = dc_setting_duration_get(env, (struct dc_setting_duration *)setting);
+            break;
+        }
+        case DC_SETTING_KIND_SIZE_T:
+        {
+            value = (uint64_t)dc_setting_size_t_get(env, (struct dc_setting_size_t *)setting);
+            break;
+        }
+        case DC_SETTING_KIND_DOUBLE:
+        {
+            double real;
+
+            // stored as its bit pattern so that it survives the trip through the segment exactly
+            real = dc_setting_double_get(env, (struct dc_setting_double *)setting);
+            dc_memcpy(env, &value, &real, sizeof(real));
+            break;
+        }
+        case DC_SETTING_KIND_STRING:
+        case DC_SETTING_KIND_REGEX:
+        case DC_SETTING_KIND_PATH:
+        case DC_SETTING_KIND_FD:
+        case DC_SETTING_KIND_DIRFD:
+        case DC_SETTING_KIND_LIST:
+        case DC_SETTING_KIND_CPUSET:
+        case DC_SETTING_KIND_NUMA_POLICY:
+        default:
+        {
+            value = 0;
+        }
+    }
+
+    return value;
+}
+
+static const struct segment_header *get_header(const struct dc_settings_segment *segment)
+{
+    return (const struct segment_header *)segment->base;
+}
+
+static const struct segment_entry *get_entry(const struct dc_settings_segment *segment, size_t index)
+{
+    return &((const struct segment_entry *)(segment->base + get_header(segment)->entries_offset))[index];
+}
+
+static const char *get_string(const struct dc_settings_segment *segment, uint64_t offset)
+{
+    return (const char *)(segment->base + get_header(segment)->strings_offset + offset);
+}
+
+// a slot that holds another kind, or was never set, reads as 0 rather than as the bits of some other value
+static uint64_t get_scalar(const struct dc_settings_segment *segment, size_t index, dc_setting_kind kind)
+{
+    const struct segment_entry *entry;
+
+    entry = get_entry(segment, index);
+
+    if(entry->type == DC_SETTING_NONE || entry->kind != (int32_t)kind)
+    {
+        return 0;
+    }
+
+    return entry->value;
+}
+
+static bool validate(const struct dc_settings_segment *segment)
+{
+    const struct segment_header *header;
+    const char *strings;
+
+    header = get_header(segment);
+
+    if(header->magic != SEGMENT_MAGIC || header->version != SEGMENT_VERSION || header->size != segment->size ||
+       header->name[DC_SETTINGS_SEGMENT_NAME_SIZE - 1] != '\0')
+    {
+        return false;
+    }
+
+    if(header->entries_offset != sizeof(struct segment_header) ||
+       header->strings_offset != header->entries_offset + (header->count * sizeof(struct segment_entry)) ||
+       (uint64_t)header->strings_offset + header->strings_size != header->size)
+    {
+        return false;
+    }
+
+    // a segment without settings has no names, so it has no strings either
+    if(header->strings_size == 0)
+    {
+        return header->count == 0;
+    }
+
+    // every string must be NUL terminated inside the segment so that readers can never run off the end
+    strings = get_string(segment, 0);
+
+    if(strings[header->strings_size - 1] != '\0')
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i < header->count; i++)
+    {
+        const struct segment_entry *entry;
+
+        entry = get_entry(segment, i);
+
+        if(entry->name_offset >= header->strings_size)
+        {
+            return false;
+        }
+
+        if(entry->type != DC_SETTING_NONE &&
+           (is_string_kind((dc_setting_kind)entry->kind) || entry->kind == DC_SETTING_KIND_LIST) &&
+           (entry->value >= header->strings_size || entry->value_length >= header->strings_size - entry->value ||
+            strings[entry->value + entry->value_length] != '\0'))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -16,50 +16,289 @@
 
 
 #include "dc_application/settings.h"
+#include "dc_application/matcher.h"
+#include "dc_application/parse.h"
 #include <dc_c/dc_stdlib.h>
 #include <dc_c/dc_string.h>
-#include <dc_posix/dc_regex.h>
+#include <dc_posix/dc_fcntl.h>
+#include <dc_posix/dc_unistd.h>
 #include <dc_util/path.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
 
 
+/*
+ * Values that can be changed after startup (reload, runtime overrides) are published with atomic stores so that
+ * readers on other threads never see a torn value. Replaced strings are retired rather than freed since a reader may
+ * still be holding the old pointer.
+ *
+ * String values are interned: settings holding equal strings share one reference counted buffer, so two values can be
+ * compared by pointer. A replaced value is retired with the generation that replaced it and its reference is dropped
+ * along with the snapshots that were published while it was current.
+ *
+ * Every committed transaction also publishes an immutable snapshot holding the value of every setting, indexed by the
+ * slot each setting is given when it is created. The slot of a destroyed setting is given to the next one created, a
+ * snapshot published before that still holds the old value so the new setting only reads snapshots that are newer than
+ * its registration. A snapshot covers the slots up to the highest one in use, not every slot ever handed out. A thread
+ * that calls dc_settings_quiesce caches the current snapshot and its generation in thread local storage and the getters
+ * read the snapshot with plain loads. Replaced snapshots are freed once every registered reader has announced a
+ * generation at least as new as the one that replaced them (epoch based reclamation).
+ */
+
 struct dc_setting_string
 {
     struct dc_setting parent;
-    char *string;
+    const char *_Atomic string;
 };
 
 struct dc_setting_regex
 {
     struct dc_setting parent;
     const char *pattern;
-    regex_t regex;
-    char *string;
+    struct dc_matcher *matcher;
+    const char *_Atomic string;
 };
 
 struct dc_setting_path
 {
     struct dc_setting parent;
-    char *path;
+    const char *_Atomic path;
+};
+
+struct dc_setting_fd
+{
+    struct dc_setting parent;
+    int flags;
+    const char *_Atomic path;
+    _Atomic int fd;
+};
+
+// the same representation, opened with O_DIRECTORY
+struct dc_setting_dirfd
+{
+    struct dc_setting_fd fd;
 };
 
 struct dc_setting_bool
 {
     struct dc_setting parent;
-    bool value;
+    _Atomic bool value;
 };
 
 struct dc_setting_uint16
 {
     struct dc_setting parent;
-    uint16_t value;
+    _Atomic uint16_t value;
 };
 
 struct dc_setting_in_port_t
 {
     struct dc_setting parent;
-    in_port_t value;
+    _Atomic in_port_t value;
+};
+
+struct dc_setting_int32
+{
+    struct dc_setting parent;
+    _Atomic int32_t value;
+};
+
+struct dc_setting_int64
+{
+    struct dc_setting parent;
+    _Atomic int64_t value;
+};
+
+struct dc_setting_uint32
+{
+    struct dc_setting parent;
+    _Atomic uint32_t value;
+};
+
+struct dc_setting_uint64
+{
+    struct dc_setting parent;
+    _Atomic uint64_t value;
+};
+
+struct dc_setting_size_t
+{
+    struct dc_setting parent;
+    _Atomic size_t value;
+};
+
+struct dc_setting_double
+{
+    struct dc_setting parent;
+    _Atomic double value;
+};
+
+struct dc_setting_bytes
+{
+    struct dc_setting parent;
+    _Atomic uint64_t value;
+};
+
+struct dc_setting_duration
+{
+    struct dc_setting parent;
+    _Atomic uint64_t value;
+};
+
+struct dc_setting_list
+{
+    struct dc_setting parent;
+    dc_list_element element;
+    struct dc_list *_Atomic list;
+};
+
+// the value is kept as the formatted set, so equal sets written differently are the same interned string
+struct dc_setting_cpuset
+{
+    struct dc_setting parent;
+    const char *_Atomic string;
+};
+
+struct dc_setting_numa_policy
+{
+    struct dc_setting parent;
+    const char *_Atomic string;
+};
+
+struct interned_string
+{
+    struct interned_string *next;
+    size_t hash;
+    size_t references;
+    char text[];
+};
+
+// any of string, list and fd can be set
+struct retired_value
+{
+    struct retired_value *next;
+    uint64_t retired_at;
+    const char *string;
+    struct dc_list *list;
+    int fd;
+};
+
+union value
+{
+    const char *string;
+    bool flag;
+    uint16_t uint16;
+    in_port_t in_port_t;
+    int32_t int32;
+    int64_t int64;
+    uint32_t uint32;
+    uint64_t uint64;
+    size_t size;
+    double real;
+    const struct dc_list *list;
+    int fd;
+};
+
+struct snapshot
+{
+    struct snapshot *next_retired;
+    uint64_t generation;
+    uint64_t retired_at;
+    size_t count;
+    union value values[];
+};
+
+struct reader
+{
+    struct reader *next;
+    _Atomic uint64_t generation;
+    bool active;
+};
+
+struct dc_setting_subscription
+{
+    struct dc_setting_subscription *next;
+    struct dc_setting *setting;
+    dc_setting_callback callback;
+    void *ctx;
+    struct dc_settings_notifier *notifier;
+};
+
+/*
+ * The settings a subscriber has to be told about. A batch is built for each subscriber (callback and ctx) when a
+ * transaction commits, and batches waiting in a notifier are merged so the subscriber sees each setting once.
+ */
+struct notification
+{
+    struct notification *next;
+    dc_setting_callback callback;
+    void *ctx;
+    struct dc_settings_notifier *notifier;
+    struct dc_setting **settings;
+    size_t count;
+    size_t capacity;
 };
 
+struct dc_settings_notifier
+{
+    pthread_mutex_t lock;
+    struct notification *pending;
+    int fds[2];
+};
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables)
+static pthread_mutex_t update_lock = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic uint64_t generation = 0;
+static struct retired_value *retired_values = NULL;
+static struct dc_setting_subscription *subscriptions = NULL;
+static struct dc_setting **changed_settings = NULL;
+static size_t changed_count = 0;
+static size_t changed_capacity = 0;
+static struct dc_setting **registered_settings = NULL;
+static size_t registered_count = 0;
+static size_t registered_capacity = 0;
+static size_t unregistered_count = 0;
+static struct snapshot *_Atomic current_snapshot = NULL;
+static struct snapshot *retired_snapshots = NULL;
+static struct reader *readers = NULL;
+static pthread_once_t reader_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t reader_key;
+static _Thread_local struct reader *local_reader = NULL;
+static _Thread_local const struct snapshot *local_snapshot = NULL;
+static _Thread_local uint64_t local_generation = 0;
+static pthread_mutex_t intern_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct interned_string **intern_buckets = NULL;
+static size_t intern_bucket_count = 0;
+static size_t interned_count = 0;
+// NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables)
+
+static bool grow_intern_buckets(const struct dc_env *env, struct dc_error *err);
+static size_t hash_string(const char *string);
+static bool create_fd(const struct dc_env *env, struct dc_error *err, struct dc_setting_fd *setting, dc_setting_kind kind, int flags);
+static void destroy_fd(const struct dc_env *env, struct dc_setting_fd *setting);
+static bool open_path(const struct dc_env *env, struct dc_error *err, int flags, const char *value, const char **ppath, int *pfd);
+static bool set_fd(const struct dc_env *env, struct dc_error *err, struct dc_setting_fd *setting, const char *value, dc_setting_type type);
+static int get_fd(struct dc_setting_fd *setting);
+static const char *intern_canonical(const struct dc_env *env, struct dc_error *err, dc_setting_kind kind, const char *value);
+static void retire_value(const struct dc_env *env, struct dc_error *err, const char *string, struct dc_list *list, int fd);
+static void release_retired(const struct dc_env *env, struct retired_value *retired);
+static bool add_setting(const struct dc_env *env, struct dc_error *err, struct dc_setting ***psettings, size_t *count, size_t *capacity, struct dc_setting *setting);
+static struct notification *build_notifications(const struct dc_env *env, struct dc_error *err);
+static void deliver_notifications(const struct dc_env *env, struct dc_error *err, struct notification *notifications);
+static void queue_notification(const struct dc_env *env, struct dc_error *err, struct notification *notification);
+static void free_notification(const struct dc_env *env, struct notification *notification);
+static bool register_setting(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting);
+static void unregister_setting(struct dc_setting *setting);
+static union value read_value(const struct dc_env *env, struct dc_setting *setting);
+static void publish_snapshot(const struct dc_env *env, struct dc_error *err, uint64_t current);
+static void collect_snapshots(const struct dc_env *env);
+static void create_reader_key(void);
+static void remove_reader(void *arg);
+static inline const union value *cached_value(const struct dc_setting *setting);
+
 bool dc_setting_is_set(const struct dc_env *env, struct dc_setting *setting)
 {
     DC_TRACE(env);
@@ -67,382 +306,2952 @@ bool dc_setting_is_set(const struct dc_env *env, struct dc_setting *setting)
     return setting->type != DC_SETTING_NONE;
 }
 
-struct dc_setting_path *dc_setting_path_create(const struct dc_env *env, struct dc_error *err)
+dc_setting_kind dc_setting_get_kind(const struct dc_env *env, const struct dc_setting *setting)
 {
-    struct dc_setting_path *setting;
+    DC_TRACE(env);
+
+    return setting->kind;
+}
 
+void dc_settings_transaction_begin(const struct dc_env *env)
+{
     DC_TRACE(env);
-    setting = dc_malloc(env, err, sizeof(struct dc_setting_path));
+    pthread_mutex_lock(&update_lock);
+    changed_count = 0;
+}
 
-    if(dc_error_has_no_error(err))
+uint64_t dc_settings_transaction_commit(const struct dc_env *env, struct dc_error *err)
+{
+    struct notification *notifications;
+    uint64_t current;
+
+    DC_TRACE(env);
+    // the snapshot has to be visible before the generation that announces it
+    current = atomic_load_explicit(&generation, memory_order_relaxed) + 1;
+    publish_snapshot(env, err, current);
+
+    if(dc_error_has_error(err))
     {
-        setting->parent.type = DC_SETTING_NONE;
-        setting->path = NULL;
+        // readers stay on the previous snapshot, the replaced values go out with the next commit that publishes
+        changed_count = 0;
+        pthread_mutex_unlock(&update_lock);
+
+        return current - 1;
     }
 
-    return setting;
+    atomic_store_explicit(&generation, current, memory_order_seq_cst);
+
+    // the values replaced in this transaction are in every snapshot retired by it and nothing newer
+    for(struct retired_value *retired = retired_values; retired && retired->retired_at == 0; retired = retired->next)
+    {
+        retired->retired_at = current;
+    }
+
+    collect_snapshots(env);
+    notifications = build_notifications(env, err);
+    changed_count = 0;
+    pthread_mutex_unlock(&update_lock);
+
+    // the callbacks run without the lock held so that they can read settings or start a transaction of their own
+    deliver_notifications(env, err, notifications);
+
+    return current;
 }
 
-void dc_setting_path_destroy(const struct dc_env *env, struct dc_setting_path **psetting)
+uint64_t dc_settings_publish(const struct dc_env *env, struct dc_error *err)
 {
-    struct dc_setting_path *setting;
+    DC_TRACE(env);
+    dc_settings_transaction_begin(env);
+
+    return dc_settings_transaction_commit(env, err);
+}
+
+void dc_settings_quiesce(const struct dc_env *env, struct dc_error *err)
+{
+    uint64_t current;
 
     DC_TRACE(env);
-    setting = *psetting;
 
-    if(setting->path)
+    if(local_reader == NULL)
+    {
+        struct reader *reader;
+
+        pthread_once(&reader_key_once, create_reader_key);
+        pthread_mutex_lock(&update_lock);
+
+        // reuse the record of a thread that has exited
+        for(reader = readers; reader && reader->active; reader = reader->next)
+        {
+        }
+
+        if(reader == NULL)
+        {
+            reader = dc_malloc(env, err, sizeof(struct reader));
+
+            if(dc_error_has_no_error(err))
+            {
+                reader->next = readers;
+                readers = reader;
+            }
+        }
+
+        if(reader)
+        {
+            reader->active = true;
+            atomic_store_explicit(&reader->generation, 0, memory_order_seq_cst);
+        }
+
+        pthread_mutex_unlock(&update_lock);
+
+        if(reader == NULL)
+        {
+            return;
+        }
+
+        pthread_setspecific(reader_key, reader);
+        local_reader = reader;
+        local_generation = 0;
+    }
+
+    current = atomic_load_explicit(&generation, memory_order_seq_cst);
+
+    if(current != local_generation || local_snapshot == NULL)
     {
-        dc_free(env, setting->path);
+        // announce the generation before loading the snapshot so the writer can not free what is about to be read
+        atomic_store_explicit(&local_reader->generation, current, memory_order_seq_cst);
+        local_snapshot = atomic_load_explicit(&current_snapshot, memory_order_seq_cst);
+        local_generation = current;
     }
+}
 
-    dc_free(env, *psetting);
-    *psetting = NULL;
+void dc_settings_offline(const struct dc_env *env)
+{
+    DC_TRACE(env);
+
+    if(local_reader)
+    {
+        local_snapshot = NULL;
+        atomic_store_explicit(&local_reader->generation, UINT64_MAX, memory_order_seq_cst);
+    }
 }
 
-bool dc_setting_path_set(const struct dc_env *env,
-                         struct dc_error *err,
-                         struct dc_setting_path *setting,
-                         const char *value,
-                         dc_setting_type type)
+uint64_t dc_settings_get_generation(const struct dc_env *env)
 {
-    bool ret_val;
+    DC_TRACE(env);
+
+    return atomic_load_explicit(&generation, memory_order_acquire);
+}
+
+bool dc_setting_update(const struct dc_env *env,
+                       struct dc_error *err,
+                       struct dc_setting *setting,
+                       const void *value,
+                       dc_setting_type type)
+{
+    const char *string;
+    const char *previous;
+    struct dc_list *previous_list;
+    int previous_fd;
+    bool unchanged;
 
     DC_TRACE(env);
-    ret_val = false;
 
-    if(setting->parent.type == DC_SETTING_NONE)
+    if(value == NULL)
     {
-        if(value)
+        return false;
+    }
+
+    string = NULL;
+    previous = NULL;
+    previous_list = NULL;
+    previous_fd = -1;
+
+    switch(setting->kind)
+    {
+        case DC_SETTING_KIND_STRING:
+        {
+            string = dc_settings_intern(env, err, value);
+
+            if(dc_error_has_no_error(err))
+            {
+                previous = atomic_exchange_explicit(&((struct dc_setting_string *)setting)->string, string, memory_order_acq_rel);
+            }
+
+            break;
+        }
+        case DC_SETTING_KIND_REGEX:
+        {
+            struct dc_setting_regex *regex_setting;
+
+            regex_setting = (struct dc_setting_regex *)setting;
+
+            if(!(dc_matcher_match(env, regex_setting->matcher, value)))
+            {
+                DC_ERROR_RAISE_USER(err, "value does not match the setting pattern", EINVAL);
+                break;
+            }
+
+            string = dc_settings_intern(env, err, value);
+
+            if(dc_error_has_no_error(err))
+            {
+                previous = atomic_exchange_explicit(&regex_setting->string, string, memory_order_acq_rel);
+            }
+
+            break;
+        }
+        case DC_SETTING_KIND_PATH:
+        {
+            char *path;
+
+            path = NULL;
+            dc_expand_path(env, err, &path, value);
+
+            if(dc_error_has_no_error(err))
+            {
+                string = dc_settings_intern(env, err, path);
+                dc_free(env, path);
+            }
+
+            if(dc_error_has_no_error(err))
+            {
+                previous = atomic_exchange_explicit(&((struct dc_setting_path *)setting)->path, string, memory_order_acq_rel);
+            }
+
+            break;
+        }
+        case DC_SETTING_KIND_FD:
+        case DC_SETTING_KIND_DIRFD:
+        {
+            struct dc_setting_fd *fd_setting;
+            int fd;
+
+            // reopened even when the path is the same, the file it names may have been replaced
+            fd_setting = (struct dc_setting_fd *)setting;
+
+            if(open_path(env, err, fd_setting->flags, value, &string, &fd))
+            {
+                previous = atomic_exchange_explicit(&fd_setting->path, string, memory_order_acq_rel);
+                previous_fd = atomic_exchange_explicit(&fd_setting->fd, fd, memory_order_acq_rel);
+            }
+
+            break;
+        }
+        case DC_SETTING_KIND_BOOL:
+        {
+            atomic_store_explicit(&((struct dc_setting_bool *)setting)->value, *(const bool *)value, memory_order_release);
+            break;
+        }
+        case DC_SETTING_KIND_UINT16:
+        {
+            atomic_store_explicit(&((struct dc_setting_uint16 *)setting)->value, *(const uint16_t *)value, memory_order_release);
+            break;
+        }
+        case DC_SETTING_KIND_IN_PORT_T:
+        {
+            atomic_store_explicit(&((struct dc_setting_in_port_t *)setting)->value, *(const in_port_t *)value, memory_order_release);
+            break;
+        }
+        case DC_SETTING_KIND_INT32:
+        {
+            atomic_store_explicit(&((struct dc_setting_int32 *)setting)->value, *(const int32_t *)value, memory_order_release);
+            break;
+        }
+        case DC_SETTING_KIND_INT64:
+        {
+            atomic_store_explicit(&((struct dc_setting_int64 *)setting)->value, *(const int64_t *)value, memory_order_release);
+            break;
+        }
+        case DC_SETTING_KIND_UINT32:
+        {
+            atomic_store_explicit(&((struct dc_setting_uint32 *)setting)->value, *(const uint32_t *)value, memory_order_release);
+            break;
+        }
+        case DC_SETTING_KIND_UINT64:
+        {
+            atomic_store_explicit(&((struct dc_setting_uint64 *)setting)->value, *(const uint64_t *)value, memory_order_release);
+            break;
+        }
+        case DC_SETTING_KIND_SIZE_T:
+        {
+            atomic_store_explicit(&((struct dc_setting_size_t *)setting)->value, *(const size_t *)value, memory_order_release);
+            break;
+        }
+        case DC_SETTING_KIND_DOUBLE:
+        {
+            atomic_store_explicit(&((struct dc_setting_double *)setting)->value, *(const double *)value, memory_order_release);
+            break;
+        }
+        case DC_SETTING_KIND_BYTES:
+        {
+            atomic_store_explicit(&((struct dc_setting_bytes *)setting)->value, *(const uint64_t *)value, memory_order_release);
+            break;
+        }
+        case DC_SETTING_KIND_DURATION:
+        {
+            atomic_store_explicit(&((struct dc_setting_duration *)setting)->value, *(const uint64_t *)value, memory_order_release);
+            break;
+        }
+        case DC_SETTING_KIND_LIST:
+        {
+            struct dc_setting_list *list_setting;
+            struct dc_list *list;
+
+            list_setting = (struct dc_setting_list *)setting;
+
+            if(dc_list_get_element(env, value) != list_setting->element)
+            {
+                DC_ERROR_RAISE_USER(err, "list elements are the wrong kind for the setting", EINVAL);
+                break;
+            }
+
+            list = dc_list_copy(env, err, value);
+
+            if(dc_error_has_no_error(err))
+            {
+                previous_list = atomic_exchange_explicit(&list_setting->list, list, memory_order_acq_rel);
+            }
+
+            break;
+        }
+        case DC_SETTING_KIND_CPUSET:
+        {
+            string = intern_canonical(env, err, setting->kind, value);
+
+            if(dc_error_has_no_error(err))
+            {
+                previous = atomic_exchange_explicit(&((struct dc_setting_cpuset *)setting)->string, string, memory_order_acq_rel);
+            }
+
+            break;
+        }
+        case DC_SETTING_KIND_NUMA_POLICY:
+        {
+            string = intern_canonical(env, err, setting->kind, value);
+
+            if(dc_error_has_no_error(err))
+            {
+                previous = atomic_exchange_explicit(&((struct dc_setting_numa_policy *)setting)->string, string, memory_order_acq_rel);
+            }
+
+            break;
+        }
+        default:
         {
-            dc_expand_path(env, err, &setting->path, value);
+            DC_ERROR_RAISE_USER(err, "unknown setting kind", EINVAL);
+        }
+    }
+
+    if(dc_error_has_error(err))
+    {
+        return false;
+    }
+
+    unchanged = false;
+
+    // the same interned string, the setting already holds a reference to it
+    if(string && previous == string)
+    {
+        dc_settings_intern_release(env, string);
+        previous = NULL;
+        unchanged = previous_fd == -1;
+    }
+
+    if(previous || previous_list || previous_fd != -1)
+    {
+        retire_value(env, err, previous, previous_list, previous_fd);
+    }
+
+    if(unchanged && setting->type == type)
+    {
+        return true;
+    }
+
+    setting->type = type;
+
+    if(subscriptions)
+    {
+        add_setting(env, err, &changed_settings, &changed_count, &changed_capacity, setting);
+    }
+
+    return true;
+}
+
+struct dc_setting_subscription *dc_setting_subscribe(const struct dc_env *env,
+                                                     struct dc_error *err,
+                                                     struct dc_setting *setting,
+                                                     dc_setting_callback callback,
+                                                     void *ctx)
+{
+    DC_TRACE(env);
+
+    return dc_setting_subscribe_on(env, err, setting, callback, ctx, NULL);
+}
+
+struct dc_setting_subscription *dc_setting_subscribe_on(const struct dc_env *env,
+                                                        struct dc_error *err,
+                                                        struct dc_setting *setting,
+                                                        dc_setting_callback callback,
+                                                        void *ctx,
+                                                        struct dc_settings_notifier *notifier)
+{
+    struct dc_setting_subscription *subscription;
+
+    DC_TRACE(env);
+    subscription = dc_malloc(env, err, sizeof(struct dc_setting_subscription));
+
+    if(dc_error_has_no_error(err))
+    {
+        subscription->setting = setting;
+        subscription->callback = callback;
+        subscription->ctx = ctx;
+        subscription->notifier = notifier;
+        pthread_mutex_lock(&update_lock);
+        subscription->next = subscriptions;
+        subscriptions = subscription;
+        pthread_mutex_unlock(&update_lock);
+    }
+
+    return subscription;
+}
+
+void dc_setting_unsubscribe(const struct dc_env *env, struct dc_setting_subscription **psubscription)
+{
+    struct dc_setting_subscription **link;
+
+    DC_TRACE(env);
+    pthread_mutex_lock(&update_lock);
+
+    for(link = &subscriptions; *link; link = &(*link)->next)
+    {
+        if(*link == *psubscription)
+        {
+            *link = (*psubscription)->next;
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&update_lock);
+    dc_free(env, *psubscription);
+    *psubscription = NULL;
+}
+
+struct dc_settings_notifier *dc_settings_notifier_create(const struct dc_env *env, struct dc_error *err)
+{
+    struct dc_settings_notifier *notifier;
+
+    DC_TRACE(env);
+    notifier = dc_calloc(env, err, 1, sizeof(struct dc_settings_notifier));
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    dc_pipe(env, err, notifier->fds);
+
+    if(dc_error_has_no_error(err))
+    {
+        // wakeups are only a hint, a full pipe or an empty read must never block either side
+        for(size_t i = 0; i < 2 && dc_error_has_no_error(err); i++)
+        {
+            dc_fcntl(env, err, notifier->fds[i], F_SETFL, O_NONBLOCK);
+            dc_fcntl(env, err, notifier->fds[i], F_SETFD, FD_CLOEXEC);
+        }
+
+        if(dc_error_has_error(err))
+        {
+            struct dc_error close_err;
+
+            dc_error_init(&close_err, NULL);
+            dc_close(env, &close_err, notifier->fds[0]);
+            dc_close(env, &close_err, notifier->fds[1]);
+            dc_error_reset(&close_err);
+        }
+    }
+
+    if(dc_error_has_error(err))
+    {
+        dc_free(env, notifier);
+
+        return NULL;
+    }
+
+    pthread_mutex_init(&notifier->lock, NULL);
+
+    return notifier;
+}
+
+void dc_settings_notifier_destroy(const struct dc_env *env, struct dc_settings_notifier **pnotifier)
+{
+    struct dc_settings_notifier *notifier;
+    struct dc_error err;
+
+    DC_TRACE(env);
+    notifier = *pnotifier;
+
+    while(notifier->pending)
+    {
+        struct notification *next;
+
+        next = notifier->pending->next;
+        free_notification(env, notifier->pending);
+        notifier->pending = next;
+    }
+
+    dc_error_init(&err, NULL);
+    dc_close(env, &err, notifier->fds[0]);
+    dc_close(env, &err, notifier->fds[1]);
+    dc_error_reset(&err);
+    pthread_mutex_destroy(&notifier->lock);
+    dc_free(env, notifier);
+    *pnotifier = NULL;
+}
+
+int dc_settings_notifier_get_fd(const struct dc_env *env, const struct dc_settings_notifier *notifier)
+{
+    DC_TRACE(env);
+
+    return notifier->fds[0];
+}
+
+size_t dc_settings_notifier_dispatch(const struct dc_env *env, struct dc_settings_notifier *notifier)
+{
+    struct notification *pending;
+    struct dc_error err;
+    char drain[64];
+    size_t count;
+
+    DC_TRACE(env);
+    pthread_mutex_lock(&notifier->lock);
+    pending = notifier->pending;
+    notifier->pending = NULL;
+    pthread_mutex_unlock(&notifier->lock);
+
+    // drained after taking the list so a wakeup for a later notification is never lost
+    dc_error_init(&err, NULL);
+
+    while(dc_read(env, &err, notifier->fds[0], drain, sizeof(drain)) > 0)
+    {
+    }
+
+    dc_error_reset(&err);
+    count = 0;
+
+    while(pending)
+    {
+        struct notification *next;
+
+        next = pending->next;
+        pending->callback(env, pending->settings, pending->count, pending->ctx);
+        free_notification(env, pending);
+        pending = next;
+        count++;
+    }
+
+    return count;
+}
+
+int dc_setting_format(const struct dc_env *env, struct dc_setting *setting, char *buffer, size_t size)
+{
+    int length;
+
+    DC_TRACE(env);
+
+    switch(setting->kind)
+    {
+        case DC_SETTING_KIND_STRING:
+        case DC_SETTING_KIND_REGEX:
+        case DC_SETTING_KIND_PATH:
+        case DC_SETTING_KIND_CPUSET:
+        case DC_SETTING_KIND_NUMA_POLICY:
+        {
+            const char *value;
+
+            if(setting->kind == DC_SETTING_KIND_STRING)
+            {
+                value = dc_setting_string_get(env, (struct dc_setting_string *)setting);
+            }
+            else if(setting->kind == DC_SETTING_KIND_REGEX)
+            {
+                value = dc_setting_regex_get(env, (struct dc_setting_regex *)setting);
+            }
+            else if(setting->kind == DC_SETTING_KIND_CPUSET)
+            {
+                value = dc_setting_cpuset_get(env, (struct dc_setting_cpuset *)setting);
+            }
+            else if(setting->kind == DC_SETTING_KIND_NUMA_POLICY)
+            {
+                value = dc_setting_numa_policy_get(env, (struct dc_setting_numa_policy *)setting);
+            }
+            else
+            {
+                value = dc_setting_path_get(env, (struct dc_setting_path *)setting);
+            }
+
+            length = snprintf(buffer, size, "%s", value ? value : "");
+            break;
+        }
+        case DC_SETTING_KIND_FD:
+        case DC_SETTING_KIND_DIRFD:
+        {
+            const char *path;
+
+            path = atomic_load_explicit(&((struct dc_setting_fd *)setting)->path, memory_order_acquire);
+            length = snprintf(buffer, size, "%s", path ? path : "");
+            break;
+        }
+        case DC_SETTING_KIND_BOOL:
+        {
+            length = snprintf(buffer, size, "%s", dc_setting_bool_get(env, (struct dc_setting_bool *)setting) ? "true" : "false");
+            break;
+        }
+        case DC_SETTING_KIND_UINT16:
+        {
+            length = snprintf(buffer, size, "%u", (unsigned int)dc_setting_uint16_get(env, (struct dc_setting_uint16 *)setting));
+            break;
+        }
+        case DC_SETTING_KIND_IN_PORT_T:
+        {
+            length = snprintf(buffer, size, "%u", (unsigned int)dc_setting_in_port_t_get(env, (struct dc_setting_in_port_t *)setting));
+            break;
+        }
+        case DC_SETTING_KIND_INT32:
+        {
+            length = snprintf(buffer, size, "%" PRId32, dc_setting_int32_get(env, (struct dc_setting_int32 *)setting));
+            break;
+        }
+        case DC_SETTING_KIND_INT64:
+        {
+            length = snprintf(buffer, size, "%" PRId64, dc_setting_int64_get(env, (struct dc_setting_int64 *)setting));
+            break;
+        }
+        case DC_SETTING_KIND_UINT32:
+        {
+            length = snprintf(buffer, size, "%" PRIu32, dc_setting_uint32_get(env, (struct dc_setting_uint32 *)setting));
+            break;
+        }
+        case DC_SETTING_KIND_UINT64:
+        {
+            length = snprintf(buffer, size, "%" PRIu64, dc_setting_uint64_get(env, (struct dc_setting_uint64 *)setting));
+            break;
+        }
+        case DC_SETTING_KIND_SIZE_T:
+        {
+            length = snprintf(buffer, size, "%zu", dc_setting_size_t_get(env, (struct dc_setting_size_t *)setting));
+            break;
+        }
+        case DC_SETTING_KIND_DOUBLE:
+        {
+            length = snprintf(buffer, size, "%.17g", dc_setting_double_get(env, (struct dc_setting_double *)setting));
+            break;
+        }
+        case DC_SETTING_KIND_BYTES:
+        {
+            length = dc_format_bytes(env, dc_setting_bytes_get(env, (struct dc_setting_bytes *)setting), buffer, size);
+            break;
+        }
+        case DC_SETTING_KIND_DURATION:
+        {
+            length = dc_format_duration(env, dc_setting_duration_get(env, (struct dc_setting_duration *)setting), buffer, size);
+            break;
+        }
+        case DC_SETTING_KIND_LIST:
+        {
+            const struct dc_list *list;
+
+            list = dc_setting_list_get(env, (struct dc_setting_list *)setting);
+            length = list ? dc_list_format(env, list, buffer, size) : snprintf(buffer, size, "%s", "");
+            break;
+        }
+        default:
+        {
+            length = -1;
+        }
+    }
+
+    return length;
+}
+
+void dc_settings_reclaim(const struct dc_env *env)
+{
+    struct retired_value *retired;
+    struct snapshot *snapshot;
+
+    DC_TRACE(env);
+    pthread_mutex_lock(&update_lock);
+    retired = retired_values;
+    retired_values = NULL;
+    pthread_mutex_unlock(&update_lock);
+
+    while(retired)
+    {
+        struct retired_value *next;
+
+        next = retired->next;
+        release_retired(env, retired);
+        retired = next;
+    }
+
+    pthread_mutex_lock(&update_lock);
+
+    if(changed_settings)
+    {
+        dc_free(env, changed_settings);
+        changed_settings = NULL;
+        changed_capacity = 0;
+    }
+
+    while(retired_snapshots)
+    {
+        struct snapshot *next;
+
+        next = retired_snapshots->next_retired;
+        dc_free(env, retired_snapshots);
+        retired_snapshots = next;
+    }
+
+    snapshot = atomic_exchange_explicit(&current_snapshot, NULL, memory_order_acq_rel);
+
+    if(snapshot)
+    {
+        dc_free(env, snapshot);
+    }
+
+    pthread_mutex_unlock(&update_lock);
+    local_snapshot = NULL;
+}
+
+const char *dc_settings_intern(const struct dc_env *env, struct dc_error *err, const char *string)
+{
+    struct interned_string *interned;
+    size_t hash;
+    size_t length;
+
+    DC_TRACE(env);
+    hash = hash_string(string);
+    pthread_mutex_lock(&intern_lock);
+
+    for(interned = intern_bucket_count ? intern_buckets[hash % intern_bucket_count] : NULL; interned; interned = interned->next)
+    {
+        if(interned->hash == hash && dc_strcmp(env, interned->text, string) == 0)
+        {
+            interned->references++;
+            pthread_mutex_unlock(&intern_lock);
+
+            return interned->text;
+        }
+    }
+
+    if(interned_count >= intern_bucket_count && !(grow_intern_buckets(env, err)))
+    {
+        pthread_mutex_unlock(&intern_lock);
+
+        return NULL;
+    }
+
+    length = dc_strlen(env, string);
+    interned = dc_malloc(env, err, sizeof(struct interned_string) + length + 1);
+
+    if(dc_error_has_error(err))
+    {
+        pthread_mutex_unlock(&intern_lock);
+
+        return NULL;
+    }
+
+    dc_memcpy(env, interned->text, string, length + 1);
+    interned->hash = hash;
+    interned->references = 1;
+    interned->next = intern_buckets[hash % intern_bucket_count];
+    intern_buckets[hash % intern_bucket_count] = interned;
+    interned_count++;
+    pthread_mutex_unlock(&intern_lock);
+
+    return interned->text;
+}
+
+void dc_settings_intern_release(const struct dc_env *env, const char *string)
+{
+    struct interned_string **link;
+    struct interned_string *interned;
+
+    DC_TRACE(env);
+    pthread_mutex_lock(&intern_lock);
+
+    if(intern_buckets == NULL)
+    {
+        pthread_mutex_unlock(&intern_lock);
+
+        return;
+    }
+
+    // found by identity, the handle is the text of the entry
+    for(link = &intern_buckets[hash_string(string) % intern_bucket_count]; *link && (*link)->text != string; link = &(*link)->next)
+    {
+    }
+
+    // not a string that was interned, or one that has already been released
+    if(*link == NULL)
+    {
+        pthread_mutex_unlock(&intern_lock);
+
+        return;
+    }
+
+    interned = *link;
+    interned->references--;
+
+    if(interned->references == 0)
+    {
+        *link = interned->next;
+        interned_count--;
+        dc_free(env, interned);
+    }
+
+    if(interned_count == 0)
+    {
+        dc_free(env, intern_buckets);
+        intern_buckets = NULL;
+        intern_bucket_count = 0;
+    }
+
+    pthread_mutex_unlock(&intern_lock);
+}
+
+struct dc_setting_path *dc_setting_path_create(const struct dc_env *env, struct dc_error *err)
+{
+    struct dc_setting_path *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_path));
+
+    if(dc_error_has_no_error(err))
+    {
+        setting->parent.type = DC_SETTING_NONE;
+        setting->parent.kind = DC_SETTING_KIND_PATH;
+        atomic_init(&setting->path, NULL);
+    }
+
+    if(dc_error_has_no_error(err) && !(register_setting(env, err, &setting->parent)))
+    {
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_path_destroy(const struct dc_env *env, struct dc_setting_path **psetting)
+{
+    struct dc_setting_path *setting;
+    const char *path;
+
+    DC_TRACE(env);
+    setting = *psetting;
+    unregister_setting(&setting->parent);
+    path = atomic_load_explicit(&setting->path, memory_order_acquire);
+
+    if(path)
+    {
+        dc_settings_intern_release(env, path);
+    }
+
+    dc_free(env, *psetting);
+    *psetting = NULL;
+}
+
+bool dc_setting_path_set(const struct dc_env *env,
+                         struct dc_error *err,
+                         struct dc_setting_path *setting,
+                         const char *value,
+                         dc_setting_type type)
+{
+    bool ret_val;
+
+    DC_TRACE(env);
+    ret_val = false;
+
+    if(setting->parent.type == DC_SETTING_NONE)
+    {
+        if(value)
+        {
+            char *path;
+            const char *string;
+
+            path = NULL;
+            dc_expand_path(env, err, &path, value);
+
+            if(dc_error_has_no_error(err))
+            {
+                string = dc_settings_intern(env, err, path);
+                dc_free(env, path);
+            }
+
+            if(dc_error_has_no_error(err))
+            {
+                atomic_store_explicit(&setting->path, string, memory_order_release);
+                setting->parent.type = type;
+                ret_val = true;
+            }
+        }
+    }
+
+    return ret_val;
+}
+
+const char *dc_setting_path_get(const struct dc_env *env, struct dc_setting_path *setting)
+{
+    const union value *cached;
+
+    DC_TRACE(env);
+    cached = cached_value(&setting->parent);
+
+    if(cached)
+    {
+        return cached->string;
+    }
+
+    return atomic_load_explicit(&setting->path, memory_order_acquire);
+}
+
+struct dc_setting_fd *dc_setting_fd_create(const struct dc_env *env, struct dc_error *err, int flags)
+{
+    struct dc_setting_fd *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_fd));
+
+    if(dc_error_has_no_error(err) && !(create_fd(env, err, setting, DC_SETTING_KIND_FD, flags)))
+    {
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_fd_destroy(const struct dc_env *env, struct dc_setting_fd **psetting)
+{
+    DC_TRACE(env);
+    destroy_fd(env, *psetting);
+    dc_free(env, *psetting);
+    *psetting = NULL;
+}
+
+bool dc_setting_fd_set(const struct dc_env *env,
+                       struct dc_error *err,
+                       struct dc_setting_fd *setting,
+                       const char *value,
+                       dc_setting_type type)
+{
+    DC_TRACE(env);
+
+    return set_fd(env, err, setting, value, type);
+}
+
+int dc_setting_fd_get(const struct dc_env *env, struct dc_setting_fd *setting)
+{
+    DC_TRACE(env);
+
+    return get_fd(setting);
+}
+
+const char *dc_setting_fd_get_path(const struct dc_env *env, struct dc_setting_fd *setting)
+{
+    DC_TRACE(env);
+
+    return atomic_load_explicit(&setting->path, memory_order_acquire);
+}
+
+struct dc_setting_dirfd *dc_setting_dirfd_create(const struct dc_env *env, struct dc_error *err, int flags)
+{
+    struct dc_setting_dirfd *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_dirfd));
+
+    if(dc_error_has_no_error(err) && !(create_fd(env, err, &setting->fd, DC_SETTING_KIND_DIRFD, flags | O_DIRECTORY)))
+    {
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_dirfd_destroy(const struct dc_env *env, struct dc_setting_dirfd **psetting)
+{
+    DC_TRACE(env);
+    destroy_fd(env, &(*psetting)->fd);
+    dc_free(env, *psetting);
+    *psetting = NULL;
+}
+
+bool dc_setting_dirfd_set(const struct dc_env *env,
+                          struct dc_error *err,
+                          struct dc_setting_dirfd *setting,
+                          const char *value,
+                          dc_setting_type type)
+{
+    DC_TRACE(env);
+
+    return set_fd(env, err, &setting->fd, value, type);
+}
+
+int dc_setting_dirfd_get(const struct dc_env *env, struct dc_setting_dirfd *setting)
+{
+    DC_TRACE(env);
+
+    return get_fd(&setting->fd);
+}
+
+const char *dc_setting_dirfd_get_path(const struct dc_env *env, struct dc_setting_dirfd *setting)
+{
+    DC_TRACE(env);
+
+    return atomic_load_explicit(&setting->fd.path, memory_order_acquire);
+}
+
+struct dc_setting_string *dc_setting_string_create(const struct dc_env *env, struct dc_error *err)
+{
+    struct dc_setting_string *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_string));
+
+    if(dc_error_has_no_error(err))
+    {
+        setting->parent.type = DC_SETTING_NONE;
+        setting->parent.kind = DC_SETTING_KIND_STRING;
+        atomic_init(&setting->string, NULL);
+    }
+
+    if(dc_error_has_no_error(err) && !(register_setting(env, err, &setting->parent)))
+    {
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_string_destroy(const struct dc_env *env, struct dc_setting_string **psetting)
+{
+    struct dc_setting_string *setting;
+    const char *string;
+
+    DC_TRACE(env);
+    setting = *psetting;
+    unregister_setting(&setting->parent);
+    string = atomic_load_explicit(&setting->string, memory_order_acquire);
+
+    if(string)
+    {
+        dc_settings_intern_release(env, string);
+    }
+
+    dc_free(env, *psetting);
+    *psetting = NULL;
+}
+
+bool dc_setting_string_set(const struct dc_env *env,
+                           struct dc_error *err,
+                           struct dc_setting_string *setting,
+                           const char *value,
+                           dc_setting_type type)
+{
+    bool ret_val;
+
+    DC_TRACE(env);
+    ret_val = false;
+
+    if(setting->parent.type == DC_SETTING_NONE)
+    {
+        const char *string;
+
+        string = dc_settings_intern(env, err, value);
+
+        if(dc_error_has_no_error(err))
+        {
+            atomic_store_explicit(&setting->string, string, memory_order_release);
+            setting->parent.type = type;
+            ret_val = true;
+        }
+    }
+
+    return ret_val;
+}
+
+const char *dc_setting_string_get(const struct dc_env *env, struct dc_setting_string *setting)
+{
+    const union value *cached;
+
+    DC_TRACE(env);
+    cached = cached_value(&setting->parent);
+
+    if(cached)
+    {
+        return cached->string;
+    }
+
+    return atomic_load_explicit(&setting->string, memory_order_acquire);
+}
+
+struct dc_setting_regex *
+dc_setting_regex_create(const struct dc_env *env, struct dc_error *err, const char *pattern)
+{
+    struct dc_setting_regex *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_regex));
+
+    if(dc_error_has_no_error(err))
+    {
+        setting->matcher = dc_matcher_acquire(env, err, pattern);
+
+        if(dc_error_has_no_error(err))
+        {
+            setting->parent.type = DC_SETTING_NONE;
+            setting->parent.kind = DC_SETTING_KIND_REGEX;
+            setting->pattern = pattern;
+            atomic_init(&setting->string, NULL);
+        }
+    }
+
+    if(dc_error_has_no_error(err) && !(register_setting(env, err, &setting->parent)))
+    {
+        dc_matcher_release(env, &setting->matcher);
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_regex_destroy(const struct dc_env *env, struct dc_setting_regex **psetting)
+{
+    struct dc_setting_regex *setting;
+    const char *string;
+
+    DC_TRACE(env);
+    setting = *psetting;
+    unregister_setting(&setting->parent);
+    string = atomic_load_explicit(&setting->string, memory_order_acquire);
+
+    if(string)
+    {
+        dc_settings_intern_release(env, string);
+    }
+
+    dc_matcher_release(env, &setting->matcher);
+    dc_free(env, setting);
+    *psetting = NULL;
+}
+
+bool dc_setting_regex_set(const struct dc_env *env,
+                          struct dc_error *err,
+                          struct dc_setting_regex *setting,
+                          const char *value,
+                          dc_setting_type type)
+{
+    bool ret_val;
+
+    DC_TRACE(env);
+    ret_val = false;
+
+    if(setting->parent.type == DC_SETTING_NONE)
+    {
+        if(dc_matcher_match(env, setting->matcher, value))
+        {
+            const char *string;
+
+            string = dc_settings_intern(env, err, value);
+
+            if(dc_error_has_no_error(err))
+            {
+                atomic_store_explicit(&setting->string, string, memory_order_release);
+                setting->parent.type = type;
+                ret_val = true;
+            }
+        }
+        else
+        {
+            // TODO: what do you do if the value doesn't match the regex
+        }
+    }
+
+    return ret_val;
+}
+
+const struct dc_matcher *dc_setting_regex_get_matcher(const struct dc_env *env, const struct dc_setting_regex *setting)
+{
+    DC_TRACE(env);
+
+    return setting->matcher;
+}
+
+const char *dc_setting_regex_get(const struct dc_env *env, struct dc_setting_regex *setting)
+{
+    const union value *cached;
+
+    DC_TRACE(env);
+    cached = cached_value(&setting->parent);
+
+    if(cached)
+    {
+        return cached->string;
+    }
+
+    return atomic_load_explicit(&setting->string, memory_order_acquire);
+}
+
+struct dc_setting_bool *dc_setting_bool_create(const struct dc_env *env, struct dc_error *err)
+{
+    struct dc_setting_bool *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_bool));
+
+    if(dc_error_has_no_error(err))
+    {
+        setting->parent.type = DC_SETTING_NONE;
+        setting->parent.kind = DC_SETTING_KIND_BOOL;
+        atomic_init(&setting->value, false);
+    }
+
+    if(dc_error_has_no_error(err) && !(register_setting(env, err, &setting->parent)))
+    {
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_bool_destroy(const struct dc_env *env, struct dc_setting_bool **psetting)
+{
+    DC_TRACE(env);
+    unregister_setting(&(*psetting)->parent);
+    dc_free(env, *psetting);
+    *psetting = NULL;
+}
+
+bool dc_setting_bool_set(const struct dc_env *env,
+                         struct dc_setting_bool *setting,
+                         bool value,
+                         dc_setting_type type)
+{
+    bool ret_val;
+
+    DC_TRACE(env);
+
+    if(setting->parent.type == DC_SETTING_NONE)
+    {
+        setting->parent.type = type;
+        atomic_store_explicit(&setting->value, value, memory_order_release);
+        ret_val = true;
+    }
+    else
+    {
+        ret_val = false;
+    }
+
+    return ret_val;
+}
+
+bool dc_setting_bool_get(const struct dc_env *env, struct dc_setting_bool *setting)
+{
+    const union value *cached;
+
+    DC_TRACE(env);
+    cached = cached_value(&setting->parent);
+
+    if(cached)
+    {
+        return cached->flag;
+    }
+
+    return atomic_load_explicit(&setting->value, memory_order_acquire);
+}
+
+struct dc_setting_uint16 *dc_setting_uint16_create(const struct dc_env *env, struct dc_error *err)
+{
+    struct dc_setting_uint16 *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_uint16));
+
+    if(dc_error_has_no_error(err))
+    {
+        setting->parent.type = DC_SETTING_NONE;
+        setting->parent.kind = DC_SETTING_KIND_UINT16;
+        atomic_init(&setting->value, 0);
+    }
+
+    if(dc_error_has_no_error(err) && !(register_setting(env, err, &setting->parent)))
+    {
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_uint16_destroy(const struct dc_env *env, struct dc_setting_uint16 **psetting)
+{
+    DC_TRACE(env);
+    unregister_setting(&(*psetting)->parent);
+    dc_free(env, *psetting);
+    *psetting = NULL;
+}
+
+bool dc_setting_uint16_set(const struct dc_env *env,
+                           struct dc_setting_uint16 *setting,
+                           uint16_t value,
+                           dc_setting_type type)
+{
+    bool ret_val;
+
+    DC_TRACE(env);
+
+    if(setting->parent.type == DC_SETTING_NONE)
+    {
+        setting->parent.type = type;
+        atomic_store_explicit(&setting->value, value, memory_order_release);
+        ret_val = true;
+    }
+    else
+    {
+        ret_val = false;
+    }
+
+    return ret_val;
+}
+
+uint16_t dc_setting_uint16_get(const struct dc_env *env, struct dc_setting_uint16 *setting)
+{
+    const union value *cached;
+
+    DC_TRACE(env);
+    cached = cached_value(&setting->parent);
+
+    if(cached)
+    {
+        return cached->uint16;
+    }
+
+    return atomic_load_explicit(&setting->value, memory_order_acquire);
+}
+
+
+struct dc_setting_in_port_t *dc_setting_in_port_t_create(const struct dc_env *env, struct dc_error *err)
+{
+    struct dc_setting_in_port_t *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_in_port_t));
+
+    if(dc_error_has_no_error(err))
+    {
+        setting->parent.type = DC_SETTING_NONE;
+        setting->parent.kind = DC_SETTING_KIND_IN_PORT_T;
+        atomic_init(&setting->value, 0);
+    }
+
+    if(dc_error_has_no_error(err) && !(register_setting(env, err, &setting->parent)))
+    {
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_in_port_t_destroy(const struct dc_env *env,  struct dc_setting_in_port_t **psetting)
+{
+    DC_TRACE(env);
+    unregister_setting(&(*psetting)->parent);
+    dc_free(env, *psetting);
+    *psetting = NULL;
+}
+
+bool dc_setting_in_port_t_set(const struct dc_env *env, struct dc_setting_in_port_t *setting, in_port_t value, dc_setting_type type)
+{
+    bool ret_val;
+
+    DC_TRACE(env);
+
+    if(setting->parent.type == DC_SETTING_NONE)
+    {
+        setting->parent.type = type;
+        atomic_store_explicit(&setting->value, value, memory_order_release);
+        ret_val = true;
+    }
+    else
+    {
+        ret_val = false;
+    }
+
+    return ret_val;
+}
+
+in_port_t dc_setting_in_port_t_get(const struct dc_env *env, struct dc_setting_in_port_t *setting)
+{
+    const union value *cached;
+
+    DC_TRACE(env);
+    cached = cached_value(&setting->parent);
+
+    if(cached)
+    {
+        return cached->in_port_t;
+    }
+
+    return atomic_load_explicit(&setting->value, memory_order_acquire);
+}
+
+struct dc_setting_int32 *dc_setting_int32_create(const struct dc_env *env, struct dc_error *err)
+{
+    struct dc_setting_int32 *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_int32));
+
+    if(dc_error_has_no_error(err))
+    {
+        setting->parent.type = DC_SETTING_NONE;
+        setting->parent.kind = DC_SETTING_KIND_INT32;
+        atomic_init(&setting->value, 0);
+    }
+
+    if(dc_error_has_no_error(err) && !(register_setting(env, err, &setting->parent)))
+    {
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_int32_destroy(const struct dc_env *env, struct dc_setting_int32 **psetting)
+{
+    DC_TRACE(env);
+    unregister_setting(&(*psetting)->parent);
+    dc_free(env, *psetting);
+    *psetting = NULL;
+}
+
+bool dc_setting_int32_set(const struct dc_env *env, struct dc_setting_int32 *setting, int32_t value, dc_setting_type type)
+{
+    bool ret_val;
+
+    DC_TRACE(env);
+
+    if(setting->parent.type == DC_SETTING_NONE)
+    {
+        setting->parent.type = type;
+        atomic_store_explicit(&setting->value, value, memory_order_release);
+        ret_val = true;
+    }
+    else
+    {
+        ret_val = false;
+    }
+
+    return ret_val;
+}
+
+int32_t dc_setting_int32_get(const struct dc_env *env, struct dc_setting_int32 *setting)
+{
+    const union value *cached;
+
+    DC_TRACE(env);
+    cached = cached_value(&setting->parent);
+
+    if(cached)
+    {
+        return cached->int32;
+    }
+
+    return atomic_load_explicit(&setting->value, memory_order_acquire);
+}
+
+struct dc_setting_int64 *dc_setting_int64_create(const struct dc_env *env, struct dc_error *err)
+{
+    struct dc_setting_int64 *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_int64));
+
+    if(dc_error_has_no_error(err))
+    {
+        setting->parent.type = DC_SETTING_NONE;
+        setting->parent.kind = DC_SETTING_KIND_INT64;
+        atomic_init(&setting->value, 0);
+    }
+
+    if(dc_error_has_no_error(err) && !(register_setting(env, err, &setting->parent)))
+    {
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_int64_destroy(const struct dc_env *env, struct dc_setting_int64 **psetting)
+{
+    DC_TRACE(env);
+    unregister_setting(&(*psetting)->parent);
+    dc_free(env, *psetting);
+    *psetting = NULL;
+}
+
+bool dc_setting_int64_set(const struct dc_env *env, struct dc_setting_int64 *setting, int64_t value, dc_setting_type type)
+{
+    bool ret_val;
+
+    DC_TRACE(env);
+
+    if(setting->parent.type == DC_SETTING_NONE)
+    {
+        setting->parent.type = type;
+        atomic_store_explicit(&setting->value, value, memory_order_release);
+        ret_val = true;
+    }
+    else
+    {
+        ret_val = false;
+    }
+
+    return ret_val;
+}
+
+int64_t dc_setting_int64_get(const struct dc_env *env, struct dc_setting_int64 *setting)
+{
+    const union value *cached;
+
+    DC_TRACE(env);
+    cached = cached_value(&setting->parent);
+
+    if(cached)
+    {
+        return cached->int64;
+    }
+
+    return atomic_load_explicit(&setting->value, memory_order_acquire);
+}
+
+struct dc_setting_uint32 *dc_setting_uint32_create(const struct dc_env *env, struct dc_error *err)
+{
+    struct dc_setting_uint32 *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_uint32));
+
+    if(dc_error_has_no_error(err))
+    {
+        setting->parent.type = DC_SETTING_NONE;
+        setting->parent.kind = DC_SETTING_KIND_UINT32;
+        atomic_init(&setting->value, 0);
+    }
+
+    if(dc_error_has_no_error(err) && !(register_setting(env, err, &setting->parent)))
+    {
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_uint32_destroy(const struct dc_env *env, struct dc_setting_uint32 **psetting)
+{
+    DC_TRACE(env);
+    unregister_setting(&(*psetting)->parent);
+    dc_free(env, *psetting);
+    *psetting = NULL;
+}
+
+bool dc_setting_uint32_set(const struct dc_env *env, struct dc_setting_uint32 *setting, uint32_t value, dc_setting_type type)
+{
+    bool ret_val;
+
+    DC_TRACE(env);
+
+    if(setting->parent.type == DC_SETTING_NONE)
+    {
+        setting->parent.type = type;
+        atomic_store_explicit(&setting->value, value, memory_order_release);
+        ret_val = true;
+    }
+    else
+    {
+        ret_val = false;
+    }
+
+    return ret_val;
+}
+
+uint32_t dc_setting_uint32_get(const struct dc_env *env, struct dc_setting_uint32 *setting)
+{
+    const union value *cached;
+
+    DC_TRACE(env);
+    cached = cached_value(&setting->parent);
+
+    if(cached)
+    {
+        return cached->uint32;
+    }
+
+    return atomic_load_explicit(&setting->value, memory_order_acquire);
+}
+
+struct dc_setting_uint64 *dc_setting_uint64_create(const struct dc_env *env, struct dc_error *err)
+{
+    struct dc_setting_uint64 *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_uint64));
+
+    if(dc_error_has_no_error(err))
+    {
+        setting->parent.type = DC_SETTING_NONE;
+        setting->parent.kind = DC_SETTING_KIND_UINT64;
+        atomic_init(&setting->value, 0);
+    }
+
+    if(dc_error_has_no_error(err) && !(register_setting(env, err, &setting->parent)))
+    {
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_uint64_destroy(const struct dc_env *env, struct dc_setting_uint64 **psetting)
+{
+    DC_TRACE(env);
+    unregister_setting(&(*psetting)->parent);
+    dc_free(env, *psetting);
+    *psetting = NULL;
+}
+
+bool dc_setting_uint64_set(const struct dc_env *env, struct dc_setting_uint64 *setting, uint64_t value, dc_setting_type type)
+{
+    bool ret_val;
+
+    DC_TRACE(env);
+
+    if(setting->parent.type == DC_SETTING_NONE)
+    {
+        setting->parent.type = type;
+        atomic_store_explicit(&setting->value, value, memory_order_release);
+        ret_val = true;
+    }
+    else
+    {
+        ret_val = false;
+    }
+
+    return ret_val;
+}
+
+uint64_t dc_setting_uint64_get(const struct dc_env *env, struct dc_setting_uint64 *setting)
+{
+    const union value *cached;
+
+    DC_TRACE(env);
+    cached = cached_value(&setting->parent);
+
+    if(cached)
+    {
+        return cached->uint64;
+    }
+
+    return atomic_load_explicit(&setting->value, memory_order_acquire);
+}
+
+struct dc_setting_size_t *dc_setting_size_t_create(const struct dc_env *env, struct dc_error *err)
+{
+    struct dc_setting_size_t *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_size_t));
+
+    if(dc_error_has_no_error(err))
+    {
+        setting->parent.type = DC_SETTING_NONE;
+        setting->parent.kind = DC_SETTING_KIND_SIZE_T;
+        atomic_init(&setting->value, 0);
+    }
+
+    if(dc_error_has_no_error(err) && !(register_setting(env, err, &setting->parent)))
+    {
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_size_t_destroy(const struct dc_env *env, struct dc_setting_size_t **psetting)
+{
+    DC_TRACE(env);
+    unregister_setting(&(*psetting)->parent);
+    dc_free(env, *psetting);
+    *psetting = NULL;
+}
+
+bool dc_setting_size_t_set(const struct dc_env *env, struct dc_setting_size_t *setting, size_t value, dc_setting_type type)
+{
+    bool ret_val;
+
+    DC_TRACE(env);
+
+    if(setting->parent.type == DC_SETTING_NONE)
+    {
+        setting->parent.type = type;
+        atomic_store_explicit(&setting->value, value, memory_order_release);
+        ret_val = true;
+    }
+    else
+    {
+        ret_val = false;
+    }
+
+    return ret_val;
+}
+
+size_t dc_setting_size_t_get(const struct dc_env *env, struct dc_setting_size_t *setting)
+{
+    const union value *cached;
+
+    DC_TRACE(env);
+    cached = cached_value(&setting->parent);
+
+    if(cached)
+    {
+        return cached->size;
+    }
+
+    return atomic_load_explicit(&setting->value, memory_order_acquire);
+}
+
+struct dc_setting_double *dc_setting_double_create(const struct dc_env *env, struct dc_error *err)
+{
+    struct dc_setting_double *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_double));
+
+    if(dc_error_has_no_error(err))
+    {
+        setting->parent.type = DC_SETTING_NONE;
+        setting->parent.kind = DC_SETTING_KIND_DOUBLE;
+        atomic_init(&setting->value, 0);
+    }
+
+    if(dc_error_has_no_error(err) && !(register_setting(env, err, &setting->parent)))
+    {
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_double_destroy(const struct dc_env *env, struct dc_setting_double **psetting)
+{
+    DC_TRACE(env);
+    unregister_setting(&(*psetting)->parent);
+    dc_free(env, *psetting);
+    *psetting = NULL;
+}
+
+bool dc_setting_double_set(const struct dc_env *env, struct dc_setting_double *setting, double value, dc_setting_type type)
+{
+    bool ret_val;
+
+    DC_TRACE(env);
+
+    if(setting->parent.type == DC_SETTING_NONE)
+    {
+        setting->parent.type = type;
+        atomic_store_explicit(&setting->value, value, memory_order_release);
+        ret_val = true;
+    }
+    else
+    {
+        ret_val = false;
+    }
+
+    return ret_val;
+}
+
+double dc_setting_double_get(const struct dc_env *env, struct dc_setting_double *setting)
+{
+    const union value *cached;
+
+    DC_TRACE(env);
+    cached = cached_value(&setting->parent);
+
+    if(cached)
+    {
+        return cached->real;
+    }
+
+    return atomic_load_explicit(&setting->value, memory_order_acquire);
+}
+
+struct dc_setting_bytes *dc_setting_bytes_create(const struct dc_env *env, struct dc_error *err)
+{
+    struct dc_setting_bytes *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_bytes));
+
+    if(dc_error_has_no_error(err))
+    {
+        setting->parent.type = DC_SETTING_NONE;
+        setting->parent.kind = DC_SETTING_KIND_BYTES;
+        atomic_init(&setting->value, 0);
+    }
+
+    if(dc_error_has_no_error(err) && !(register_setting(env, err, &setting->parent)))
+    {
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_bytes_destroy(const struct dc_env *env, struct dc_setting_bytes **psetting)
+{
+    DC_TRACE(env);
+    unregister_setting(&(*psetting)->parent);
+    dc_free(env, *psetting);
+    *psetting = NULL;
+}
+
+bool dc_setting_bytes_set(const struct dc_env *env, struct dc_setting_bytes *setting, uint64_t value, dc_setting_type type)
+{
+    bool ret_val;
+
+    DC_TRACE(env);
+
+    if(setting->parent.type == DC_SETTING_NONE)
+    {
+        setting->parent.type = type;
+        atomic_store_explicit(&setting->value, value, memory_order_release);
+        ret_val = true;
+    }
+    else
+    {
+        ret_val = false;
+    }
+
+    return ret_val;
+}
+
+uint64_t dc_setting_bytes_get(const struct dc_env *env, struct dc_setting_bytes *setting)
+{
+    const union value *cached;
+
+    DC_TRACE(env);
+    cached = cached_value(&setting->parent);
+
+    if(cached)
+    {
+        return cached->uint64;
+    }
+
+    return atomic_load_explicit(&setting->value, memory_order_acquire);
+}
+
+struct dc_setting_duration *dc_setting_duration_create(const struct dc_env *env, struct dc_error *err)
+{
+    struct dc_setting_duration *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_duration));
+
+    if(dc_error_has_no_error(err))
+    {
+        setting->parent.type = DC_SETTING_NONE;
+        setting->parent.kind = DC_SETTING_KIND_DURATION;
+        atomic_init(&setting->value, 0);
+    }
+
+    if(dc_error_has_no_error(err) && !(register_setting(env, err, &setting->parent)))
+    {
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_duration_destroy(const struct dc_env *env, struct dc_setting_duration **psetting)
+{
+    DC_TRACE(env);
+    unregister_setting(&(*psetting)->parent);
+    dc_free(env, *psetting);
+    *psetting = NULL;
+}
+
+bool dc_setting_duration_set(const struct dc_env *env, struct dc_setting_duration *setting, uint64_t value, dc_setting_type type)
+{
+    bool ret_val;
+
+    DC_TRACE(env);
+
+    if(setting->parent.type == DC_SETTING_NONE)
+    {
+        setting->parent.type = type;
+        atomic_store_explicit(&setting->value, value, memory_order_release);
+        ret_val = true;
+    }
+    else
+    {
+        ret_val = false;
+    }
+
+    return ret_val;
+}
+
+uint64_t dc_setting_duration_get(const struct dc_env *env, struct dc_setting_duration *setting)
+{
+    const union value *cached;
+
+    DC_TRACE(env);
+    cached = cached_value(&setting->parent);
+
+    if(cached)
+    {
+        return cached->uint64;
+    }
+
+    return atomic_load_explicit(&setting->value, memory_order_acquire);
+}
+
+struct dc_setting_list *dc_setting_list_create(const struct dc_env *env, struct dc_error *err, dc_list_element element)
+{
+    struct dc_setting_list *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_list));
+
+    if(dc_error_has_no_error(err))
+    {
+        setting->parent.type = DC_SETTING_NONE;
+        setting->parent.kind = DC_SETTING_KIND_LIST;
+        setting->element = element;
+        atomic_init(&setting->list, NULL);
+    }
+
+    if(dc_error_has_no_error(err) && !(register_setting(env, err, &setting->parent)))
+    {
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_list_destroy(const struct dc_env *env, struct dc_setting_list **psetting)
+{
+    struct dc_setting_list *setting;
+    struct dc_list *list;
+
+    DC_TRACE(env);
+    setting = *psetting;
+    unregister_setting(&setting->parent);
+    list = atomic_load_explicit(&setting->list, memory_order_acquire);
+
+    if(list)
+    {
+        dc_list_destroy(env, &list);
+    }
+
+    dc_free(env, *psetting);
+    *psetting = NULL;
+}
+
+bool dc_setting_list_set(const struct dc_env *env,
+                         struct dc_error *err,
+                         struct dc_setting_list *setting,
+                         const struct dc_list *value,
+                         dc_setting_type type)
+{
+    bool ret_val;
+
+    DC_TRACE(env);
+    ret_val = false;
+
+    if(setting->parent.type == DC_SETTING_NONE)
+    {
+        struct dc_list *list;
+
+        if(dc_list_get_element(env, value) != setting->element)
+        {
+            DC_ERROR_RAISE_USER(err, "list elements are the wrong kind for the setting", EINVAL);
+
+            return false;
+        }
+
+        list = dc_list_copy(env, err, value);
+
+        if(dc_error_has_no_error(err))
+        {
+            atomic_store_explicit(&setting->list, list, memory_order_release);
+            setting->parent.type = type;
+            ret_val = true;
+        }
+    }
+
+    return ret_val;
+}
+
+const struct dc_list *dc_setting_list_get(const struct dc_env *env, struct dc_setting_list *setting)
+{
+    const union value *cached;
+
+    DC_TRACE(env);
+    cached = cached_value(&setting->parent);
+
+    if(cached)
+    {
+        return cached->list;
+    }
+
+    return atomic_load_explicit(&setting->list, memory_order_acquire);
+}
+
+struct dc_setting_cpuset *dc_setting_cpuset_create(const struct dc_env *env, struct dc_error *err)
+{
+    struct dc_setting_cpuset *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_cpuset));
+
+    if(dc_error_has_no_error(err))
+    {
+        setting->parent.type = DC_SETTING_NONE;
+        setting->parent.kind = DC_SETTING_KIND_CPUSET;
+        atomic_init(&setting->string, NULL);
+    }
+
+    if(dc_error_has_no_error(err) && !(register_setting(env, err, &setting->parent)))
+    {
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_cpuset_destroy(const struct dc_env *env, struct dc_setting_cpuset **psetting)
+{
+    struct dc_setting_cpuset *setting;
+    const char *string;
+
+    DC_TRACE(env);
+    setting = *psetting;
+    unregister_setting(&setting->parent);
+    string = atomic_load_explicit(&setting->string, memory_order_acquire);
+
+    if(string)
+    {
+        dc_settings_intern_release(env, string);
+    }
+
+    dc_free(env, *psetting);
+    *psetting = NULL;
+}
+
+bool dc_setting_cpuset_set(const struct dc_env *env,
+                           struct dc_error *err,
+                           struct dc_setting_cpuset *setting,
+                           const char *value,
+                           dc_setting_type type)
+{
+    bool ret_val;
+
+    DC_TRACE(env);
+    ret_val = false;
+
+    if(setting->parent.type == DC_SETTING_NONE)
+    {
+        const char *string;
+
+        string = intern_canonical(env, err, DC_SETTING_KIND_CPUSET, value);
+
+        if(dc_error_has_no_error(err))
+        {
+            atomic_store_explicit(&setting->string, string, memory_order_release);
+            setting->parent.type = type;
+            ret_val = true;
+        }
+    }
+
+    return ret_val;
+}
+
+const char *dc_setting_cpuset_get(const struct dc_env *env, struct dc_setting_cpuset *setting)
+{
+    const union value *cached;
+
+    DC_TRACE(env);
+    cached = cached_value(&setting->parent);
+
+    if(cached)
+    {
+        return cached->string;
+    }
+
+    return atomic_load_explicit(&setting->string, memory_order_acquire);
+}
+
+bool dc_setting_cpuset_get_cpus(const struct dc_env *env, struct dc_setting_cpuset *setting, struct dc_cpuset *set)
+{
+    struct dc_error parse_err;
+    const char *string;
+    bool ret_val;
+
+    DC_TRACE(env);
+    string = dc_setting_cpuset_get(env, setting);
+
+    if(string == NULL)
+    {
+        dc_memset(env, set, 0, sizeof(struct dc_cpuset));
+
+        return false;
+    }
+
+    // the string was written by dc_cpuset_format, it always parses
+    dc_error_init(&parse_err, NULL);
+    ret_val = dc_cpuset_parse(env, &parse_err, string, set);
+    dc_error_reset(&parse_err);
+
+    return ret_val;
+}
+
+struct dc_setting_numa_policy *dc_setting_numa_policy_create(const struct dc_env *env, struct dc_error *err)
+{
+    struct dc_setting_numa_policy *setting;
+
+    DC_TRACE(env);
+    setting = dc_malloc(env, err, sizeof(struct dc_setting_numa_policy));
+
+    if(dc_error_has_no_error(err))
+    {
+        setting->parent.type = DC_SETTING_NONE;
+        setting->parent.kind = DC_SETTING_KIND_NUMA_POLICY;
+        atomic_init(&setting->string, NULL);
+    }
+
+    if(dc_error_has_no_error(err) && !(register_setting(env, err, &setting->parent)))
+    {
+        dc_free(env, setting);
+        setting = NULL;
+    }
+
+    return setting;
+}
+
+void dc_setting_numa_policy_destroy(const struct dc_env *env, struct dc_setting_numa_policy **psetting)
+{
+    struct dc_setting_numa_policy *setting;
+    const char *string;
+
+    DC_TRACE(env);
+    setting = *psetting;
+    unregister_setting(&setting->parent);
+    string = atomic_load_explicit(&setting->string, memory_order_acquire);
+
+    if(string)
+    {
+        dc_settings_intern_release(env, string);
+    }
+
+    dc_free(env, *psetting);
+    *psetting = NULL;
+}
+
+bool dc_setting_numa_policy_set(const struct dc_env *env,
+                                struct dc_error *err,
+                                struct dc_setting_numa_policy *setting,
+                                const char *value,
+                                dc_setting_type type)
+{
+    bool ret_val;
+
+    DC_TRACE(env);
+    ret_val = false;
+
+    if(setting->parent.type == DC_SETTING_NONE)
+    {
+        const char *string;
+
+        string = intern_canonical(env, err, DC_SETTING_KIND_NUMA_POLICY, value);
+
+        if(dc_error_has_no_error(err))
+        {
+            atomic_store_explicit(&setting->string, string, memory_order_release);
+            setting->parent.type = type;
+            ret_val = true;
+        }
+    }
+
+    return ret_val;
+}
+
+const char *dc_setting_numa_policy_get(const struct dc_env *env, struct dc_setting_numa_policy *setting)
+{
+    const union value *cached;
+
+    DC_TRACE(env);
+    cached = cached_value(&setting->parent);
+
+    if(cached)
+    {
+        return cached->string;
+    }
+
+    return atomic_load_explicit(&setting->string, memory_order_acquire);
+}
+
+bool dc_setting_numa_policy_get_policy(const struct dc_env *env, struct dc_setting_numa_policy *setting, struct dc_numa_policy *policy)
+{
+    struct dc_error parse_err;
+    const char *string;
+    bool ret_val;
+
+    DC_TRACE(env);
+    string = dc_setting_numa_policy_get(env, setting);
+
+    if(string == NULL)
+    {
+        dc_memset(env, policy, 0, sizeof(struct dc_numa_policy));
+
+        return false;
+    }
+
+    // the string was written by dc_numa_policy_format, it always parses
+    dc_error_init(&parse_err, NULL);
+    ret_val = dc_numa_policy_parse(env, &parse_err, string, policy);
+    dc_error_reset(&parse_err);
+
+    return ret_val;
+}
+
+static bool register_setting(const struct dc_env *env, struct dc_error *err, struct dc_setting *setting)
+{
+    bool ret_val;
+    size_t slot;
+
+    ret_val = true;
+    pthread_mutex_lock(&update_lock);
+    slot = registered_count;
+
+    // the lowest free slot is reused so that the registry stays as large as the most settings alive at once
+    if(unregistered_count > 0)
+    {
+        for(slot = 0; registered_settings[slot] != NULL; slot++)
+        {
+        }
+
+        unregistered_count--;
+    }
+    else if(registered_count == registered_capacity)
+    {
+        struct dc_setting **grown;
+        size_t capacity;
+
+        capacity = registered_capacity ? registered_capacity * 2 : 16;
+        grown = dc_realloc(env, err, registered_settings, capacity * sizeof(struct dc_setting *));
+
+        if(dc_error_has_no_error(err))
+        {
+            registered_settings = grown;
+            registered_capacity = capacity;
+        }
+        else
+        {
+            ret_val = false;
+        }
+    }
+
+    if(ret_val)
+    {
+        setting->slot = slot;
+        setting->registered_at = atomic_load_explicit(&generation, memory_order_relaxed);
+        registered_settings[slot] = setting;
+
+        if(slot == registered_count)
+        {
+            registered_count++;
+        }
+    }
+
+    pthread_mutex_unlock(&update_lock);
+
+    return ret_val;
+}
+
+// the slot is free straight away, the setting that gets it next does not read the snapshots that are older than it
+static void unregister_setting(struct dc_setting *setting)
+{
+    pthread_mutex_lock(&update_lock);
+    registered_settings[setting->slot] = NULL;
+    unregistered_count++;
+
+    // the snapshots only cover up to the highest slot in use, free slots above it are dropped rather than reused
+    while(registered_count > 0 && registered_settings[registered_count - 1] == NULL)
+    {
+        registered_count--;
+        unregistered_count--;
+    }
+
+    pthread_mutex_unlock(&update_lock);
+}
+
+static union value read_value(const struct dc_env *env, struct dc_setting *setting)
+{
+    union value value;
+
+    switch(setting->kind)
+    {
+        case DC_SETTING_KIND_STRING:
+        {
+            value.string = atomic_load_explicit(&((struct dc_setting_string *)setting)->string, memory_order_acquire);
+            break;
+        }
+        case DC_SETTING_KIND_REGEX:
+        {
+            value.string = atomic_load_explicit(&((struct dc_setting_regex *)setting)->string, memory_order_acquire);
+            break;
+        }
+        case DC_SETTING_KIND_PATH:
+        {
+            value.string = atomic_load_explicit(&((struct dc_setting_path *)setting)->path, memory_order_acquire);
+            break;
+        }
+        case DC_SETTING_KIND_FD:
+        case DC_SETTING_KIND_DIRFD:
+        {
+            value.fd = atomic_load_explicit(&((struct dc_setting_fd *)setting)->fd, memory_order_acquire);
+            break;
+        }
+        case DC_SETTING_KIND_BOOL:
+        {
+            value.flag = atomic_load_explicit(&((struct dc_setting_bool *)setting)->value, memory_order_acquire);
+            break;
+        }
+        case DC_SETTING_KIND_UINT16:
+        {
+            value.uint16 = atomic_load_explicit(&((struct dc_setting_uint16 *)setting)->value, memory_order_acquire);
+            break;
+        }
+        case DC_SETTING_KIND_IN_PORT_T:
+        {
+            value.in_port_t = atomic_load_explicit(&((struct dc_setting_in_port_t *)setting)->value, memory_order_acquire);
+            break;
+        }
+        case DC_SETTING_KIND_INT32:
+        {
+            value.int32 = atomic_load_explicit(&((struct dc_setting_int32 *)setting)->value, memory_order_acquire);
+            break;
+        }
+        case DC_SETTING_KIND_INT64:
+        {
+            value.int64 = atomic_load_explicit(&((struct dc_setting_int64 *)setting)->value, memory_order_acquire);
+            break;
+        }
+        case DC_SETTING_KIND_UINT32:
+        {
+            value.uint32 = atomic_load_explicit(&((struct dc_setting_uint32 *)setting)->value, memory_order_acquire);
+            break;
+        }
+        case DC_SETTING_KIND_UINT64:
+        {
+            value.uint64 = atomic_load_explicit(&((struct dc_setting_uint64 *)setting)->value, memory_order_acquire);
+            break;
+        }
+        case DC_SETTING_KIND_SIZE_T:
+        {
+            value.size = atomic_load_explicit(&((struct dc_setting_size_t *)setting)->value, memory_order_acquire);
+            break;
+        }
+        case DC_SETTING_KIND_DOUBLE:
+        {
+            value.real = atomic_load_explicit(&((struct dc_setting_double *)setting)->value, memory_order_acquire);
+            break;
+        }
+        case DC_SETTING_KIND_BYTES:
+        {
+            value.uint64 = atomic_load_explicit(&((struct dc_setting_bytes *)setting)->value, memory_order_acquire);
+            break;
+        }
+        case DC_SETTING_KIND_DURATION:
+        {
+            value.uint64 = atomic_load_explicit(&((struct dc_setting_duration *)setting)->value, memory_order_acquire);
+            break;
+        }
+        case DC_SETTING_KIND_LIST:
+        {
+            value.list = atomic_load_explicit(&((struct dc_setting_list *)setting)->list, memory_order_acquire);
+            break;
+        }
+        case DC_SETTING_KIND_CPUSET:
+        {
+            value.string = atomic_load_explicit(&((struct dc_setting_cpuset *)setting)->string, memory_order_acquire);
+            break;
+        }
+        case DC_SETTING_KIND_NUMA_POLICY:
+        {
+            value.string = atomic_load_explicit(&((struct dc_setting_numa_policy *)setting)->string, memory_order_acquire);
+            break;
+        }
+        default:
+        {
+            dc_memset(env, &value, 0, sizeof(value));
+        }
+    }
+
+    return value;
+}
+
+// called with update_lock held by the transaction
+static void publish_snapshot(const struct dc_env *env, struct dc_error *err, uint64_t current)
+{
+    struct snapshot *snapshot;
+    struct snapshot *previous;
+
+    snapshot = dc_malloc(env, err, sizeof(struct snapshot) + (registered_count * sizeof(union value)));
+
+    if(dc_error_has_error(err))
+    {
+        return;
+    }
+
+    snapshot->next_retired = NULL;
+    snapshot->generation = current;
+    snapshot->retired_at = 0;
+    snapshot->count = registered_count;
+
+    for(size_t i = 0; i < registered_count; i++)
+    {
+        if(registered_settings[i])
+        {
+            snapshot->values[i] = read_value(env, registered_settings[i]);
+        }
+        else
+        {
+            dc_memset(env, &snapshot->values[i], 0, sizeof(union value));
+        }
+    }
+
+    previous = atomic_exchange_explicit(&current_snapshot, snapshot, memory_order_seq_cst);
+
+    if(previous)
+    {
+        previous->retired_at = current;
+        previous->next_retired = retired_snapshots;
+        retired_snapshots = previous;
+    }
+}
+
+// called with update_lock held by the transaction
+static void collect_snapshots(const struct dc_env *env)
+{
+    struct snapshot **link;
+    uint64_t oldest;
+
+    oldest = UINT64_MAX;
+
+    for(struct reader *reader = readers; reader; reader = reader->next)
+    {
+        uint64_t reader_generation;
+
+        reader_generation = atomic_load_explicit(&reader->generation, memory_order_seq_cst);
+
+        if(reader_generation < oldest)
+        {
+            oldest = reader_generation;
+        }
+    }
+
+    link = &retired_snapshots;
+
+    while(*link)
+    {
+        struct snapshot *snapshot;
+
+        snapshot = *link;
+
+        // a reader that announced the generation the snapshot was replaced in loaded the replacement or a later one
+        if(snapshot->retired_at <= oldest)
+        {
+            *link = snapshot->next_retired;
+            dc_free(env, snapshot);
+        }
+        else
+        {
+            link = &snapshot->next_retired;
+        }
+    }
+
+    for(struct retired_value **rlink = &retired_values; *rlink;)
+    {
+        struct retired_value *retired;
 
-            if(dc_error_has_no_error(err))
-            {
-                setting->parent.type = type;
-                ret_val = true;
-            }
+        retired = *rlink;
+
+        if(retired->retired_at != 0 && retired->retired_at <= oldest)
+        {
+            *rlink = retired->next;
+            release_retired(env, retired);
+        }
+        else
+        {
+            rlink = &retired->next;
         }
     }
+}
 
-    return ret_val;
+static void create_reader_key(void)
+{
+    pthread_key_create(&reader_key, remove_reader);
 }
 
-const char *dc_setting_path_get(const struct dc_env *env, struct dc_setting_path *setting)
+// runs when a thread that called dc_settings_quiesce exits, the record is kept for the next thread to use
+static void remove_reader(void *arg)
 {
-    DC_TRACE(env);
+    struct reader *reader;
 
-    return setting->path;
+    reader = arg;
+    pthread_mutex_lock(&update_lock);
+    atomic_store_explicit(&reader->generation, UINT64_MAX, memory_order_seq_cst);
+    reader->active = false;
+    pthread_mutex_unlock(&update_lock);
 }
 
-struct dc_setting_string *dc_setting_string_create(const struct dc_env *env, struct dc_error *err)
+static inline const union value *cached_value(const struct dc_setting *setting)
 {
-    struct dc_setting_string *setting;
+    const struct snapshot *snapshot;
 
-    DC_TRACE(env);
-    setting = dc_malloc(env, err, sizeof(struct dc_setting_string));
+    snapshot = local_snapshot;
 
-    if(dc_error_has_no_error(err))
+    // a snapshot from before the setting was registered holds the value of whatever had the slot then, if anything
+    if(snapshot && setting->slot < snapshot->count && snapshot->generation > setting->registered_at)
     {
-        setting->parent.type = DC_SETTING_NONE;
-        setting->string = NULL;
+        return &snapshot->values[setting->slot];
     }
 
-    return setting;
+    return NULL;
 }
 
-void dc_setting_string_destroy(const struct dc_env *env, struct dc_setting_string **psetting)
+static bool create_fd(const struct dc_env *env, struct dc_error *err, struct dc_setting_fd *setting, dc_setting_kind kind, int flags)
 {
-    struct dc_setting_string *setting;
+    setting->parent.type = DC_SETTING_NONE;
+    setting->parent.kind = kind;
+    setting->flags = flags;
+    atomic_init(&setting->path, NULL);
+    atomic_init(&setting->fd, -1);
 
-    DC_TRACE(env);
-    setting = *psetting;
+    return register_setting(env, err, &setting->parent);
+}
 
-    if(setting->string)
+static void destroy_fd(const struct dc_env *env, struct dc_setting_fd *setting)
+{
+    const char *path;
+    int fd;
+
+    unregister_setting(&setting->parent);
+    path = atomic_load_explicit(&setting->path, memory_order_acquire);
+    fd = atomic_load_explicit(&setting->fd, memory_order_acquire);
+
+    if(path)
     {
-        dc_free(env, setting->string);
+        dc_settings_intern_release(env, path);
     }
 
-    dc_free(env, *psetting);
-    *psetting = NULL;
+    if(fd != -1)
+    {
+        struct dc_error err;
+
+        dc_error_init(&err, NULL);
+        dc_close(env, &err, fd);
+        dc_error_reset(&err);
+    }
 }
 
-bool dc_setting_string_set(const struct dc_env *env,
-                           struct dc_error *err,
-                           struct dc_setting_string *setting,
-                           const char *value,
-                           dc_setting_type type)
+static bool open_path(const struct dc_env *env, struct dc_error *err, int flags, const char *value, const char **ppath, int *pfd)
 {
-    bool ret_val;
+    char *path;
+    int fd;
 
-    DC_TRACE(env);
-    ret_val = false;
+    path = NULL;
+    fd = -1;
+    dc_expand_path(env, err, &path, value);
 
-    if(setting->parent.type == DC_SETTING_NONE)
+    if(dc_error_has_no_error(err))
+    {
+        fd = dc_open(env, err, path, flags);
+    }
+
+    if(dc_error_has_no_error(err))
     {
-        size_t len;
+        *ppath = dc_settings_intern(env, err, path);
+    }
 
-        len = dc_strlen(env, value);
-        setting->string = dc_malloc(env, err, (len + 1) * sizeof(char));
+    if(path)
+    {
+        dc_free(env, path);
+    }
 
-        if(dc_error_has_no_error(err))
+    if(dc_error_has_error(err))
+    {
+        if(fd != -1)
         {
-            dc_strcpy(env, setting->string, value);
-            setting->parent.type = type;
-            ret_val = true;
+            struct dc_error close_err;
+
+            dc_error_init(&close_err, NULL);
+            dc_close(env, &close_err, fd);
+            dc_error_reset(&close_err);
         }
-    }
 
-    return ret_val;
-}
+        return false;
+    }
 
-const char *dc_setting_string_get(const struct dc_env *env, struct dc_setting_string *setting)
-{
-    DC_TRACE(env);
+    *pfd = fd;
 
-    return setting->string;
+    return true;
 }
 
-struct dc_setting_regex *
-dc_setting_regex_create(const struct dc_env *env, struct dc_error *err, const char *pattern)
+static bool set_fd(const struct dc_env *env, struct dc_error *err, struct dc_setting_fd *setting, const char *value, dc_setting_type type)
 {
-    struct dc_setting_regex *setting;
-
-    DC_TRACE(env);
-    setting = dc_malloc(env, err, sizeof(struct dc_setting_regex));
+    const char *path;
+    int fd;
 
-    if(dc_error_has_no_error(err))
+    if(setting->parent.type != DC_SETTING_NONE || value == NULL)
     {
-        dc_regcomp(env, err, &setting->regex, pattern, REG_EXTENDED);
+        return false;
+    }
 
-        if(dc_error_has_no_error(err))
-        {
-            setting->parent.type = DC_SETTING_NONE;
-            setting->pattern = pattern;
-            setting->string = NULL;
-        }
+    if(!(open_path(env, err, setting->flags, value, &path, &fd)))
+    {
+        return false;
     }
 
-    return setting;
+    atomic_store_explicit(&setting->path, path, memory_order_release);
+    atomic_store_explicit(&setting->fd, fd, memory_order_release);
+    setting->parent.type = type;
+
+    return true;
 }
 
-void dc_setting_regex_destroy(const struct dc_env *env, struct dc_setting_regex **psetting)
+static int get_fd(struct dc_setting_fd *setting)
 {
-    struct dc_setting_regex *setting;
+    const union value *cached;
 
-    DC_TRACE(env);
-    setting = *psetting;
+    cached = cached_value(&setting->parent);
 
-    if(setting->string)
+    if(cached)
     {
-        dc_free(env, setting->string);
+        return cached->fd;
     }
 
-    dc_regfree(env, &setting->regex);
-    dc_free(env, setting);
-    *psetting = NULL;
+    return atomic_load_explicit(&setting->fd, memory_order_acquire);
 }
 
-bool dc_setting_regex_set(const struct dc_env *env,
-                          struct dc_error *err,
-                          struct dc_setting_regex *setting,
-                          const char *value,
-                          dc_setting_type type)
+static const char *intern_canonical(const struct dc_env *env, struct dc_error *err, dc_setting_kind kind, const char *value)
 {
-    bool ret_val;
+    char buffer[DC_NUMA_POLICY_FORMAT_SIZE];
 
     DC_TRACE(env);
-    ret_val = false;
 
-    if(setting->parent.type == DC_SETTING_NONE)
+    if(kind == DC_SETTING_KIND_CPUSET)
     {
-        int match;
+        struct dc_cpuset set;
 
-        match = dc_regexec(env, &setting->regex, value, 0, NULL, 0);
-
-        if(match == 0)
+        if(dc_cpuset_parse(env, err, value, &set))
         {
-            size_t len;
-
-            len = dc_strlen(env, value);
-            setting->string = dc_malloc(env, err, (len + 1) * sizeof(char));
-
-            if(dc_error_has_no_error(err))
-            {
-                dc_strcpy(env, setting->string, value);
-                setting->parent.type = type;
-                ret_val = true;
-            }
+            dc_cpuset_format(env, &set, buffer, sizeof(buffer));
         }
-        else
+    }
+    else
+    {
+        struct dc_numa_policy policy;
+
+        if(dc_numa_policy_parse(env, err, value, &policy))
         {
-            // TODO: what do you do if the value doesn't match the regex
+            dc_numa_policy_format(env, &policy, buffer, sizeof(buffer));
         }
     }
 
-    return ret_val;
-}
-
-const char *dc_setting_regex_get(const struct dc_env *env, struct dc_setting_regex *setting)
-{
-    DC_TRACE(env);
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
 
-    return setting->string;
+    return dc_settings_intern(env, err, buffer);
 }
 
-struct dc_setting_bool *dc_setting_bool_create(const struct dc_env *env, struct dc_error *err)
+// called with intern_lock held
+static bool grow_intern_buckets(const struct dc_env *env, struct dc_error *err)
 {
-    struct dc_setting_bool *setting;
+    struct interned_string **grown;
+    size_t count;
 
-    DC_TRACE(env);
-    setting = dc_malloc(env, err, sizeof(struct dc_setting_bool));
+    count = intern_bucket_count ? intern_bucket_count * 2 : 64;
+    grown = dc_calloc(env, err, count, sizeof(struct interned_string *));
 
-    if(dc_error_has_no_error(err))
+    if(dc_error_has_error(err))
     {
-        setting->parent.type = DC_SETTING_NONE;
-        setting->value = false;
+        return false;
     }
 
-    return setting;
-}
+    for(size_t i = 0; i < intern_bucket_count; i++)
+    {
+        struct interned_string *interned;
+        struct interned_string *next;
 
-void dc_setting_bool_destroy(const struct dc_env *env, struct dc_setting_bool **psetting)
-{
-    DC_TRACE(env);
-    dc_free(env, *psetting);
-    *psetting = NULL;
+        for(interned = intern_buckets[i]; interned; interned = next)
+        {
+            next = interned->next;
+            interned->next = grown[interned->hash % count];
+            grown[interned->hash % count] = interned;
+        }
+    }
+
+    dc_free(env, intern_buckets);
+    intern_buckets = grown;
+    intern_bucket_count = count;
+
+    return true;
 }
 
-bool dc_setting_bool_set(const struct dc_env *env,
-                         struct dc_setting_bool *setting,
-                         bool value,
-                         dc_setting_type type)
+// FNV-1a
+static size_t hash_string(const char *string)
 {
-    bool ret_val;
+    uint64_t hash;
 
-    DC_TRACE(env);
+    hash = UINT64_C(14695981039346656037);
 
-    if(setting->parent.type == DC_SETTING_NONE)
+    for(const unsigned char *c = (const unsigned char *)string; *c; c++)
     {
-        setting->parent.type = type;
-        setting->value = value;
-        ret_val = true;
-    }
-    else
-    {
-        ret_val = false;
+        hash ^= *c;
+        hash *= UINT64_C(1099511628211);
     }
 
-    return ret_val;
+    return (size_t)hash;
 }
 
-bool dc_setting_bool_get(const struct dc_env *env, struct dc_setting_bool *setting)
+static bool add_setting(const struct dc_env *env,
+                        struct dc_error *err,
+                        struct dc_setting ***psettings,
+                        size_t *count,
+                        size_t *capacity,
+                        struct dc_setting *setting)
 {
-    DC_TRACE(env);
+    for(size_t i = 0; i < *count; i++)
+    {
+        if((*psettings)[i] == setting)
+        {
+            return false;
+        }
+    }
+
+    if(*count == *capacity)
+    {
+        struct dc_setting **grown;
+        size_t new_capacity;
+
+        new_capacity = *capacity ? *capacity * 2 : 8;
+        grown = dc_realloc(env, err, *psettings, new_capacity * sizeof(struct dc_setting *));
 
-    return setting->value;
+        if(dc_error_has_error(err))
+        {
+            return false;
+        }
+
+        *psettings = grown;
+        *capacity = new_capacity;
+    }
+
+    (*psettings)[*count] = setting;
+    (*count)++;
+
+    return true;
 }
 
-struct dc_setting_uint16 *dc_setting_uint16_create(const struct dc_env *env, struct dc_error *err)
+// called with update_lock held by the transaction
+static struct notification *build_notifications(const struct dc_env *env, struct dc_error *err)
 {
-    struct dc_setting_uint16 *setting;
+    struct notification *notifications;
 
-    DC_TRACE(env);
-    setting = dc_malloc(env, err, sizeof(struct dc_setting_uint16));
+    notifications = NULL;
 
-    if(dc_error_has_no_error(err))
+    for(size_t i = 0; i < changed_count && dc_error_has_no_error(err); i++)
     {
-        setting->parent.type = DC_SETTING_NONE;
-        setting->value = 0;
+        for(struct dc_setting_subscription *subscription = subscriptions; subscription; subscription = subscription->next)
+        {
+            struct notification *notification;
+
+            if(subscription->setting != changed_settings[i])
+            {
+                continue;
+            }
+
+            for(notification = notifications; notification; notification = notification->next)
+            {
+                if(notification->callback == subscription->callback && notification->ctx == subscription->ctx &&
+                   notification->notifier == subscription->notifier)
+                {
+                    break;
+                }
+            }
+
+            if(notification == NULL)
+            {
+                notification = dc_calloc(env, err, 1, sizeof(struct notification));
+
+                if(dc_error_has_error(err))
+                {
+                    break;
+                }
+
+                notification->callback = subscription->callback;
+                notification->ctx = subscription->ctx;
+                notification->notifier = subscription->notifier;
+                notification->next = notifications;
+                notifications = notification;
+            }
+
+            add_setting(env, err, &notification->settings, &notification->count, &notification->capacity, changed_settings[i]);
+        }
     }
 
-    return setting;
+    return notifications;
 }
 
-void dc_setting_uint16_destroy(const struct dc_env *env, struct dc_setting_uint16 **psetting)
+static void deliver_notifications(const struct dc_env *env, struct dc_error *err, struct notification *notifications)
 {
-    DC_TRACE(env);
-    dc_free(env, *psetting);
-    *psetting = NULL;
+    while(notifications)
+    {
+        struct notification *next;
+
+        next = notifications->next;
+
+        if(notifications->notifier)
+        {
+            queue_notification(env, err, notifications);
+        }
+        else
+        {
+            notifications->callback(env, notifications->settings, notifications->count, notifications->ctx);
+            free_notification(env, notifications);
+        }
+
+        notifications = next;
+    }
 }
 
-bool dc_setting_uint16_set(const struct dc_env *env,
-                           struct dc_setting_uint16 *setting,
-                           uint16_t value,
-                           dc_setting_type type)
+static void queue_notification(const struct dc_env *env, struct dc_error *err, struct notification *notification)
 {
-    bool ret_val;
+    struct dc_settings_notifier *notifier;
+    struct notification *pending;
+    struct dc_error wake_err;
+    char wake;
 
-    DC_TRACE(env);
+    notifier = notification->notifier;
+    pthread_mutex_lock(&notifier->lock);
 
-    if(setting->parent.type == DC_SETTING_NONE)
+    for(pending = notifier->pending; pending; pending = pending->next)
     {
-        setting->parent.type = type;
-        setting->value = value;
-        ret_val = true;
+        if(pending->callback == notification->callback && pending->ctx == notification->ctx)
+        {
+            break;
+        }
+    }
+
+    if(pending)
+    {
+        for(size_t i = 0; i < notification->count; i++)
+        {
+            add_setting(env, err, &pending->settings, &pending->count, &pending->capacity, notification->settings[i]);
+        }
+
+        free_notification(env, notification);
     }
     else
     {
-        ret_val = false;
+        notification->next = notifier->pending;
+        notifier->pending = notification;
     }
 
-    return ret_val;
+    pthread_mutex_unlock(&notifier->lock);
+    wake = 1;
+    dc_error_init(&wake_err, NULL);
+    dc_write(env, &wake_err, notifier->fds[1], &wake, sizeof(wake));
+    dc_error_reset(&wake_err);
 }
 
-uint16_t dc_setting_uint16_get(const struct dc_env *env, struct dc_setting_uint16 *setting)
+static void free_notification(const struct dc_env *env, struct notification *notification)
 {
-    DC_TRACE(env);
+    if(notification->settings)
+    {
+        dc_free(env, notification->settings);
+    }
 
-    return setting->value;
+    dc_free(env, notification);
 }
 
-
-struct dc_setting_in_port_t *dc_setting_in_port_t_create(const struct dc_env *env, struct dc_error *err)
+// called with update_lock held by the transaction, the commit stamps the generation
+static void retire_value(const struct dc_env *env, struct dc_error *err, const char *string, struct dc_list *list, int fd)
 {
-    struct dc_setting_in_port_t *setting;
+    struct retired_value *retired;
 
-    DC_TRACE(env);
-    setting = dc_malloc(env, err, sizeof(struct dc_setting_uint16));
+    retired = dc_malloc(env, err, sizeof(struct retired_value));
 
     if(dc_error_has_no_error(err))
     {
-        setting->parent.type = DC_SETTING_NONE;
-        setting->value = 0;
+        retired->retired_at = 0;
+        retired->string = string;
+        retired->list = list;
+        retired->fd = fd;
+        retired->next = retired_values;
+        retired_values = retired;
     }
-
-    return setting;
-}
-
-void dc_setting_in_port_t_destroy(const struct dc_env *env,  struct dc_setting_in_port_t **psetting)
-{
-    DC_TRACE(env);
-    dc_free(env, *psetting);
-    *psetting = NULL;
 }
 
-bool dc_setting_in_port_t_set(const struct dc_env *env, struct dc_setting_in_port_t *setting, in_port_t value, dc_setting_type type)
+static void release_retired(const struct dc_env *env, struct retired_value *retired)
 {
-    bool ret_val;
-
-    DC_TRACE(env);
-
-    if(setting->parent.type == DC_SETTING_NONE)
+    if(retired->string)
     {
-        setting->parent.type = type;
-        setting->value = value;
-        ret_val = true;
+        dc_settings_intern_release(env, retired->string);
     }
-    else
+
+    if(retired->list)
     {
-        ret_val = false;
+        dc_list_destroy(env, &retired->list);
     }
 
-    return ret_val;
-}
+    if(retired->fd != -1)
+    {
+        struct dc_error err;
 
-in_port_t dc_setting_in_port_t_get(const struct dc_env *env, struct dc_setting_in_port_t *setting)
-{
-    DC_TRACE(env);
+        dc_error_init(&err, NULL);
+        dc_close(env, &err, retired->fd);
+        dc_error_reset(&err);
+    }
 
-    return setting->value;
+    dc_free(env, retired);
 }
-
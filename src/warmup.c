@@ -0,0 +1,100 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "dc_application/warmup.h"
+#include <dc_c/dc_stdlib.h>
+#include <dc_posix/dc_fcntl.h>
+#include <dc_posix/dc_unistd.h>
+#include <dc_posix/sys/dc_mman.h>
+
+
+// how much of a file is read at a time when it is loaded into the page cache
+#define READ_SIZE (128U * 1024U)
+
+
+void dc_warmup_lock_memory(const struct dc_env *env, struct dc_error *err)
+{
+    DC_TRACE(env);
+    dc_mlockall(env, err, MCL_CURRENT | MCL_FUTURE);
+}
+
+void dc_warmup_prefault(const struct dc_env *env, struct dc_error *err, void *addr, size_t length)
+{
+    volatile char *bytes;
+    size_t page_size;
+
+    DC_TRACE(env);
+    page_size = (size_t)dc_sysconf(env, err, _SC_PAGESIZE);
+
+    if(dc_error_has_error(err))
+    {
+        return;
+    }
+
+    bytes = addr;
+
+    // a write is needed, reading an untouched anonymous page only maps the shared zero page
+    for(size_t offset = 0; offset < length; offset += page_size)
+    {
+        bytes[offset] = bytes[offset];
+    }
+
+    if(length > 0)
+    {
+        bytes[length - 1] = bytes[length - 1];
+    }
+}
+
+void dc_warmup_file(const struct dc_env *env, struct dc_error *err, const char *path)
+{
+    char *buffer;
+    int fd;
+
+    DC_TRACE(env);
+    fd = dc_open(env, err, path, O_RDONLY | O_CLOEXEC);
+
+    if(dc_error_has_error(err))
+    {
+        return;
+    }
+
+    buffer = dc_malloc(env, err, READ_SIZE);
+
+    if(dc_error_has_no_error(err))
+    {
+        ssize_t nread;
+
+        // the advice widens the kernel's readahead, the reads wait until it is all in
+        dc_posix_fadvise(env, err, fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        do
+        {
+            nread = dc_read(env, err, fd, buffer, READ_SIZE);
+        }
+        while(nread > 0);
+
+        dc_free(env, buffer);
+    }
+
+    {
+        struct dc_error close_err;
+
+        dc_error_init(&close_err, NULL);
+        dc_close(env, &close_err, fd);
+        dc_error_reset(&close_err);
+    }
+}
@@ -0,0 +1,907 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "dc_application/zygote.h"
+#include "dc_application/command_line.h"
+#include "dc_application/local_socket.h"
+#include "dc_application/options.h"
+#include "dc_application/settings.h"
+#include <dc_c/dc_stdlib.h>
+#include <dc_c/dc_string.h>
+#include <dc_posix/dc_poll.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_unistd.h>
+#include <dc_posix/sys/dc_socket.h>
+#include <dc_posix/sys/dc_wait.h>
+#include <errno.h>
+
+
+// how long the zygote waits for a request before reaping the children that exited
+#define REAP_INTERVAL_MS 1000
+
+struct dc_zygote_request
+{
+    int fd;
+    char *buffer;
+    int argc;
+    char **argv;
+    uint32_t envc;
+    char *envp;
+};
+
+struct children
+{
+    pid_t *pids;
+    size_t count;
+    size_t capacity;
+};
+
+
+static struct dc_zygote_request *read_request(const struct dc_env *env,
+                                              struct dc_error *err,
+                                              int client_fd,
+                                              int *fds,
+                                              size_t *fd_count,
+                                              uint32_t *fd_mask);
+static size_t receive_length(const struct dc_env *env, int client_fd, uint32_t *length, int *fds);
+static bool split_request(const struct dc_env *env, struct dc_error *err, struct dc_zygote_request *request, uint32_t length);
+static void start_child(const struct dc_env *env,
+                        struct dc_error *err,
+                        struct dc_application_settings *settings,
+                        struct dc_zygote_request *request,
+                        const int *fds,
+                        size_t fd_count,
+                        uint32_t fd_mask);
+static void apply_environment(const struct dc_env *env,
+                              struct dc_error *err,
+                              struct dc_opt_settings *opt_settings,
+                              struct dc_zygote_request *request);
+static void apply_arguments(const struct dc_env *env,
+                            struct dc_error *err,
+                            struct dc_opt_settings *opt_settings,
+                            struct dc_zygote_request *request);
+static void add_child(const struct dc_env *env, struct children *children, pid_t pid);
+static void reap_children(const struct dc_env *env, struct children *children);
+static void close_fds(const struct dc_env *env, const int *fds, size_t fd_count);
+static bool read_fully(const struct dc_env *env, int fd, void *buffer, size_t length);
+static bool write_fully(const struct dc_env *env, int fd, const void *buffer, size_t length);
+
+
+struct dc_zygote_request *dc_zygote_serve(const struct dc_env *env,
+                                          struct dc_error *err,
+                                          struct dc_application_settings *settings,
+                                          const char *path)
+{
+    struct children children;
+    int listen_fd;
+
+    DC_TRACE(env);
+    listen_fd = dc_local_socket_listen(env, err, path);
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    dc_memset(env, &children, 0, sizeof(children));
+
+    while(true)
+    {
+        struct dc_zygote_request *request;
+        struct pollfd fds[1];
+        struct dc_error local_err;
+        int passed_fds[DC_ZYGOTE_MAX_FDS];
+        size_t fd_count;
+        uint32_t fd_mask;
+        int client_fd;
+        pid_t pid;
+
+        reap_children(env, &children);
+        fds[0].fd = listen_fd;
+        fds[0].events = POLLIN;
+        dc_error_init(&local_err, NULL);
+
+        if(dc_poll(env, &local_err, fds, 1, REAP_INTERVAL_MS) <= 0)
+        {
+            dc_error_reset(&local_err);
+            continue;
+        }
+
+        client_fd = dc_accept(env, &local_err, listen_fd, NULL, NULL);
+
+        if(dc_error_has_error(&local_err))
+        {
+            dc_error_reset(&local_err);
+            continue;
+        }
+
+        // a child runs as the zygote with the settings it resolved, only the same user may ask for one
+        if(!(dc_local_socket_is_peer_trusted(env, client_fd)))
+        {
+            dc_close(env, &local_err, client_fd);
+            dc_error_reset(&local_err);
+            continue;
+        }
+
+        fd_count = 0;
+        request = read_request(env, &local_err, client_fd, passed_fds, &fd_count, &fd_mask);
+
+        if(request == NULL)
+        {
+            bool stop;
+
+            // a request that could not be read is dropped, a well formed empty one is the stop request
+            stop = dc_error_has_no_error(&local_err);
+            close_fds(env, passed_fds, fd_count);
+            dc_close(env, &local_err, client_fd);
+            dc_error_reset(&local_err);
+
+            if(stop)
+            {
+                break;
+            }
+
+            continue;
+        }
+
+        pid = dc_fork(env, &local_err);
+
+        if(pid == 0)
+        {
+            dc_close(env, &local_err, listen_fd);
+            dc_error_reset(&local_err);
+            dc_free(env, children.pids);
+            start_child(env, err, settings, request, passed_fds, fd_count, fd_mask);
+
+            return request;
+        }
+
+        if(pid > 0)
+        {
+            add_child(env, &children, pid);
+        }
+
+        close_fds(env, passed_fds, fd_count);
+        dc_zygote_request_destroy(env, &request);
+        dc_error_reset(&local_err);
+    }
+
+    {
+        struct dc_error local_err;
+
+        dc_error_init(&local_err, NULL);
+        dc_close(env, &local_err, listen_fd);
+        dc_unlink(env, &local_err, path);
+        dc_error_reset(&local_err);
+    }
+
+    // the children that are still running finish on their own
+    dc_free(env, children.pids);
+
+    return NULL;
+}
+
+void dc_zygote_request_reply(const struct dc_env *env, struct dc_zygote_request *request, int status)
+{
+    struct dc_error err;
+    uint32_t value;
+
+    DC_TRACE(env);
+
+    if(request->fd == -1)
+    {
+        return;
+    }
+
+    value = htonl((uint32_t)status);
+    write_fully(env, request->fd, &value, sizeof(value));
+    dc_error_init(&err, NULL);
+    dc_close(env, &err, request->fd);
+    dc_error_reset(&err);
+    request->fd = -1;
+}
+
+void dc_zygote_request_destroy(const struct dc_env *env, struct dc_zygote_request **prequest)
+{
+    struct dc_zygote_request *request;
+
+    DC_TRACE(env);
+    request = *prequest;
+
+    if(request->fd != -1)
+    {
+        struct dc_error err;
+
+        dc_error_init(&err, NULL);
+        dc_close(env, &err, request->fd);
+        dc_error_reset(&err);
+    }
+
+    dc_free(env, request->argv);
+    dc_free(env, request->buffer);
+    dc_free(env, request);
+    *prequest = NULL;
+}
+
+int dc_zygote_spawn(const struct dc_env *env,
+                    struct dc_error *err,
+                    const char *path,
+                    char *const argv[],
+                    char *const envp[],
+                    const int fds[DC_ZYGOTE_MAX_FDS],
+                    pid_t *pid)
+{
+    union
+    {
+        struct cmsghdr align;
+        char buffer[CMSG_SPACE(sizeof(int) * DC_ZYGOTE_MAX_FDS)];
+    } control;
+    struct msghdr message;
+    struct iovec iov;
+    uint32_t header[4];
+    char *frame;
+    size_t length;
+    size_t argc;
+    size_t envc;
+    size_t fd_count;
+    uint32_t fd_mask;
+    int fd;
+
+    DC_TRACE(env);
+    length = sizeof(uint32_t) * 3;
+    fd_count = 0;
+    fd_mask = 0;
+
+    for(argc = 0; argv[argc]; argc++)
+    {
+        length += dc_strlen(env, argv[argc]) + 1;
+    }
+
+    for(envc = 0; envp && envp[envc]; envc++)
+    {
+        length += dc_strlen(env, envp[envc]) + 1;
+    }
+
+    if(length > DC_ZYGOTE_MAX_FRAME)
+    {
+        DC_ERROR_RAISE_USER(err, "zygote request is too long", E2BIG);
+
+        return -1;
+    }
+
+    frame = dc_malloc(env, err, sizeof(uint32_t) + length);
+
+    if(dc_error_has_error(err))
+    {
+        return -1;
+    }
+
+    dc_memset(env, &control, 0, sizeof(control));
+
+    for(size_t i = 0; fds && i < DC_ZYGOTE_MAX_FDS; i++)
+    {
+        if(fds[i] != -1)
+        {
+            dc_memcpy(env, (int *)CMSG_DATA(&control.align) + fd_count, &fds[i], sizeof(int));    // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+            fd_count++;
+            fd_mask |= 1U << i;
+        }
+    }
+
+    header[0] = htonl((uint32_t)length);
+    header[1] = htonl((uint32_t)argc);
+    header[2] = htonl((uint32_t)envc);
+    header[3] = htonl(fd_mask);
+    dc_memcpy(env, frame, header, sizeof(header));
+    length = sizeof(header);
+
+    for(size_t i = 0; i < argc; i++)
+    {
+        size_t arg_length;
+
+        arg_length = dc_strlen(env, argv[i]) + 1;
+        dc_memcpy(env, &frame[length], argv[i], arg_length);
+        length += arg_length;
+    }
+
+    for(size_t i = 0; i < envc; i++)
+    {
+        size_t env_length;
+
+        env_length = dc_strlen(env, envp[i]) + 1;
+        dc_memcpy(env, &frame[length], envp[i], env_length);
+        length += env_length;
+    }
+
+    fd = dc_local_socket_connect(env, err, path);
+
+    if(dc_error_has_no_error(err))
+    {
+        // the descriptors go with the first byte, the rest of the frame is written as a stream
+        dc_memset(env, &message, 0, sizeof(message));
+        iov.iov_base = frame;
+        iov.iov_len = 1;
+        message.msg_iov = &iov;
+        message.msg_iovlen = 1;
+
+        if(fd_count > 0)
+        {
+            control.align.cmsg_level = SOL_SOCKET;
+            control.align.cmsg_type = SCM_RIGHTS;
+            control.align.cmsg_len = CMSG_LEN(sizeof(int) * fd_count);
+            message.msg_control = control.buffer;
+            message.msg_controllen = CMSG_SPACE(sizeof(int) * fd_count);
+        }
+
+        dc_sendmsg(env, err, fd, &message, 0);
+    }
+
+    if(dc_error_has_no_error(err) && !(write_fully(env, fd, &frame[1], length - 1)))
+    {
+        DC_ERROR_RAISE_USER(err, "could not send the zygote request", EPIPE);
+    }
+
+    if(dc_error_has_no_error(err))
+    {
+        uint32_t child;
+
+        if(read_fully(env, fd, &child, sizeof(child)))
+        {
+            *pid = (pid_t)ntohl(child);
+        }
+        else
+        {
+            DC_ERROR_RAISE_USER(err, "the zygote did not start a child", ECHILD);
+        }
+    }
+
+    dc_free(env, frame);
+
+    if(dc_error_has_error(err) && fd != -1)
+    {
+        struct dc_error close_err;
+
+        dc_error_init(&close_err, NULL);
+        dc_close(env, &close_err, fd);
+        dc_error_reset(&close_err);
+        fd = -1;
+    }
+
+    return fd;
+}
+
+bool dc_zygote_wait(const struct dc_env *env, struct dc_error *err, int fd, int *status)
+{
+    uint32_t value;
+    bool finished;
+
+    DC_TRACE(env);
+    finished = read_fully(env, fd, &value, sizeof(value));
+
+    if(finished)
+    {
+        *status = (int)ntohl(value);
+    }
+
+    dc_close(env, err, fd);
+
+    return finished;
+}
+
+void dc_zygote_stop(const struct dc_env *env, struct dc_error *err, const char *path)
+{
+    uint32_t length;
+    int fd;
+
+    DC_TRACE(env);
+    fd = dc_local_socket_connect(env, err, path);
+
+    if(dc_error_has_error(err))
+    {
+        return;
+    }
+
+    length = 0;
+
+    if(!(write_fully(env, fd, &length, sizeof(length))))
+    {
+        DC_ERROR_RAISE_USER(err, "could not send the zygote stop request", EPIPE);
+    }
+
+    {
+        struct dc_error close_err;
+
+        dc_error_init(&close_err, NULL);
+        dc_close(env, &close_err, fd);
+        dc_error_reset(&close_err);
+    }
+}
+
+static struct dc_zygote_request *read_request(const struct dc_env *env,
+                                              struct dc_error *err,
+                                              int client_fd,
+                                              int *fds,
+                                              size_t *fd_count,
+                                              uint32_t *fd_mask)
+{
+    struct dc_zygote_request *request;
+    uint32_t length;
+    uint32_t header[3];
+
+    DC_TRACE(env);
+    *fd_count = receive_length(env, client_fd, &length, fds);
+    length = ntohl(length);
+
+    if(length == 0)
+    {
+        return NULL;
+    }
+
+    if(length < sizeof(header) || length > DC_ZYGOTE_MAX_FRAME || !(read_fully(env, client_fd, header, sizeof(header))))
+    {
+        DC_ERROR_RAISE_USER(err, "bad zygote request", EINVAL);
+
+        return NULL;
+    }
+
+    length -= (uint32_t)sizeof(header);
+    *fd_mask = ntohl(header[2]);
+    request = dc_calloc(env, err, 1, sizeof(struct dc_zygote_request));
+
+    if(dc_error_has_error(err))
+    {
+        return NULL;
+    }
+
+    request->fd = client_fd;
+    request->argc = (int)ntohl(header[0]);
+    request->envc = ntohl(header[1]);
+    request->buffer = dc_malloc(env, err, (size_t)length + 1);
+
+    if(dc_error_has_no_error(err))
+    {
+        if(!(read_fully(env, client_fd, request->buffer, length)))
+        {
+            DC_ERROR_RAISE_USER(err, "bad zygote request", EINVAL);
+        }
+        else
+        {
+            request->buffer[length] = '\0';
+            split_request(env, err, request, length);
+        }
+    }
+
+    if(dc_error_has_error(err))
+    {
+        // the caller still owns the connection
+        request->fd = -1;
+        dc_zygote_request_destroy(env, &request);
+    }
+
+    return request;
+}
+
+static size_t receive_length(const struct dc_env *env, int client_fd, uint32_t *length, int *fds)
+{
+    union
+    {
+        struct cmsghdr align;
+        char buffer[CMSG_SPACE(sizeof(int) * DC_ZYGOTE_MAX_FDS)];
+    } control;
+    struct msghdr message;
+    struct iovec iov;
+    struct dc_error err;
+    struct cmsghdr *header;
+    ssize_t nread;
+    size_t fd_count;
+
+    DC_TRACE(env);
+    dc_memset(env, &message, 0, sizeof(message));
+    iov.iov_base = length;
+    iov.iov_len = sizeof(*length);
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+    fd_count = 0;
+    *length = 0;
+    dc_error_init(&err, NULL);
+    nread = dc_recvmsg(env, &err, client_fd, &message, 0);
+    dc_error_reset(&err);
+
+    if(nread <= 0)
+    {
+        // reads as a bad request since the length cannot be 0 and too short at once
+        *length = htonl(1);
+
+        return 0;
+    }
+
+    for(header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header))
+    {
+        if(header->cmsg_level == SOL_SOCKET && header->cmsg_type == SCM_RIGHTS)
+        {
+            size_t count;
+
+            count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+
+            for(size_t i = 0; i < count && fd_count < DC_ZYGOTE_MAX_FDS; i++)
+            {
+                dc_memcpy(env, &fds[fd_count], (int *)CMSG_DATA(header) + i, sizeof(int));   // NOLINT(cppcoreguidelines-pro-type-cstyle-cast)
+                fd_count++;
+            }
+        }
+    }
+
+    if((size_t)nread < sizeof(*length) && !(read_fully(env, client_fd, (char *)length + nread, sizeof(*length) - (size_t)nread)))
+    {
+        *length = htonl(1);
+    }
+
+    return fd_count;
+}
+
+static bool split_request(const struct dc_env *env, struct dc_error *err, struct dc_zygote_request *request, uint32_t length)
+{
+    char *next;
+    char *end;
+
+    DC_TRACE(env);
+
+    // every string has to end inside the frame, the counts cannot be trusted until they have been checked against it
+    if(request->argc < 1 || (size_t)request->argc + request->envc > length)
+    {
+        DC_ERROR_RAISE_USER(err, "bad zygote request", EINVAL);
+
+        return false;
+    }
+
+    request->argv = dc_calloc(env, err, (size_t)request->argc + 1, sizeof(char *));
+
+    if(dc_error_has_error(err))
+    {
+        return false;
+    }
+
+    next = request->buffer;
+    end = &request->buffer[length];
+
+    for(size_t i = 0; i < (size_t)request->argc + request->envc; i++)
+    {
+        if(next >= end)
+        {
+            DC_ERROR_RAISE_USER(err, "bad zygote request", EINVAL);
+
+            return false;
+        }
+
+        if(i < (size_t)request->argc)
+        {
+            request->argv[i] = next;
+        }
+        else if(i == (size_t)request->argc)
+        {
+            request->envp = next;
+        }
+
+        next += dc_strlen(env, next) + 1;
+    }
+
+    if(next > end)
+    {
+        DC_ERROR_RAISE_USER(err, "bad zygote request", EINVAL);
+
+        return false;
+    }
+
+    return true;
+}
+
+static void start_child(const struct dc_env *env,
+                        struct dc_error *err,
+                        struct dc_application_settings *settings,
+                        struct dc_zygote_request *request,
+                        const int *fds,
+                        size_t fd_count,
+                        uint32_t fd_mask)
+{
+    struct dc_opt_settings *opt_settings;
+    uint32_t pid;
+    size_t next_fd;
+
+    DC_TRACE(env);
+    next_fd = 0;
+
+    // the descriptors came in order of the bits set in the mask
+    for(int i = 0; i < DC_ZYGOTE_MAX_FDS && next_fd < fd_count; i++)
+    {
+        if(fd_mask & (1U << i))
+        {
+            dc_dup2(env, err, fds[next_fd], i);
+            next_fd++;
+        }
+    }
+
+    // the copies are all the child needs, a received descriptor is only kept if it already was in its place
+    for(size_t i = 0; i < fd_count; i++)
+    {
+        if(fds[i] >= DC_ZYGOTE_MAX_FDS || !(fd_mask & (1U << fds[i])))
+        {
+            struct dc_error close_err;
+
+            dc_error_init(&close_err, NULL);
+            dc_close(env, &close_err, fds[i]);
+            dc_error_reset(&close_err);
+        }
+    }
+
+    pid = htonl((uint32_t)dc_getpid(env));
+    write_fully(env, request->fd, &pid, sizeof(pid));
+    opt_settings = (struct dc_opt_settings *)settings;
+
+    if(dc_error_has_error(err))
+    {
+        return;
+    }
+
+    if(opt_settings == NULL)
+    {
+        apply_environment(env, err, NULL, request);
+
+        return;
+    }
+
+    // the request is a layer over what the zygote resolved, committed as one change
+    dc_settings_transaction_begin(env);
+    apply_environment(env, err, opt_settings, request);
+
+    if(dc_error_has_no_error(err))
+    {
+        apply_arguments(env, err, opt_settings, request);
+    }
+
+    dc_settings_transaction_commit(env, err);
+}
+
+static void apply_environment(const struct dc_env *env,
+                              struct dc_error *err,
+                              struct dc_opt_settings *opt_settings,
+                              struct dc_zygote_request *request)
+{
+    const char *prefix;
+    size_t prefix_len;
+    char *variable;
+
+    DC_TRACE(env);
+    prefix = opt_settings ? opt_settings->env_prefix : NULL;
+    prefix_len = prefix ? dc_strlen(env, prefix) : 0;
+    variable = request->envp;
+
+    for(uint32_t i = 0; i < request->envc && dc_error_has_no_error(err); i++)
+    {
+        char *equals;
+        size_t length;
+
+        length = dc_strlen(env, variable);
+        equals = dc_strchr(env, variable, '=');
+
+        if(equals)
+        {
+            *equals = '\0';
+            dc_setenv(env, err, variable, &equals[1], 1);
+            *equals = '=';
+        }
+
+        if(equals && prefix && dc_strncmp(env, variable, prefix, prefix_len) == 0)
+        {
+            const struct options *opt;
+            const char *key;
+
+            key = &variable[prefix_len];
+            opt = dc_options_find_env(env, opt_settings, key, (size_t)(equals - key));
+
+            if(opt)
+            {
+                struct dc_setting *setting;
+
+                setting = dc_options_get_setting(env, opt_settings, opt);
+
+                // the environment never overrides the command line or runtime changes
+                if(setting->type != DC_SETTING_COMMAND_LINE && setting->type != DC_SETTING_RUNTIME)
+                {
+                    const void *value;
+
+                    value = opt->read_from_string(env, err, &equals[1]);
+
+                    if(dc_error_has_no_error(err) && dc_options_check_range(env, err, opt_settings, opt, value))
+                    {
+                        dc_setting_update(env, err, setting, value, DC_SETTING_ENVIRONMENT);
+                    }
+                }
+            }
+        }
+
+        variable += length + 1;
+    }
+}
+
+static void apply_arguments(const struct dc_env *env,
+                            struct dc_error *err,
+                            struct dc_opt_settings *opt_settings,
+                            struct dc_zygote_request *request)
+{
+    struct dc_command_line_parser parser;
+    const struct options *opt;
+    const char *arg;
+
+    DC_TRACE(env);
+    dc_command_line_parser_init(env, &parser, opt_settings, request->argc, request->argv);
+
+    while(dc_command_line_parser_next(env, err, &parser, &opt, &arg))
+    {
+        const void *value;
+
+        value = opt->read_from_string(env, err, arg);
+
+        if(dc_error_has_no_error(err) && dc_options_check_range(env, err, opt_settings, opt, value))
+        {
+            dc_setting_update(env, err, dc_options_get_setting(env, opt_settings, opt), value, DC_SETTING_COMMAND_LINE);
+        }
+
+        if(dc_error_has_error(err))
+        {
+            break;
+        }
+    }
+
+    // the operands are the request's, the zygote's own response files are not needed in the child
+    if(opt_settings->response_files)
+    {
+        dc_command_line_release_response_files(env, &opt_settings->response_files);
+    }
+
+    opt_settings->optind = parser.optind;
+    opt_settings->argc = request->argc;
+    opt_settings->argv = request->argv;
+    opt_settings->response_files = parser.response_files;
+}
+
+static void add_child(const struct dc_env *env, struct children *children, pid_t pid)
+{
+    DC_TRACE(env);
+
+    if(children->count == children->capacity)
+    {
+        struct dc_error err;
+        pid_t *pids;
+        size_t capacity;
+
+        capacity = children->capacity ? children->capacity * 2 : 16;
+        dc_error_init(&err, NULL);
+        pids = dc_realloc(env, &err, children->pids, capacity * sizeof(pid_t));
+
+        // without room to remember it the child is reaped by whoever inherits it
+        if(dc_error_has_error(&err))
+        {
+            dc_error_reset(&err);
+
+            return;
+        }
+
+        children->pids = pids;
+        children->capacity = capacity;
+    }
+
+    children->pids[children->count] = pid;
+    children->count++;
+}
+
+// only the zygote's own children are waited for, anything the warmup started is left to the application
+static void reap_children(const struct dc_env *env, struct children *children)
+{
+    size_t i;
+
+    DC_TRACE(env);
+    i = 0;
+
+    while(i < children->count)
+    {
+        struct dc_error err;
+        pid_t pid;
+
+        dc_error_init(&err, NULL);
+        pid = dc_waitpid(env, &err, children->pids[i], NULL, WNOHANG);
+        dc_error_reset(&err);
+
+        if(pid == 0)
+        {
+            i++;
+        }
+        else
+        {
+            children->count--;
+            children->pids[i] = children->pids[children->count];
+        }
+    }
+}
+
+static void close_fds(const struct dc_env *env, const int *fds, size_t fd_count)
+{
+    struct dc_error err;
+
+    DC_TRACE(env);
+    dc_error_init(&err, NULL);
+
+    for(size_t i = 0; i < fd_count; i++)
+    {
+        dc_close(env, &err, fds[i]);
+    }
+
+    dc_error_reset(&err);
+}
+
+static bool read_fully(const struct dc_env *env, int fd, void *buffer, size_t length)
+{
+    size_t total;
+
+    total = 0;
+
+    while(total < length)
+    {
+        struct dc_error err;
+        ssize_t nread;
+
+        dc_error_init(&err, NULL);
+        nread = dc_read(env, &err, fd, (char *)buffer + total, length - total);
+        dc_error_reset(&err);
+
+        if(nread <= 0)
+        {
+            return false;
+        }
+
+        total += (size_t)nread;
+    }
+
+    return true;
+}
+
+static bool write_fully(const struct dc_env *env, int fd, const void *buffer, size_t length)
+{
+    size_t total;
+
+    total = 0;
+
+    while(total < length)
+    {
+        struct dc_error err;
+        ssize_t nwrote;
+
+        dc_error_init(&err, NULL);
+        nwrote = dc_write(env, &err, fd, (const char *)buffer + total, length - total);
+        dc_error_reset(&err);
+
+        if(nwrote <= 0)
+        {
+            return false;
+        }
+
+        total += (size_t)nwrote;
+    }
+
+    return true;
+}
@@ -8,6 +8,26 @@ int main(int argc, char **argv)
     int suite_result;
 
     suite = create_test_suite();
+    add_suite(suite, affinity_tests());
+    add_suite(suite, allocator_tests());
+    add_suite(suite, application_tests());
+    add_suite(suite, command_line_tests());
+    add_suite(suite, component_tests());
+    add_suite(suite, config_load_tests());
+    add_suite(suite, control_tests());
+    add_suite(suite, intern_tests());
+    add_suite(suite, list_tests());
+    add_suite(suite, matcher_tests());
+    add_suite(suite, memory_tests());
+    add_suite(suite, notify_tests());
+    add_suite(suite, parse_tests());
+    add_suite(suite, provider_tests());
+    add_suite(suite, schema_index_tests());
+    add_suite(suite, segment_tests());
+    add_suite(suite, snapshot_tests());
+    add_suite(suite, subscription_tests());
+    add_suite(suite, warmup_tests());
+    add_suite(suite, zygote_tests());
     reporter = create_text_reporter();
 
     if(argc > 1)
@@ -0,0 +1,190 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "dc_application/affinity.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+
+
+static void *pin(void *arg);
+
+
+Describe(affinity);
+
+static struct dc_env env;
+static struct dc_error err;
+static cpu_set_t pinned;
+
+BeforeEach(affinity)
+{
+    dc_env_init(&env, NULL);
+    dc_error_init(&err, NULL);
+}
+
+AfterEach(affinity)
+{
+    dc_error_reset(&err);
+}
+
+Ensure(affinity, cpuset_ranges)
+{
+    struct dc_cpuset set;
+
+    assert_that(dc_cpuset_parse(&env, &err, "0-3,8,10-11", &set), is_true);
+    assert_that(dc_cpuset_get_count(&env, &set), is_equal_to(7));
+    assert_that(dc_cpuset_get_cpu(&env, &set, 0), is_equal_to(0));
+    assert_that(dc_cpuset_get_cpu(&env, &set, 4), is_equal_to(8));
+    assert_that(dc_cpuset_get_cpu(&env, &set, 6), is_equal_to(11));
+}
+
+Ensure(affinity, cpuset_rejects_bad_input)
+{
+    const char *bad[] = {"", ",", "1,", ",1", "1-", "-1", "3-1", "1 ,2", "1;2", "a", "1-2-3"};
+    struct dc_cpuset set;
+
+    for(size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        struct dc_error local_err;
+
+        dc_error_init(&local_err, NULL);
+        assert_that(dc_cpuset_parse(&env, &local_err, bad[i], &set), is_false);
+        assert_that(dc_error_has_error(&local_err), is_true);
+        dc_error_reset(&local_err);
+    }
+}
+
+Ensure(affinity, cpuset_range_check)
+{
+    struct dc_cpuset set;
+
+    assert_that(dc_cpuset_parse(&env, &err, "1023", &set), is_true);
+    assert_that(dc_cpuset_parse(&env, &err, "1024", &set), is_false);
+    assert_that(dc_error_has_error(&err), is_true);
+    dc_error_reset(&err);
+    assert_that(dc_cpuset_parse(&env, &err, "1000-1024", &set), is_false);
+    assert_that(dc_error_has_error(&err), is_true);
+    dc_error_reset(&err);
+    assert_that(dc_cpuset_parse(&env, &err, "99999999999999999999", &set), is_false);
+    assert_that(dc_error_has_error(&err), is_true);
+}
+
+Ensure(affinity, cpuset_format_round_trips)
+{
+    struct dc_cpuset set;
+    struct dc_cpuset copy;
+    char buffer[64];
+    char small[6];
+    int length;
+
+    assert_that(dc_cpuset_parse(&env, &err, "5,0-2,3,9-10", &set), is_true);
+    length = dc_cpuset_format(&env, &set, buffer, sizeof(buffer));
+    assert_that(buffer, is_equal_to_string("0-3,5,9-10"));
+    assert_that(length, is_equal_to(10));
+    assert_that(dc_cpuset_parse(&env, &err, buffer, &copy), is_true);
+    assert_that(dc_cpuset_get_count(&env, &copy), is_equal_to(dc_cpuset_get_count(&env, &set)));
+
+    // a short buffer is cut between numbers
+    length = dc_cpuset_format(&env, &set, small, sizeof(small));
+    assert_that(length, is_equal_to(10));
+    assert_that(small, is_equal_to_string("0-3,5"));
+}
+
+Ensure(affinity, numa_policies)
+{
+    struct dc_numa_policy policy;
+    char buffer[64];
+
+    assert_that(dc_numa_policy_parse(&env, &err, "local", &policy), is_true);
+    assert_that(policy.mode, is_equal_to(DC_NUMA_LOCAL));
+    assert_that(dc_numa_policy_parse(&env, &err, "interleave:0-1", &policy), is_true);
+    assert_that(policy.mode, is_equal_to(DC_NUMA_INTERLEAVE));
+    dc_numa_policy_format(&env, &policy, buffer, sizeof(buffer));
+    assert_that(buffer, is_equal_to_string("interleave:0-1"));
+}
+
+Ensure(affinity, numa_rejects_bad_input)
+{
+    const char *bad[] = {"", "locall", "local:0", "node", "node:", "node:x", "preferred:0-1", "interleave:1024", "Local"};
+    struct dc_numa_policy policy;
+
+    for(size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        struct dc_error local_err;
+
+        dc_error_init(&local_err, NULL);
+        assert_that(dc_numa_policy_parse(&env, &local_err, bad[i], &policy), is_false);
+        assert_that(dc_error_has_error(&local_err), is_true);
+        dc_error_reset(&local_err);
+    }
+}
+
+Ensure(affinity, pin_worker_wraps_around)
+{
+    cpu_set_t allowed;
+    cpu_set_t after;
+    char str[16];
+    struct dc_cpuset set;
+    pthread_t thread;
+    unsigned int cpu;
+
+    // pin a thread to the first CPU the test may use, worker 5 of a one CPU set wraps around to it
+    sched_getaffinity(0, sizeof(allowed), &allowed);
+    cpu = 0;
+
+    while(!CPU_ISSET(cpu, &allowed))
+    {
+        cpu++;
+    }
+
+    snprintf(str, sizeof(str), "%u", cpu);
+    assert_that(dc_cpuset_parse(&env, &err, str, &set), is_true);
+    pthread_create(&thread, NULL, pin, &set);
+    pthread_join(thread, NULL);
+    assert_that(dc_error_has_no_error(&err), is_true);
+    assert_that(CPU_COUNT(&pinned), is_equal_to(1));
+    assert_that(CPU_ISSET(cpu, &pinned), is_true);
+
+    // the thread that started it is left alone
+    sched_getaffinity(0, sizeof(after), &after);
+    assert_that(CPU_EQUAL(&allowed, &after), is_true);
+}
+
+TestSuite *affinity_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, affinity, cpuset_ranges);
+    add_test_with_context(suite, affinity, cpuset_rejects_bad_input);
+    add_test_with_context(suite, affinity, cpuset_range_check);
+    add_test_with_context(suite, affinity, cpuset_format_round_trips);
+    add_test_with_context(suite, affinity, numa_policies);
+    add_test_with_context(suite, affinity, numa_rejects_bad_input);
+    add_test_with_context(suite, affinity, pin_worker_wraps_around);
+
+    return suite;
+}
+
+static void *pin(void *arg)
+{
+    dc_affinity_pin_worker(&env, &err, arg, 5);
+    sched_getaffinity(0, sizeof(pinned), &pinned);
+
+    return NULL;
+}
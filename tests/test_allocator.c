@@ -0,0 +1,128 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "test_schema.h"
+#include "dc_application/allocator.h"
+#include "dc_application/application.h"
+#include "dc_application/defaults.h"
+#include "dc_application/schema.h"
+#include <dc_posix/dc_stdlib.h>
+
+
+DC_SCHEMA_STRUCT(allocator_settings, TEST_SCHEMA)
+DC_SCHEMA_DEFINE(allocator_settings, TEST_SCHEMA, "TEST_")
+
+
+static void run_application(void);
+static int run(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings);
+
+
+Describe(allocator);
+
+static struct dc_env test_env;
+static struct dc_error test_err;
+static bool ran;
+
+BeforeEach(allocator)
+{
+    dc_env_init(&test_env, NULL);
+    dc_error_init(&test_err, NULL);
+    ran = false;
+}
+
+AfterEach(allocator)
+{
+    dc_unsetenv(&test_env, &test_err, DC_ALLOCATOR_ENV_VAR);
+    dc_error_reset(&test_err);
+}
+
+Ensure(allocator, names)
+{
+    dc_allocator kind;
+
+    kind = DC_ALLOCATOR_SYSTEM;
+    assert_that(dc_allocator_from_string(&test_env, "arena", &kind), is_true);
+    assert_that(kind, is_equal_to(DC_ALLOCATOR_ARENA));
+    assert_that(dc_allocator_from_string(&test_env, "retain", &kind), is_true);
+    assert_that(kind, is_equal_to(DC_ALLOCATOR_RETAIN));
+    assert_that(dc_allocator_from_string(&test_env, "system", &kind), is_true);
+    assert_that(kind, is_equal_to(DC_ALLOCATOR_SYSTEM));
+    assert_that(dc_allocator_from_string(&test_env, "jemalloc", &kind), is_false);
+    assert_that(dc_allocator_from_string(&test_env, "", &kind), is_false);
+    assert_that(kind, is_equal_to(DC_ALLOCATOR_SYSTEM));
+}
+
+Ensure(allocator, every_kind_installs)
+{
+    dc_allocator_install(&test_env, &test_err, DC_ALLOCATOR_ARENA);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+    dc_allocator_install(&test_env, &test_err, DC_ALLOCATOR_RETAIN);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+    dc_allocator_install(&test_env, &test_err, DC_ALLOCATOR_SYSTEM);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+}
+
+Ensure(allocator, environment_picks_the_allocator)
+{
+    dc_setenv(&test_env, &test_err, DC_ALLOCATOR_ENV_VAR, "arena", 1);
+    run_application();
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+    assert_that(ran, is_true);
+}
+
+Ensure(allocator, unknown_allocator_is_an_error)
+{
+    dc_setenv(&test_env, &test_err, DC_ALLOCATOR_ENV_VAR, "jemalloc", 1);
+    run_application();
+    assert_that(dc_error_has_error(&test_err), is_true);
+    assert_that(ran, is_false);
+}
+
+TestSuite *allocator_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, allocator, names);
+    add_test_with_context(suite, allocator, every_kind_installs);
+    add_test_with_context(suite, allocator, environment_picks_the_allocator);
+    add_test_with_context(suite, allocator, unknown_allocator_is_an_error);
+
+    return suite;
+}
+
+static void run_application(void)
+{
+    struct dc_application_info *info;
+    char name[] = "test";
+    char *argv[] = {name, NULL};
+
+    info = dc_application_info_create(&test_env, &test_err, "Test Application");
+    dc_application_run(&test_env, &test_err, info, allocator_settings_create, allocator_settings_destroy, run, dc_default_create_lifecycle, dc_default_destroy_lifecycle, NULL, 1, argv);
+    dc_application_info_destroy(&test_env, &info);
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int run(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings)
+{
+    ran = true;
+
+    return 0;
+}
+#pragma GCC diagnostic pop
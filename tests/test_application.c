@@ -0,0 +1,335 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "test_schema.h"
+#include "dc_application/application.h"
+#include "dc_application/command_line.h"
+#include "dc_application/schema.h"
+#include <dc_c/dc_string.h>
+#include <pthread.h>
+
+
+DC_SCHEMA_STRUCT(application_settings, TEST_SCHEMA)
+DC_SCHEMA_DEFINE(application_settings, TEST_SCHEMA, "DC_APPLICATION_TEST_")
+
+
+static int run_application(void (*phases)(struct dc_application_lifecycle *lifecycle));
+static struct dc_application_lifecycle *create_lifecycle(const struct dc_env *env,
+                                                         struct dc_error *err,
+                                                         struct dc_application_settings *(*create_settings_func)(const struct dc_env *env, struct dc_error *err),
+                                                         int (*destroy_settings_func)(const struct dc_env *env,
+                                                                                      struct dc_error *err,
+                                                                                      struct dc_application_settings **),
+                                                         int (*run_func)(const struct dc_env *env, struct dc_error *err,
+                                                                         struct dc_application_settings *));
+static void record(const char *name);
+static void ordered_phases(struct dc_application_lifecycle *lifecycle);
+static void parallel_phases(struct dc_application_lifecycle *lifecycle);
+static void cyclic_phases(struct dc_application_lifecycle *lifecycle);
+static void cycle_through_run(struct dc_application_lifecycle *lifecycle);
+static void unknown_phase(struct dc_application_lifecycle *lifecycle);
+static void failing_phase(struct dc_application_lifecycle *lifecycle);
+static void before_only_phase(struct dc_application_lifecycle *lifecycle);
+static int run(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings);
+static int phase_zero(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings);
+static int phase_one(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings);
+static int phase_two(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings);
+static int phase_late(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings);
+static int phase_fail(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings);
+static int phase_resolved(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings);
+
+
+Describe(application);
+
+static struct dc_env test_env;
+static struct dc_error test_err;
+static void (*add_phases)(struct dc_application_lifecycle *lifecycle);
+static pthread_mutex_t order_mutex = PTHREAD_MUTEX_INITIALIZER;
+// the names of the phases and "run" in the order they ran, each followed by a space
+static char order[128];
+
+BeforeEach(application)
+{
+    dc_env_init(&test_env, NULL);
+    dc_error_init(&test_err, NULL);
+    order[0] = '\0';
+}
+
+AfterEach(application)
+{
+    dc_error_reset(&test_err);
+}
+
+Ensure(application, phases_run_in_order)
+{
+    run_application(ordered_phases);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+    assert_that(order, is_equal_to_string("zero one two run late "));
+}
+
+Ensure(application, parallel_phases_run_together)
+{
+    run_application(parallel_phases);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+
+    // zero and two only depend on one, so they may finish in either order
+    if(order[4] == 'z')
+    {
+        assert_that(order, is_equal_to_string("one zero two late run "));
+    }
+    else
+    {
+        assert_that(order, is_equal_to_string("one two zero late run "));
+    }
+}
+
+Ensure(application, cycles_are_errors)
+{
+    run_application(cyclic_phases);
+    assert_that(dc_error_has_error(&test_err), is_true);
+    assert_that(order, is_equal_to_string(""));
+}
+
+Ensure(application, cycles_through_built_in_states_are_errors)
+{
+    run_application(cycle_through_run);
+    assert_that(dc_error_has_error(&test_err), is_true);
+    assert_that(order, is_equal_to_string(""));
+}
+
+Ensure(application, constraints_have_to_name_phases)
+{
+    run_application(unknown_phase);
+    assert_that(dc_error_has_error(&test_err), is_true);
+    assert_that(order, is_equal_to_string(""));
+}
+
+Ensure(application, failed_phase_stops_the_run)
+{
+    run_application(failing_phase);
+    assert_that(order, is_equal_to_string("zero fail "));
+}
+
+Ensure(application, phases_without_after_follow_set_defaults)
+{
+    run_application(before_only_phase);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+    assert_that(order, is_equal_to_string("resolved run "));
+}
+
+Ensure(application, phase_names_are_unique)
+{
+    struct dc_application_lifecycle *lifecycle;
+
+    lifecycle = dc_default_create_lifecycle(&test_env, &test_err, application_settings_create, application_settings_destroy, run);
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "one", phase_one, NULL, NULL, false);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "one", phase_two, NULL, NULL, false);
+    assert_that(dc_error_has_error(&test_err), is_true);
+    dc_error_reset(&test_err);
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "RUN", phase_two, NULL, NULL, false);
+    assert_that(dc_error_has_error(&test_err), is_true);
+    dc_error_reset(&test_err);
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "a,b", phase_two, NULL, NULL, false);
+    assert_that(dc_error_has_error(&test_err), is_true);
+    dc_default_destroy_lifecycle(&test_env, &lifecycle);
+}
+
+TestSuite *application_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, application, phases_run_in_order);
+    add_test_with_context(suite, application, parallel_phases_run_together);
+    add_test_with_context(suite, application, cycles_are_errors);
+    add_test_with_context(suite, application, cycles_through_built_in_states_are_errors);
+    add_test_with_context(suite, application, constraints_have_to_name_phases);
+    add_test_with_context(suite, application, failed_phase_stops_the_run);
+    add_test_with_context(suite, application, phases_without_after_follow_set_defaults);
+    add_test_with_context(suite, application, phase_names_are_unique);
+
+    return suite;
+}
+
+static int run_application(void (*phases)(struct dc_application_lifecycle *lifecycle))
+{
+    struct dc_application_info *info;
+    char name[] = "test";
+    char *argv[] = {name, NULL};
+    int ret_val;
+
+    add_phases = phases;
+    info = dc_application_info_create(&test_env, &test_err, "Test Application");
+    ret_val = dc_application_run(&test_env, &test_err, info, application_settings_create, application_settings_destroy, run, create_lifecycle, dc_default_destroy_lifecycle, NULL, 1, argv);
+    dc_application_info_destroy(&test_env, &info);
+
+    return ret_val;
+}
+
+static struct dc_application_lifecycle *create_lifecycle(const struct dc_env *env,
+                                                         struct dc_error *err,
+                                                         struct dc_application_settings *(*create_settings_func)(const struct dc_env *env, struct dc_error *err),
+                                                         int (*destroy_settings_func)(const struct dc_env *env,
+                                                                                      struct dc_error *err,
+                                                                                      struct dc_application_settings **),
+                                                         int (*run_func)(const struct dc_env *env, struct dc_error *err,
+                                                                         struct dc_application_settings *))
+{
+    struct dc_application_lifecycle *lifecycle;
+
+    lifecycle = dc_default_create_lifecycle(env, err, create_settings_func, destroy_settings_func, run_func);
+
+    if(dc_error_has_no_error(err))
+    {
+        add_phases(lifecycle);
+    }
+
+    return lifecycle;
+}
+
+static void record(const char *name)
+{
+    size_t length;
+
+    pthread_mutex_lock(&order_mutex);
+    length = dc_strlen(&test_env, order);
+    dc_strcpy(&test_env, &order[length], name);
+    dc_strcpy(&test_env, &order[length + dc_strlen(&test_env, name)], " ");
+    pthread_mutex_unlock(&order_mutex);
+}
+
+// added out of order, the constraints decide when they run
+static void ordered_phases(struct dc_application_lifecycle *lifecycle)
+{
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "late", phase_late, "RUN", NULL, false);
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "two", phase_two, "one", NULL, false);
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "one", phase_one, NULL, NULL, false);
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "zero", phase_zero, NULL, "one", false);
+}
+
+static void parallel_phases(struct dc_application_lifecycle *lifecycle)
+{
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "one", phase_one, NULL, NULL, false);
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "zero", phase_zero, "one", NULL, true);
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "two", phase_two, "one", NULL, true);
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "late", phase_late, "zero,two", "RUN", false);
+}
+
+static void cyclic_phases(struct dc_application_lifecycle *lifecycle)
+{
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "zero", phase_zero, NULL, NULL, false);
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "one", phase_one, "two", NULL, false);
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "two", phase_two, "one", NULL, false);
+}
+
+static void cycle_through_run(struct dc_application_lifecycle *lifecycle)
+{
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "one", phase_one, "RUN", "SET_DEFAULTS", false);
+}
+
+static void unknown_phase(struct dc_application_lifecycle *lifecycle)
+{
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "one", phase_one, "zero", NULL, false);
+}
+
+static void failing_phase(struct dc_application_lifecycle *lifecycle)
+{
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "zero", phase_zero, NULL, NULL, false);
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "fail", phase_fail, "zero", NULL, false);
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "two", phase_two, "fail", NULL, false);
+}
+
+// only before is given, the phase still waits for the settings
+static void before_only_phase(struct dc_application_lifecycle *lifecycle)
+{
+    dc_application_lifecycle_add_phase(&test_env, &test_err, lifecycle, "resolved", phase_resolved, NULL, "RUN", false);
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int run(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings)
+{
+    record("run");
+
+    return 0;
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int phase_zero(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings)
+{
+    record("zero");
+
+    return 0;
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int phase_one(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings)
+{
+    record("one");
+
+    return 0;
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int phase_two(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings)
+{
+    record("two");
+
+    return 0;
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int phase_late(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings)
+{
+    record("late");
+
+    return 0;
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int phase_fail(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings)
+{
+    record("fail");
+
+    return -1;
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int phase_resolved(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings)
+{
+    struct application_settings *app_settings;
+
+    app_settings = (struct application_settings *)settings;
+    record(dc_setting_is_set(env, (struct dc_setting *)app_settings->message) ? "resolved" : "unresolved");
+
+    return 0;
+}
+#pragma GCC diagnostic pop
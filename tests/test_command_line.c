@@ -0,0 +1,294 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "test_schema.h"
+#include "dc_application/command_line.h"
+#include "dc_application/schema.h"
+#include <dc_c/dc_string.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_unistd.h>
+
+
+DC_SCHEMA_STRUCT(command_line_settings, TEST_SCHEMA)
+DC_SCHEMA_DEFINE(command_line_settings, TEST_SCHEMA, "TEST_")
+
+
+static int set_arguments(char **argv, char *storage, const char *const *arguments);
+static void write_response_file(const char *text);
+static void assert_next(struct dc_command_line_parser *parser, const char *name, const char *expected);
+static void assert_fails(const char *const *arguments);
+
+
+Describe(command_line);
+
+static struct dc_env env;
+static struct dc_error err;
+static struct dc_application_settings *settings;
+static struct dc_opt_settings *opt_settings;
+static char response_file[] = "/tmp/dc_application_testXXXXXX";
+static char response_argument[sizeof(response_file) + 1];
+static char *args[16];
+static char arg_storage[512];
+
+BeforeEach(command_line)
+{
+    dc_env_init(&env, NULL);
+    dc_error_init(&err, NULL);
+    settings = command_line_settings_create(&env, &err);
+    opt_settings = (struct dc_opt_settings *)settings;
+    response_argument[0] = '\0';
+}
+
+AfterEach(command_line)
+{
+    command_line_settings_destroy(&env, &err, &settings);
+
+    if(response_argument[0])
+    {
+        dc_unlink(&env, &err, &response_argument[1]);
+        dc_memcpy(&env, response_file, "/tmp/dc_application_testXXXXXX", sizeof(response_file));
+    }
+
+    dc_error_reset(&err);
+}
+
+Ensure(command_line, short_options)
+{
+    struct dc_command_line_parser parser;
+    int argc;
+
+    argc = set_arguments(args, arg_storage, (const char *[]){"prog", "-vqmhello", "-w", "8", "-l", "-ldebug", NULL});
+    dc_command_line_parser_init(&env, &parser, opt_settings, argc, args);
+    assert_next(&parser, "verbose", NULL);
+    assert_next(&parser, "quiet", NULL);
+    assert_next(&parser, "message", "hello");
+    assert_next(&parser, "workers", "8");
+    assert_next(&parser, "level", NULL);
+    assert_next(&parser, "level", "debug");
+    assert_that(dc_command_line_parser_next(&env, &err, &parser, &(const struct options *){NULL}, &(const char *){NULL}), is_false);
+    assert_that(dc_error_has_no_error(&err), is_true);
+    assert_that(parser.optind, is_equal_to(argc));
+}
+
+Ensure(command_line, long_options)
+{
+    struct dc_command_line_parser parser;
+    int argc;
+
+    argc = set_arguments(args, arg_storage, (const char *[]){"prog", "--message=a=b", "--port", "80", "--verb", "--level", "--message=", NULL});
+    dc_command_line_parser_init(&env, &parser, opt_settings, argc, args);
+    assert_next(&parser, "message", "a=b");
+    assert_next(&parser, "port", "80");
+    assert_next(&parser, "verbose", NULL);
+    assert_next(&parser, "level", NULL);
+    assert_next(&parser, "message", "");
+    assert_that(dc_command_line_parser_next(&env, &err, &parser, &(const struct options *){NULL}, &(const char *){NULL}), is_false);
+    assert_that(dc_error_has_no_error(&err), is_true);
+}
+
+Ensure(command_line, operands_follow_the_options)
+{
+    struct dc_command_line_parser parser;
+    int argc;
+
+    argc = set_arguments(args, arg_storage, (const char *[]){"prog", "a", "-v", "-", "b", "--", "-q", NULL});
+    dc_command_line_parser_init(&env, &parser, opt_settings, argc, args);
+    assert_next(&parser, "verbose", NULL);
+    assert_that(dc_command_line_parser_next(&env, &err, &parser, &(const struct options *){NULL}, &(const char *){NULL}), is_false);
+    assert_that(dc_error_has_no_error(&err), is_true);
+    assert_that(parser.optind, is_equal_to(3));
+    assert_that(args[3], is_equal_to_string("a"));
+    assert_that(args[4], is_equal_to_string("-"));
+    assert_that(args[5], is_equal_to_string("b"));
+    assert_that(args[6], is_equal_to_string("-q"));
+}
+
+Ensure(command_line, bad_options_are_errors)
+{
+    assert_fails((const char *[]){"prog", "-x", NULL});
+    assert_fails((const char *[]){"prog", "-vx", NULL});
+    assert_fails((const char *[]){"prog", "--nope", NULL});
+    assert_fails((const char *[]){"prog", "--nope=1", NULL});
+    // --p could be --port or --peers
+    assert_fails((const char *[]){"prog", "--p", "80", NULL});
+    assert_fails((const char *[]){"prog", "-m", NULL});
+    assert_fails((const char *[]){"prog", "-vm", NULL});
+    assert_fails((const char *[]){"prog", "--message", NULL});
+    assert_fails((const char *[]){"prog", "--verbose=yes", NULL});
+    assert_fails((const char *[]){"prog", "@/nonexistent/dc_application_test", NULL});
+}
+
+Ensure(command_line, parsers_are_independent)
+{
+    struct dc_command_line_parser first;
+    struct dc_command_line_parser second;
+    char *other_args[8];
+    char other_storage[64];
+    int argc;
+    int other_argc;
+
+    argc = set_arguments(args, arg_storage, (const char *[]){"prog", "-vm", "one", "--port=1", NULL});
+    other_argc = set_arguments(other_args, other_storage, (const char *[]){"prog", "-qmtwo", "--timeout", "2s", NULL});
+    dc_command_line_parser_init(&env, &first, opt_settings, argc, args);
+    dc_command_line_parser_init(&env, &second, opt_settings, other_argc, other_args);
+    assert_next(&first, "verbose", NULL);
+    assert_next(&second, "quiet", NULL);
+    assert_next(&first, "message", "one");
+    assert_next(&second, "message", "two");
+    assert_next(&second, "timeout", "2s");
+    assert_next(&first, "port", "1");
+}
+
+Ensure(command_line, response_files)
+{
+    struct dc_command_line_operands operands;
+    int argc;
+
+    write_response_file("-v one 'two words' \"three \\\"quoted\\\"\"\n--port 80 four\\ five -- -q\n");
+    argc = set_arguments(args, arg_storage, (const char *[]){"prog", "first", response_argument, "last", NULL});
+    dc_default_parse_command_line(&env, &err, settings, argc, args);
+    assert_that(dc_error_has_no_error(&err), is_true);
+    assert_that(dc_setting_bool_get(&env, ((struct command_line_settings *)settings)->verbose), is_true);
+    assert_that(dc_setting_in_port_t_get(&env, ((struct command_line_settings *)settings)->port), is_equal_to(80));
+    assert_that(dc_setting_is_set(&env, (struct dc_setting *)((struct command_line_settings *)settings)->quiet), is_false);
+
+    dc_command_line_operands_init(&env, &operands, opt_settings);
+    assert_that(dc_command_line_operands_next(&env, &operands), is_equal_to_string("first"));
+    assert_that(dc_command_line_operands_next(&env, &operands), is_equal_to_string("one"));
+    assert_that(dc_command_line_operands_next(&env, &operands), is_equal_to_string("two words"));
+    assert_that(dc_command_line_operands_next(&env, &operands), is_equal_to_string("three \"quoted\""));
+    assert_that(dc_command_line_operands_next(&env, &operands), is_equal_to_string("four five"));
+    assert_that(dc_command_line_operands_next(&env, &operands), is_equal_to_string("-q"));
+    assert_that(dc_command_line_operands_next(&env, &operands), is_equal_to_string("last"));
+    assert_that(dc_command_line_operands_next(&env, &operands), is_null);
+}
+
+Ensure(command_line, response_file_argument_from_the_command_line)
+{
+    struct dc_command_line_parser parser;
+    int argc;
+
+    // an option at the end of the file takes the argument after the @file
+    write_response_file("-v --message");
+    argc = set_arguments(args, arg_storage, (const char *[]){"prog", response_argument, "hello", NULL});
+    dc_command_line_parser_init(&env, &parser, opt_settings, argc, args);
+    assert_next(&parser, "verbose", NULL);
+    assert_next(&parser, "message", "hello");
+    assert_that(dc_command_line_parser_next(&env, &err, &parser, &(const struct options *){NULL}, &(const char *){NULL}), is_false);
+    dc_command_line_release_response_files(&env, &parser.response_files);
+}
+
+Ensure(command_line, empty_response_file)
+{
+    struct dc_command_line_operands operands;
+    int argc;
+
+    write_response_file("");
+    argc = set_arguments(args, arg_storage, (const char *[]){"prog", response_argument, NULL});
+    dc_default_parse_command_line(&env, &err, settings, argc, args);
+    assert_that(dc_error_has_no_error(&err), is_true);
+    dc_command_line_operands_init(&env, &operands, opt_settings);
+    assert_that(dc_command_line_operands_next(&env, &operands), is_null);
+}
+
+TestSuite *command_line_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, command_line, short_options);
+    add_test_with_context(suite, command_line, long_options);
+    add_test_with_context(suite, command_line, operands_follow_the_options);
+    add_test_with_context(suite, command_line, bad_options_are_errors);
+    add_test_with_context(suite, command_line, parsers_are_independent);
+    add_test_with_context(suite, command_line, response_files);
+    add_test_with_context(suite, command_line, response_file_argument_from_the_command_line);
+    add_test_with_context(suite, command_line, empty_response_file);
+
+    return suite;
+}
+
+// the parser moves the arguments around, so they are copied into writable storage
+static int set_arguments(char **argv, char *storage, const char *const *arguments)
+{
+    int argc;
+
+    for(argc = 0; arguments[argc]; argc++)
+    {
+        size_t length;
+
+        length = dc_strlen(&env, arguments[argc]) + 1;
+        dc_memcpy(&env, storage, arguments[argc], length);
+        argv[argc] = storage;
+        storage += length;
+    }
+
+    argv[argc] = NULL;
+
+    return argc;
+}
+
+static void write_response_file(const char *text)
+{
+    int fd;
+
+    fd = dc_mkstemp(&env, &err, response_file);
+    dc_write(&env, &err, fd, text, dc_strlen(&env, text));
+    dc_close(&env, &err, fd);
+    response_argument[0] = '@';
+    dc_strcpy(&env, &response_argument[1], response_file);
+}
+
+static void assert_next(struct dc_command_line_parser *parser, const char *name, const char *expected)
+{
+    const struct options *opt;
+    const char *value;
+
+    assert_that(dc_command_line_parser_next(&env, &err, parser, &opt, &value), is_true);
+    assert_that(opt->name, is_equal_to_string(name));
+
+    if(expected)
+    {
+        assert_that(value, is_equal_to_string(expected));
+    }
+    else
+    {
+        assert_that(value, is_null);
+    }
+}
+
+static void assert_fails(const char *const *arguments)
+{
+    struct dc_command_line_parser parser;
+    struct dc_error local_err;
+    const struct options *opt;
+    const char *value;
+    int argc;
+
+    dc_error_init(&local_err, NULL);
+    argc = set_arguments(args, arg_storage, arguments);
+    dc_command_line_parser_init(&env, &parser, opt_settings, argc, args);
+
+    while(dc_command_line_parser_next(&env, &local_err, &parser, &opt, &value))
+    {
+    }
+
+    assert_that(dc_error_has_error(&local_err), is_true);
+    dc_command_line_release_response_files(&env, &parser.response_files);
+    dc_error_reset(&local_err);
+}
@@ -0,0 +1,305 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "test_schema.h"
+#include "dc_application/command_line.h"
+#include "dc_application/component.h"
+#include "dc_application/schema.h"
+#include <stdatomic.h>
+
+
+DC_SCHEMA_STRUCT(component_settings, TEST_SCHEMA)
+DC_SCHEMA_DEFINE(component_settings, TEST_SCHEMA, "TEST_")
+
+
+// when each callback ran, by a clock that every callback moves on, 0 for never
+struct probe
+{
+    int fail_init;
+    int fail_start;
+    int init_at;
+    int start_at;
+    int stop_at;
+    int destroy_at;
+};
+
+
+static int init_probe(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings, void *data);
+static int start_probe(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings, void *data);
+static int stop_probe(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings, void *data);
+static int destroy_probe(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings, void *data);
+static void add_component(struct dc_component *component, const char *name, const char *depends, struct probe *probe);
+
+
+Describe(component);
+
+static struct dc_env test_env;
+static struct dc_error test_err;
+static struct dc_components *components;
+static struct dc_component component_a;
+static struct dc_component component_b;
+static struct dc_component component_c;
+static struct dc_component component_d;
+static struct probe probe_a;
+static struct probe probe_b;
+static struct probe probe_c;
+static struct probe probe_d;
+static atomic_int clock_ticks;
+
+BeforeEach(component)
+{
+    dc_env_init(&test_env, NULL);
+    dc_error_init(&test_err, NULL);
+    components = dc_components_create(&test_env, &test_err);
+    probe_a = (struct probe){0};
+    probe_b = (struct probe){0};
+    probe_c = (struct probe){0};
+    probe_d = (struct probe){0};
+    atomic_store(&clock_ticks, 0);
+}
+
+AfterEach(component)
+{
+    dc_components_destroy(&test_env, &components);
+    dc_error_reset(&test_err);
+}
+
+Ensure(component, dependencies_come_first)
+{
+    add_component(&component_a, "a", NULL, &probe_a);
+    add_component(&component_b, "b", "a", &probe_b);
+    add_component(&component_c, "c", "b,a", &probe_c);
+    add_component(&component_d, "d", NULL, &probe_d);
+    dc_components_init(&test_env, &test_err, components, NULL, 4);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+    assert_that(probe_a.init_at, is_greater_than(0));
+    assert_that(probe_d.init_at, is_greater_than(0));
+    assert_that(probe_b.init_at, is_greater_than(probe_a.init_at));
+    assert_that(probe_c.init_at, is_greater_than(probe_b.init_at));
+
+    dc_components_start(&test_env, &test_err, components, NULL);
+    assert_that(probe_b.start_at, is_greater_than(probe_a.start_at));
+    assert_that(probe_c.start_at, is_greater_than(probe_b.start_at));
+
+    // everything is taken down in the reverse order
+    dc_components_stop(&test_env, &test_err, components, NULL);
+    dc_components_release(&test_env, &test_err, components, NULL);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+    assert_that(probe_c.stop_at, is_less_than(probe_b.stop_at));
+    assert_that(probe_b.stop_at, is_less_than(probe_a.stop_at));
+    assert_that(probe_c.destroy_at, is_less_than(probe_b.destroy_at));
+    assert_that(probe_b.destroy_at, is_less_than(probe_a.destroy_at));
+    assert_that(probe_d.destroy_at, is_greater_than(0));
+}
+
+Ensure(component, one_thread_is_enough)
+{
+    add_component(&component_c, "c", "b", &probe_c);
+    add_component(&component_b, "b", "a", &probe_b);
+    add_component(&component_a, "a", NULL, &probe_a);
+    dc_components_init(&test_env, &test_err, components, NULL, 1);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+    assert_that(probe_a.init_at, is_equal_to(1));
+    assert_that(probe_b.init_at, is_equal_to(2));
+    assert_that(probe_c.init_at, is_equal_to(3));
+    dc_components_release(&test_env, &test_err, components, NULL);
+}
+
+Ensure(component, names_are_unique)
+{
+    add_component(&component_a, "a", NULL, &probe_a);
+    add_component(&component_b, "a", NULL, &probe_b);
+    assert_that(dc_error_has_error(&test_err), is_true);
+}
+
+Ensure(component, unknown_dependency)
+{
+    add_component(&component_a, "a", NULL, &probe_a);
+    add_component(&component_b, "b", "a,ab", &probe_b);
+    dc_components_init(&test_env, &test_err, components, NULL, 0);
+    assert_that(dc_error_has_error(&test_err), is_true);
+    assert_that(probe_a.init_at, is_equal_to(0));
+    assert_that(probe_b.init_at, is_equal_to(0));
+}
+
+Ensure(component, depending_on_itself)
+{
+    add_component(&component_a, "a", "a", &probe_a);
+    dc_components_init(&test_env, &test_err, components, NULL, 0);
+    assert_that(dc_error_has_error(&test_err), is_true);
+    assert_that(probe_a.init_at, is_equal_to(0));
+}
+
+Ensure(component, cycle)
+{
+    add_component(&component_a, "a", "c", &probe_a);
+    add_component(&component_b, "b", "a", &probe_b);
+    add_component(&component_c, "c", "b", &probe_c);
+    add_component(&component_d, "d", NULL, &probe_d);
+    dc_components_init(&test_env, &test_err, components, NULL, 0);
+    assert_that(dc_error_has_error(&test_err), is_true);
+    assert_that(probe_a.init_at, is_equal_to(0));
+    assert_that(probe_b.init_at, is_equal_to(0));
+    assert_that(probe_c.init_at, is_equal_to(0));
+
+    // the component outside the cycle was released again
+    assert_that(probe_d.destroy_at, is_greater_than(probe_d.init_at));
+}
+
+Ensure(component, failed_init)
+{
+    probe_b.fail_init = 1;
+    add_component(&component_a, "a", NULL, &probe_a);
+    add_component(&component_b, "b", "a", &probe_b);
+    add_component(&component_c, "c", "b", &probe_c);
+    dc_components_init(&test_env, &test_err, components, NULL, 0);
+    assert_that(dc_error_has_error(&test_err), is_true);
+    assert_that(probe_b.init_at, is_greater_than(0));
+    assert_that(probe_b.destroy_at, is_equal_to(0));
+    assert_that(probe_c.init_at, is_equal_to(0));
+    assert_that(probe_a.destroy_at, is_greater_than(probe_b.init_at));
+}
+
+Ensure(component, failed_start)
+{
+    probe_b.fail_start = 1;
+    add_component(&component_a, "a", NULL, &probe_a);
+    add_component(&component_b, "b", "a", &probe_b);
+    add_component(&component_c, "c", "b", &probe_c);
+    dc_components_init(&test_env, &test_err, components, NULL, 0);
+    dc_components_start(&test_env, &test_err, components, NULL);
+    assert_that(dc_error_has_error(&test_err), is_true);
+    assert_that(probe_a.stop_at, is_greater_than(probe_b.start_at));
+    assert_that(probe_b.stop_at, is_equal_to(0));
+    assert_that(probe_c.start_at, is_equal_to(0));
+    dc_error_reset(&test_err);
+    dc_components_release(&test_env, &test_err, components, NULL);
+    assert_that(probe_c.destroy_at, is_greater_than(0));
+}
+
+Ensure(component, settings_have_to_be_set)
+{
+    struct dc_application_settings *settings;
+    struct component_settings *test_settings;
+
+    settings = component_settings_create(&test_env, &test_err);
+    test_settings = (struct component_settings *)settings;
+    component_a = (struct dc_component){.name = "a", .settings = "nope", .init = init_probe, .data = &probe_a};
+    dc_components_add(&test_env, &test_err, components, &component_a);
+    dc_components_init(&test_env, &test_err, components, settings, 0);
+    assert_that(dc_error_has_error(&test_err), is_true);
+    dc_error_reset(&test_err);
+
+    component_a.settings = "workers,message";
+    dc_components_init(&test_env, &test_err, components, settings, 0);
+    assert_that(dc_error_has_error(&test_err), is_true);
+    assert_that(probe_a.init_at, is_equal_to(0));
+    dc_error_reset(&test_err);
+
+    dc_setting_string_set(&test_env, &test_err, test_settings->message, "hello", DC_SETTING_COMMAND_LINE);
+    dc_setting_uint16_set(&test_env, test_settings->workers, 2, DC_SETTING_COMMAND_LINE);
+    dc_components_init(&test_env, &test_err, components, settings, 0);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+    assert_that(probe_a.init_at, is_equal_to(1));
+    dc_components_release(&test_env, &test_err, components, settings);
+    component_settings_destroy(&test_env, &test_err, &settings);
+}
+
+TestSuite *component_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, component, dependencies_come_first);
+    add_test_with_context(suite, component, one_thread_is_enough);
+    add_test_with_context(suite, component, names_are_unique);
+    add_test_with_context(suite, component, unknown_dependency);
+    add_test_with_context(suite, component, depending_on_itself);
+    add_test_with_context(suite, component, cycle);
+    add_test_with_context(suite, component, failed_init);
+    add_test_with_context(suite, component, failed_start);
+    add_test_with_context(suite, component, settings_have_to_be_set);
+
+    return suite;
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int init_probe(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings, void *data)
+{
+    struct probe *probe;
+
+    probe = data;
+    probe->init_at = atomic_fetch_add(&clock_ticks, 1) + 1;
+
+    return probe->fail_init;
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int start_probe(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings, void *data)
+{
+    struct probe *probe;
+
+    probe = data;
+    probe->start_at = atomic_fetch_add(&clock_ticks, 1) + 1;
+
+    return probe->fail_start;
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int stop_probe(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings, void *data)
+{
+    struct probe *probe;
+
+    probe = data;
+    probe->stop_at = atomic_fetch_add(&clock_ticks, 1) + 1;
+
+    return 0;
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int destroy_probe(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings, void *data)
+{
+    struct probe *probe;
+
+    probe = data;
+    probe->destroy_at = atomic_fetch_add(&clock_ticks, 1) + 1;
+
+    return 0;
+}
+#pragma GCC diagnostic pop
+
+static void add_component(struct dc_component *component, const char *name, const char *depends, struct probe *probe)
+{
+    *component = (struct dc_component){
+        .name = name,
+        .depends = depends,
+        .init = init_probe,
+        .start = start_probe,
+        .stop = stop_probe,
+        .destroy = destroy_probe,
+        .data = probe,
+    };
+    dc_components_add(&test_env, &test_err, components, component);
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "test_schema.h"
+#include "dc_application/config.h"
+#include "dc_application/schema.h"
+#include <dc_c/dc_string.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_unistd.h>
+
+
+DC_SCHEMA_STRUCT(config_load_settings, TEST_SCHEMA)
+DC_SCHEMA_DEFINE(config_load_settings, TEST_SCHEMA, "TEST_")
+
+
+static void write_config(char *path, const char *text);
+
+
+Describe(config_load);
+
+static struct dc_env env;
+static struct dc_error err;
+static struct dc_application_settings *settings;
+static struct config_load_settings *test_settings;
+static char first_path[] = "/tmp/dc_application_testXXXXXX";
+static char second_path[] = "/tmp/dc_application_testXXXXXX";
+
+BeforeEach(config_load)
+{
+    dc_env_init(&env, NULL);
+    dc_error_init(&err, NULL);
+    settings = config_load_settings_create(&env, &err);
+    assert_that(settings, is_not_null);
+    test_settings = (struct config_load_settings *)settings;
+    dc_memcpy(&env, first_path, "/tmp/dc_application_testXXXXXX", sizeof(first_path));
+    dc_memcpy(&env, second_path, "/tmp/dc_application_testXXXXXX", sizeof(second_path));
+    write_config(first_path, "message = \"first\";\n");
+    write_config(second_path, "message = \"second\";\n");
+}
+
+AfterEach(config_load)
+{
+    config_load_settings_destroy(&env, &err, &settings);
+    dc_unlink(&env, &err, first_path);
+    dc_unlink(&env, &err, second_path);
+    dc_error_reset(&err);
+}
+
+Ensure(config_load, the_file_read_early_is_applied)
+{
+    struct dc_config_load *load;
+
+    load = dc_config_load_start(&env, &err, first_path);
+    assert_that(load, is_not_null);
+    dc_setting_path_set(&env, &err, settings->config_path, first_path, DC_SETTING_DEFAULT);
+    assert_that(dc_config_load_finish(&env, &err, &load, settings), is_equal_to(0));
+    assert_that(load, is_null);
+    assert_that(dc_setting_string_get(&env, test_settings->message), is_equal_to_string("first"));
+}
+
+Ensure(config_load, another_config_path_is_read_instead)
+{
+    struct dc_config_load *load;
+
+    // the command line named another file while the first one was being read
+    load = dc_config_load_start(&env, &err, first_path);
+    dc_setting_path_set(&env, &err, settings->config_path, second_path, DC_SETTING_COMMAND_LINE);
+    assert_that(dc_config_load_finish(&env, &err, &load, settings), is_equal_to(0));
+    assert_that(dc_setting_string_get(&env, test_settings->message), is_equal_to_string("second"));
+}
+
+Ensure(config_load, cancel_applies_nothing)
+{
+    struct dc_config_load *load;
+
+    load = dc_config_load_start(&env, &err, first_path);
+    dc_config_load_cancel(&env, &load);
+    assert_that(load, is_null);
+    assert_that(dc_setting_is_set(&env, (struct dc_setting *)test_settings->message), is_false);
+}
+
+TestSuite *config_load_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, config_load, the_file_read_early_is_applied);
+    add_test_with_context(suite, config_load, another_config_path_is_read_instead);
+    add_test_with_context(suite, config_load, cancel_applies_nothing);
+
+    return suite;
+}
+
+static void write_config(char *path, const char *text)
+{
+    int fd;
+
+    fd = dc_mkstemp(&env, &err, path);
+    dc_write(&env, &err, fd, text, dc_strlen(&env, text));
+    dc_close(&env, &err, fd);
+}
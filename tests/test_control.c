@@ -0,0 +1,212 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "test_schema.h"
+#include "dc_application/command_line.h"
+#include "dc_application/control.h"
+#include "dc_application/local_socket.h"
+#include "dc_application/schema.h"
+#include <arpa/inet.h>
+#include <dc_c/dc_string.h>
+#include <dc_posix/dc_unistd.h>
+
+
+DC_SCHEMA_STRUCT(control_settings, TEST_SCHEMA)
+DC_SCHEMA_DEFINE(control_settings, TEST_SCHEMA, "TEST_")
+
+
+// the socket directory is created owner only on first use
+#define SOCKET_PATH "/tmp/dc_application_test_control/control.sock"
+
+
+static void request(const char *text);
+static void transfer(void *data, size_t length, bool sending);
+static int reload(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings);
+
+
+Describe(control);
+
+static struct dc_env test_env;
+static struct dc_error test_err;
+static struct dc_application_settings *application_settings;
+static struct control_settings *test_settings;
+static struct dc_control_server *server;
+static int client_fd;
+static int reload_count;
+static char response[1024];
+
+BeforeEach(control)
+{
+    dc_env_init(&test_env, NULL);
+    dc_error_init(&test_err, NULL);
+    application_settings = control_settings_create(&test_env, &test_err);
+    assert_that(application_settings, is_not_null);
+    test_settings = (struct control_settings *)application_settings;
+
+    if(test_settings != NULL)
+    {
+        dc_setting_string_set(&test_env, &test_err, test_settings->message, "Hello", DC_SETTING_DEFAULT);
+        dc_setting_uint16_set(&test_env, test_settings->workers, 4, DC_SETTING_DEFAULT);
+    }
+
+    reload_count = 0;
+    server = dc_control_server_start(&test_env, &test_err, application_settings, SOCKET_PATH, reload);
+    client_fd = dc_local_socket_connect(&test_env, &test_err, SOCKET_PATH);
+}
+
+AfterEach(control)
+{
+    dc_close(&test_env, &test_err, client_fd);
+    dc_control_server_stop(&test_env, &server);
+    control_settings_destroy(&test_env, &test_err, &application_settings);
+    dc_error_reset(&test_err);
+}
+
+Ensure(control, get_and_set)
+{
+    assert_that(server, is_not_null);
+    request("get message");
+    assert_that(response, is_equal_to_string("OK Hello"));
+    request("set message Goodbye");
+    assert_that(response, is_equal_to_string("OK"));
+    request("get message");
+    assert_that(response, is_equal_to_string("OK Goodbye"));
+    assert_that(dc_setting_string_get(&test_env, test_settings->message), is_equal_to_string("Goodbye"));
+    request("set workers 16");
+    assert_that(response, is_equal_to_string("OK"));
+    assert_that(dc_setting_uint16_get(&test_env, test_settings->workers), is_equal_to(16));
+}
+
+Ensure(control, bad_requests_are_answered_with_errors)
+{
+    const char *bad[] = {"get nope", "set nope 1", "set message", "set workers 65", "set workers x", "frob", "get", ""};
+
+    for(size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        request(bad[i]);
+        assert_that(dc_strncmp(&test_env, response, "ERR", 3), is_equal_to(0));
+    }
+
+    // a rejected value leaves the setting as it was
+    assert_that(dc_setting_uint16_get(&test_env, test_settings->workers), is_equal_to(4));
+    request("get workers");
+    assert_that(response, is_equal_to_string("OK 4"));
+}
+
+Ensure(control, dump)
+{
+    request("dump");
+    assert_that(dc_strncmp(&test_env, response, "OK\n", 3), is_equal_to(0));
+    assert_that(dc_strstr(&test_env, response, "\nmessage=Hello\n"), is_not_null);
+    assert_that(dc_strstr(&test_env, response, "\nworkers=4\n"), is_not_null);
+}
+
+Ensure(control, reload)
+{
+    request("reload");
+    assert_that(response, is_equal_to_string("OK"));
+    request("reload");
+    assert_that(reload_count, is_equal_to(2));
+}
+
+Ensure(control, reload_without_a_function)
+{
+    dc_close(&test_env, &test_err, client_fd);
+    dc_control_server_stop(&test_env, &server);
+    server = dc_control_server_start(&test_env, &test_err, application_settings, SOCKET_PATH, NULL);
+    client_fd = dc_local_socket_connect(&test_env, &test_err, SOCKET_PATH);
+    request("reload");
+    assert_that(response, is_equal_to_string("ERR reload is not supported"));
+    assert_that(reload_count, is_equal_to(0));
+}
+
+TestSuite *control_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, control, get_and_set);
+    add_test_with_context(suite, control, bad_requests_are_answered_with_errors);
+    add_test_with_context(suite, control, dump);
+    add_test_with_context(suite, control, reload);
+    add_test_with_context(suite, control, reload_without_a_function);
+
+    return suite;
+}
+
+// one frame out and one back, the response is left NUL terminated in response
+static void request(const char *text)
+{
+    uint32_t length;
+
+    length = htonl((uint32_t)dc_strlen(&test_env, text));
+    transfer(&length, sizeof(length), true);
+    transfer((void *)(uintptr_t)text, dc_strlen(&test_env, text), true);
+    length = 0;
+    transfer(&length, sizeof(length), false);
+    length = ntohl(length);
+    assert_that(length, is_less_than(sizeof(response)));
+
+    if(length >= sizeof(response))
+    {
+        length = 0;
+    }
+
+    transfer(response, length, false);
+    response[length] = '\0';
+}
+
+static void transfer(void *data, size_t length, bool sending)
+{
+    size_t done;
+
+    done = 0;
+
+    while(done < length && dc_error_has_no_error(&test_err))
+    {
+        ssize_t count;
+
+        if(sending)
+        {
+            count = dc_write(&test_env, &test_err, client_fd, (char *)data + done, length - done);
+        }
+        else
+        {
+            count = dc_read(&test_env, &test_err, client_fd, (char *)data + done, length - done);
+        }
+
+        if(count <= 0)
+        {
+            break;
+        }
+
+        done += (size_t)count;
+    }
+
+    assert_that(done, is_equal_to(length));
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int reload(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings)
+{
+    reload_count++;
+
+    return 0;
+}
+#pragma GCC diagnostic pop
@@ -0,0 +1,84 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "dc_application/settings.h"
+
+
+Describe(intern);
+
+static struct dc_env env;
+static struct dc_error err;
+
+BeforeEach(intern)
+{
+    dc_env_init(&env, NULL);
+    dc_error_init(&err, NULL);
+}
+
+AfterEach(intern)
+{
+    dc_error_reset(&err);
+}
+
+Ensure(intern, equal_strings_share_a_buffer)
+{
+    char text[] = "shared";
+    const char *first;
+    const char *second;
+    const char *other;
+
+    first = dc_settings_intern(&env, &err, "shared");
+    second = dc_settings_intern(&env, &err, text);
+    other = dc_settings_intern(&env, &err, "other");
+    assert_that(first, is_equal_to_string("shared"));
+    assert_that(first == second, is_true);
+    assert_that(first == text, is_false);
+    assert_that(first == other, is_false);
+
+    // the buffer lives until the last reference is released
+    dc_settings_intern_release(&env, first);
+    assert_that(second, is_equal_to_string("shared"));
+    dc_settings_intern_release(&env, second);
+    dc_settings_intern_release(&env, other);
+}
+
+Ensure(intern, releasing_an_unknown_string_is_ignored)
+{
+    const char *interned;
+
+    dc_settings_intern_release(&env, "never interned");
+
+    // the same text is not enough, only the pointer dc_settings_intern returned counts
+    interned = dc_settings_intern(&env, &err, "kept");
+    dc_settings_intern_release(&env, "kept");
+    assert_that(interned, is_equal_to_string("kept"));
+    assert_that(dc_settings_intern(&env, &err, "kept") == interned, is_true);
+    dc_settings_intern_release(&env, interned);
+    dc_settings_intern_release(&env, interned);
+}
+
+TestSuite *intern_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, intern, equal_strings_share_a_buffer);
+    add_test_with_context(suite, intern, releasing_an_unknown_string_is_ignored);
+
+    return suite;
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "dc_application/list.h"
+#include <dc_c/dc_stdlib.h>
+#include <dc_c/dc_string.h>
+
+
+Describe(list);
+
+static struct dc_env env;
+static struct dc_error err;
+
+BeforeEach(list)
+{
+    dc_env_init(&env, NULL);
+    dc_error_init(&err, NULL);
+}
+
+AfterEach(list)
+{
+    dc_error_reset(&err);
+}
+
+static void assert_parse_fails(dc_list_element element, const char *str)
+{
+    struct dc_error local_err;
+    struct dc_list *list;
+
+    dc_error_init(&local_err, NULL);
+    list = dc_list_parse(&env, &local_err, element, str, ',');
+    assert_that(list, is_null);
+    assert_that(dc_error_has_error(&local_err), is_true);
+    dc_error_reset(&local_err);
+}
+
+Ensure(list, strings)
+{
+    struct dc_list *list;
+
+    list = dc_list_parse(&env, &err, DC_LIST_STRING, " a , bc,d ", ',');
+    assert_that(list, is_not_null);
+    assert_that(dc_list_get_count(&env, list), is_equal_to(3));
+    assert_that(dc_list_get_string(&env, list, 1), is_equal_to_string("bc"));
+    assert_that(dc_list_get_length(&env, list, 1), is_equal_to(2));
+    assert_that(dc_list_get_string(&env, list, 2), is_equal_to_string("d"));
+    dc_list_destroy(&env, &list);
+    assert_parse_fails(DC_LIST_STRING, "a,,b");
+    assert_parse_fails(DC_LIST_STRING, "a, ");
+}
+
+Ensure(list, integers)
+{
+    struct dc_list *list;
+    char buffer[32];
+
+    list = dc_list_parse(&env, &err, DC_LIST_INTEGER, "1,-2,9223372036854775807", ',');
+    assert_that(list, is_not_null);
+    assert_that(dc_list_get_integer(&env, list, 1), is_equal_to(-2));
+    assert_that(dc_list_get_integer(&env, list, 2), is_equal_to(INT64_MAX));
+    dc_list_format(&env, list, buffer, sizeof(buffer));
+    assert_that(buffer, is_equal_to_string("1,-2,9223372036854775807"));
+    dc_list_destroy(&env, &list);
+    assert_parse_fails(DC_LIST_INTEGER, "1,x");
+    assert_parse_fails(DC_LIST_INTEGER, "1,9223372036854775808");
+    assert_parse_fails(DC_LIST_INTEGER, "1.5");
+}
+
+Ensure(list, endpoints)
+{
+    struct dc_list *list;
+    char buffer[64];
+
+    list = dc_list_parse(&env, &err, DC_LIST_ENDPOINT, "localhost:80,[::1]:65535", ',');
+    assert_that(list, is_not_null);
+    assert_that(dc_list_get_host(&env, list, 0), is_equal_to_string("localhost"));
+    assert_that(dc_list_get_port(&env, list, 0), is_equal_to(80));
+    assert_that(dc_list_get_host(&env, list, 1), is_equal_to_string("::1"));
+    assert_that(dc_list_get_port(&env, list, 1), is_equal_to(65535));
+    dc_list_format(&env, list, buffer, sizeof(buffer));
+    assert_that(buffer, is_equal_to_string("localhost:80,[::1]:65535"));
+    dc_list_destroy(&env, &list);
+}
+
+Ensure(list, endpoints_reject_bad_input)
+{
+    const char *bad[] = {"localhost", ":80", "host:", "host:65536", "host:x", "::1:80", "[::1]80", "[::1", "[]:80"};
+
+    for(size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        assert_parse_fails(DC_LIST_ENDPOINT, bad[i]);
+    }
+}
+
+Ensure(list, load_checks_the_bytes)
+{
+    struct dc_list *list;
+    struct dc_list *loaded;
+    unsigned char *bytes;
+    size_t size;
+
+    list = dc_list_parse(&env, &err, DC_LIST_STRING, "a,b", ',');
+    size = dc_list_get_size(&env, list);
+    bytes = dc_malloc(&env, &err, size);
+    dc_memcpy(&env, bytes, list, size);
+    loaded = dc_list_load(&env, &err, bytes, size);
+    assert_that(loaded, is_not_null);
+    assert_that(dc_list_get_string(&env, loaded, 1), is_equal_to_string("b"));
+    dc_list_destroy(&env, &loaded);
+
+    loaded = dc_list_load(&env, &err, bytes, size - 1);
+    assert_that(loaded, is_null);
+    assert_that(dc_error_has_error(&err), is_true);
+    dc_error_reset(&err);
+
+    // the last string is no longer terminated
+    bytes[size - 1] = 'x';
+    loaded = dc_list_load(&env, &err, bytes, size);
+    assert_that(loaded, is_null);
+    assert_that(dc_error_has_error(&err), is_true);
+    dc_error_reset(&err);
+
+    loaded = dc_list_load(&env, &err, bytes, 1);
+    assert_that(loaded, is_null);
+    assert_that(dc_error_has_error(&err), is_true);
+    dc_free(&env, bytes);
+    dc_list_destroy(&env, &list);
+}
+
+TestSuite *list_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, list, strings);
+    add_test_with_context(suite, list, integers);
+    add_test_with_context(suite, list, endpoints);
+    add_test_with_context(suite, list, endpoints_reject_bad_input);
+    add_test_with_context(suite, list, load_checks_the_bytes);
+
+    return suite;
+}
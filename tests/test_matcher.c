@@ -0,0 +1,108 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "dc_application/matcher.h"
+#include <regex.h>
+
+
+Describe(matcher);
+
+static struct dc_env env;
+static struct dc_error err;
+
+BeforeEach(matcher)
+{
+    dc_env_init(&env, NULL);
+    dc_error_init(&err, NULL);
+}
+
+AfterEach(matcher)
+{
+    dc_error_reset(&err);
+}
+
+Ensure(matcher, same_pattern_is_shared)
+{
+    struct dc_matcher *first;
+    struct dc_matcher *second;
+    struct dc_matcher *other;
+
+    first = dc_matcher_acquire(&env, &err, "^[a-z]+$");
+    second = dc_matcher_acquire(&env, &err, "^[a-z]+$");
+    other = dc_matcher_acquire(&env, &err, "^[a-z]*$");
+    assert_that(first, is_not_null);
+    assert_that(first == second, is_true);
+    assert_that(first == other, is_false);
+    assert_that(dc_matcher_get_pattern(&env, first), is_equal_to_string("^[a-z]+$"));
+
+    // the matcher stays usable until the last holder lets go
+    dc_matcher_release(&env, &first);
+    assert_that(first, is_null);
+    assert_that(dc_matcher_match(&env, second, "abc"), is_true);
+    dc_matcher_release(&env, &second);
+    dc_matcher_release(&env, &other);
+}
+
+Ensure(matcher, bad_pattern)
+{
+    assert_that(dc_matcher_acquire(&env, &err, "[a-"), is_null);
+    assert_that(dc_error_has_error(&err), is_true);
+}
+
+Ensure(matcher, simple_forms_agree_with_regexec)
+{
+    const char *patterns[] = {
+        "^abc$", "^abc", "abc$", "abc", "^[a-z]+$", "^[a-z0-9_-]*$", "^[[:digit:]]+$", "^[^/]+$", "a.c", "^(ab|cd)$", "",
+    };
+    const char *inputs[] = {
+        "", "abc", "abcd", "xabc", "xabcx", "ab", "a-b_1", "123", "12a", "a/b", "cd", "ABC",
+    };
+
+    for(size_t i = 0; i < sizeof(patterns) / sizeof(patterns[0]); i++)
+    {
+        struct dc_matcher *matcher;
+        regex_t regex;
+
+        matcher = dc_matcher_acquire(&env, &err, patterns[i]);
+        assert_that(matcher, is_not_null);
+        assert_that(regcomp(&regex, patterns[i], REG_EXTENDED | REG_NOSUB), is_equal_to(0));
+
+        for(size_t j = 0; j < sizeof(inputs) / sizeof(inputs[0]); j++)
+        {
+            bool expected;
+
+            expected = regexec(&regex, inputs[j], 0, NULL, 0) == 0;
+            assert_that(dc_matcher_match(&env, matcher, inputs[j]), is_equal_to(expected));
+        }
+
+        regfree(&regex);
+        dc_matcher_release(&env, &matcher);
+    }
+}
+
+TestSuite *matcher_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, matcher, same_pattern_is_shared);
+    add_test_with_context(suite, matcher, bad_pattern);
+    add_test_with_context(suite, matcher, simple_forms_agree_with_regexec);
+
+    return suite;
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "dc_application/memory.h"
+#include <stdalign.h>
+#include <stdint.h>
+
+
+#define OBJECT_COUNT 8
+
+
+Describe(memory);
+
+static struct dc_env env;
+static struct dc_error err;
+static struct dc_memory_region *region;
+
+BeforeEach(memory)
+{
+    dc_env_init(&env, NULL);
+    dc_error_init(&err, NULL);
+    region = dc_memory_region_create(&env, &err, 1);
+}
+
+AfterEach(memory)
+{
+    dc_memory_region_destroy(&env, &region);
+    dc_error_reset(&err);
+}
+
+Ensure(memory, region_is_rounded_to_huge_pages)
+{
+    assert_that(dc_error_has_no_error(&err), is_true);
+    assert_that(region, is_not_null);
+    assert_that(dc_memory_region_get_length(&env, region), is_equal_to(DC_MEMORY_HUGE_PAGE_SIZE));
+    assert_that((uintptr_t)dc_memory_region_get_address(&env, region) % 4096, is_equal_to(0));
+}
+
+Ensure(memory, get_and_put)
+{
+    struct dc_memory_pool *pool;
+    void *objects[OBJECT_COUNT];
+    void *object;
+    char *start;
+    char *end;
+
+    pool = dc_memory_pool_create(&env, &err, region, 20, OBJECT_COUNT);
+    assert_that(dc_error_has_no_error(&err), is_true);
+    start = dc_memory_region_get_address(&env, region);
+    end = start + dc_memory_region_get_length(&env, region);
+
+    for(size_t i = 0; i < OBJECT_COUNT; i++)
+    {
+        objects[i] = dc_memory_pool_get(&env, &err, pool);
+        assert_that(objects[i], is_not_null);
+        assert_that((char *)objects[i] >= start && (char *)objects[i] + 20 <= end, is_true);
+        assert_that((uintptr_t)objects[i] % alignof(max_align_t), is_equal_to(0));
+
+        for(size_t j = 0; j < i; j++)
+        {
+            assert_that(objects[i], is_not_equal_to(objects[j]));
+        }
+    }
+
+    assert_that(dc_error_has_no_error(&err), is_true);
+    object = dc_memory_pool_get(&env, &err, pool);
+    assert_that(object, is_null);
+    assert_that(dc_error_has_error(&err), is_true);
+    dc_error_reset(&err);
+
+    dc_memory_pool_put(&env, pool, objects[3]);
+    object = dc_memory_pool_get(&env, &err, pool);
+    assert_that(object, is_equal_to(objects[3]));
+
+    for(size_t i = 0; i < OBJECT_COUNT; i++)
+    {
+        dc_memory_pool_put(&env, pool, objects[i]);
+    }
+
+    for(size_t i = 0; i < OBJECT_COUNT; i++)
+    {
+        assert_that(dc_memory_pool_get(&env, &err, pool), is_not_null);
+    }
+
+    assert_that(dc_error_has_no_error(&err), is_true);
+    dc_memory_pool_destroy(&env, &pool);
+    assert_that(pool, is_null);
+}
+
+Ensure(memory, pools_share_the_region)
+{
+    struct dc_memory_pool *first;
+    struct dc_memory_pool *second;
+    struct dc_memory_pool *too_big;
+    char *a;
+    char *b;
+
+    first = dc_memory_pool_create(&env, &err, region, 64, 1024);
+    second = dc_memory_pool_create(&env, &err, region, 64, 1024);
+    assert_that(dc_error_has_no_error(&err), is_true);
+    a = dc_memory_pool_get(&env, &err, first);
+    b = dc_memory_pool_get(&env, &err, second);
+    assert_that(a + 64 <= b || b + 64 <= a, is_true);
+
+    too_big = dc_memory_pool_create(&env, &err, region, DC_MEMORY_HUGE_PAGE_SIZE, 1);
+    assert_that(too_big, is_null);
+    assert_that(dc_error_has_error(&err), is_true);
+    dc_error_reset(&err);
+    dc_memory_pool_destroy(&env, &first);
+    dc_memory_pool_destroy(&env, &second);
+}
+
+TestSuite *memory_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, memory, region_is_rounded_to_huge_pages);
+    add_test_with_context(suite, memory, get_and_put);
+    add_test_with_context(suite, memory, pools_share_the_region);
+
+    return suite;
+}
@@ -0,0 +1,177 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "test_schema.h"
+#include "dc_application/application.h"
+#include "dc_application/defaults.h"
+#include "dc_application/notify.h"
+#include "dc_application/schema.h"
+#include <dc_c/dc_string.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_unistd.h>
+#include <dc_posix/sys/dc_socket.h>
+#include <sys/un.h>
+
+
+DC_SCHEMA_STRUCT(notify_settings, TEST_SCHEMA)
+DC_SCHEMA_DEFINE(notify_settings, TEST_SCHEMA, "DC_NOTIFY_TEST_")
+
+
+#define SOCKET_PATH "/tmp/dc_application_test_notify.sock"
+
+
+static int bind_socket(const char *path);
+static void receive(int fd, char *buffer, size_t size);
+static int run(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings);
+
+
+Describe(notify);
+
+static struct dc_env test_env;
+static struct dc_error test_err;
+static int receiver;
+
+BeforeEach(notify)
+{
+    dc_env_init(&test_env, NULL);
+    dc_error_init(&test_err, NULL);
+    receiver = bind_socket(SOCKET_PATH);
+    dc_setenv(&test_env, &test_err, DC_NOTIFY_SOCKET_ENV_VAR, SOCKET_PATH, 1);
+}
+
+AfterEach(notify)
+{
+    dc_unsetenv(&test_env, &test_err, DC_NOTIFY_SOCKET_ENV_VAR);
+    dc_unsetenv(&test_env, &test_err, DC_NOTIFY_WATCHDOG_USEC_ENV_VAR);
+    dc_unsetenv(&test_env, &test_err, DC_NOTIFY_WATCHDOG_PID_ENV_VAR);
+    dc_close(&test_env, &test_err, receiver);
+    dc_unlink(&test_env, &test_err, SOCKET_PATH);
+    dc_error_reset(&test_err);
+}
+
+Ensure(notify, no_socket_no_notifier)
+{
+    dc_unsetenv(&test_env, &test_err, DC_NOTIFY_SOCKET_ENV_VAR);
+    assert_that(dc_notifier_create(&test_env, &test_err), is_null);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+}
+
+Ensure(notify, messages_arrive_as_sent)
+{
+    struct dc_notifier *notifier;
+    char buffer[256];
+
+    notifier = dc_notifier_create(&test_env, &test_err);
+    assert_that(notifier, is_not_null);
+    dc_notifier_send(&test_env, &test_err, notifier, "READY=1\nSTATUS=up");
+    receive(receiver, buffer, sizeof(buffer));
+    assert_that(buffer, is_equal_to_string("READY=1\nSTATUS=up"));
+    dc_notifier_destroy(&test_env, &notifier);
+    assert_that(notifier, is_null);
+}
+
+Ensure(notify, watchdog_pings)
+{
+    struct dc_notifier *notifier;
+    char pid[32];
+    char buffer[256];
+
+    // a ping every 10ms, the receive timeout is much longer
+    snprintf(pid, sizeof(pid), "%d", (int)dc_getpid(&test_env));
+    dc_setenv(&test_env, &test_err, DC_NOTIFY_WATCHDOG_USEC_ENV_VAR, "20000", 1);
+    dc_setenv(&test_env, &test_err, DC_NOTIFY_WATCHDOG_PID_ENV_VAR, pid, 1);
+    notifier = dc_notifier_create(&test_env, &test_err);
+    dc_notifier_start_watchdog(&test_env, &test_err, notifier);
+    receive(receiver, buffer, sizeof(buffer));
+    assert_that(buffer, is_equal_to_string("WATCHDOG=1"));
+    receive(receiver, buffer, sizeof(buffer));
+    assert_that(buffer, is_equal_to_string("WATCHDOG=1"));
+    dc_notifier_destroy(&test_env, &notifier);
+}
+
+Ensure(notify, application_reports_ready_and_stopping_with_timestamps)
+{
+    struct dc_application_info *info;
+    char name[] = "test";
+    char *argv[] = {name, NULL};
+    char buffer[1024];
+
+    info = dc_application_info_create(&test_env, &test_err, "Test Application");
+    dc_application_run(&test_env, &test_err, info, notify_settings_create, notify_settings_destroy, run, dc_default_create_lifecycle, dc_default_destroy_lifecycle, NULL, 1, argv);
+    dc_application_info_destroy(&test_env, &info);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+
+    receive(receiver, buffer, sizeof(buffer));
+    assert_that(dc_strncmp(&test_env, buffer, "READY=1\nMONOTONIC_USEC=", 23), is_equal_to(0));
+    assert_that(dc_strstr(&test_env, buffer, "\nSTATUS=READY=1 after "), is_not_null);
+    assert_that(dc_strstr(&test_env, buffer, "\nDC_PHASE_SET_DEFAULTS_USEC="), is_not_null);
+    assert_that(buffer[dc_strlen(&test_env, buffer) - 1] == '\n', is_false);
+
+    receive(receiver, buffer, sizeof(buffer));
+    assert_that(dc_strncmp(&test_env, buffer, "STOPPING=1\nMONOTONIC_USEC=", 26), is_equal_to(0));
+}
+
+TestSuite *notify_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, notify, no_socket_no_notifier);
+    add_test_with_context(suite, notify, messages_arrive_as_sent);
+    add_test_with_context(suite, notify, watchdog_pings);
+    add_test_with_context(suite, notify, application_reports_ready_and_stopping_with_timestamps);
+
+    return suite;
+}
+
+static int bind_socket(const char *path)
+{
+    struct sockaddr_un address;
+    struct timeval timeout;
+    int fd;
+
+    dc_memset(&test_env, &address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    dc_strcpy(&test_env, address.sun_path, path);
+    fd = dc_socket(&test_env, &test_err, AF_UNIX, SOCK_DGRAM, 0);
+    dc_bind(&test_env, &test_err, fd, (struct sockaddr *)&address, sizeof(address));
+
+    // a message that never comes fails the test rather than hanging it
+    timeout.tv_sec = 2;
+    timeout.tv_usec = 0;
+    dc_setsockopt(&test_env, &test_err, fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    return fd;
+}
+
+static void receive(int fd, char *buffer, size_t size)
+{
+    ssize_t count;
+
+    count = dc_recv(&test_env, &test_err, fd, buffer, size - 1, 0);
+    assert_that(count, is_greater_than(0));
+    buffer[count > 0 ? count : 0] = '\0';
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int run(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings)
+{
+    return 0;
+}
+#pragma GCC diagnostic pop
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "dc_application/parse.h"
+
+
+Describe(parse);
+
+static struct dc_env env;
+static struct dc_error err;
+
+BeforeEach(parse)
+{
+    dc_env_init(&env, NULL);
+    dc_error_init(&err, NULL);
+}
+
+AfterEach(parse)
+{
+    dc_error_reset(&err);
+}
+
+Ensure(parse, uint32_bounds)
+{
+    uint32_t value;
+
+    assert_that(dc_parse_uint32(&env, &err, "4294967295", &value), is_true);
+    assert_that(value, is_equal_to(UINT32_MAX));
+    assert_that(dc_parse_uint32(&env, &err, "4294967296", &value), is_false);
+    assert_that(dc_error_has_error(&err), is_true);
+}
+
+Ensure(parse, int32_bounds)
+{
+    int32_t value;
+
+    assert_that(dc_parse_int32(&env, &err, "-2147483648", &value), is_true);
+    assert_that(value, is_equal_to(INT32_MIN));
+    assert_that(dc_parse_int32(&env, &err, "-2147483649", &value), is_false);
+    assert_that(dc_error_has_error(&err), is_true);
+}
+
+Ensure(parse, integers_reject_junk)
+{
+    const char *bad[] = {"", " 1", "1 ", "1x", "0x10", "+", "-", "--1", "99999999999999999999x"};
+    uint64_t value;
+
+    for(size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        struct dc_error local_err;
+
+        dc_error_init(&local_err, NULL);
+        assert_that(dc_parse_uint64(&env, &local_err, bad[i], &value), is_false);
+        assert_that(dc_error_has_error(&local_err), is_true);
+        dc_error_reset(&local_err);
+    }
+}
+
+Ensure(parse, double_rejects_what_strtod_accepts)
+{
+    const char *bad[] = {"", " 1", "0x10", "inf", "nan", "1e400", "1.5x", "e5", "."};
+    double value;
+
+    for(size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        struct dc_error local_err;
+
+        dc_error_init(&local_err, NULL);
+        assert_that(dc_parse_double(&env, &local_err, bad[i], &value), is_false);
+        assert_that(dc_error_has_error(&local_err), is_true);
+        dc_error_reset(&local_err);
+    }
+
+    assert_that(dc_parse_double(&env, &err, "-.5e1", &value), is_true);
+    assert_that((int)value, is_equal_to(-5));
+}
+
+Ensure(parse, bytes_units)
+{
+    uint64_t value;
+
+    assert_that(dc_parse_bytes(&env, &err, "1.5KiB", &value), is_true);
+    assert_that(value, is_equal_to(1536));
+    assert_that(dc_parse_bytes(&env, &err, "2MB", &value), is_true);
+    assert_that(value, is_equal_to(2000000));
+    assert_that(dc_parse_bytes(&env, &err, "16EiB", &value), is_false);
+    assert_that(dc_error_has_error(&err), is_true);
+}
+
+Ensure(parse, bytes_rejects_unknown_units)
+{
+    const char *bad[] = {"1kib", "1 KiB", "KiB", "1..5KiB", "-1", "1XB"};
+    uint64_t value;
+
+    for(size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        struct dc_error local_err;
+
+        dc_error_init(&local_err, NULL);
+        assert_that(dc_parse_bytes(&env, &local_err, bad[i], &value), is_false);
+        assert_that(dc_error_has_error(&local_err), is_true);
+        dc_error_reset(&local_err);
+    }
+}
+
+Ensure(parse, duration_needs_a_unit)
+{
+    uint64_t value;
+
+    assert_that(dc_parse_duration(&env, &err, "0", &value), is_true);
+    assert_that(value, is_equal_to(0));
+    assert_that(dc_parse_duration(&env, &err, "1.5s", &value), is_true);
+    assert_that(value, is_equal_to(1500000000));
+    assert_that(dc_parse_duration(&env, &err, "10", &value), is_false);
+    assert_that(dc_error_has_error(&err), is_true);
+}
+
+Ensure(parse, duration_range)
+{
+    uint64_t value;
+
+    // UINT64_MAX nanoseconds is a little over 213503 days
+    assert_that(dc_parse_duration(&env, &err, "213503d", &value), is_true);
+    assert_that(dc_parse_duration(&env, &err, "213504d", &value), is_false);
+    assert_that(dc_error_has_error(&err), is_true);
+}
+
+Ensure(parse, format_round_trips)
+{
+    char buffer[32];
+    uint64_t value;
+
+    dc_format_bytes(&env, UINT64_C(3) << 20, buffer, sizeof(buffer));
+    assert_that(buffer, is_equal_to_string("3MiB"));
+    assert_that(dc_parse_bytes(&env, &err, buffer, &value), is_true);
+    assert_that(value, is_equal_to(UINT64_C(3) << 20));
+    dc_format_duration(&env, UINT64_C(90000000000), buffer, sizeof(buffer));
+    assert_that(dc_parse_duration(&env, &err, buffer, &value), is_true);
+    assert_that(value, is_equal_to(UINT64_C(90000000000)));
+}
+
+TestSuite *parse_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, parse, uint32_bounds);
+    add_test_with_context(suite, parse, int32_bounds);
+    add_test_with_context(suite, parse, integers_reject_junk);
+    add_test_with_context(suite, parse, double_rejects_what_strtod_accepts);
+    add_test_with_context(suite, parse, bytes_units);
+    add_test_with_context(suite, parse, bytes_rejects_unknown_units);
+    add_test_with_context(suite, parse, duration_needs_a_unit);
+    add_test_with_context(suite, parse, duration_range);
+    add_test_with_context(suite, parse, format_round_trips);
+
+    return suite;
+}
@@ -0,0 +1,214 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "test_schema.h"
+#include "dc_application/provider.h"
+#include "dc_application/schema.h"
+#include <dc_c/dc_stdlib.h>
+#include <dc_c/dc_string.h>
+#include <dc_posix/dc_fcntl.h>
+#include <dc_posix/dc_unistd.h>
+#include <stdatomic.h>
+
+
+DC_SCHEMA_STRUCT(provider_settings, TEST_SCHEMA)
+DC_SCHEMA_DEFINE(provider_settings, TEST_SCHEMA, "TEST_")
+
+
+#define CACHE_PATH "/tmp/dc_application_test_provider.cache"
+
+
+struct source
+{
+    const char *text;
+    atomic_int calls;
+};
+
+
+static char *fetch(const struct dc_env *env, struct dc_error *err, void *data);
+static void apply(struct dc_config_provider *provider);
+static void write_cache(const char *text);
+static void remove_cache(void);
+static void read_cache(char *buffer, size_t size);
+
+
+Describe(provider);
+
+static struct dc_env test_env;
+static struct dc_error test_err;
+static struct dc_application_settings *settings;
+static struct provider_settings *test_settings;
+static struct dc_config_providers *providers;
+
+BeforeEach(provider)
+{
+    dc_env_init(&test_env, NULL);
+    dc_error_init(&test_err, NULL);
+    settings = provider_settings_create(&test_env, &test_err);
+    assert_that(settings, is_not_null);
+    test_settings = (struct provider_settings *)settings;
+    providers = dc_config_providers_create(&test_env, &test_err);
+    remove_cache();
+}
+
+AfterEach(provider)
+{
+    dc_config_providers_destroy(&test_env, &providers);
+    provider_settings_destroy(&test_env, &test_err, &settings);
+    remove_cache();
+    dc_error_reset(&test_err);
+}
+
+Ensure(provider, fetched_settings_are_applied_and_cached)
+{
+    struct source source = {"message = \"fetched\";\n", 0};
+    struct dc_config_provider provider = {"test", fetch, &source, CACHE_PATH, 60000, 1000};
+    char cached[64];
+
+    apply(&provider);
+    assert_that(source.calls, is_equal_to(1));
+    assert_that(dc_setting_string_get(&test_env, test_settings->message), is_equal_to_string("fetched"));
+    read_cache(cached, sizeof(cached));
+    assert_that(cached, is_equal_to_string(source.text));
+}
+
+Ensure(provider, fresh_cache_skips_the_fetch)
+{
+    struct source source = {"message = \"fetched\";\n", 0};
+    struct dc_config_provider provider = {"test", fetch, &source, CACHE_PATH, 60000, 1000};
+
+    write_cache("message = \"cached\";\n");
+    apply(&provider);
+    assert_that(source.calls, is_equal_to(0));
+    assert_that(dc_setting_string_get(&test_env, test_settings->message), is_equal_to_string("cached"));
+}
+
+Ensure(provider, stale_cache_stands_in_for_a_failed_fetch)
+{
+    struct source source = {NULL, 0};
+    struct dc_config_provider provider = {"test", fetch, &source, CACHE_PATH, 0, 1000};
+
+    write_cache("message = \"cached\";\n");
+    apply(&provider);
+    assert_that(source.calls, is_equal_to(1));
+    assert_that(dc_setting_string_get(&test_env, test_settings->message), is_equal_to_string("cached"));
+}
+
+Ensure(provider, damaged_cache_is_ignored)
+{
+    struct source source = {NULL, 0};
+    struct dc_config_provider provider = {"test", fetch, &source, CACHE_PATH, 60000, 1000};
+
+    write_cache("message = {{");
+    apply(&provider);
+    assert_that(source.calls, is_equal_to(1));
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+    assert_that(dc_setting_is_set(&test_env, (struct dc_setting *)test_settings->message), is_false);
+}
+
+Ensure(provider, earlier_providers_win)
+{
+    struct source first_source = {"message = \"first\";\n", 0};
+    struct source second_source = {"message = \"second\";\n", 0};
+    struct dc_config_provider first = {"first", fetch, &first_source, NULL, 0, 1000};
+    struct dc_config_provider second = {"second", fetch, &second_source, NULL, 0, 1000};
+
+    dc_config_providers_add(&test_env, &test_err, providers, &first);
+    apply(&second);
+    assert_that(second_source.calls, is_equal_to(1));
+    assert_that(dc_setting_string_get(&test_env, test_settings->message), is_equal_to_string("first"));
+}
+
+TestSuite *provider_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, provider, fetched_settings_are_applied_and_cached);
+    add_test_with_context(suite, provider, fresh_cache_skips_the_fetch);
+    add_test_with_context(suite, provider, stale_cache_stands_in_for_a_failed_fetch);
+    add_test_with_context(suite, provider, damaged_cache_is_ignored);
+    add_test_with_context(suite, provider, earlier_providers_win);
+
+    return suite;
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static char *fetch(const struct dc_env *env, struct dc_error *err, void *data)
+{
+    struct source *source;
+    char *text;
+
+    source = data;
+    atomic_fetch_add(&source->calls, 1);
+
+    if(source->text == NULL)
+    {
+        DC_ERROR_RAISE_USER(err, "the source is down", -1);
+
+        return NULL;
+    }
+
+    text = dc_malloc(env, err, dc_strlen(env, source->text) + 1);
+
+    if(text)
+    {
+        dc_strcpy(env, text, source->text);
+    }
+
+    return text;
+}
+#pragma GCC diagnostic pop
+
+static void apply(struct dc_config_provider *provider)
+{
+    dc_config_providers_add(&test_env, &test_err, providers, provider);
+    dc_config_providers_start(&test_env, &test_err, providers);
+    dc_config_providers_apply(&test_env, &test_err, providers, settings);
+}
+
+static void write_cache(const char *text)
+{
+    int fd;
+
+    fd = dc_open(&test_env, &test_err, CACHE_PATH, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+    dc_write(&test_env, &test_err, fd, text, dc_strlen(&test_env, text));
+    dc_close(&test_env, &test_err, fd);
+}
+
+// there is not always a cache to remove
+static void remove_cache(void)
+{
+    struct dc_error local_err;
+
+    dc_error_init(&local_err, NULL);
+    dc_unlink(&test_env, &local_err, CACHE_PATH);
+    dc_error_reset(&local_err);
+}
+
+static void read_cache(char *buffer, size_t size)
+{
+    ssize_t count;
+    int fd;
+
+    fd = dc_open(&test_env, &test_err, CACHE_PATH, O_RDONLY);
+    count = dc_read(&test_env, &test_err, fd, buffer, size - 1);
+    dc_close(&test_env, &test_err, fd);
+    buffer[count > 0 ? count : 0] = '\0';
+}
@@ -0,0 +1,24 @@
+#ifndef LIBDC_APPLICATION_TEST_SCHEMA_H
+#define LIBDC_APPLICATION_TEST_SCHEMA_H
+
+
+/*
+ * The settings the tests run against. It is in a header of its own so dc_application_schema_index can generate the
+ * indexes for it.
+ */
+#define TEST_SCHEMA(X, S)                                                                                                                                    \
+    X(S, config_path, opts.parent.config_path, 0, "config", required_argument, 'c', "CONFIG", NULL, NULL, NULL, NULL)                                        \
+    X(S, string, message, 0, "message", required_argument, 'm', "MESSAGE", "message", "Hello", NULL, NULL)                                                 \
+    X(S, bool, verbose, 0, "verbose", no_argument, 'v', "VERBOSE", "verbose", NULL, NULL, NULL)                                                            \
+    X(S, bool, quiet, 0, "quiet", no_argument, 'q', "QUIET", "quiet", NULL, NULL, NULL)                                                                    \
+    X(S, uint16, workers, 0, "workers", required_argument, 'w', "WORKERS", "server.workers", &(const uint16_t){4}, &(const uint16_t){1}, &(const uint16_t){64}) \
+    X(S, in_port_t, port, 0, "port", long_required_argument, 0x100, "PORT", "server.port", NULL, NULL, NULL)                                                \
+    X(S, int64, offset, 0, "offset", long_required_argument, 0x101, "OFFSET", "server.offset", NULL, NULL, NULL)                                            \
+    X(S, bytes, buffer_size, 0, "buffer-size", long_required_argument, 0x102, "BUFFER_SIZE", "server.buffer_size", NULL, NULL, NULL)                       \
+    X(S, duration, timeout, 0, "timeout", required_argument, 't', "TIMEOUT", "server.tls.timeout", NULL, NULL, NULL)                                       \
+    X(S, string, level, 0, "level", optional_argument, 'l', "LEVEL", "log.level", NULL, NULL, NULL)                                                        \
+    X(S, string_list, hosts, 0, "hosts", long_required_argument, 0x103, "HOSTS", "hosts", NULL, NULL, NULL)                                               \
+    X(S, endpoint_list, peers, 0, "peers", long_required_argument, 0x104, "PEERS", "cluster.peers", NULL, NULL, NULL)
+
+
+#endif // LIBDC_APPLICATION_TEST_SCHEMA_H
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "test_schema.h"
+#include "dc_application/command_line.h"
+#include "dc_application/options.h"
+#include "dc_application/schema.h"
+#include <dc_c/dc_string.h>
+
+
+DC_SCHEMA_STRUCT(test_settings, TEST_SCHEMA)
+#include "test_settings_index.h"
+DC_SCHEMA_DEFINE_INDEXED(test_settings, TEST_SCHEMA, "TEST_")
+
+
+Describe(schema_index);
+
+static struct dc_env env;
+static struct dc_error err;
+static struct dc_application_settings *settings;
+static struct dc_opt_settings *opt_settings;
+
+static const char *const unknown_keys[] =
+{
+    "",
+    "x",
+    "messag",
+    "messages",
+    "Message",
+    "server",
+    "server.",
+    "server.tls",
+    "WORKER",
+    "TEST_WORKERS",
+    "tls.timeout",
+};
+
+BeforeEach(schema_index)
+{
+    dc_env_init(&env, NULL);
+    dc_error_init(&err, NULL);
+    settings = test_settings_create(&env, &err);
+    opt_settings = (struct dc_opt_settings *)settings;
+}
+
+AfterEach(schema_index)
+{
+    test_settings_destroy(&env, &err, &settings);
+    dc_error_reset(&err);
+}
+
+Ensure(schema_index, every_key_is_found)
+{
+    assert_that(settings, is_not_null);
+    assert_that(opt_settings->name_index, is_not_null);
+
+    for(const struct options *opt = opt_settings->opts; opt->name != NULL; opt++)
+    {
+        assert_that(dc_options_find(&env, opt_settings, opt->name), is_equal_to(opt));
+
+        if(opt->env_key)
+        {
+            assert_that(dc_options_find_env(&env, opt_settings, opt->env_key, dc_strlen(&env, opt->env_key)), is_equal_to(opt));
+        }
+
+        if(opt->config_key)
+        {
+            assert_that(dc_options_find_config(&env, opt_settings, opt->config_key, dc_strlen(&env, opt->config_key)), is_equal_to(opt));
+        }
+    }
+}
+
+Ensure(schema_index, unknown_keys_are_not_found)
+{
+    for(size_t i = 0; i < sizeof(unknown_keys) / sizeof(unknown_keys[0]); i++)
+    {
+        size_t length;
+
+        length = dc_strlen(&env, unknown_keys[i]);
+        assert_that(dc_options_find_name(&env, opt_settings, unknown_keys[i], length), is_null);
+        assert_that(dc_options_find_env(&env, opt_settings, unknown_keys[i], length), is_null);
+        assert_that(dc_options_find_config(&env, opt_settings, unknown_keys[i], length), is_null);
+    }
+}
+
+Ensure(schema_index, keys_are_matched_by_length)
+{
+    const char *path;
+
+    // config keys are looked up one group at a time without being copied out of the path
+    path = "server.workers.extra";
+    assert_that(dc_options_find_config(&env, opt_settings, path, 14), is_equal_to(&opt_settings->opts[4]));
+    assert_that(dc_options_find_config(&env, opt_settings, path, 13), is_null);
+    assert_that(dc_options_find_config(&env, opt_settings, path, 20), is_null);
+    assert_that(dc_options_find_name(&env, opt_settings, "portable", 4), is_equal_to(&opt_settings->opts[5]));
+}
+
+Ensure(schema_index, agrees_with_the_table)
+{
+    struct dc_opt_settings searched;
+
+    // without the indexes the table is searched in order, both have to give the same answers
+    searched = *opt_settings;
+    searched.name_index = NULL;
+    searched.env_index = NULL;
+    searched.config_index = NULL;
+
+    for(size_t i = 0; i < sizeof(unknown_keys) / sizeof(unknown_keys[0]); i++)
+    {
+        assert_that(dc_options_find(&env, &searched, unknown_keys[i]), is_equal_to(dc_options_find(&env, opt_settings, unknown_keys[i])));
+    }
+
+    for(const struct options *opt = opt_settings->opts; opt->name != NULL; opt++)
+    {
+        assert_that(dc_options_find(&env, &searched, opt->name), is_equal_to(opt));
+    }
+}
+
+TestSuite *schema_index_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, schema_index, every_key_is_found);
+    add_test_with_context(suite, schema_index, unknown_keys_are_not_found);
+    add_test_with_context(suite, schema_index, keys_are_matched_by_length);
+    add_test_with_context(suite, schema_index, agrees_with_the_table);
+
+    return suite;
+}
@@ -0,0 +1,337 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "test_schema.h"
+#include "dc_application/command_line.h"
+#include "dc_application/list.h"
+#include "dc_application/schema.h"
+#include "dc_application/segment.h"
+#include <dc_c/dc_stdlib.h>
+#include <dc_c/dc_string.h>
+#include <dc_posix/dc_fcntl.h>
+#include <dc_posix/dc_unistd.h>
+#include <dc_posix/sys/dc_mman.h>
+#include <dc_posix/sys/dc_stat.h>
+
+
+DC_SCHEMA_STRUCT(segment_settings, TEST_SCHEMA)
+DC_SCHEMA_DEFINE(segment_settings, TEST_SCHEMA, "TEST_")
+
+
+// where the fields are in the segment, see struct segment_header and struct segment_entry in src/segment.c
+#define MAGIC_AT 0
+#define VERSION_AT 4
+#define NAME_AT 8
+#define SIZE_AT 80
+#define COUNT_AT 88
+#define ENTRIES_OFFSET_AT 92
+#define STRINGS_OFFSET_AT 96
+#define STRINGS_SIZE_AT 100
+#define HEADER_SIZE 104
+#define ENTRY_SIZE 24
+#define ENTRY_NAME_OFFSET_AT 0
+#define ENTRY_VALUE_LENGTH_AT 12
+#define ENTRY_VALUE_AT 16
+// the message setting is the second one in TEST_SCHEMA
+#define MESSAGE_ENTRY (HEADER_SIZE + ENTRY_SIZE)
+
+#ifdef F_SEAL_FUTURE_WRITE
+#define SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL | F_SEAL_FUTURE_WRITE)
+#else
+#define SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)
+#endif
+
+
+static int write_segment(const unsigned char *bytes, size_t size, int seals);
+static void put32(unsigned char *bytes, size_t at, uint32_t value);
+static void put64(unsigned char *bytes, size_t at, uint64_t value);
+static void assert_attach_fails(const unsigned char *bytes, size_t size);
+
+
+Describe(segment);
+
+static struct dc_env env;
+static struct dc_error err;
+static struct dc_application_settings *settings;
+static struct segment_settings *test_settings;
+static struct dc_settings_segment *segment;
+static unsigned char *image;
+static size_t image_size;
+
+BeforeEach(segment)
+{
+    struct dc_list *hosts;
+    struct stat status;
+    void *mapping;
+
+    dc_env_init(&env, NULL);
+    dc_error_init(&err, NULL);
+    settings = segment_settings_create(&env, &err);
+    test_settings = (struct segment_settings *)settings;
+    dc_setting_string_set(&env, &err, test_settings->message, "Hello, World", DC_SETTING_COMMAND_LINE);
+    dc_setting_uint16_set(&env, test_settings->workers, 8, DC_SETTING_CONFIG);
+    hosts = dc_list_parse(&env, &err, DC_LIST_STRING, "a,b", ',');
+    dc_setting_list_set(&env, &err, test_settings->hosts, hosts, DC_SETTING_ENVIRONMENT);
+    dc_list_destroy(&env, &hosts);
+    segment = dc_settings_segment_publish(&env, &err, "test", settings);
+
+    // a copy of the published bytes that the tests can damage
+    dc_fstat(&env, &err, dc_settings_segment_get_fd(&env, segment), &status);
+    image_size = (size_t)status.st_size;
+    mapping = dc_mmap(&env, &err, NULL, image_size, PROT_READ, MAP_SHARED, dc_settings_segment_get_fd(&env, segment), 0);
+    image = dc_malloc(&env, &err, image_size);
+    dc_memcpy(&env, image, mapping, image_size);
+    dc_munmap(&env, &err, mapping, image_size);
+}
+
+AfterEach(segment)
+{
+    dc_free(&env, image);
+    dc_settings_segment_destroy(&env, &segment);
+    segment_settings_destroy(&env, &err, &settings);
+    dc_error_reset(&err);
+}
+
+Ensure(segment, round_trips)
+{
+    struct dc_settings_segment *attached;
+    struct dc_application_settings *copy;
+    struct segment_settings *copy_settings;
+    const struct dc_list *hosts;
+    ssize_t index;
+
+    assert_that(dc_error_has_no_error(&err), is_true);
+    attached = dc_settings_segment_attach(&env, &err, dc_settings_segment_get_fd(&env, segment), "test");
+    assert_that(attached, is_not_null);
+    index = dc_settings_segment_find(&env, attached, "message");
+    assert_that(index, is_equal_to(1));
+    assert_that(dc_settings_segment_get_string(&env, attached, (size_t)index), is_equal_to_string("Hello, World"));
+    index = dc_settings_segment_find(&env, attached, "workers");
+    assert_that(dc_settings_segment_get_uint16(&env, attached, (size_t)index), is_equal_to(8));
+    assert_that(dc_settings_segment_find(&env, attached, "nothing"), is_equal_to(-1));
+
+    copy = segment_settings_create(&env, &err);
+    copy_settings = (struct segment_settings *)copy;
+    dc_settings_segment_apply(&env, &err, attached, copy);
+    assert_that(dc_error_has_no_error(&err), is_true);
+    assert_that(dc_setting_string_get(&env, copy_settings->message), is_equal_to_string("Hello, World"));
+    assert_that(dc_setting_uint16_get(&env, copy_settings->workers), is_equal_to(8));
+    hosts = dc_setting_list_get(&env, copy_settings->hosts);
+    assert_that(hosts, is_not_null);
+    assert_that(dc_list_get_string(&env, hosts, 1), is_equal_to_string("b"));
+    segment_settings_destroy(&env, &err, &copy);
+    dc_settings_segment_destroy(&env, &attached);
+}
+
+Ensure(segment, getters_check_the_kind)
+{
+    assert_that(dc_settings_segment_get_int64(&env, segment, 1), is_equal_to(0));
+    assert_that(dc_settings_segment_get_bool(&env, segment, 1), is_false);
+    assert_that(dc_settings_segment_get_uint16(&env, segment, 4), is_equal_to(8));
+    assert_that(dc_settings_segment_get_uint32(&env, segment, 4), is_equal_to(0));
+    assert_that(dc_settings_segment_get_string(&env, segment, 4), is_null);
+}
+
+Ensure(segment, without_settings)
+{
+    static const struct options no_options[] = {{0}};
+    struct dc_opt_settings empty_settings;
+    struct dc_settings_segment *empty;
+    struct dc_settings_segment *attached;
+
+    dc_memset(&env, &empty_settings, 0, sizeof(empty_settings));
+    empty_settings.opts = no_options;
+    empty = dc_settings_segment_publish(&env, &err, "empty", (struct dc_application_settings *)&empty_settings);
+    assert_that(empty, is_not_null);
+    attached = dc_settings_segment_attach(&env, &err, dc_settings_segment_get_fd(&env, empty), "empty");
+    assert_that(attached, is_not_null);
+    assert_that(dc_settings_segment_get_count(&env, attached), is_equal_to(0));
+    assert_that(dc_settings_segment_find(&env, attached, "message"), is_equal_to(-1));
+    dc_settings_segment_destroy(&env, &attached);
+    dc_settings_segment_destroy(&env, &empty);
+}
+
+Ensure(segment, name_has_to_fit)
+{
+    char name[DC_SETTINGS_SEGMENT_NAME_SIZE + 1];
+    struct dc_settings_segment *other;
+
+    dc_memset(&env, name, 'a', DC_SETTINGS_SEGMENT_NAME_SIZE);
+    name[DC_SETTINGS_SEGMENT_NAME_SIZE] = '\0';
+    other = dc_settings_segment_publish(&env, &err, name, settings);
+    assert_that(other, is_null);
+    assert_that(dc_error_has_error(&err), is_true);
+}
+
+Ensure(segment, has_to_be_sealed)
+{
+    struct dc_settings_segment *attached;
+    int fd;
+
+    fd = write_segment(image, image_size, F_SEAL_SHRINK | F_SEAL_GROW);
+    attached = dc_settings_segment_attach(&env, &err, fd, "test");
+    assert_that(attached, is_null);
+    assert_that(dc_error_has_error(&err), is_true);
+    dc_error_reset(&err);
+    dc_close(&env, &err, fd);
+
+    // the copy is fine once it has all of the seals
+    fd = write_segment(image, image_size, SEALS);
+    attached = dc_settings_segment_attach(&env, &err, fd, "test");
+    assert_that(attached, is_not_null);
+    dc_settings_segment_destroy(&env, &attached);
+    dc_close(&env, &err, fd);
+}
+
+Ensure(segment, belongs_to_one_application)
+{
+    struct dc_settings_segment *attached;
+
+    attached = dc_settings_segment_attach(&env, &err, dc_settings_segment_get_fd(&env, segment), "other");
+    assert_that(attached, is_null);
+    assert_that(dc_error_has_error(&err), is_true);
+}
+
+Ensure(segment, header_is_checked)
+{
+    uint32_t magic;
+    uint32_t version;
+
+    dc_memcpy(&env, &magic, &image[MAGIC_AT], sizeof(magic));
+    dc_memcpy(&env, &version, &image[VERSION_AT], sizeof(version));
+    assert_attach_fails(image, HEADER_SIZE - 1);
+    assert_attach_fails(image, image_size - 1);
+    put32(image, MAGIC_AT, magic + 1);
+    assert_attach_fails(image, image_size);
+    put32(image, MAGIC_AT, magic);
+    put32(image, VERSION_AT, version + 1);
+    assert_attach_fails(image, image_size);
+    put32(image, VERSION_AT, version);
+    put64(image, SIZE_AT, image_size + 8);
+    assert_attach_fails(image, image_size);
+    put64(image, SIZE_AT, image_size);
+    dc_memset(&env, &image[NAME_AT], 'x', DC_SETTINGS_SEGMENT_NAME_SIZE);
+    assert_attach_fails(image, image_size);
+}
+
+Ensure(segment, offsets_are_checked)
+{
+    uint32_t count;
+    uint32_t strings_offset;
+
+    dc_memcpy(&env, &count, &image[COUNT_AT], sizeof(count));
+    dc_memcpy(&env, &strings_offset, &image[STRINGS_OFFSET_AT], sizeof(strings_offset));
+    put32(image, COUNT_AT, count + 1);
+    assert_attach_fails(image, image_size);
+    put32(image, COUNT_AT, count);
+    put32(image, ENTRIES_OFFSET_AT, HEADER_SIZE + 8);
+    assert_attach_fails(image, image_size);
+    put32(image, ENTRIES_OFFSET_AT, HEADER_SIZE);
+    put32(image, STRINGS_OFFSET_AT, strings_offset - ENTRY_SIZE);
+    assert_attach_fails(image, image_size);
+    put32(image, STRINGS_OFFSET_AT, strings_offset);
+    put32(image, STRINGS_SIZE_AT, (uint32_t)(image_size - strings_offset - 1));
+    assert_attach_fails(image, image_size);
+}
+
+Ensure(segment, strings_have_to_be_terminated)
+{
+    image[image_size - 1] = 'x';
+    assert_attach_fails(image, image_size);
+}
+
+Ensure(segment, entries_stay_inside_the_strings)
+{
+    uint32_t strings_size;
+    uint32_t value_length;
+
+    dc_memcpy(&env, &strings_size, &image[STRINGS_SIZE_AT], sizeof(strings_size));
+    dc_memcpy(&env, &value_length, &image[MESSAGE_ENTRY + ENTRY_VALUE_LENGTH_AT], sizeof(value_length));
+    put32(image, MESSAGE_ENTRY + ENTRY_NAME_OFFSET_AT, strings_size);
+    assert_attach_fails(image, image_size);
+    put32(image, MESSAGE_ENTRY + ENTRY_NAME_OFFSET_AT, 0);
+    put64(image, MESSAGE_ENTRY + ENTRY_VALUE_AT, strings_size);
+    assert_attach_fails(image, image_size);
+    put64(image, MESSAGE_ENTRY + ENTRY_VALUE_AT, UINT64_MAX);
+    assert_attach_fails(image, image_size);
+    put64(image, MESSAGE_ENTRY + ENTRY_VALUE_AT, 0);
+    put32(image, MESSAGE_ENTRY + ENTRY_VALUE_LENGTH_AT, strings_size);
+    assert_attach_fails(image, image_size);
+    put32(image, MESSAGE_ENTRY + ENTRY_VALUE_LENGTH_AT, UINT32_MAX);
+    assert_attach_fails(image, image_size);
+
+    // the value has to end on a NUL, at 0 this length lands in the middle of the setting names
+    put32(image, MESSAGE_ENTRY + ENTRY_VALUE_LENGTH_AT, value_length);
+    assert_attach_fails(image, image_size);
+}
+
+TestSuite *segment_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, segment, round_trips);
+    add_test_with_context(suite, segment, getters_check_the_kind);
+    add_test_with_context(suite, segment, without_settings);
+    add_test_with_context(suite, segment, name_has_to_fit);
+    add_test_with_context(suite, segment, has_to_be_sealed);
+    add_test_with_context(suite, segment, belongs_to_one_application);
+    add_test_with_context(suite, segment, header_is_checked);
+    add_test_with_context(suite, segment, offsets_are_checked);
+    add_test_with_context(suite, segment, strings_have_to_be_terminated);
+    add_test_with_context(suite, segment, entries_stay_inside_the_strings);
+
+    return suite;
+}
+
+static int write_segment(const unsigned char *bytes, size_t size, int seals)
+{
+    int fd;
+
+    fd = memfd_create("dc_settings_test", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    dc_write(&env, &err, fd, bytes, size);
+    dc_fcntl(&env, &err, fd, F_ADD_SEALS, seals);
+
+    return fd;
+}
+
+static void put32(unsigned char *bytes, size_t at, uint32_t value)
+{
+    dc_memcpy(&env, &bytes[at], &value, sizeof(value));
+}
+
+static void put64(unsigned char *bytes, size_t at, uint64_t value)
+{
+    dc_memcpy(&env, &bytes[at], &value, sizeof(value));
+}
+
+static void assert_attach_fails(const unsigned char *bytes, size_t size)
+{
+    struct dc_settings_segment *attached;
+    struct dc_error local_err;
+    int fd;
+
+    dc_error_init(&local_err, NULL);
+    fd = write_segment(bytes, size, SEALS);
+    attached = dc_settings_segment_attach(&env, &local_err, fd, "test");
+    assert_that(attached, is_null);
+    assert_that(dc_error_has_error(&local_err), is_true);
+    dc_error_reset(&local_err);
+    dc_close(&env, &local_err, fd);
+    dc_error_reset(&local_err);
+}
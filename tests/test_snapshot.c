@@ -0,0 +1,141 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "test_schema.h"
+#include "dc_application/schema.h"
+#include <dc_c/dc_string.h>
+#include <pthread.h>
+
+
+DC_SCHEMA_STRUCT(snapshot_settings, TEST_SCHEMA)
+DC_SCHEMA_DEFINE(snapshot_settings, TEST_SCHEMA, "TEST_")
+
+
+static void update_message(const char *message);
+static void *hold_snapshot(void *arg);
+
+
+Describe(snapshot);
+
+static struct dc_env test_env;
+static struct dc_error test_err;
+static struct dc_application_settings *application_settings;
+static struct snapshot_settings *settings;
+static pthread_barrier_t barrier;
+static char held_value[16];
+static char quiesced_value[16];
+
+BeforeEach(snapshot)
+{
+    dc_env_init(&test_env, NULL);
+    dc_error_init(&test_err, NULL);
+    application_settings = snapshot_settings_create(&test_env, &test_err);
+    assert_that(application_settings, is_not_null);
+    settings = (struct snapshot_settings *)application_settings;
+}
+
+AfterEach(snapshot)
+{
+    dc_settings_offline(&test_env);
+    snapshot_settings_destroy(&test_env, &test_err, &application_settings);
+    dc_error_reset(&test_err);
+}
+
+Ensure(snapshot, reads_follow_quiesce)
+{
+    uint64_t generation;
+
+    update_message("one");
+    generation = dc_settings_get_generation(&test_env);
+    dc_settings_quiesce(&test_env, &test_err);
+    assert_that(dc_setting_string_get(&test_env, settings->message), is_equal_to_string("one"));
+
+    // the thread keeps reading its snapshot until it quiesces again
+    update_message("two");
+    assert_that(dc_settings_get_generation(&test_env), is_equal_to(generation + 1));
+    assert_that(dc_setting_string_get(&test_env, settings->message), is_equal_to_string("one"));
+    dc_settings_quiesce(&test_env, &test_err);
+    assert_that(dc_setting_string_get(&test_env, settings->message), is_equal_to_string("two"));
+
+    // offline reads go straight to the setting
+    dc_settings_offline(&test_env);
+    update_message("three");
+    assert_that(dc_setting_string_get(&test_env, settings->message), is_equal_to_string("three"));
+}
+
+Ensure(snapshot, replaced_values_outlive_readers)
+{
+    pthread_t thread;
+
+    update_message("one");
+    pthread_barrier_init(&barrier, NULL, 2);
+    pthread_create(&thread, NULL, hold_snapshot, NULL);
+
+    // the reader has quiesced and holds on to "one" while it is replaced twice
+    pthread_barrier_wait(&barrier);
+    update_message("two");
+    update_message("three");
+    pthread_barrier_wait(&barrier);
+
+    pthread_join(thread, NULL);
+    pthread_barrier_destroy(&barrier);
+    assert_that(held_value, is_equal_to_string("one"));
+    assert_that(quiesced_value, is_equal_to_string("three"));
+}
+
+TestSuite *snapshot_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, snapshot, reads_follow_quiesce);
+    add_test_with_context(suite, snapshot, replaced_values_outlive_readers);
+
+    return suite;
+}
+
+static void update_message(const char *message)
+{
+    dc_settings_transaction_begin(&test_env);
+    dc_setting_update(&test_env, &test_err, (struct dc_setting *)settings->message, message, DC_SETTING_RUNTIME);
+    dc_settings_transaction_commit(&test_env, &test_err);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static void *hold_snapshot(void *arg)
+{
+    struct dc_error local_err;
+    const char *held;
+
+    dc_error_init(&local_err, NULL);
+    dc_settings_quiesce(&test_env, &local_err);
+    held = dc_setting_string_get(&test_env, settings->message);
+    pthread_barrier_wait(&barrier);
+    pthread_barrier_wait(&barrier);
+
+    // still the value of the snapshot the thread is on, and not freed since the thread has not quiesced
+    dc_strcpy(&test_env, held_value, held);
+    dc_settings_quiesce(&test_env, &local_err);
+    dc_strcpy(&test_env, quiesced_value, dc_setting_string_get(&test_env, settings->message));
+    dc_settings_offline(&test_env);
+
+    return NULL;
+}
+#pragma GCC diagnostic pop
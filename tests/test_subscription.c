@@ -0,0 +1,196 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "test_schema.h"
+#include "dc_application/schema.h"
+#include <dc_c/dc_string.h>
+#include <poll.h>
+
+
+DC_SCHEMA_STRUCT(subscription_settings, TEST_SCHEMA)
+DC_SCHEMA_DEFINE(subscription_settings, TEST_SCHEMA, "TEST_")
+
+
+struct calls
+{
+    size_t count;
+    size_t last_count;
+    struct dc_setting *last[4];
+};
+
+
+static void changed(const struct dc_env *env, struct dc_setting *const *changed_settings, size_t count, void *ctx);
+static void update_message(const char *message);
+static bool is_readable(int fd);
+
+
+Describe(subscription);
+
+static struct dc_env test_env;
+static struct dc_error test_err;
+static struct dc_application_settings *application_settings;
+static struct subscription_settings *settings;
+static struct calls calls;
+
+BeforeEach(subscription)
+{
+    dc_env_init(&test_env, NULL);
+    dc_error_init(&test_err, NULL);
+    application_settings = subscription_settings_create(&test_env, &test_err);
+    assert_that(application_settings, is_not_null);
+    settings = (struct subscription_settings *)application_settings;
+    dc_memset(&test_env, &calls, 0, sizeof(calls));
+}
+
+AfterEach(subscription)
+{
+    subscription_settings_destroy(&test_env, &test_err, &application_settings);
+    dc_error_reset(&test_err);
+}
+
+Ensure(subscription, one_call_per_transaction)
+{
+    struct dc_setting_subscription *message_subscription;
+    struct dc_setting_subscription *workers_subscription;
+    uint16_t workers;
+
+    message_subscription = dc_setting_subscribe(&test_env, &test_err, (struct dc_setting *)settings->message, changed, &calls);
+    workers_subscription = dc_setting_subscribe(&test_env, &test_err, (struct dc_setting *)settings->workers, changed, &calls);
+    assert_that(message_subscription, is_not_null);
+    assert_that(workers_subscription, is_not_null);
+
+    workers = 8;
+    dc_settings_transaction_begin(&test_env);
+    dc_setting_update(&test_env, &test_err, (struct dc_setting *)settings->message, "Hello", DC_SETTING_RUNTIME);
+    dc_setting_update(&test_env, &test_err, (struct dc_setting *)settings->workers, &workers, DC_SETTING_RUNTIME);
+    dc_setting_update(&test_env, &test_err, (struct dc_setting *)settings->message, "Goodbye", DC_SETTING_RUNTIME);
+    assert_that(calls.count, is_equal_to(0));
+    dc_settings_transaction_commit(&test_env, &test_err);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+    assert_that(calls.count, is_equal_to(1));
+    assert_that(calls.last_count, is_equal_to(2));
+    assert_that(calls.last[0] == (struct dc_setting *)settings->message || calls.last[1] == (struct dc_setting *)settings->message, is_true);
+    assert_that(calls.last[0] == (struct dc_setting *)settings->workers || calls.last[1] == (struct dc_setting *)settings->workers, is_true);
+
+    dc_setting_unsubscribe(&test_env, &message_subscription);
+    dc_setting_unsubscribe(&test_env, &workers_subscription);
+    assert_that(message_subscription, is_null);
+}
+
+Ensure(subscription, only_changes_are_delivered)
+{
+    struct dc_setting_subscription *subscription;
+    bool verbose;
+
+    subscription = dc_setting_subscribe(&test_env, &test_err, (struct dc_setting *)settings->message, changed, &calls);
+    update_message("Hello");
+    assert_that(calls.count, is_equal_to(1));
+
+    // the same value at the same type is not a change
+    update_message("Hello");
+    assert_that(calls.count, is_equal_to(1));
+
+    // neither is a setting nobody subscribed to
+    verbose = true;
+    dc_settings_transaction_begin(&test_env);
+    dc_setting_update(&test_env, &test_err, (struct dc_setting *)settings->verbose, &verbose, DC_SETTING_RUNTIME);
+    dc_settings_transaction_commit(&test_env, &test_err);
+    assert_that(calls.count, is_equal_to(1));
+
+    dc_setting_unsubscribe(&test_env, &subscription);
+    update_message("Goodbye");
+    assert_that(calls.count, is_equal_to(1));
+}
+
+Ensure(subscription, notifier_coalesces_until_dispatch)
+{
+    struct dc_settings_notifier *notifier;
+    struct dc_setting_subscription *subscription;
+    int fd;
+
+    notifier = dc_settings_notifier_create(&test_env, &test_err);
+    assert_that(notifier, is_not_null);
+    fd = dc_settings_notifier_get_fd(&test_env, notifier);
+    subscription = dc_setting_subscribe_on(&test_env, &test_err, (struct dc_setting *)settings->message, changed, &calls, notifier);
+    assert_that(is_readable(fd), is_false);
+
+    update_message("one");
+    update_message("two");
+    update_message("three");
+    assert_that(calls.count, is_equal_to(0));
+    assert_that(is_readable(fd), is_true);
+
+    assert_that(dc_settings_notifier_dispatch(&test_env, notifier), is_equal_to(1));
+    assert_that(calls.count, is_equal_to(1));
+    assert_that(calls.last_count, is_equal_to(1));
+    assert_that(calls.last[0] == (struct dc_setting *)settings->message, is_true);
+    assert_that(is_readable(fd), is_false);
+    assert_that(dc_settings_notifier_dispatch(&test_env, notifier), is_equal_to(0));
+
+    dc_setting_unsubscribe(&test_env, &subscription);
+    dc_settings_notifier_destroy(&test_env, &notifier);
+    assert_that(notifier, is_null);
+}
+
+TestSuite *subscription_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, subscription, one_call_per_transaction);
+    add_test_with_context(suite, subscription, only_changes_are_delivered);
+    add_test_with_context(suite, subscription, notifier_coalesces_until_dispatch);
+
+    return suite;
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static void changed(const struct dc_env *env, struct dc_setting *const *changed_settings, size_t count, void *ctx)
+{
+    struct calls *recorded;
+
+    recorded = ctx;
+    recorded->count++;
+    recorded->last_count = count;
+
+    for(size_t i = 0; i < count && i < sizeof(recorded->last) / sizeof(recorded->last[0]); i++)
+    {
+        recorded->last[i] = changed_settings[i];
+    }
+}
+#pragma GCC diagnostic pop
+
+static void update_message(const char *message)
+{
+    dc_settings_transaction_begin(&test_env);
+    dc_setting_update(&test_env, &test_err, (struct dc_setting *)settings->message, message, DC_SETTING_RUNTIME);
+    dc_settings_transaction_commit(&test_env, &test_err);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+}
+
+static bool is_readable(int fd)
+{
+    struct pollfd descriptor;
+
+    descriptor.fd = fd;
+    descriptor.events = POLLIN;
+    descriptor.revents = 0;
+
+    return poll(&descriptor, 1, 0) == 1;
+}
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "dc_application/application.h"
+#include "dc_application/command_line.h"
+#include "dc_application/config.h"
+#include "dc_application/defaults.h"
+#include "dc_application/options.h"
+#include "dc_application/warmup.h"
+#include <dc_c/dc_stdlib.h>
+#include <dc_c/dc_string.h>
+#include <dc_posix/dc_stdlib.h>
+#include <dc_posix/dc_unistd.h>
+#include <getopt.h>
+
+
+struct hand_built_settings
+{
+    struct dc_opt_settings opts;
+    struct dc_setting_bool *prefault;
+};
+
+
+static struct dc_application_settings *create_hand_built_settings(const struct dc_env *env, struct dc_error *err);
+static int destroy_hand_built_settings(const struct dc_env *env, struct dc_error *err, struct dc_application_settings **psettings);
+static int run(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings);
+
+
+Describe(warmup);
+
+static struct dc_env test_env;
+static struct dc_error test_err;
+static bool prefault_kept;
+static bool lock_memory_cleared;
+
+BeforeEach(warmup)
+{
+    dc_env_init(&test_env, NULL);
+    dc_error_init(&test_err, NULL);
+}
+
+AfterEach(warmup)
+{
+    dc_error_reset(&test_err);
+}
+
+Ensure(warmup, prefault_and_file)
+{
+    char path[] = "/tmp/dc_application_testXXXXXX";
+    char *region;
+    int fd;
+
+    region = dc_malloc(&test_env, &test_err, 3 * 4096);
+    dc_warmup_prefault(&test_env, &test_err, region, 3 * 4096);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+    dc_free(&test_env, region);
+
+    fd = dc_mkstemp(&test_env, &test_err, path);
+    dc_write(&test_env, &test_err, fd, "warm", 4);
+    dc_close(&test_env, &test_err, fd);
+    dc_warmup_file(&test_env, &test_err, path);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+    dc_unlink(&test_env, &test_err, path);
+
+    dc_warmup_file(&test_env, &test_err, "/nonexistent/dc_application_test");
+    assert_that(dc_error_has_error(&test_err), is_true);
+}
+
+Ensure(warmup, hand_built_tables_keep_their_settings)
+{
+    struct dc_application_info *info;
+    char name[] = "test";
+    char *argv[] = {name, NULL};
+
+    prefault_kept = false;
+    lock_memory_cleared = false;
+    info = dc_application_info_create(&test_env, &test_err, "Test Application");
+    dc_application_run(&test_env, &test_err, info, create_hand_built_settings, destroy_hand_built_settings, run, dc_default_create_lifecycle, dc_default_destroy_lifecycle, NULL, 1, argv);
+    dc_application_info_destroy(&test_env, &info);
+    assert_that(dc_error_has_no_error(&test_err), is_true);
+    assert_that(prefault_kept, is_true);
+    assert_that(lock_memory_cleared, is_true);
+}
+
+TestSuite *warmup_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, warmup, prefault_and_file);
+    add_test_with_context(suite, warmup, hand_built_tables_keep_their_settings);
+
+    return suite;
+}
+
+// built the way applications did before the schema, the options point at the settings and the struct is not cleared
+static struct dc_application_settings *create_hand_built_settings(const struct dc_env *env, struct dc_error *err)
+{
+    static const bool default_prefault = true;
+    struct hand_built_settings *settings;
+
+    settings = dc_malloc(env, err, sizeof(struct hand_built_settings));
+
+    if(settings == NULL)
+    {
+        return NULL;
+    }
+
+    dc_memset(env, settings, 0xA5, sizeof(struct hand_built_settings));
+    settings->opts.parent.config_path = dc_setting_path_create(env, err);
+    settings->prefault = dc_setting_bool_create(env, err);
+    settings->opts.parent.prefault = settings->prefault;
+
+    struct options opts[] = {
+            {(struct dc_setting *)settings->opts.parent.config_path,
+                    dc_options_set_path,
+                    "config",
+                    required_argument,
+                    'c',
+                    "CONFIG",
+                    dc_string_from_string,
+                    NULL,
+                    dc_string_from_config,
+                    NULL,
+                    NULL,
+                    NULL,
+                    0},
+            {(struct dc_setting *)settings->prefault,
+                    dc_options_set_bool,
+                    "prefault",
+                    no_argument,
+                    'p',
+                    "PREFAULT",
+                    dc_flag_from_string,
+                    "prefault",
+                    dc_flag_from_config,
+                    &default_prefault,
+                    NULL,
+                    NULL,
+                    0},
+    };
+
+    // note the trick here - we use calloc and add 1 to ensure the last line is all 0/NULL
+    settings->opts.opts_count = (sizeof(opts) / sizeof(struct options)) + 1;
+    settings->opts.opts_size = sizeof(struct options);
+    settings->opts.opts = dc_calloc(env, err, settings->opts.opts_count, settings->opts.opts_size);
+    dc_memcpy(env, (void *)(uintptr_t)settings->opts.opts, opts, sizeof(opts));
+    settings->opts.flags = "c:p";
+    settings->opts.env_prefix = "DC_WARMUP_TEST_";
+    settings->opts.name_index = NULL;
+    settings->opts.env_index = NULL;
+    settings->opts.config_index = NULL;
+    settings->opts.response_files = NULL;
+
+    return (struct dc_application_settings *)settings;
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int destroy_hand_built_settings(const struct dc_env *env, struct dc_error *err, struct dc_application_settings **psettings)
+{
+    struct hand_built_settings *settings;
+
+    settings = (struct hand_built_settings *)*psettings;
+    // the library destroys config_path
+    dc_setting_bool_destroy(env, &settings->prefault);
+    dc_free(env, (void *)(uintptr_t)settings->opts.opts);
+    dc_free(env, settings);
+    *psettings = NULL;
+
+    return 0;
+}
+#pragma GCC diagnostic pop
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+static int run(const struct dc_env *env, struct dc_error *err, struct dc_application_settings *settings)
+{
+    struct hand_built_settings *hand_built;
+
+    hand_built = (struct hand_built_settings *)settings;
+    prefault_kept = settings->prefault == hand_built->prefault && dc_setting_bool_get(env, settings->prefault);
+    lock_memory_cleared = settings->lock_memory == NULL && settings->warmup_files == NULL && settings->cpuset == NULL;
+
+    return 0;
+}
+#pragma GCC diagnostic pop
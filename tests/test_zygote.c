@@ -0,0 +1,175 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "tests.h"
+#include "test_schema.h"
+#include "dc_application/schema.h"
+#include "dc_application/zygote.h"
+#include <dc_c/dc_string.h>
+#include <dc_posix/dc_unistd.h>
+#include <dc_posix/sys/dc_wait.h>
+#include <time.h>
+
+
+DC_SCHEMA_STRUCT(zygote_settings, TEST_SCHEMA)
+DC_SCHEMA_DEFINE(zygote_settings, TEST_SCHEMA, "TEST_")
+
+
+// the socket directory is created owner only on first use
+#define SOCKET_PATH "/tmp/dc_application_test_zygote/zygote.sock"
+
+
+static pid_t start_zygote(void);
+static int spawn(char *const argv[], char *const envp[], const int fds[DC_ZYGOTE_MAX_FDS], pid_t *pid);
+
+
+Describe(zygote);
+
+static struct dc_env env;
+static struct dc_error err;
+
+BeforeEach(zygote)
+{
+    dc_env_init(&env, NULL);
+    dc_error_init(&err, NULL);
+}
+
+AfterEach(zygote)
+{
+    dc_error_reset(&err);
+}
+
+Ensure(zygote, child_gets_the_request_settings_and_descriptors)
+{
+    char program[] = "prog";
+    char message_option[] = "--message";
+    char message[] = "Bye";
+    char workers[] = "TEST_WORKERS=9";
+    char *argv[] = {program, message_option, message, NULL};
+    char *envp[] = {workers, NULL};
+    char output[8];
+    int output_fds[2];
+    int fds[DC_ZYGOTE_MAX_FDS];
+    pid_t zygote;
+    pid_t child;
+    ssize_t count;
+    int connection;
+    int status;
+
+    zygote = start_zygote();
+    dc_pipe(&env, &err, output_fds);
+    fds[0] = -1;
+    fds[1] = output_fds[1];
+    fds[2] = -1;
+    child = 0;
+    connection = spawn(argv, envp, fds, &child);
+    dc_close(&env, &err, output_fds[1]);
+    assert_that(connection, is_greater_than(-1));
+    assert_that(child, is_greater_than(0));
+    assert_that(child == zygote, is_false);
+
+    status = -1;
+    assert_that(dc_zygote_wait(&env, &err, connection, &status), is_true);
+    assert_that(status, is_equal_to(109));
+
+    // the child's standard output was the pipe
+    count = dc_read(&env, &err, output_fds[0], output, sizeof(output) - 1);
+    assert_that(count, is_equal_to(3));
+    output[count > 0 ? count : 0] = '\0';
+    assert_that(output, is_equal_to_string("Bye"));
+    dc_close(&env, &err, output_fds[0]);
+
+    dc_zygote_stop(&env, &err, SOCKET_PATH);
+    assert_that(dc_waitpid(&env, &err, zygote, &status, 0), is_equal_to(zygote));
+    assert_that(WIFEXITED(status) && WEXITSTATUS(status) == 0, is_true);
+}
+
+TestSuite *zygote_tests(void)
+{
+    TestSuite *suite;
+
+    suite = create_test_suite();
+    add_test_with_context(suite, zygote, child_gets_the_request_settings_and_descriptors);
+
+    return suite;
+}
+
+// the zygote answers in a child of its own with workers plus 100 if the message is Bye, and prints the message
+static pid_t start_zygote(void)
+{
+    struct dc_application_settings *settings;
+    struct dc_zygote_request *request;
+    struct zygote_settings *zygote_settings;
+    const char *message;
+    int status;
+    pid_t pid;
+
+    pid = dc_fork(&env, &err);
+
+    if(pid != 0)
+    {
+        return pid;
+    }
+
+    settings = zygote_settings_create(&env, &err);
+    request = dc_zygote_serve(&env, &err, settings, SOCKET_PATH);
+
+    if(request == NULL)
+    {
+        status = dc_error_has_error(&err) ? 1 : 0;
+        zygote_settings_destroy(&env, &err, &settings);
+        _exit(status);
+    }
+
+    zygote_settings = (struct zygote_settings *)settings;
+    message = dc_setting_string_get(&env, zygote_settings->message);
+    status = dc_setting_uint16_get(&env, zygote_settings->workers);
+
+    if(message && dc_strcmp(&env, message, "Bye") == 0)
+    {
+        status += 100;
+    }
+
+    dc_write(&env, &err, STDOUT_FILENO, message, dc_strlen(&env, message));
+    dc_zygote_request_reply(&env, request, dc_error_has_error(&err) ? -1 : status);
+    zygote_settings_destroy(&env, &err, &settings);
+    dc_zygote_request_destroy(&env, &request);
+    _exit(0);
+}
+
+static int spawn(char *const argv[], char *const envp[], const int fds[DC_ZYGOTE_MAX_FDS], pid_t *pid)
+{
+    // the zygote may not be listening yet
+    for(int attempt = 0; attempt < 200; attempt++)
+    {
+        struct dc_error local_err;
+        int fd;
+
+        dc_error_init(&local_err, NULL);
+        fd = dc_zygote_spawn(&env, &local_err, SOCKET_PATH, argv, envp, fds, pid);
+
+        if(dc_error_has_no_error(&local_err))
+        {
+            return fd;
+        }
+
+        dc_error_reset(&local_err);
+        nanosleep(&(struct timespec){0, 10000000}, NULL);
+    }
+
+    return -1;
+}
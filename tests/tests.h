@@ -5,4 +5,26 @@
 #include <cgreen/cgreen.h>
 
 
+TestSuite *affinity_tests(void);
+TestSuite *allocator_tests(void);
+TestSuite *application_tests(void);
+TestSuite *command_line_tests(void);
+TestSuite *component_tests(void);
+TestSuite *config_load_tests(void);
+TestSuite *control_tests(void);
+TestSuite *intern_tests(void);
+TestSuite *list_tests(void);
+TestSuite *matcher_tests(void);
+TestSuite *memory_tests(void);
+TestSuite *notify_tests(void);
+TestSuite *parse_tests(void);
+TestSuite *provider_tests(void);
+TestSuite *schema_index_tests(void);
+TestSuite *segment_tests(void);
+TestSuite *snapshot_tests(void);
+TestSuite *subscription_tests(void);
+TestSuite *warmup_tests(void);
+TestSuite *zygote_tests(void);
+
+
 #endif // LIBDC_POSIX_TESTS_H
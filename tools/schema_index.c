@@ -0,0 +1,411 @@
+/*
+ * Copyright 2021-2022 D'Arcy Smith.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+/*
+ * Writes the perfect hash indexes for a schema. It is compiled once per schema with:
+ *  - DC_SCHEMA_HEADER: the quoted header that defines the schema macro
+ *  - DC_SCHEMA: the schema macro
+ *  - DC_SCHEMA_NAME: the name given to DC_SCHEMA_DEFINE_INDEXED
+ * and run with the path of the header to write. dc_application_schema_index in cmake/DcApplicationSchema.cmake does
+ * all of that.
+ *
+ * It only runs at build time, so it uses the C library directly instead of going through dc_env.
+ */
+
+
+#include "dc_application/schema.h"
+#include DC_SCHEMA_HEADER
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define STRINGIFY_VALUE(x) #x
+#define STRINGIFY(x) STRINGIFY_VALUE(x)
+
+
+typedef enum
+{
+    KEY_NAME,
+    KEY_ENV,
+    KEY_CONFIG,
+} key_field;
+
+struct bucket
+{
+    size_t index;
+    size_t count;
+    size_t *keys;
+};
+
+struct index_work
+{
+    uint64_t *hashes;
+    size_t *occupant;
+    uint32_t *displacements;
+    struct bucket *buckets;
+    size_t *bucket_keys;
+    size_t count;
+};
+
+
+static const char *key_of(size_t position, key_field field);
+static int build_index(FILE *out, const char *field_name, key_field field);
+static int fill_index(struct index_work *work, const char *field_name, key_field field);
+static void write_index(FILE *out, const struct index_work *work, const char *field_name);
+static int check_key(const char *key, key_field field);
+static int place_bucket(const struct bucket *bucket, const uint64_t *hashes, size_t slot_count, const size_t *occupant, uint32_t *displacement);
+static int compare_buckets(const void *a, const void *b);
+
+
+static const struct dc_schema_keys keys[] =
+{
+    DC_SCHEMA(DC_SCHEMA_KEYS, DC_SCHEMA_NAME)
+};
+
+static const size_t key_count = sizeof(keys) / sizeof(keys[0]);
+
+
+int main(int argc, char *argv[])
+{
+    FILE *out;
+    int ret_val;
+
+    if(argc != 2)
+    {
+        fprintf(stderr, "usage: %s <output header>\n", argv[0]);        // NOLINT(cert-err33-c)
+
+        return EXIT_FAILURE;
+    }
+
+    // the slots are uint16_t and the sentinel entry follows the options
+    if(key_count >= UINT16_MAX)
+    {
+        fprintf(stderr, "%s: too many options\n", argv[0]);             // NOLINT(cert-err33-c)
+
+        return EXIT_FAILURE;
+    }
+
+    out = fopen(argv[1], "w");
+
+    if(out == NULL)
+    {
+        perror(argv[1]);
+
+        return EXIT_FAILURE;
+    }
+
+    fprintf(out, "// generated by schema_index from %s, do not edit\n\n", DC_SCHEMA_HEADER);  // NOLINT(cert-err33-c)
+    ret_val = build_index(out, "name", KEY_NAME);
+
+    if(ret_val == 0)
+    {
+        ret_val = build_index(out, "env", KEY_ENV);
+    }
+
+    if(ret_val == 0)
+    {
+        ret_val = build_index(out, "config", KEY_CONFIG);
+    }
+
+    if(fclose(out) != 0)
+    {
+        perror(argv[1]);
+        ret_val = -1;
+    }
+
+    if(ret_val != 0)
+    {
+        remove(argv[1]);                                                  // NOLINT(cert-err33-c)
+
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+static const char *key_of(size_t position, key_field field)
+{
+    const char *key;
+
+    switch(field)
+    {
+        case KEY_ENV:
+        {
+            key = keys[position].env_key;
+            break;
+        }
+        case KEY_CONFIG:
+        {
+            key = keys[position].config_key;
+            break;
+        }
+        case KEY_NAME:
+        default:
+        {
+            key = keys[position].name;
+        }
+    }
+
+    return key;
+}
+
+static int build_index(FILE *out, const char *field_name, key_field field)
+{
+    struct index_work work;
+    int ret_val;
+
+    work.hashes = calloc(key_count + 1, sizeof(uint64_t));
+    work.occupant = calloc(key_count + 1, sizeof(size_t));
+    work.displacements = calloc(key_count + 1, sizeof(uint32_t));
+    work.buckets = calloc(key_count + 1, sizeof(struct bucket));
+    work.bucket_keys = calloc(key_count + 1, sizeof(size_t));
+    work.count = 0;
+
+    if(work.hashes == NULL || work.occupant == NULL || work.displacements == NULL || work.buckets == NULL ||
+       work.bucket_keys == NULL)
+    {
+        perror("schema_index");
+        ret_val = -1;
+    }
+    else
+    {
+        ret_val = fill_index(&work, field_name, field);
+    }
+
+    if(ret_val == 0)
+    {
+        write_index(out, &work, field_name);
+    }
+
+    free(work.bucket_keys);
+    free(work.buckets);
+    free(work.displacements);
+    free(work.occupant);
+    free(work.hashes);
+
+    return ret_val;
+}
+
+/*
+ * Hash and displace: the keys are split into as many buckets as there are options, and starting with the biggest
+ * bucket each one gets the first displacement that puts all of its keys in free slots. With a bucket per option the
+ * buckets are small and the search ends quickly.
+ */
+static int fill_index(struct index_work *work, const char *field_name, key_field field)
+{
+    size_t next;
+
+    for(size_t i = 0; i < key_count; i++)
+    {
+        const char *key;
+
+        key = key_of(i, field);
+
+        if(key == NULL)
+        {
+            continue;
+        }
+
+        if(check_key(key, field) != 0)
+        {
+            return -1;
+        }
+
+        for(size_t j = 0; j < i; j++)
+        {
+            const char *other;
+
+            other = key_of(j, field);
+
+            if(other && strcmp(key, other) == 0)
+            {
+                fprintf(stderr, "schema_index: %s key \"%s\" is used more than once\n", field_name, key);  // NOLINT(cert-err33-c)
+
+                return -1;
+            }
+        }
+
+        work->hashes[i] = dc_options_hash(key, strlen(key));
+        work->buckets[dc_options_hash_bucket(work->hashes[i], key_count)].count++;
+        work->count++;
+    }
+
+    // lay the keys of each bucket out next to each other
+    next = 0;
+
+    for(size_t i = 0; i < key_count; i++)
+    {
+        work->buckets[i].index = i;
+        work->buckets[i].keys = &work->bucket_keys[next];
+        next += work->buckets[i].count;
+        work->buckets[i].count = 0;
+    }
+
+    for(size_t i = 0; i < key_count; i++)
+    {
+        if(key_of(i, field))
+        {
+            struct bucket *bucket;
+
+            bucket = &work->buckets[dc_options_hash_bucket(work->hashes[i], key_count)];
+            bucket->keys[bucket->count++] = i;
+        }
+    }
+
+    qsort(work->buckets, key_count, sizeof(struct bucket), compare_buckets);
+
+    // occupant holds the table position + 1 so that 0 is a free slot
+    for(size_t i = 0; i < key_count && work->buckets[i].count > 0; i++)
+    {
+        const struct bucket *bucket;
+        uint32_t displacement;
+
+        bucket = &work->buckets[i];
+
+        if(place_bucket(bucket, work->hashes, work->count, work->occupant, &displacement) != 0)
+        {
+            fprintf(stderr, "schema_index: no displacement found for the %s keys\n", field_name);  // NOLINT(cert-err33-c)
+
+            return -1;
+        }
+
+        work->displacements[bucket->index] = displacement;
+
+        for(size_t j = 0; j < bucket->count; j++)
+        {
+            work->occupant[dc_options_hash_slot(work->hashes[bucket->keys[j]], displacement, work->count)] = bucket->keys[j] + 1;
+        }
+    }
+
+    return 0;
+}
+
+static void write_index(FILE *out, const struct index_work *work, const char *field_name)
+{
+    const char *name;
+    size_t bucket_count;
+
+    name = STRINGIFY(DC_SCHEMA_NAME);
+    bucket_count = key_count ? key_count : 1;
+
+    // an empty index still needs an element in each array, slot_count 0 tells the lookup not to use them
+    fprintf(out, "static const uint32_t %s_%s_displacements[] =\n{\n", name, field_name);  // NOLINT(cert-err33-c)
+
+    for(size_t i = 0; i < bucket_count; i++)
+    {
+        fprintf(out, "    UINT32_C(%lu),\n", (unsigned long)work->displacements[i]);  // NOLINT(cert-err33-c)
+    }
+
+    fprintf(out, "};\n\nstatic const uint16_t %s_%s_slots[] =\n{\n", name, field_name);  // NOLINT(cert-err33-c)
+
+    for(size_t i = 0; i < (work->count ? work->count : 1); i++)
+    {
+        fprintf(out, "    %zu,\n", work->count ? work->occupant[i] - 1 : 0);  // NOLINT(cert-err33-c)
+    }
+
+    fprintf(out, "};\n\nstatic const struct dc_options_index %s_%s_index =\n{\n", name, field_name);  // NOLINT(cert-err33-c)
+    fprintf(out, "    %zu,\n    %zu,\n", work->count, bucket_count);  // NOLINT(cert-err33-c)
+    fprintf(out, "    %s_%s_displacements,\n    %s_%s_slots,\n};\n\n", name, field_name, name, field_name);  // NOLINT(cert-err33-c)
+}
+
+static int check_key(const char *key, key_field field)
+{
+    if(field != KEY_CONFIG)
+    {
+        return 0;
+    }
+
+    // the config loader builds the path it looks up with '.' between the groups in a fixed size buffer
+    if(strlen(key) >= DC_OPTIONS_MAX_CONFIG_KEY)
+    {
+        fprintf(stderr, "schema_index: config key \"%s\" is longer than %d\n", key, DC_OPTIONS_MAX_CONFIG_KEY - 1);  // NOLINT(cert-err33-c)
+
+        return -1;
+    }
+
+    if(strpbrk(key, "/:") != NULL)
+    {
+        fprintf(stderr, "schema_index: config key \"%s\" has to use '.' between the groups\n", key);  // NOLINT(cert-err33-c)
+
+        return -1;
+    }
+
+    return 0;
+}
+
+static int place_bucket(const struct bucket *bucket, const uint64_t *hashes, size_t slot_count, const size_t *occupant, uint32_t *displacement)
+{
+    for(uint32_t d = 0; d < UINT32_MAX; d++)
+    {
+        size_t j;
+
+        for(j = 0; j < bucket->count; j++)
+        {
+            size_t slot;
+
+            slot = dc_options_hash_slot(hashes[bucket->keys[j]], d, slot_count);
+
+            if(occupant[slot] != 0)
+            {
+                break;
+            }
+
+            // two keys of the same bucket cannot share a slot either
+            for(size_t k = 0; k < j; k++)
+            {
+                if(dc_options_hash_slot(hashes[bucket->keys[k]], d, slot_count) == slot)
+                {
+                    slot = SIZE_MAX;
+                    break;
+                }
+            }
+
+            if(slot == SIZE_MAX)
+            {
+                break;
+            }
+        }
+
+        if(j == bucket->count)
+        {
+            *displacement = d;
+
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+// biggest first, the big buckets are the hard ones to place
+static int compare_buckets(const void *a, const void *b)
+{
+    const struct bucket *bucket_a;
+    const struct bucket *bucket_b;
+
+    bucket_a = a;
+    bucket_b = b;
+
+    if(bucket_a->count != bucket_b->count)
+    {
+        return bucket_a->count < bucket_b->count ? 1 : -1;
+    }
+
+    return bucket_a->index < bucket_b->index ? -1 : (bucket_a->index > bucket_b->index);
+}